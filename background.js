@@ -89,6 +89,37 @@ class CryptoMonitorBackend {
 
 const backend = new CryptoMonitorBackend();
 
+// The WASM monitor runs in a worker owned by an offscreen document, since
+// service workers cannot start workers; see src/offscreen/monitor_host.js
+let creatingMonitorHost = null;
+
+async function ensureMonitorHost() {
+    const contexts = await chrome.runtime.getContexts({ contextTypes: ['OFFSCREEN_DOCUMENT'] });
+    if (contexts.length > 0) return;
+    if (!creatingMonitorHost) {
+        creatingMonitorHost = chrome.offscreen.createDocument({
+            url: 'monitor_host.html',
+            reasons: ['WORKERS'],
+            justification: 'Hosts the WASM crypto monitor in a dedicated worker'
+        }).finally(() => { creatingMonitorHost = null; });
+    }
+    await creatingMonitorHost;
+}
+
+async function forwardToMonitorHost(message) {
+    await ensureMonitorHost();
+    const response = await chrome.runtime.sendMessage({ ...message, target: 'monitor-host' });
+    if (response && response.error) throw new Error(response.error);
+    return response ? response.result : undefined;
+}
+
+// Content scripts run next to untrusted pages, so they may only submit
+// event batches; monitor queries need one of the extension's own pages
+const fromThisExtension = (sender) => sender.id === chrome.runtime.id;
+const fromExtensionPage = (sender) =>
+    fromThisExtension(sender) && !sender.tab &&
+    String(sender.url).startsWith(chrome.runtime.getURL(''));
+
 chrome.runtime.onMessage.addListener((request, sender, sendResponse) => {
     const handleError = (error) => {
         console.error('Operation failed:', error);
@@ -109,6 +140,47 @@ chrome.runtime.onMessage.addListener((request, sender, sendResponse) => {
                     .catch(handleError);
                 break;
 
+            case 'recordEvents':
+                // Batches from the WebCrypto content scripts
+                if (!fromThisExtension(sender)) {
+                    sendResponse({ error: 'Not permitted' });
+                    break;
+                }
+                forwardToMonitorHost({
+                    action: 'recordEvents',
+                    count: request.count,
+                    timeOrigin: request.timeOrigin,
+                    events: request.events
+                })
+                    .then(merged => sendResponse({ status: 'recorded', merged }))
+                    .catch(handleError);
+                break;
+
+            case 'researchMetrics':
+                // Sliced in the worker, so neither it nor this worker stalls
+                if (!fromExtensionPage(sender)) {
+                    sendResponse({ error: 'Not permitted' });
+                    break;
+                }
+                forwardToMonitorHost({
+                    action: 'researchMetrics',
+                    operationType: request.operationType,
+                    sliceMs: request.sliceMs
+                })
+                    .then(result => sendResponse({ result }))
+                    .catch(handleError);
+                break;
+
+            case 'queryMonitor':
+                if (!fromExtensionPage(sender)) {
+                    sendResponse({ error: 'Not permitted' });
+                    break;
+                }
+                forwardToMonitorHost({ action: 'query', method: request.method, args: request.args })
+                    .then(result => sendResponse({ result }))
+                    .catch(handleError);
+                break;
+
             default:
                 sendResponse({ error: 'Unknown action' });
         }
@@ -117,4 +189,52 @@ chrome.runtime.onMessage.addListener((request, sender, sendResponse) => {
     }
 
     return true;
-});
\ No newline at end of file
+});
+
+// Live dashboards connect a port named 'cryptomon-live' and send
+// { subscribe: { intervalMs } }. Each tick the monitor folds the records
+// stored since this port's last delta into a compact binary frame, so a
+// port costs bounded bandwidth however large the capture grows. Frames
+// travel base64 encoded because extension ports only carry JSON.
+const LIVE_PORT = 'cryptomon-live';
+const LIVE_MIN_INTERVAL_MS = 250;
+let nextLiveSubscriber = 1;
+
+chrome.runtime.onConnect.addListener((port) => {
+    if (port.name !== LIVE_PORT) return;
+    if (!fromExtensionPage(port.sender)) {
+        port.disconnect();
+        return;
+    }
+    const subscriber = nextLiveSubscriber++;
+    let timer = null;
+    let inFlight = false;
+
+    const tick = async () => {
+        // A slow host skips ticks instead of queueing them
+        if (inFlight) return;
+        inFlight = true;
+        try {
+            const frame = await forwardToMonitorHost({ action: 'liveDelta', subscriber });
+            if (frame) port.postMessage({ type: 'delta', frame });
+        } catch (error) {
+            port.postMessage({ type: 'error', error: error.message });
+        } finally {
+            inFlight = false;
+        }
+    };
+
+    port.onMessage.addListener((message) => {
+        if (!message || !message.subscribe) return;
+        const intervalMs = Math.max(LIVE_MIN_INTERVAL_MS,
+                                    Number(message.subscribe.intervalMs) || 1000);
+        clearInterval(timer);
+        timer = setInterval(tick, intervalMs);
+        tick();
+    });
+
+    port.onDisconnect.addListener(() => {
+        clearInterval(timer);
+        forwardToMonitorHost({ action: 'releaseLive', subscriber }).catch(() => {});
+    });
+});
@@ -0,0 +1,58 @@
+mkdir -p dist/native
+
+# Capture/spill block compression is enabled for whichever of zstd and LZ4
+# pkg-config can find; without them captures use delta coding only.
+CODEC_FLAGS=""
+if pkg-config --exists libzstd 2>/dev/null; then
+  CODEC_FLAGS="$CODEC_FLAGS -DCRYPTO_MONITOR_WITH_ZSTD $(pkg-config --cflags --libs libzstd)"
+fi
+if pkg-config --exists liblz4 2>/dev/null; then
+  CODEC_FLAGS="$CODEC_FLAGS -DCRYPTO_MONITOR_WITH_LZ4 $(pkg-config --cflags --libs liblz4)"
+fi
+
+g++ src/native/crypto_monitor_c.cpp \
+  -o dist/native/libcryptomonitor.so.1 \
+  -std=c++17 \
+  -shared \
+  -fPIC \
+  -fvisibility=hidden \
+  -Wl,-soname,libcryptomonitor.so.1 \
+  -pthread \
+  -Wall \
+  -Wextra \
+  -O3 \
+  $CODEC_FLAGS
+
+ln -sf libcryptomonitor.so.1 dist/native/libcryptomonitor.so
+cp src/native/crypto_monitor_c.h dist/native/crypto_monitor_c.h
+
+g++ src/native/libcrypto_interposer.cpp \
+  -o dist/native/libcrypto_interposer.so \
+  -std=c++17 \
+  -shared \
+  -fPIC \
+  -fvisibility=hidden \
+  -ldl \
+  -pthread \
+  -Wall \
+  -Wextra \
+  -O3 \
+  $CODEC_FLAGS
+
+g++ src/native/cryptomon_cli.cpp \
+  -o dist/native/cryptomon \
+  -std=c++20 \
+  -pthread \
+  -Wall \
+  -Wextra \
+  -O3 \
+  $CODEC_FLAGS
+
+g++ src/native/cryptomon_collector.cpp \
+  -o dist/native/cryptomon-collector \
+  -std=c++17 \
+  -pthread \
+  -Wall \
+  -Wextra \
+  -O3 \
+  $CODEC_FLAGS
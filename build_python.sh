@@ -0,0 +1,20 @@
+mkdir -p dist/native
+
+CODEC_FLAGS=""
+if pkg-config --exists libzstd 2>/dev/null; then
+  CODEC_FLAGS="$CODEC_FLAGS -DCRYPTO_MONITOR_WITH_ZSTD $(pkg-config --cflags --libs libzstd)"
+fi
+if pkg-config --exists liblz4 2>/dev/null; then
+  CODEC_FLAGS="$CODEC_FLAGS -DCRYPTO_MONITOR_WITH_LZ4 $(pkg-config --cflags --libs liblz4)"
+fi
+
+g++ src/python/cryptomon_module.cpp \
+  -o dist/native/cryptomon$(python3-config --extension-suffix) \
+  $(python3 -m pybind11 --includes) \
+  -std=c++17 \
+  -shared \
+  -fPIC \
+  -fvisibility=hidden \
+  -pthread \
+  -O3 \
+  $CODEC_FLAGS
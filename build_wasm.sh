@@ -9,9 +9,11 @@ emcc src/wasm/crypto_monitor.cpp \
   -s SAFE_HEAP=1 \
   -s WASM_BIGINT=1 \
   -s USE_PTHREADS=0 \
-  -s ENVIRONMENT='web' \
+  -s ENVIRONMENT='web,worker' \
   -s MODULARIZE=1 \
   -s EXPORT_NAME='createModule' \
   -s EXPORTED_FUNCTIONS='["_malloc", "_free"]' \
   -lembind \
-  -O3
\ No newline at end of file
+  -std=c++20 \
+  -O3 \
+  -msimd128
\ No newline at end of file
@@ -102,12 +102,14 @@
 
 import React, { useState, useEffect } from 'react';
 import { createRoot } from 'react-dom/client';
+import useLiveMonitor from './src/components/useLiveMonitor';
 
 const Popup = () => {
   const [isMonitoring, setIsMonitoring] = useState(false);
   const [selectedOperation, setSelectedOperation] = useState('AES_ENCRYPT');
   const [results, setResults] = useState(null);
   const [liveMetrics, setLiveMetrics] = useState(null);
+  const liveTiming = useLiveMonitor(selectedOperation, isMonitoring);
 
   useEffect(() => {
     let interval;
@@ -215,6 +217,35 @@ const Popup = () => {
         </div>
       )}
 
+      {liveTiming && isMonitoring && (
+        <div style={{
+          marginTop: '20px',
+          padding: '15px',
+          backgroundColor: '#e9ecef',
+          borderRadius: '4px'
+        }}>
+          <h3 style={{ marginBottom: '10px' }}>Observed Operations:</h3>
+          <div style={{ display: 'grid', gridTemplateColumns: '1fr 1fr', gap: '10px' }}>
+            <div>
+              <div style={{ fontWeight: 'bold' }}>Count:</div>
+              <div>{liveTiming.count}</div>
+            </div>
+            <div>
+              <div style={{ fontWeight: 'bold' }}>Mean:</div>
+              <div>{(liveTiming.mean / 1e3).toFixed(1)} us</div>
+            </div>
+            <div>
+              <div style={{ fontWeight: 'bold' }}>Median:</div>
+              <div>{(liveTiming.p50 / 1e3).toFixed(1)} us</div>
+            </div>
+            <div>
+              <div style={{ fontWeight: 'bold' }}>p99:</div>
+              <div>{(liveTiming.p99 / 1e3).toFixed(1)} us</div>
+            </div>
+          </div>
+        </div>
+      )}
+
       {results && (
         <div style={{ marginTop: '20px' }}>
           <h3>Performance Metrics:</h3>
@@ -0,0 +1,74 @@
+# Builds and runs the tests in tests/. The C ABI test links the library
+# from build_native.sh, so run that first (npm test does both).
+set -e
+mkdir -p dist/native
+
+CODEC_FLAGS=""
+if pkg-config --exists libzstd 2>/dev/null; then
+  CODEC_FLAGS="$CODEC_FLAGS -DCRYPTO_MONITOR_WITH_ZSTD $(pkg-config --cflags --libs libzstd)"
+fi
+if pkg-config --exists liblz4 2>/dev/null; then
+  CODEC_FLAGS="$CODEC_FLAGS -DCRYPTO_MONITOR_WITH_LZ4 $(pkg-config --cflags --libs liblz4)"
+fi
+
+g++ tests/capture_test.cpp \
+  -o dist/native/capture_test \
+  -std=c++17 \
+  -pthread \
+  -O2 \
+  $CODEC_FLAGS
+
+./dist/native/capture_test
+
+g++ tests/analysis_test.cpp \
+  -o dist/native/analysis_test \
+  -std=c++17 \
+  -pthread \
+  -O2 \
+  $CODEC_FLAGS
+
+./dist/native/analysis_test
+
+g++ tests/fork_test.cpp \
+  -o dist/native/fork_test \
+  -std=c++17 \
+  -pthread \
+  -O2 \
+  $CODEC_FLAGS
+
+./dist/native/fork_test
+
+# Buffers there are freed by whichever side lets go last, so it also runs
+# under the sanitizers where the toolchain has them; leaks only show there
+for SANITIZER in address,undefined thread; do
+  if g++ tests/fork_test.cpp \
+       -o dist/native/fork_test_sanitized \
+       -std=c++17 \
+       -pthread \
+       -O1 \
+       -g \
+       -fsanitize=$SANITIZER \
+       $CODEC_FLAGS 2>/dev/null; then
+    ./dist/native/fork_test_sanitized
+  else
+    echo "fork_test ($SANITIZER): skipping, sanitizer unavailable"
+  fi
+done
+
+gcc tests/c_abi_test.c \
+  -o dist/native/c_abi_test \
+  -std=c99 \
+  -O2 \
+  -Wall \
+  -Isrc/native \
+  -Ldist/native \
+  -lcryptomonitor
+
+LD_LIBRARY_PATH=dist/native ./dist/native/c_abi_test
+
+# The Python module needs pybind11 (build_python.sh); test it when built
+if ls dist/native/cryptomon*.so >/dev/null 2>&1; then
+  python3 tests/python/test_cryptomon.py
+else
+  echo "test_cryptomon: skipping, run build_python.sh first"
+fi
@@ -1,10 +1,12 @@
 // src/components/CryptoDashboard.jsx
 import React, { useState, useEffect } from 'react';
+import useLiveMonitor from './useLiveMonitor';
 
 const CryptoDashboard = () => {
     const [isMonitoring, setIsMonitoring] = useState(false);
     const [operationType, setOperationType] = useState('AES_ENCRYPT');
     const [monitoringData, setMonitoringData] = useState(null);
+    const liveTiming = useLiveMonitor(operationType, isMonitoring);
 
     const startMonitoring = () => {
         chrome.runtime.sendMessage({
@@ -30,6 +32,20 @@ const CryptoDashboard = () => {
         });
     };
 
+    const renderLiveTiming = () => {
+        if (!liveTiming || !isMonitoring) return null;
+
+        return (
+            <div style={{ marginTop: '20px' }}>
+                <h3>Observed Operations (live):</h3>
+                <div>
+                    {liveTiming.count} operations, mean {(liveTiming.mean / 1e3).toFixed(1)} us,
+                    p50 {(liveTiming.p50 / 1e3).toFixed(1)} us, p99 {(liveTiming.p99 / 1e3).toFixed(1)} us
+                </div>
+            </div>
+        );
+    };
+
     const renderMetrics = () => {
         if (!monitoringData) return null;
 
@@ -79,6 +95,7 @@ const CryptoDashboard = () => {
                 </button>
             </div>
 
+            {renderLiveTiming()}
             {renderMetrics()}
 
             <div style={{ 
@@ -0,0 +1,45 @@
+// src/components/useLiveMonitor.js
+import { useEffect, useRef, useState } from 'react';
+import { LiveAggregate } from '../worker/live_delta.js';
+import { fromBase64 } from '../worker/event_batch.js';
+
+/**
+ * Subscribe to the background's live delta port while `enabled`
+ * @param {string} operation - e.g. 'AES_ENCRYPT'
+ * @param {boolean} enabled - Whether to keep the port open
+ * @param {number} intervalMs - Requested rate; the background enforces a floor
+ * @returns {Object|null} LiveAggregate summary for `operation`
+ */
+const useLiveMonitor = (operation, enabled, intervalMs = 1000) => {
+  const aggregate = useRef(new LiveAggregate());
+  const selected = useRef(operation);
+  const [summary, setSummary] = useState(null);
+
+  // A new port is a new subscriber whose first delta replays the whole
+  // store, so totals start over with it; switching operations only
+  // changes which totals are shown
+  useEffect(() => {
+    if (!enabled) return undefined;
+    aggregate.current = new LiveAggregate();
+    const port = chrome.runtime.connect({ name: 'cryptomon-live' });
+    port.onMessage.addListener((message) => {
+      if (message.type === 'delta') {
+        aggregate.current.apply(fromBase64(message.frame));
+        setSummary(aggregate.current.summary(selected.current));
+      } else if (message.type === 'error') {
+        console.error('Live monitor error:', message.error);
+      }
+    });
+    port.postMessage({ subscribe: { intervalMs } });
+    return () => port.disconnect();
+  }, [enabled, intervalMs]);
+
+  useEffect(() => {
+    selected.current = operation;
+    setSummary(aggregate.current.summary(operation));
+  }, [operation]);
+
+  return summary;
+};
+
+export default useLiveMonitor;
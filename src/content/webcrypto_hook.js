@@ -0,0 +1,128 @@
+// webcrypto_hook.js
+//
+// Runs in the page's MAIN world at document_start and wraps the
+// SubtleCrypto methods the monitor has operations for. Each call costs two
+// performance.now() reads, a cached key-size lookup and eight typed-array
+// stores into the current batch; batches are posted to the isolated-world
+// relay (webcrypto_relay.js) when full or every FLUSH_MS.
+//
+// Outside a cross-origin isolated page performance.now() is coarsened
+// (100us in Chrome), so short operations are only resolved statistically.
+// The end time is taken when the returned promise settles, which includes
+// the hop back from the crypto thread.
+
+import { OPERATION_CODES } from '../worker/event_ring.js';
+import { EventBatchWriter } from '../worker/event_batch.js';
+
+const FLUSH_MS = 250;
+const BATCH_RECORDS = 1024;
+const MARK = Symbol.for('cryptomon.webcrypto');
+const MESSAGE = 'cryptomon:events';
+
+const EC_CURVE_BITS = { 'P-256': 256, 'P-384': 384, 'P-521': 521 };
+
+const subtle = globalThis.SubtleCrypto && globalThis.SubtleCrypto.prototype;
+
+if (subtle && !subtle[MARK]) {
+  Object.defineProperty(subtle, MARK, { value: true });
+
+  const batch = new EventBatchWriter(BATCH_RECORDS);
+  const keyBits = new WeakMap();
+  let flushTimer = 0;
+
+  const flush = () => {
+    clearTimeout(flushTimer);
+    flushTimer = 0;
+    const taken = batch.take();
+    if (!taken) return;
+    window.postMessage({ type: MESSAGE, ...taken }, '*', [taken.buffer]);
+  };
+
+  const record = (op, bits, start, end) => {
+    if (!batch.add(op, bits, start, end)) {
+      flush();
+      batch.add(op, bits, start, end);
+    }
+    if (!flushTimer) flushTimer = setTimeout(flush, FLUSH_MS);
+  };
+
+  const sizeOf = (key) => {
+    if (typeof key !== 'object' || key === null) return 0;
+    let bits = keyBits.get(key);
+    if (bits === undefined) {
+      const algorithm = key.algorithm || {};
+      bits = algorithm.length || algorithm.modulusLength ||
+             EC_CURVE_BITS[algorithm.namedCurve] || 0;
+      keyBits.set(key, bits);
+    }
+    return bits;
+  };
+
+  const algorithmName = (algorithm) =>
+    String(typeof algorithm === 'string' ? algorithm : algorithm && algorithm.name).toUpperCase();
+
+  // The monitor has no RSA signature operations; RSASSA/PSS signing is a
+  // private-key exponentiation like decryption, and verifying a public-key
+  // one like encryption, so they are timed as those. Unmapped algorithms
+  // (HMAC, Ed25519, other digests) pass through untimed.
+  const classify = {
+    encrypt: (algorithm) => {
+      const name = algorithmName(algorithm);
+      if (name.startsWith('AES')) return OPERATION_CODES.aes_encrypt;
+      if (name === 'RSA-OAEP') return OPERATION_CODES.rsa_encrypt;
+      return -1;
+    },
+    decrypt: (algorithm) => {
+      const name = algorithmName(algorithm);
+      if (name.startsWith('AES')) return OPERATION_CODES.aes_decrypt;
+      if (name === 'RSA-OAEP') return OPERATION_CODES.rsa_decrypt;
+      return -1;
+    },
+    sign: (algorithm) => {
+      const name = algorithmName(algorithm);
+      if (name === 'ECDSA') return OPERATION_CODES.ecdsa_sign;
+      if (name.startsWith('RSA')) return OPERATION_CODES.rsa_decrypt;
+      return -1;
+    },
+    verify: (algorithm) => {
+      const name = algorithmName(algorithm);
+      if (name === 'ECDSA') return OPERATION_CODES.ecdsa_verify;
+      if (name.startsWith('RSA')) return OPERATION_CODES.rsa_encrypt;
+      return -1;
+    },
+    digest: (algorithm) =>
+      algorithmName(algorithm) === 'SHA-256' ? OPERATION_CODES.sha256_hash : -1,
+    deriveBits: () => OPERATION_CODES.key_derivation
+  };
+
+  for (const method of Object.keys(classify)) {
+    const original = subtle[method];
+    if (typeof original !== 'function') continue;
+    const opFor = classify[method];
+
+    const wrapped = {
+      [method](algorithm, ...rest) {
+        const op = opFor(algorithm);
+        if (op < 0) return original.call(this, algorithm, ...rest);
+        // digest has no key; deriveBits reports the requested length
+        const bits = method === 'digest' ? 256
+          : method === 'deriveBits' ? rest[1] >>> 0
+          : sizeOf(rest[0]);
+        const start = performance.now();
+        return original.call(this, algorithm, ...rest).then((result) => {
+          record(op, bits, start, performance.now());
+          return result;
+        });
+      }
+    }[method];
+
+    Object.defineProperty(subtle, method, {
+      value: wrapped,
+      writable: true,
+      configurable: true,
+      enumerable: true
+    });
+  }
+
+  window.addEventListener('pagehide', flush);
+}
@@ -0,0 +1,33 @@
+// webcrypto_relay.js
+//
+// Isolated-world half of the WebCrypto layer: picks up event batches the
+// MAIN-world hook posts on the window and forwards them to the background,
+// which feeds them to the worker-hosted monitor. The page can post the same
+// message shape, so batches are checked for size only; the data is only as
+// trustworthy as the page.
+
+import { EVENT_RECORD_BYTES } from '../worker/event_ring.js';
+import { toBase64 } from '../worker/event_batch.js';
+
+const MESSAGE = 'cryptomon:events';
+const MAX_RECORDS = 1 << 16;
+
+window.addEventListener('message', (event) => {
+  const data = event.data;
+  if (event.source !== window || !data || data.type !== MESSAGE) return;
+  const { buffer, count, timeOrigin } = data;
+  if (!(buffer instanceof ArrayBuffer) || !Number.isInteger(count) || count <= 0 ||
+      count > MAX_RECORDS || buffer.byteLength < count * EVENT_RECORD_BYTES ||
+      !Number.isFinite(timeOrigin)) {
+    return;
+  }
+
+  chrome.runtime.sendMessage({
+    action: 'recordEvents',
+    count,
+    timeOrigin,
+    events: toBase64(buffer.slice(0, count * EVENT_RECORD_BYTES))
+  }).catch(() => {
+    // The extension was reloaded under the page; nothing to deliver to
+  });
+});
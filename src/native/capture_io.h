@@ -0,0 +1,31 @@
+// capture_io.h
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Whole-file helpers for capture files produced by serializeCapture().
+inline bool readCaptureFile(const std::string& path, std::vector<uint8_t>& out) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    bool ok = std::fseek(file, 0, SEEK_END) == 0;
+    long size = ok ? std::ftell(file) : -1;
+    ok = ok && size >= 0 && std::fseek(file, 0, SEEK_SET) == 0;
+    if (ok) {
+        out.resize(static_cast<size_t>(size));
+        ok = out.empty() || std::fread(out.data(), 1, out.size(), file) == out.size();
+    }
+    std::fclose(file);
+    return ok;
+}
+
+inline bool writeCaptureFile(const std::string& path, const std::vector<uint8_t>& data) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = data.empty() || std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = (std::fclose(file) == 0) && ok;
+    return ok;
+}
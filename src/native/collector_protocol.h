@@ -0,0 +1,64 @@
+// collector_protocol.h
+//
+// Wire format between monitors and cryptomon-collector. A stream is a
+// sequence of frames, each an 8-byte header followed by `length` payload
+// bytes:
+//
+//   u32 length | u8 kind | u8 flags | u16 reserved | payload
+//
+// HELLO names the sending host and must come first; every later frame is
+// merged into that host's store. QUERY is answered with a SUMMARY frame
+// holding the named host's (or, with an empty payload, the global) state.
+// A frame the collector cannot apply is answered with ERROR, after which
+// it closes that connection.
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../wasm/thread_event_buffer.h"
+
+namespace collector {
+
+enum class FrameKind : uint8_t {
+    HELLO = 1,    // payload: host name
+    SUMMARY = 2,  // payload: MonitorSummary::serialize()
+    CAPTURE = 3,  // payload: EnhancedCryptoMonitor::serializeCapture()
+    EVENTS = 4,   // payload: packed CompletedOperation records
+    QUERY = 5,    // payload: host name, or empty for the global store
+    ERROR = 6     // payload: message; the collector then closes the stream
+};
+
+struct FrameHeader {
+    uint32_t length;
+    uint8_t kind;
+    uint8_t flags;
+    uint16_t reserved;
+};
+static_assert(sizeof(FrameHeader) == 8, "frame header is packed on the wire");
+static_assert(sizeof(CompletedOperation) == 32, "event records are packed on the wire");
+
+constexpr size_t kMaxHostName = 255;
+constexpr uint32_t kMaxFrameLength = 64u << 20;
+
+inline void appendFrame(std::vector<uint8_t>& out, FrameKind kind,
+                        const void* payload, size_t length) {
+    FrameHeader header{static_cast<uint32_t>(length), static_cast<uint8_t>(kind), 0, 0};
+    size_t offset = out.size();
+    out.resize(offset + sizeof(header) + length);
+    std::memcpy(out.data() + offset, &header, sizeof(header));
+    if (length > 0) std::memcpy(out.data() + offset + sizeof(header), payload, length);
+}
+
+inline void appendFrame(std::vector<uint8_t>& out, FrameKind kind,
+                        const std::vector<uint8_t>& payload) {
+    appendFrame(out, kind, payload.data(), payload.size());
+}
+
+inline void appendFrame(std::vector<uint8_t>& out, FrameKind kind, const std::string& payload) {
+    appendFrame(out, kind, payload.data(), payload.size());
+}
+
+}  // namespace collector
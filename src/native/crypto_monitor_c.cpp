@@ -0,0 +1,637 @@
+// crypto_monitor_c.cpp
+#include "crypto_monitor_c.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+
+#include "../wasm/crypto_monitor.h"
+
+struct cm_monitor {
+    EnhancedCryptoMonitor impl;
+};
+
+namespace {
+
+using CryptoOperation = EnhancedCryptoMonitor::CryptoOperation;
+
+bool valid(cm_trace_source source) {
+    return source == CM_TRACE_ROUND_POWER || source == CM_TRACE_POWER_TRACE ||
+           source == CM_TRACE_ROUND_TIMING;
+}
+
+bool valid(cm_operation op) {
+    return static_cast<unsigned>(op) < EnhancedCryptoMonitor::kOperationCount;
+}
+
+CryptoOperation to_operation(cm_operation op) {
+    return static_cast<CryptoOperation>(op);
+}
+
+cm_statistics to_c(const EnhancedCryptoMonitor::SummaryStatistics& stats) {
+    return cm_statistics{stats.count, stats.mean, stats.stddev, stats.min, stats.max};
+}
+
+cm_anomaly_event to_c(const AnomalyEvent& event) {
+    return cm_anomaly_event{event.timestamp, event.op, event.round, event.value, event.z_score};
+}
+
+cm_distribution_shape to_c(const DistributionShape& shape) {
+    cm_distribution_shape out{};
+    out.count = shape.count;
+    out.outliers = shape.outliers;
+    for (int i = 0; i < 2; ++i) {
+        out.weight[i] = shape.mixture.components[i].weight;
+        out.mean[i] = shape.mixture.components[i].mean;
+        out.stddev[i] = shape.mixture.components[i].stddev;
+    }
+    out.separation = shape.separation;
+    out.bic_unimodal = shape.bic_unimodal;
+    out.bic_bimodal = shape.bic_bimodal;
+    out.dip = shape.dip;
+    out.dip_z = shape.dip_z;
+    out.bimodal = shape.bimodal ? 1u : 0u;
+    return out;
+}
+
+cm_alert_event to_c(const AlertEvent& event) {
+    return cm_alert_event{event.timestamp, event.rule, event.firing ? 1u : 0u, event.value};
+}
+
+// Copies into a malloc'd buffer the caller releases with cm_free
+int export_bytes(const std::vector<uint8_t>& bytes, uint8_t** data, size_t* size) {
+    auto* buffer = static_cast<uint8_t*>(std::malloc(bytes.size() ? bytes.size() : 1));
+    if (!buffer) return CM_ERR_NO_MEMORY;
+    std::memcpy(buffer, bytes.data(), bytes.size());
+    *data = buffer;
+    *size = bytes.size();
+    return CM_OK;
+}
+
+void copy_message(const std::string& message, char* out, size_t capacity) {
+    if (!out || capacity == 0) return;
+    size_t n = std::min(message.size(), capacity - 1);
+    std::memcpy(out, message.data(), n);
+    out[n] = '\0';
+}
+
+// Runs body, which returns a status (or an id), and maps anything it throws
+// onto one so no exception crosses the C boundary
+template <class F>
+auto guarded(F&& body) -> decltype(body()) {
+    try {
+        return body();
+    } catch (const std::bad_alloc&) {
+        return CM_ERR_NO_MEMORY;
+    } catch (...) {
+        return CM_ERR_INTERNAL;
+    }
+}
+
+// The same for calls that return a count: a failure copies nothing
+template <class F>
+size_t counted(F&& body) {
+    try {
+        return body();
+    } catch (...) {
+        return 0;
+    }
+}
+
+}  // namespace
+
+extern "C" {
+
+uint32_t cm_abi_version(void) {
+    return CM_ABI_VERSION;
+}
+
+cm_monitor* cm_monitor_create(void) {
+    try {
+        return new cm_monitor();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void cm_monitor_destroy(cm_monitor* monitor) {
+    delete monitor;
+}
+
+int cm_start(cm_monitor* monitor, cm_operation op, uint64_t key_size) {
+    if (!monitor || !valid(op)) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        monitor->impl.startOperation(to_operation(op), key_size);
+        return CM_OK;
+    });
+}
+
+int cm_record_round(cm_monitor* monitor, cm_operation op, uint64_t round) {
+    if (!monitor || !valid(op)) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        monitor->impl.recordRound(to_operation(op), round);
+        return CM_OK;
+    });
+}
+
+int cm_end(cm_monitor* monitor, cm_operation op) {
+    if (!monitor || !valid(op)) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        monitor->impl.endOperation(to_operation(op));
+        return CM_OK;
+    });
+}
+
+int cm_set_label(cm_monitor* monitor, cm_operation op, uint32_t label) {
+    if (!monitor || !valid(op)) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        monitor->impl.labelOperation(to_operation(op), label);
+        return CM_OK;
+    });
+}
+
+int cm_record_completed(cm_monitor* monitor, cm_operation op, uint64_t key_size,
+                        uint64_t start_ns, uint64_t end_ns) {
+    if (!monitor || !valid(op) || end_ns < start_ns) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        return monitor->impl.recordCompletedOperation(to_operation(op), key_size, start_ns,
+                                                      end_ns)
+                   ? CM_OK
+                   : CM_ERR_RING_FULL;
+    });
+}
+
+uint64_t cm_timestamp_ns(void) {
+    return EnhancedCryptoMonitor::get_timestamp();
+}
+
+int cm_analyze_timing(cm_monitor* monitor, cm_operation op, cm_timing_summary* out) {
+    if (!monitor || !valid(op) || !out) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        auto analysis = monitor->impl.timingAnalysis(to_operation(op));
+        out->execution_time = to_c(analysis.statistics);
+        out->round_variation = to_c(EnhancedCryptoMonitor::summarize(analysis.round_variations));
+        out->power_variation = to_c(EnhancedCryptoMonitor::summarize(analysis.power_variations));
+        return CM_OK;
+    });
+}
+
+int cm_analyze_distribution(cm_monitor* monitor, cm_operation op,
+                            cm_distribution_shape* execution_time,
+                            cm_distribution_shape* round_deltas) {
+    if (!monitor || !valid(op)) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        auto analysis = monitor->impl.distributionAnalysis(to_operation(op));
+        if (execution_time) *execution_time = to_c(analysis.execution_time);
+        if (round_deltas) *round_deltas = to_c(analysis.round_deltas);
+        return CM_OK;
+    });
+}
+
+int cm_execution_time_density(cm_monitor* monitor, cm_operation op,
+                              cm_bandwidth_rule rule, double* out, size_t points,
+                              cm_density_info* info) {
+    if (!monitor || !valid(op) || !out || points < 2) return CM_ERR_INVALID_ARGUMENT;
+    if (rule != CM_BANDWIDTH_SILVERMAN && rule != CM_BANDWIDTH_ISJ) {
+        return CM_ERR_INVALID_ARGUMENT;
+    }
+    return guarded([&] {
+        DensityOptions options;
+        options.points = points;
+        options.rule = static_cast<BandwidthRule>(rule);
+        DensityEstimate estimate = monitor->impl.executionTimeDensity(to_operation(op), options);
+        std::copy(estimate.density.begin(), estimate.density.end(), out);
+        if (estimate.density.empty()) std::fill(out, out + points, 0.0);
+        if (info) {
+            info->low = estimate.low;
+            info->high = estimate.high;
+            info->bandwidth = estimate.bandwidth;
+            info->rule = static_cast<uint32_t>(estimate.rule);
+            info->count = estimate.count;
+            info->outside = estimate.outside;
+        }
+        return CM_OK;
+    });
+}
+
+int cm_analyze_snr(cm_monitor* monitor, cm_operation op, cm_trace_source source,
+                   double* snr, size_t capacity, size_t* points) {
+    if (!monitor || !valid(op) || !points) return CM_ERR_INVALID_ARGUMENT;
+    if (!valid(source)) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        SnrResult result = monitor->impl.snrAnalysis(
+            to_operation(op), static_cast<EnhancedCryptoMonitor::TraceSource>(source));
+        if (snr && capacity > 0) {
+            size_t n = result.snr.size() < capacity ? result.snr.size() : capacity;
+            std::memcpy(snr, result.snr.data(), n * sizeof(double));
+        }
+        *points = result.points;
+        return CM_OK;
+    });
+}
+
+size_t cm_select_poi(const double* scores, size_t count, size_t k, size_t min_spacing,
+                     uint32_t* out) {
+    if (!scores || !out || count > UINT32_MAX) return 0;
+    return counted([&] {
+        std::vector<uint32_t> chosen =
+            selectPointsOfInterest(std::vector<double>(scores, scores + count), k, min_spacing);
+        std::copy(chosen.begin(), chosen.end(), out);
+        return chosen.size();
+    });
+}
+
+int cm_enable_trace_projection(cm_monitor* monitor, cm_operation op,
+                               cm_trace_source source, size_t components,
+                               uint32_t discard_raw, double* eigenvalues) {
+    if (!monitor || !valid(op) || components == 0) return CM_ERR_INVALID_ARGUMENT;
+    if (!valid(source)) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        auto trace_source = static_cast<EnhancedCryptoMonitor::TraceSource>(source);
+        PrincipalComponents pca = monitor->impl.tracePca(to_operation(op), trace_source, components);
+        if (eigenvalues) {
+            std::fill(eigenvalues, eigenvalues + components, 0.0);
+            std::copy(pca.eigenvalues.begin(), pca.eigenvalues.end(), eigenvalues);
+        }
+        monitor->impl.setTraceProjection(to_operation(op), trace_source, std::move(pca),
+                                         discard_raw != 0);
+        return CM_OK;
+    });
+}
+
+int cm_disable_trace_projection(cm_monitor* monitor, cm_operation op) {
+    if (!monitor || !valid(op)) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        monitor->impl.clearTraceProjection(to_operation(op));
+        return CM_OK;
+    });
+}
+
+size_t cm_copy_projected_traces(cm_monitor* monitor, cm_operation op, double* out,
+                                size_t capacity, size_t* components) {
+    if (!monitor || !valid(op)) return 0;
+    return counted([&] {
+        std::vector<double> scores;
+        size_t width = monitor->impl.projectedTraces(to_operation(op), scores);
+        if (components) *components = width;
+        if (out && capacity > 0) {
+            size_t n = scores.size() < capacity ? scores.size() : capacity;
+            std::memcpy(out, scores.data(), n * sizeof(double));
+        }
+        return scores.size();
+    });
+}
+
+int cm_build_templates(cm_monitor* monitor, cm_operation op, cm_trace_source source,
+                       const uint32_t* points, size_t count, size_t* classes) {
+    if (!monitor || !valid(op) || !valid(source) || !points || count == 0 || !classes) {
+        return CM_ERR_INVALID_ARGUMENT;
+    }
+    return guarded([&] {
+        *classes = monitor->impl.buildTemplates(
+            to_operation(op), static_cast<EnhancedCryptoMonitor::TraceSource>(source),
+            std::vector<uint32_t>(points, points + count));
+        return CM_OK;
+    });
+}
+
+int cm_match_templates(cm_monitor* monitor, cm_operation op, size_t first,
+                       cm_template_match* out) {
+    if (!monitor || !valid(op) || !out) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        TemplateMatch match = monitor->impl.matchTemplates(to_operation(op), first);
+        out->trace_count = match.trace_count;
+        out->best_label = match.best_label;
+        out->margin = match.margin;
+        std::fill(out->log_likelihood, out->log_likelihood + 256,
+                  -std::numeric_limits<double>::infinity());
+        for (size_t c = 0; c < match.labels.size(); ++c) {
+            out->log_likelihood[match.labels[c]] = match.log_likelihood[c];
+        }
+        return CM_OK;
+    });
+}
+
+int cm_score_templates(cm_monitor* monitor, cm_operation op, const double* traces,
+                       size_t count, size_t length, double* out) {
+    if (!monitor || !valid(op) || (count > 0 && (!traces || !out))) {
+        return CM_ERR_INVALID_ARGUMENT;
+    }
+    return guarded([&] {
+        std::vector<double> scores;
+        if (!monitor->impl.scoreTemplates(to_operation(op), traces, count, length, scores)) {
+            return CM_ERR_INVALID_ARGUMENT;
+        }
+        const std::vector<uint32_t>& labels = monitor->impl.templates(to_operation(op))->labels;
+        std::fill(out, out + count * 256, -std::numeric_limits<double>::infinity());
+        for (size_t t = 0; t < count; ++t) {
+            for (size_t c = 0; c < labels.size(); ++c) {
+                out[t * 256 + labels[c]] = scores[t * labels.size() + c];
+            }
+        }
+        return CM_OK;
+    });
+}
+
+size_t cm_copy_execution_times(cm_monitor* monitor, cm_operation op,
+                               double* out, size_t capacity) {
+    if (!monitor || !valid(op)) return 0;
+    return counted([&] {
+        auto times = monitor->impl.collectExecutionTimes(to_operation(op));
+        if (out && capacity > 0) {
+            size_t n = times.size() < capacity ? times.size() : capacity;
+            std::memcpy(out, times.data(), n * sizeof(double));
+        }
+        return times.size();
+    });
+}
+
+int cm_serialize(cm_monitor* monitor, uint8_t** data, size_t* size) {
+    if (!monitor || !data || !size) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] { return export_bytes(monitor->impl.serializeCapture(), data, size); });
+}
+
+int cm_load(cm_monitor* monitor, const uint8_t* data, size_t size) {
+    if (!monitor || (!data && size > 0)) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        return monitor->impl.loadCapture(data, size) ? CM_OK : CM_ERR_BAD_FORMAT;
+    });
+}
+
+void cm_free(void* data) {
+    std::free(data);
+}
+
+int cm_enable_spill(cm_monitor* monitor, const char* path, size_t budget_bytes) {
+    if (!monitor || !path) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        return monitor->impl.enableSpill(path, budget_bytes) ? CM_OK : CM_ERR_INVALID_ARGUMENT;
+    });
+}
+
+int cm_clear(cm_monitor* monitor, cm_operation op) {
+    if (!monitor || !valid(op)) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        monitor->impl.clear(to_operation(op));
+        return CM_OK;
+    });
+}
+
+int cm_clear_all(cm_monitor* monitor) {
+    if (!monitor) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        monitor->impl.clearAll();
+        return CM_OK;
+    });
+}
+
+int cm_compact(cm_monitor* monitor, uint64_t* saved) {
+    if (!monitor) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        size_t bytes = monitor->impl.compact();
+        if (saved) *saved = bytes;
+        return CM_OK;
+    });
+}
+
+int cm_memory_stats(cm_monitor* monitor, cm_memory_usage* out) {
+    if (!monitor || !out) return CM_ERR_INVALID_ARGUMENT;
+    static_assert(EnhancedCryptoMonitor::kOperationCount == CM_OPERATION_COUNT,
+                  "cm_operation out of step with the monitor");
+    static_assert(EnhancedCryptoMonitor::kRecordSeriesCount == CM_RECORD_SERIES_COUNT,
+                  "cm_record_series out of step with the monitor");
+    EnhancedCryptoMonitor::MemoryUsage usage;
+    int status = guarded([&] {
+        usage = monitor->impl.memoryUsage();
+        return CM_OK;
+    });
+    if (status != CM_OK) return status;
+    *out = cm_memory_usage{};
+    for (size_t op = 0; op < CM_OPERATION_COUNT; ++op) {
+        const auto& memory = usage.operations[op];
+        cm_operation_memory& entry = out->operations[op];
+        entry.records = memory.store.records;
+        entry.sealed_bytes = memory.store.sealed_bytes;
+        entry.tail_bytes = memory.store.tail_bytes;
+        entry.shared_bytes = memory.store.shared_bytes;
+        entry.pending_bytes = memory.store.pending_bytes;
+        entry.spilled_bytes = memory.store.spilled_bytes;
+        entry.index_bytes = memory.store.index_bytes;
+        entry.projection_bytes = memory.projection_bytes;
+        for (size_t i = 0; i < CM_RECORD_SERIES_COUNT; ++i) {
+            entry.series_used[i] = memory.series[i].used_bytes;
+            entry.series_allocated[i] = memory.series[i].allocated_bytes;
+        }
+    }
+    out->resident_bytes = usage.resident_bytes;
+    out->slack_bytes = usage.slack_bytes;
+    out->dead_spill_bytes = usage.dead_spill_bytes;
+    out->heap_available = usage.heap.available ? 1 : 0;
+    out->heap_arena_bytes = usage.heap.arena_bytes;
+    out->heap_in_use_bytes = usage.heap.in_use_bytes;
+    out->heap_free_bytes = usage.heap.free_bytes;
+    return CM_OK;
+}
+
+int cm_merge(cm_monitor* into, const cm_monitor* other) {
+    if (!into || !other) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        into->impl.merge(other->impl);
+        return CM_OK;
+    });
+}
+
+cm_monitor* cm_snapshot(cm_monitor* monitor) {
+    if (!monitor) return nullptr;
+    cm_monitor* snapshot = nullptr;
+    try {
+        snapshot = new cm_monitor();
+        monitor->impl.snapshotInto(snapshot->impl);
+    } catch (...) {
+        delete snapshot;
+        return nullptr;
+    }
+    return snapshot;
+}
+
+int cm_serialize_summary(cm_monitor* monitor, uint8_t** data, size_t* size) {
+    if (!monitor || !data || !size) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] { return export_bytes(monitor->impl.serializeSummary(), data, size); });
+}
+
+int cm_merge_summary(cm_monitor* monitor, const uint8_t* data, size_t size) {
+    if (!monitor || (!data && size > 0)) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        return monitor->impl.mergeSerializedSummary(data, size) ? CM_OK : CM_ERR_BAD_FORMAT;
+    });
+}
+
+int cm_set_window(cm_monitor* monitor, uint64_t window_ns, uint32_t buckets) {
+    if (!monitor || window_ns == 0 || buckets == 0) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        monitor->impl.setWindow(window_ns, buckets);
+        return CM_OK;
+    });
+}
+
+int cm_window_stats(cm_monitor* monitor, cm_operation op, uint64_t now_ns,
+                    cm_window_statistics* out) {
+    if (!monitor || !valid(op) || !out) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        WindowStatistics stats = now_ns ? monitor->impl.windowStatistics(to_operation(op), now_ns)
+                                        : monitor->impl.windowStatistics(to_operation(op));
+        *out = cm_window_statistics{stats.window_ns, stats.count, stats.mean, stats.stddev,
+                                    stats.min, stats.max, stats.p50, stats.p90, stats.p99};
+        return CM_OK;
+    });
+}
+
+int cm_configure_anomalies(cm_monitor* monitor, double alpha, double threshold,
+                           uint64_t warmup) {
+    if (!monitor || !(alpha > 0.0 && alpha <= 1.0) || !(threshold > 0.0)) {
+        return CM_ERR_INVALID_ARGUMENT;
+    }
+    AnomalyConfig config;
+    config.alpha = alpha;
+    config.threshold = threshold;
+    config.warmup = warmup;
+    return guarded([&] {
+        monitor->impl.configureAnomalyDetection(config);
+        return CM_OK;
+    });
+}
+
+int cm_set_anomaly_callback(cm_monitor* monitor, cm_anomaly_callback callback,
+                            void* user_data) {
+    if (!monitor) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        if (!callback) {
+            monitor->impl.setAnomalyCallback(nullptr);
+            return CM_OK;
+        }
+        monitor->impl.setAnomalyCallback([callback, user_data](const AnomalyEvent& event) {
+            cm_anomaly_event c_event = to_c(event);
+            callback(&c_event, user_data);
+        });
+        return CM_OK;
+    });
+}
+
+size_t cm_poll_anomalies(cm_monitor* monitor, cm_anomaly_event* out, size_t capacity) {
+    if (!monitor || !out || capacity == 0) return 0;
+    return counted([&] {
+        std::vector<AnomalyEvent> events = monitor->impl.pollAnomalies(capacity);
+        for (size_t i = 0; i < events.size(); ++i) out[i] = to_c(events[i]);
+        return events.size();
+    });
+}
+
+int64_t cm_add_alert_rule(cm_monitor* monitor, const char* rule,
+                          char* error, size_t error_size) {
+    if (!monitor || !rule) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&]() -> int64_t {
+        std::string message;
+        int64_t id = monitor->impl.addAlertRule(rule, message);
+        if (id >= 0) return id;
+        copy_message(message, error, error_size);
+        return CM_ERR_BAD_FORMAT;
+    });
+}
+
+int cm_remove_alert_rule(cm_monitor* monitor, uint32_t rule) {
+    if (!monitor) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        return monitor->impl.removeAlertRule(rule) ? CM_OK : CM_ERR_INVALID_ARGUMENT;
+    });
+}
+
+int cm_set_alert_callback(cm_monitor* monitor, cm_alert_callback callback, void* user_data) {
+    if (!monitor) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        if (!callback) {
+            monitor->impl.setAlertCallback(nullptr);
+            return CM_OK;
+        }
+        monitor->impl.setAlertCallback([callback, user_data](const AlertEvent& event) {
+            cm_alert_event c_event = to_c(event);
+            callback(&c_event, user_data);
+        });
+        return CM_OK;
+    });
+}
+
+int cm_evaluate_alerts(cm_monitor* monitor, uint64_t now_ns) {
+    if (!monitor) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        monitor->impl.evaluateAlerts(now_ns ? now_ns : EnhancedCryptoMonitor::get_timestamp());
+        return CM_OK;
+    });
+}
+
+size_t cm_poll_alerts(cm_monitor* monitor, cm_alert_event* out, size_t capacity) {
+    if (!monitor || !out || capacity == 0) return 0;
+    return counted([&] {
+        std::vector<AlertEvent> events = monitor->impl.pollAlerts(capacity);
+        for (size_t i = 0; i < events.size(); ++i) out[i] = to_c(events[i]);
+        return events.size();
+    });
+}
+
+int cm_derive_metric(cm_monitor* monitor, cm_operation op, const char* expression,
+                     double* out, size_t capacity, size_t* total,
+                     char* error, size_t error_size) {
+    if (!monitor || !valid(op) || !expression || !total) return CM_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        std::vector<double> values;
+        std::string message;
+        if (!monitor->impl.deriveMetric(to_operation(op), expression, values, message)) {
+            copy_message(message, error, error_size);
+            return CM_ERR_BAD_FORMAT;
+        }
+        if (out && capacity > 0) {
+            size_t n = values.size() < capacity ? values.size() : capacity;
+            std::memcpy(out, values.data(), n * sizeof(double));
+        }
+        *total = values.size();
+        return CM_OK;
+    });
+}
+
+int cm_permutation_test(cm_monitor* monitor, cm_operation op, const char* expression,
+                        uint32_t label_a, uint32_t label_b,
+                        const cm_permutation_options* options,
+                        cm_permutation_result* out, char* error, size_t error_size) {
+    if (!monitor || !valid(op) || !expression || !out) return CM_ERR_INVALID_ARGUMENT;
+    PermutationTestOptions test_options;
+    if (options) {
+        if (options->statistic > CM_PERMUTATION_MEDIAN || options->max_permutations == 0) {
+            return CM_ERR_INVALID_ARGUMENT;
+        }
+        test_options.statistic = static_cast<PermutationStatistic>(options->statistic);
+        test_options.max_permutations = options->max_permutations;
+        test_options.alpha = options->alpha;
+        test_options.seed = options->seed;
+        test_options.threads = options->threads;
+    }
+    return guarded([&] {
+        PermutationTestResult result;
+        std::string message;
+        if (!monitor->impl.permutationTest(to_operation(op), expression, label_a, label_b,
+                                           test_options, result, message)) {
+            copy_message(message, error, error_size);
+            return CM_ERR_BAD_FORMAT;
+        }
+        out->count_a = result.count_a;
+        out->count_b = result.count_b;
+        out->observed = result.observed;
+        out->p_value = result.p_value;
+        out->permutations = result.permutations;
+        out->exceedances = result.exceedances;
+        out->stopped_early = result.stopped_early ? 1u : 0u;
+        return CM_OK;
+    });
+}
+
+}  // extern "C"
@@ -0,0 +1,379 @@
+/* crypto_monitor_c.h
+ *
+ * Stable C ABI over EnhancedCryptoMonitor for native services
+ * (libcryptomonitor.so). Operations are passed as integers, never strings,
+ * so recording costs no marshalling. Enum values and struct layouts below
+ * are part of the ABI: append only, never reorder.
+ */
+#ifndef CRYPTO_MONITOR_C_H
+#define CRYPTO_MONITOR_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+#define CM_API __declspec(dllexport)
+#else
+#define CM_API __attribute__((visibility("default")))
+#endif
+
+#define CM_ABI_VERSION 1
+
+typedef struct cm_monitor cm_monitor;
+
+typedef enum cm_operation {
+    CM_AES_ENCRYPT = 0,
+    CM_AES_DECRYPT = 1,
+    CM_RSA_ENCRYPT = 2,
+    CM_RSA_DECRYPT = 3,
+    CM_ECDSA_SIGN = 4,
+    CM_ECDSA_VERIFY = 5,
+    CM_SHA256_HASH = 6,
+    CM_KEY_DERIVATION = 7
+} cm_operation;
+
+#define CM_OPERATION_COUNT 8
+
+typedef enum cm_status {
+    CM_OK = 0,
+    CM_ERR_INVALID_ARGUMENT = -1,
+    CM_ERR_BAD_FORMAT = -2,
+    CM_ERR_NO_MEMORY = -3,
+    CM_ERR_RING_FULL = -4,
+    CM_ERR_INTERNAL = -5  /* unexpected failure inside the library; the call had no effect
+                             or a partial one, and the monitor remains usable */
+} cm_status;
+
+typedef struct cm_statistics {
+    uint64_t count;
+    double mean;
+    double stddev;
+    double min;
+    double max;
+} cm_statistics;
+
+typedef struct cm_timing_summary {
+    cm_statistics execution_time;
+    cm_statistics round_variation;
+    cm_statistics power_variation;
+} cm_timing_summary;
+
+typedef struct cm_window_statistics {
+    uint64_t window_ns;
+    uint64_t count;
+    double mean;
+    double stddev;
+    double min;
+    double max;
+    double p50;
+    double p90;
+    double p99;
+} cm_window_statistics;
+
+/* round is -1 for a whole-operation execution time */
+typedef struct cm_anomaly_event {
+    uint64_t timestamp_ns;
+    uint32_t op;
+    int32_t round;
+    double value;
+    double z_score;
+} cm_anomaly_event;
+
+typedef void (*cm_anomaly_callback)(const cm_anomaly_event* event, void* user_data);
+
+/* Two-component Gaussian mixture (ascending means) plus Hartigan's dip;
+ * bimodal is 1 when either clearly rejects a single peak. */
+typedef struct cm_distribution_shape {
+    uint64_t count;
+    uint64_t outliers;
+    double weight[2];
+    double mean[2];
+    double stddev[2];
+    double separation;
+    double bic_unimodal;
+    double bic_bimodal;
+    double dip;
+    double dip_z;
+    uint32_t bimodal;
+} cm_distribution_shape;
+
+typedef enum cm_bandwidth_rule {
+    CM_BANDWIDTH_SILVERMAN = 0,
+    CM_BANDWIDTH_ISJ = 1
+} cm_bandwidth_rule;
+
+/* Grid of a density estimate: point i is at low + i * (high - low) / (points - 1).
+ * rule reports the selector actually used (ISJ falls back to Silverman). */
+typedef struct cm_density_info {
+    double low;
+    double high;
+    double bandwidth;
+    uint32_t rule;
+    uint64_t count;
+    uint64_t outside;
+} cm_density_info;
+
+typedef enum cm_permutation_statistic {
+    CM_PERMUTATION_MEAN = 0,
+    CM_PERMUTATION_MEDIAN = 1
+} cm_permutation_statistic;
+
+/* alpha <= 0 disables early stopping; threads 0 = hardware concurrency */
+typedef struct cm_permutation_options {
+    uint32_t statistic;
+    uint64_t max_permutations;
+    double alpha;
+    uint64_t seed;
+    uint32_t threads;
+} cm_permutation_options;
+
+/* Two-sided; observed is statistic(label_a) - statistic(label_b) */
+typedef struct cm_permutation_result {
+    uint64_t count_a;
+    uint64_t count_b;
+    double observed;
+    double p_value;
+    uint64_t permutations;
+    uint64_t exceedances;
+    uint32_t stopped_early;
+} cm_permutation_result;
+
+typedef enum cm_trace_source {
+    CM_TRACE_ROUND_POWER = 0,
+    CM_TRACE_POWER_TRACE = 1,
+    CM_TRACE_ROUND_TIMING = 2  /* deltas between round timestamps */
+} cm_trace_source;
+
+/* Summed template log-likelihoods, indexed by label; -inf where no
+ * template was profiled for that label */
+typedef struct cm_template_match {
+    uint64_t trace_count;
+    uint32_t best_label;
+    double margin;
+    double log_likelihood[256];
+} cm_template_match;
+
+/* firing is 1 when a rule starts to hold and 0 when it stops */
+typedef struct cm_alert_event {
+    uint64_t timestamp_ns;
+    uint32_t rule;
+    uint32_t firing;
+    double value;
+} cm_alert_event;
+
+typedef void (*cm_alert_callback)(const cm_alert_event* event, void* user_data);
+
+/* Per-record vectors, for the memory breakdown; RECORD is the fixed part */
+typedef enum cm_record_series {
+    CM_SERIES_RECORD = 0,
+    CM_SERIES_POWER_TRACE = 1,
+    CM_SERIES_ACCESS_PATTERNS = 2,
+    CM_SERIES_SQUARE_TIMINGS = 3,
+    CM_SERIES_MULTIPLY_TIMINGS = 4,
+    CM_SERIES_REDUCE_TIMINGS = 5,
+    CM_SERIES_MEMORY_ACCESS_PATTERN = 6,
+    CM_SERIES_ROUND_TIMINGS = 7,
+    CM_SERIES_ROUND_POWER = 8
+} cm_record_series;
+
+#define CM_RECORD_SERIES_COUNT 9
+
+/* Bytes held for one operation. shared_bytes are sealed bytes a snapshot
+ * also holds; series_* cover resident records only, used vs. reserved. */
+typedef struct cm_operation_memory {
+    uint64_t records;
+    uint64_t sealed_bytes;
+    uint64_t tail_bytes;
+    uint64_t shared_bytes;
+    uint64_t pending_bytes;
+    uint64_t spilled_bytes;
+    uint64_t index_bytes;
+    uint64_t projection_bytes;
+    uint64_t series_used[CM_RECORD_SERIES_COUNT];
+    uint64_t series_allocated[CM_RECORD_SERIES_COUNT];
+} cm_operation_memory;
+
+/* heap_* come from the allocator and are 0 unless heap_available */
+typedef struct cm_memory_usage {
+    cm_operation_memory operations[CM_OPERATION_COUNT];
+    uint64_t resident_bytes;
+    uint64_t slack_bytes;
+    uint64_t dead_spill_bytes;
+    uint32_t heap_available;
+    uint64_t heap_arena_bytes;
+    uint64_t heap_in_use_bytes;
+    uint64_t heap_free_bytes;
+} cm_memory_usage;
+
+CM_API uint32_t cm_abi_version(void);
+
+CM_API cm_monitor* cm_monitor_create(void);
+CM_API void cm_monitor_destroy(cm_monitor* monitor);
+
+/* Same semantics as startCryptoOperation / recordRoundMetrics /
+ * endCryptoOperation. Not thread-safe per monitor. */
+CM_API int cm_start(cm_monitor* monitor, cm_operation op, uint64_t key_size);
+CM_API int cm_record_round(cm_monitor* monitor, cm_operation op, uint64_t round);
+CM_API int cm_end(cm_monitor* monitor, cm_operation op);
+/* Class label for the in-flight operation (TVLA group or CPA input byte) */
+CM_API int cm_set_label(cm_monitor* monitor, cm_operation op, uint32_t label);
+
+/* Lock-free, callable from any thread. Returns CM_ERR_INVALID_ARGUMENT
+ * when end_ns < start_ns, and CM_ERR_RING_FULL when the calling thread's
+ * buffer is full and the record was dropped. */
+CM_API int cm_record_completed(cm_monitor* monitor, cm_operation op, uint64_t key_size,
+                               uint64_t start_ns, uint64_t end_ns);
+CM_API uint64_t cm_timestamp_ns(void);
+
+CM_API int cm_analyze_timing(cm_monitor* monitor, cm_operation op, cm_timing_summary* out);
+
+/* Either output may be NULL */
+CM_API int cm_analyze_distribution(cm_monitor* monitor, cm_operation op,
+                                   cm_distribution_shape* execution_time,
+                                   cm_distribution_shape* round_deltas);
+
+/* Gaussian KDE of execution times written to `out[0..points)`, points >= 2.
+ * info may be NULL. */
+CM_API int cm_execution_time_density(cm_monitor* monitor, cm_operation op,
+                                     cm_bandwidth_rule rule, double* out, size_t points,
+                                     cm_density_info* info);
+
+/* Per-point SNR between label classes (low byte of the label). Copies up
+ * to `capacity` values into `snr` and stores the trace length in `*points`. */
+CM_API int cm_analyze_snr(cm_monitor* monitor, cm_operation op, cm_trace_source source,
+                          double* snr, size_t capacity, size_t* points);
+
+/* Indices of the `k` best scores, best first, into `out`; picks closer than
+ * `min_spacing` to a better one are skipped, as are NaN scores. Returns the
+ * number written. */
+CM_API size_t cm_select_poi(const double* scores, size_t count, size_t k, size_t min_spacing,
+                            uint32_t* out);
+
+/* Fits `components` principal components to the traces recorded so far and
+ * from then on projects each finished operation's trace onto them. With
+ * discard_raw the raw trace is dropped after projection. eigenvalues, when
+ * non-NULL, receives up to `components` values, largest first. */
+CM_API int cm_enable_trace_projection(cm_monitor* monitor, cm_operation op,
+                                      cm_trace_source source, size_t components,
+                                      uint32_t discard_raw, double* eigenvalues);
+
+CM_API int cm_disable_trace_projection(cm_monitor* monitor, cm_operation op);
+
+/* Copies up to `capacity` projected scores, row-major with `*components`
+ * per trace; returns the total number of scores available. */
+CM_API size_t cm_copy_projected_traces(cm_monitor* monitor, cm_operation op, double* out,
+                                       size_t capacity, size_t* components);
+
+/* Profiles Gaussian templates over `count` points of `source`, one per
+ * label low byte, from the traces recorded so far, replacing any earlier
+ * templates for `op`. `*classes` receives the number of templates, 0 when
+ * there was too little data or a point lies beyond the longest trace. */
+CM_API int cm_build_templates(cm_monitor* monitor, cm_operation op, cm_trace_source source,
+                              const uint32_t* points, size_t count, size_t* classes);
+
+/* Scores the recorded traces from record `first` on against the templates */
+CM_API int cm_match_templates(cm_monitor* monitor, cm_operation op, size_t first,
+                              cm_template_match* out);
+
+/* Scores `count` row-major traces of `length` values; out is
+ * [count x 256] log-likelihoods by label. */
+CM_API int cm_score_templates(cm_monitor* monitor, cm_operation op, const double* traces,
+                              size_t count, size_t length, double* out);
+
+/* Copies up to `capacity` execution times; returns the total available. */
+CM_API size_t cm_copy_execution_times(cm_monitor* monitor, cm_operation op,
+                                      double* out, size_t capacity);
+
+/* Serialized captures are heap buffers released with cm_free. */
+CM_API int cm_serialize(cm_monitor* monitor, uint8_t** data, size_t* size);
+CM_API int cm_load(cm_monitor* monitor, const uint8_t* data, size_t size);
+CM_API void cm_free(void* data);
+
+/* Native-only memory cap: sealed measurement blocks beyond `budget_bytes`
+ * are spilled to an (immediately unlinked) segment file at `path` and read
+ * back transparently by the analyses. */
+CM_API int cm_enable_spill(cm_monitor* monitor, const char* path, size_t budget_bytes);
+
+/* Dropping and compacting measurements. Record numbering continues across
+ * clears (cm_match_templates' `first` counts from the records kept).
+ * cm_compact rebuilds resident blocks at their exact size and returns
+ * free heap pages to the system; `saved` may be NULL. */
+CM_API int cm_clear(cm_monitor* monitor, cm_operation op);
+CM_API int cm_clear_all(cm_monitor* monitor);
+CM_API int cm_compact(cm_monitor* monitor, uint64_t* saved);
+CM_API int cm_memory_stats(cm_monitor* monitor, cm_memory_usage* out);
+
+/* Fleet aggregation. cm_merge appends `other`'s drained measurements to
+ * `into`; summaries carry moments, quantile sketches, round profiles and
+ * TVLA state only, and merge exactly (quantiles within 1% relative error). */
+CM_API int cm_merge(cm_monitor* into, const cm_monitor* other);
+
+/* Snapshot isolation: a new monitor that shares `monitor`'s sealed
+ * measurement blocks and copies only each open tail block. Analyse it on
+ * another thread while `monitor` keeps recording; release it with
+ * cm_monitor_destroy. NULL on a bad argument or allocation failure. */
+CM_API cm_monitor* cm_snapshot(cm_monitor* monitor);
+CM_API int cm_serialize_summary(cm_monitor* monitor, uint8_t** data, size_t* size);
+CM_API int cm_merge_summary(cm_monitor* monitor, const uint8_t* data, size_t size);
+
+/* Sliding-window execution-time statistics over the operations that ended
+ * in the last `window_ns` before `now_ns` (a cm_timestamp_ns value, or 0
+ * for now). The window expires in `buckets` equal slices; the default is
+ * 60 s in 60 buckets. cm_set_window clears what the windows held. */
+CM_API int cm_set_window(cm_monitor* monitor, uint64_t window_ns, uint32_t buckets);
+CM_API int cm_window_stats(cm_monitor* monitor, cm_operation op, uint64_t now_ns,
+                           cm_window_statistics* out);
+
+/* EWMA z-score anomaly detection over execution and round times. alpha is
+ * the weight of the newest sample, events fire at |z| >= threshold after
+ * `warmup` samples per tracker (defaults 0.05, 4.0, 30). The callback runs
+ * synchronously on the recording or draining thread and must not call back
+ * into the monitor; NULL removes it. cm_poll_anomalies copies up to
+ * `capacity` of the newest 1024 undelivered events and returns the count. */
+CM_API int cm_configure_anomalies(cm_monitor* monitor, double alpha, double threshold,
+                                  uint64_t warmup);
+CM_API int cm_set_anomaly_callback(cm_monitor* monitor, cm_anomaly_callback callback,
+                                   void* user_data);
+CM_API size_t cm_poll_anomalies(cm_monitor* monitor, cm_anomaly_event* out, size_t capacity);
+
+/* Alert rules such as "p99 of RSA_DECRYPT 2048 over 1m > 3ms" or
+ * "tvla |t| > 4.5 for AES_ENCRYPT", checked incrementally as operations
+ * end. cm_add_alert_rule returns the rule id (>= 0) or CM_ERR_BAD_FORMAT
+ * with a message copied into `error` when it is non-NULL. Callback rules
+ * match the anomaly callback. cm_evaluate_alerts re-checks windowed rules
+ * at `now_ns` (0 for now) when no operations arrive. */
+CM_API int64_t cm_add_alert_rule(cm_monitor* monitor, const char* rule,
+                                 char* error, size_t error_size);
+CM_API int cm_remove_alert_rule(cm_monitor* monitor, uint32_t rule);
+CM_API int cm_set_alert_callback(cm_monitor* monitor, cm_alert_callback callback,
+                                 void* user_data);
+CM_API int cm_evaluate_alerts(cm_monitor* monitor, uint64_t now_ns);
+CM_API size_t cm_poll_alerts(cm_monitor* monitor, cm_alert_event* out, size_t capacity);
+
+/* Evaluates a derived metric expression, e.g.
+ * "(end_inst - start_inst) / (end_cycle - start_cycle)", over every sample
+ * of `op`. Copies up to `capacity` values into `out` and stores the total
+ * in `*total`. On a parse error returns CM_ERR_BAD_FORMAT with a message
+ * copied into `error` when it is non-NULL. */
+CM_API int cm_derive_metric(cm_monitor* monitor, cm_operation op, const char* expression,
+                            double* out, size_t capacity, size_t* total,
+                            char* error, size_t error_size);
+
+/* Permutation test of a derived metric expression between the samples
+ * labelled label_a and label_b. options may be NULL for the defaults
+ * (mean, 10000 permutations, alpha 0.05). Parse errors are reported as
+ * in cm_derive_metric. */
+CM_API int cm_permutation_test(cm_monitor* monitor, cm_operation op, const char* expression,
+                               uint32_t label_a, uint32_t label_b,
+                               const cm_permutation_options* options,
+                               cm_permutation_result* out, char* error, size_t error_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRYPTO_MONITOR_C_H */
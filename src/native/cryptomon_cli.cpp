@@ -0,0 +1,438 @@
+// cryptomon_cli.cpp
+//
+// Batch analysis of capture files:
+//
+//   cryptomon summarize [-j N] [--op OP] FILE...
+//   cryptomon tvla      [-j N] [--op OP] [--threshold T] FILE...
+//   cryptomon cpa       [-j N] [--op OP] FILE...
+//   cryptomon modes     [-j N] [--op OP] FILE...
+//   cryptomon diff      [-j N] [--op OP] BASELINE FILE...
+//   cryptomon export    [-j N] [--op OP] [--out DIR] FILE...
+//   cryptomon convert   [-j N] [--codec [COLUMN=]CODEC]... [--out DIR] FILE...
+//
+// Files are processed in parallel, one capture per worker at a time, so
+// peak memory is bounded by the N largest captures rather than the total.
+// Output is printed in command-line order.
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../wasm/crypto_monitor.h"
+#include "capture_io.h"
+
+namespace {
+
+using CryptoOperation = EnhancedCryptoMonitor::CryptoOperation;
+
+struct Options {
+    std::string command;
+    std::vector<std::string> files;
+    std::vector<CryptoOperation> operations;
+    unsigned jobs = 0;
+    double threshold = kTvlaThreshold;
+    std::string out_dir = ".";
+    ColumnPolicy policy = ColumnPolicy::dense();
+};
+
+int usage() {
+    std::fprintf(stderr,
+        "usage: cryptomon <summarize|tvla|cpa|modes|diff|export|convert> [options] FILE...\n"
+        "  -j N             worker threads (default: hardware concurrency)\n"
+        "  --op OP          restrict to one operation type (repeatable)\n"
+        "  --threshold T    TVLA |t| threshold (default 4.5)\n"
+        "  --out DIR        export/convert directory (default .)\n"
+        "  --codec C        convert: codec for every column, or COLUMN=C for one\n"
+        "                   (raw, delta, lz4, zstd, delta+lz4, delta+zstd)\n"
+        "diff compares every FILE against BASELINE.\n");
+    return 2;
+}
+
+bool parse_operation(const std::string& name, CryptoOperation& op) {
+    for (size_t i = 0; i < EnhancedCryptoMonitor::kOperationCount; ++i) {
+        auto candidate = static_cast<CryptoOperation>(i);
+        if (name == EnhancedCryptoMonitor::operationName(candidate)) {
+            op = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// "CODEC" applies to every column, "COLUMN=CODEC" to one column
+bool parse_codec_option(const std::string& value, ColumnPolicy& policy) {
+    size_t eq = value.find('=');
+    ColumnCodec codec;
+    if (!parseCodec(eq == std::string::npos ? value : value.substr(eq + 1), codec) ||
+        !codecAvailable(codec)) {
+        return false;
+    }
+    if (eq == std::string::npos) {
+        policy.integers = policy.floats = policy.lengths = codec;
+    } else {
+        policy.overrides.emplace_back(value.substr(0, eq), codec);
+    }
+    return true;
+}
+
+bool parse_args(int argc, char** argv, Options& options) {
+    if (argc < 2) return false;
+    options.command = argv[1];
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&](std::string& value) {
+            if (i + 1 >= argc) return false;
+            value = argv[++i];
+            return true;
+        };
+        std::string value;
+        if (arg == "-j") {
+            if (!next(value)) return false;
+            options.jobs = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+        } else if (arg == "--op") {
+            CryptoOperation op;
+            if (!next(value) || !parse_operation(value, op)) {
+                std::fprintf(stderr, "cryptomon: unknown operation '%s'\n", value.c_str());
+                return false;
+            }
+            options.operations.push_back(op);
+        } else if (arg == "--threshold") {
+            if (!next(value)) return false;
+            options.threshold = std::strtod(value.c_str(), nullptr);
+        } else if (arg == "--out") {
+            if (!next(value)) return false;
+            options.out_dir = value;
+        } else if (arg == "--codec") {
+            if (!next(value) || !parse_codec_option(value, options.policy)) {
+                std::fprintf(stderr, "cryptomon: unsupported codec '%s'\n", value.c_str());
+                return false;
+            }
+        } else if (!arg.empty() && arg[0] == '-') {
+            return false;
+        } else {
+            options.files.push_back(arg);
+        }
+    }
+    if (options.operations.empty()) {
+        for (size_t i = 0; i < EnhancedCryptoMonitor::kOperationCount; ++i) {
+            options.operations.push_back(static_cast<CryptoOperation>(i));
+        }
+    }
+    if (options.jobs == 0) {
+        options.jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return !options.files.empty();
+}
+
+std::unique_ptr<EnhancedCryptoMonitor> load(const std::string& path, std::string& error,
+                                            size_t* size = nullptr) {
+    std::vector<uint8_t> bytes;
+    if (!readCaptureFile(path, bytes)) {
+        error = "cannot read " + path;
+        return nullptr;
+    }
+    if (size) *size = bytes.size();
+    auto monitor = std::make_unique<EnhancedCryptoMonitor>();
+    if (!monitor->loadCapture(bytes.data(), bytes.size())) {
+        error = "malformed capture " + path;
+        return nullptr;
+    }
+    return monitor;
+}
+
+std::string format(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+std::string format(const char* fmt, ...) {
+    char buffer[4096];
+    va_list args;
+    va_start(args, fmt);
+    std::vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    return buffer;
+}
+
+std::string summarize(const Options& options, EnhancedCryptoMonitor& monitor,
+                      const std::string& path) {
+    std::string out;
+    for (CryptoOperation op : options.operations) {
+        auto analysis = monitor.timingAnalysis(op);
+        const auto& s = analysis.statistics;
+        if (s.count == 0) continue;
+        auto rounds = EnhancedCryptoMonitor::summarize(analysis.round_variations);
+        out += format("%s\t%s\t%zu\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\n",
+                      path.c_str(), EnhancedCryptoMonitor::operationName(op),
+                      s.count, s.mean, s.stddev, s.min, s.max, rounds.stddev);
+    }
+    return out;
+}
+
+std::string tvla(const Options& options, EnhancedCryptoMonitor& monitor,
+                 const std::string& path) {
+    std::string out;
+    for (CryptoOperation op : options.operations) {
+        if (monitor.measurementCount(op) == 0) continue;
+        TvlaResult r = monitor.tvlaAnalysis(op);
+        bool leak = r.max_abs_t > options.threshold;
+        out += format("%s\t%s\t%llu\t%llu\t%.3f\t%.3f\t%s\n",
+                      path.c_str(), EnhancedCryptoMonitor::operationName(op),
+                      static_cast<unsigned long long>(r.fixed_count),
+                      static_cast<unsigned long long>(r.random_count),
+                      r.execution_time_t, r.max_abs_t, leak ? "LEAK" : "pass");
+    }
+    return out;
+}
+
+std::string cpa(const Options& options, EnhancedCryptoMonitor& monitor,
+                const std::string& path) {
+    std::string out;
+    for (CryptoOperation op : options.operations) {
+        if (monitor.measurementCount(op) == 0) continue;
+        CpaResult r = monitor.cpaAnalysis(op);
+        out += format("%s\t%s\t%llu\t%zu\t0x%02x\t%.4f\n",
+                      path.c_str(), EnhancedCryptoMonitor::operationName(op),
+                      static_cast<unsigned long long>(r.trace_count), r.points,
+                      r.best_guess, r.best_correlation);
+    }
+    return out;
+}
+
+// Two-component mixture and dip test per series; see distribution_shape.h
+// Every operation's mixture fits go to `pool` together, so a file with
+// few operations still keeps the workers busy
+std::string modes(const Options& options, EnhancedCryptoMonitor& monitor,
+                  const std::string& path, ThreadPool& pool) {
+    std::vector<CryptoOperation> operations;
+    std::vector<Task<EnhancedCryptoMonitor::DistributionAnalysis>> fits;
+    for (CryptoOperation op : options.operations) {
+        if (monitor.measurementCount(op) == 0) continue;
+        operations.push_back(op);
+        fits.push_back(monitor.distributionAnalysisAsync(op, pool));
+    }
+    auto analyses = syncWait(whenAll(std::move(fits)));
+
+    std::string out;
+    for (size_t k = 0; k < operations.size(); ++k) {
+        const auto& analysis = analyses[k];
+        const std::pair<const char*, const DistributionShape*> series[] = {
+            {"execution_time", &analysis.execution_time},
+            {"round_delta", &analysis.round_deltas},
+        };
+        for (const auto& entry : series) {
+            const DistributionShape& shape = *entry.second;
+            if (shape.count == 0) continue;
+            const GaussianComponent& low = shape.mixture.components[0];
+            const GaussianComponent& high = shape.mixture.components[1];
+            out += format("%s\t%s\t%s\t%llu\t%.1f\t%.1f\t%.3f\t%.2f\t%.5f\t%.2f\t%s\n",
+                          path.c_str(), EnhancedCryptoMonitor::operationName(operations[k]),
+                          entry.first, static_cast<unsigned long long>(shape.count), low.mean,
+                          high.mean, high.weight, shape.separation, shape.dip, shape.dip_z,
+                          shape.bimodal ? "BIMODAL" : "unimodal");
+        }
+    }
+    return out;
+}
+
+// Baseline moments are computed once up front and shared read-only.
+using BaselineMoments = std::vector<RunningMoments>;
+
+BaselineMoments baseline_moments(EnhancedCryptoMonitor& baseline) {
+    BaselineMoments moments(EnhancedCryptoMonitor::kOperationCount);
+    for (size_t i = 0; i < moments.size(); ++i) {
+        for (double x : baseline.collectExecutionTimes(static_cast<CryptoOperation>(i))) {
+            moments[i].add(x);
+        }
+    }
+    return moments;
+}
+
+std::string diff(const Options& options, const BaselineMoments& baseline,
+                 EnhancedCryptoMonitor& monitor, const std::string& path) {
+    std::string out;
+    for (CryptoOperation op : options.operations) {
+        const RunningMoments& before = baseline[static_cast<size_t>(op)];
+        RunningMoments after;
+        for (double x : monitor.collectExecutionTimes(op)) after.add(x);
+        if (before.count == 0 && after.count == 0) continue;
+        double delta = after.mean - before.mean;
+        double relative = before.mean != 0.0 ? 100.0 * delta / before.mean : 0.0;
+        out += format("%s\t%s\t%llu\t%llu\t%.1f\t%.1f\t%+.1f\t%+.2f%%\t%.3f\n",
+                      path.c_str(), EnhancedCryptoMonitor::operationName(op),
+                      static_cast<unsigned long long>(before.count),
+                      static_cast<unsigned long long>(after.count),
+                      before.mean, after.mean, delta, relative,
+                      welchT(after, before));
+    }
+    return out;
+}
+
+std::string base_name(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+std::string export_csv(const Options& options, EnhancedCryptoMonitor& monitor,
+                       const std::string& path) {
+    std::string out;
+    for (CryptoOperation op : options.operations) {
+        auto columns = monitor.extractColumns(op);
+        if (columns.count == 0) continue;
+
+        std::string target = options.out_dir + "/" + base_name(path) + "." +
+                             EnhancedCryptoMonitor::operationName(op) + ".csv";
+        FILE* file = std::fopen(target.c_str(), "w");
+        if (!file) {
+            out += format("%s\terror: cannot write %s\n", path.c_str(), target.c_str());
+            continue;
+        }
+        std::fprintf(file, "start_cycle,end_cycle,execution_time,start_inst,end_inst,"
+                           "key_size,rounds,label,l1_miss_rate,mispredict_rate,energy");
+        for (size_t r = 0; r < columns.round_width; ++r) std::fprintf(file, ",round_power_%zu", r);
+        std::fputc('\n', file);
+        for (size_t i = 0; i < columns.count; ++i) {
+            std::fprintf(file, "%llu,%llu,%.0f,%llu,%llu,%llu,%llu,%u,%.9g,%.9g,%.9g",
+                         static_cast<unsigned long long>(columns.start_cycle[i]),
+                         static_cast<unsigned long long>(columns.end_cycle[i]),
+                         columns.execution_time[i],
+                         static_cast<unsigned long long>(columns.start_inst[i]),
+                         static_cast<unsigned long long>(columns.end_inst[i]),
+                         static_cast<unsigned long long>(columns.key_size[i]),
+                         static_cast<unsigned long long>(columns.rounds[i]),
+                         columns.label[i], columns.l1_miss_rate[i],
+                         columns.mispredict_rate[i], columns.energy[i]);
+            const double* row = columns.round_power.data() + i * columns.round_width;
+            for (size_t r = 0; r < columns.round_width; ++r) {
+                if (std::isnan(row[r])) std::fputs(",", file);
+                else std::fprintf(file, ",%.9g", row[r]);
+            }
+            std::fputc('\n', file);
+        }
+        std::fclose(file);
+        out += format("%s\t%s\t%zu\t%s\n", path.c_str(),
+                      EnhancedCryptoMonitor::operationName(op), columns.count, target.c_str());
+    }
+    return out;
+}
+
+// Rewrites a capture in the current block format with the chosen codecs.
+// Goes through a temporary file so converting in place is safe.
+std::string convert(const Options& options, EnhancedCryptoMonitor& monitor,
+                    const std::string& path, size_t input_size, bool& ok) {
+    std::string target = options.out_dir + "/" + base_name(path);
+    std::string temporary = target + ".tmp";
+    std::vector<uint8_t> bytes = monitor.serializeCapture(options.policy);
+    if (!writeCaptureFile(temporary, bytes) || std::rename(temporary.c_str(), target.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        ok = false;
+        return format("%s\terror: cannot write %s\n", path.c_str(), target.c_str());
+    }
+    double ratio = bytes.empty() ? 0.0 : static_cast<double>(input_size) / bytes.size();
+    return format("%s\t%zu\t%zu\t%.2f\t%s\n", path.c_str(), input_size, bytes.size(),
+                  ratio, target.c_str());
+}
+
+const char* header_for(const std::string& command) {
+    if (command == "summarize") return "file\toperation\tcount\tmean\tstddev\tmin\tmax\tround_stddev\n";
+    if (command == "tvla") return "file\toperation\tfixed\trandom\texec_t\tmax_abs_t\tresult\n";
+    if (command == "cpa") return "file\toperation\ttraces\tpoints\tbest_guess\tcorrelation\n";
+    if (command == "modes") {
+        return "file\toperation\tseries\tcount\tmean_low\tmean_high\tweight_high\tseparation\tdip\tdip_z\tresult\n";
+    }
+    if (command == "diff") return "file\toperation\tbase_n\tn\tbase_mean\tmean\tdelta\tdelta_pct\twelch_t\n";
+    if (command == "export") return "file\toperation\trows\tpath\n";
+    if (command == "convert") return "file\tbytes_in\tbytes_out\tratio\tpath\n";
+    return nullptr;
+}
+
+// Runs `task` for each index on `jobs` workers and prints results strictly
+// in index order as soon as each prefix is complete.
+template <typename Task>
+int run_ordered(size_t count, unsigned jobs, Task task) {
+    std::vector<std::string> results(count);
+    std::vector<bool> done(count, false);
+    std::atomic<size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable ready;
+    int status = 0;
+
+    auto worker = [&] {
+        for (size_t i = next++; i < count; i = next++) {
+            bool ok = true;
+            std::string text = task(i, ok);
+            std::lock_guard<std::mutex> lock(mutex);
+            results[i] = std::move(text);
+            done[i] = true;
+            if (!ok) status = 1;
+            ready.notify_one();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < std::min<size_t>(jobs, count); ++t) threads.emplace_back(worker);
+
+    for (size_t printed = 0; printed < count; ++printed) {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [&] { return done[printed]; });
+        std::string text = std::move(results[printed]);
+        results[printed].shrink_to_fit();
+        lock.unlock();
+        std::fputs(text.c_str(), stdout);
+        std::fflush(stdout);
+    }
+    for (auto& thread : threads) thread.join();
+    return status;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_args(argc, argv, options)) return usage();
+    const char* header = header_for(options.command);
+    if (!header) return usage();
+
+    BaselineMoments baseline;
+    std::vector<std::string> files = options.files;
+    if (options.command == "diff") {
+        if (files.size() < 2) return usage();
+        std::string error;
+        auto monitor = load(files.front(), error);
+        if (!monitor) {
+            std::fprintf(stderr, "cryptomon: %s\n", error.c_str());
+            return 1;
+        }
+        baseline = baseline_moments(*monitor);
+        files.erase(files.begin());
+    }
+
+    // Shared by every file's analysis tasks
+    std::unique_ptr<ThreadPool> pool;
+    if (options.command == "modes") pool = std::make_unique<ThreadPool>(options.jobs);
+
+    std::fputs(header, stdout);
+    return run_ordered(files.size(), options.jobs, [&](size_t i, bool& ok) -> std::string {
+        const std::string& path = files[i];
+        std::string error;
+        size_t input_size = 0;
+        auto monitor = load(path, error, &input_size);
+        if (!monitor) {
+            ok = false;
+            std::fprintf(stderr, "cryptomon: %s\n", error.c_str());
+            return std::string();
+        }
+        if (options.command == "summarize") return summarize(options, *monitor, path);
+        if (options.command == "tvla") return tvla(options, *monitor, path);
+        if (options.command == "cpa") return cpa(options, *monitor, path);
+        if (options.command == "modes") return modes(options, *monitor, path, *pool);
+        if (options.command == "diff") return diff(options, baseline, *monitor, path);
+        if (options.command == "convert") return convert(options, *monitor, path, input_size, ok);
+        return export_csv(options, *monitor, path);
+    });
+}
@@ -0,0 +1,828 @@
+// cryptomon_collector.cpp
+//
+// Aggregation daemon for multi-host deployments, and the client commands
+// that feed and query it:
+//
+//   cryptomon-collector serve [--listen ADDR]... [--report PATH]
+//   cryptomon-collector send  ADDR --host NAME [--summary] FILE...
+//   cryptomon-collector query ADDR [--host NAME]
+//   cryptomon-collector flood ADDR --host NAME [--events N] [--batch B]
+//
+// ADDR is unix:PATH or HOST:PORT. The daemon is one edge-triggered epoll
+// loop; each connection decodes frames in place from its read buffer and
+// folds them into that host's MonitorSummary, so memory is bounded by the
+// number of hosts rather than the number of events. A frame that fails to
+// apply, or a peer that stops reading its replies, costs only that
+// connection. SIGUSR1 writes the report; SIGINT/SIGTERM write it and exit.
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../wasm/crypto_monitor.h"
+#include "capture_io.h"
+#include "collector_protocol.h"
+
+namespace {
+
+using CryptoOperation = EnhancedCryptoMonitor::CryptoOperation;
+using collector::FrameHeader;
+using collector::FrameKind;
+
+int usage() {
+    std::fprintf(stderr,
+        "usage: cryptomon-collector serve [--listen ADDR]... [--report PATH]\n"
+        "       cryptomon-collector send ADDR --host NAME [--summary] FILE...\n"
+        "       cryptomon-collector query ADDR [--host NAME]\n"
+        "       cryptomon-collector flood ADDR --host NAME [--events N] [--batch B]\n"
+        "ADDR is unix:PATH or HOST:PORT; the report goes to PATH or - (stdout).\n");
+    return 2;
+}
+
+void log_error(const char* what) {
+    std::fprintf(stderr, "cryptomon-collector: %s: %s\n", what, std::strerror(errno));
+}
+
+struct Address {
+    bool unix_socket = false;
+    std::string path;
+    std::string host;
+    std::string port;
+};
+
+bool parse_address(const std::string& text, Address& address) {
+    if (text.compare(0, 5, "unix:") == 0) {
+        address.unix_socket = true;
+        address.path = text.substr(5);
+        return !address.path.empty() && address.path.size() < sizeof(sockaddr_un::sun_path);
+    }
+    size_t colon = text.rfind(':');
+    if (colon == std::string::npos || colon + 1 == text.size()) return false;
+    address.host = text.substr(0, colon);
+    address.port = text.substr(colon + 1);
+    return true;
+}
+
+sockaddr_un unix_address(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+// Opens a listening (passive) or connected socket for `address`.
+int open_socket(const Address& address, bool passive) {
+    if (address.unix_socket) {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        sockaddr_un addr = unix_address(address.path);
+        if (passive) {
+            ::unlink(address.path.c_str());
+            if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+                ::listen(fd, SOMAXCONN) == 0) {
+                return fd;
+            }
+        } else if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            return fd;
+        }
+        ::close(fd);
+        return -1;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    addrinfo* results = nullptr;
+    const char* host = address.host.empty() ? nullptr : address.host.c_str();
+    if (::getaddrinfo(host, address.port.c_str(), &hints, &results) != 0) return -1;
+
+    int fd = -1;
+    for (addrinfo* ai = results; ai && fd < 0; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        bool ok;
+        if (passive) {
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            ok = ::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, SOMAXCONN) == 0;
+        } else {
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            ok = ::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0;
+        }
+        if (!ok) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    ::freeaddrinfo(results);
+    return fd;
+}
+
+bool set_nonblocking(int fd) {
+    int flags = ::fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+void print_summary(FILE* out, const std::string& name, const MonitorSummary& summary) {
+    for (size_t i = 0; i < MonitorSummary::kOperations; ++i) {
+        const OperationSummary& op = summary.operations[i];
+        if (op.empty()) continue;
+        std::fprintf(out, "%s\t%s\t%llu\t%.1f\t%.1f\t%.1f\t%.1f\t%.3f\n",
+                     name.c_str(),
+                     EnhancedCryptoMonitor::operationName(static_cast<CryptoOperation>(i)),
+                     static_cast<unsigned long long>(op.execution_time.count),
+                     op.execution_time.mean, op.execution_time.stddev(),
+                     op.execution_sketch.quantile(0.5), op.execution_sketch.quantile(0.99),
+                     op.tvla.result().max_abs_t);
+    }
+}
+
+const char* kReportHeader = "host\toperation\tcount\tmean\tstddev\tp50\tp99\tmax_abs_t\n";
+
+// ---------------------------------------------------------------------------
+// Daemon
+
+// Growable byte window; frames are decoded straight out of [begin, end).
+class ReadBuffer {
+public:
+    uint8_t* data() { return storage_.get() + begin_; }
+    size_t size() const { return end_ - begin_; }
+    void consume(size_t n) {
+        begin_ += n;
+        if (begin_ == end_) begin_ = end_ = 0;
+    }
+
+    // Makes room for at least `want` more bytes after end_
+    uint8_t* reserve(size_t want, size_t& room) {
+        if (capacity_ - end_ < want) {
+            size_t live = end_ - begin_;
+            if (capacity_ - live < want) {
+                size_t capacity = std::max(capacity_ * 2, live + want);
+                std::unique_ptr<uint8_t[]> grown(new uint8_t[capacity]);
+                if (live > 0) std::memcpy(grown.get(), storage_.get() + begin_, live);
+                storage_ = std::move(grown);
+                capacity_ = capacity;
+            } else if (live > 0) {
+                std::memmove(storage_.get(), storage_.get() + begin_, live);
+            }
+            begin_ = 0;
+            end_ = live;
+        }
+        room = capacity_ - end_;
+        return storage_.get() + end_;
+    }
+
+    void commit(size_t n) { end_ += n; }
+
+private:
+    std::unique_ptr<uint8_t[]> storage_;
+    size_t capacity_ = 0;
+    size_t begin_ = 0;
+    size_t end_ = 0;
+};
+
+struct Endpoint {
+    int fd = -1;
+    bool listener = false;
+};
+
+struct Connection : Endpoint {
+    std::string peer;
+    MonitorSummary* store = nullptr;
+    ReadBuffer in;
+    std::vector<uint8_t> out;
+    size_t sent = 0;
+    bool want_write = false;
+};
+
+class Collector {
+public:
+    static constexpr size_t kReadChunk = 256 << 10;
+    // Replies a peer may leave unread before it is disconnected
+    static constexpr size_t kMaxQueuedOutput = 16 << 20;
+
+    Collector() : start_(std::chrono::steady_clock::now()) {}
+
+    ~Collector() {
+        for (auto& entry : connections_) ::close(entry.first);
+        for (auto& listener : listeners_) ::close(listener->fd);
+        for (const auto& path : unix_paths_) ::unlink(path.c_str());
+        if (signal_fd_ >= 0) ::close(signal_fd_);
+        if (epoll_fd_ >= 0) ::close(epoll_fd_);
+    }
+
+    bool init() {
+        epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) return false;
+
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        sigaddset(&mask, SIGUSR1);
+        if (::sigprocmask(SIG_BLOCK, &mask, nullptr) != 0) return false;
+        ::signal(SIGPIPE, SIG_IGN);
+        signal_fd_ = ::signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+        return signal_fd_ >= 0 && watch(signal_fd_, EPOLLIN, nullptr);
+    }
+
+    bool listen(const Address& address) {
+        int fd = open_socket(address, true);
+        if (fd < 0 || !set_nonblocking(fd)) return false;
+        auto endpoint = std::make_unique<Endpoint>();
+        endpoint->fd = fd;
+        endpoint->listener = true;
+        if (!watch(fd, EPOLLIN, endpoint.get())) {
+            ::close(fd);
+            return false;
+        }
+        if (address.unix_socket) unix_paths_.push_back(address.path);
+        listeners_.push_back(std::move(endpoint));
+        return true;
+    }
+
+    int run(const std::string& report_path) {
+        epoll_event events[64];
+        for (;;) {
+            int n = ::epoll_wait(epoll_fd_, events, 64, -1);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                log_error("epoll_wait");
+                return 1;
+            }
+            for (int i = 0; i < n; ++i) {
+                auto* endpoint = static_cast<Endpoint*>(events[i].data.ptr);
+                if (!endpoint) {
+                    if (!on_signal(report_path)) return 0;
+                } else if (endpoint->listener) {
+                    accept_all(endpoint->fd);
+                } else {
+                    on_event(static_cast<Connection*>(endpoint), events[i].events);
+                }
+            }
+        }
+    }
+
+    void report(const std::string& path) const {
+        FILE* out = path == "-" ? stdout : std::fopen(path.c_str(), "w");
+        if (!out) {
+            log_error(path.c_str());
+            return;
+        }
+        std::fputs(kReportHeader, out);
+        for (const auto& entry : hosts_) print_summary(out, entry.first, entry.second);
+        print_summary(out, "*", global());
+        if (out == stdout) std::fflush(out);
+        else std::fclose(out);
+
+        double elapsed = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start_).count();
+        std::fprintf(stderr,
+                     "cryptomon-collector: %zu hosts, %llu frames, %llu events, %.1f MB in %.1fs\n",
+                     hosts_.size(), static_cast<unsigned long long>(frames_),
+                     static_cast<unsigned long long>(events_), bytes_ / 1e6, elapsed);
+    }
+
+private:
+    bool watch(int fd, uint32_t events, Endpoint* endpoint) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.ptr = endpoint;
+        return ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == 0;
+    }
+
+    bool on_signal(const std::string& report_path) {
+        signalfd_siginfo info;
+        bool keep_running = true;
+        while (::read(signal_fd_, &info, sizeof(info)) == sizeof(info)) {
+            report(report_path);
+            if (info.ssi_signo != SIGUSR1) keep_running = false;
+        }
+        return keep_running;
+    }
+
+    void accept_all(int listen_fd) {
+        for (;;) {
+            sockaddr_storage addr{};
+            socklen_t len = sizeof(addr);
+            int fd = ::accept4(listen_fd, reinterpret_cast<sockaddr*>(&addr), &len,
+                               SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) log_error("accept");
+                return;
+            }
+            auto connection = std::make_unique<Connection>();
+            connection->fd = fd;
+            connection->peer = describe(addr);
+            if (!watch(fd, EPOLLIN | EPOLLRDHUP | EPOLLET, connection.get())) {
+                ::close(fd);
+                continue;
+            }
+            connections_[fd] = std::move(connection);
+        }
+    }
+
+    static std::string describe(const sockaddr_storage& addr) {
+        char host[INET6_ADDRSTRLEN] = "?";
+        if (addr.ss_family == AF_INET) {
+            const auto* in = reinterpret_cast<const sockaddr_in*>(&addr);
+            ::inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+            return std::string(host) + ":" + std::to_string(ntohs(in->sin_port));
+        }
+        if (addr.ss_family == AF_INET6) {
+            const auto* in6 = reinterpret_cast<const sockaddr_in6*>(&addr);
+            ::inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+            return std::string(host) + ":" + std::to_string(ntohs(in6->sin6_port));
+        }
+        return "unix";
+    }
+
+    void on_event(Connection* connection, uint32_t events) {
+        const char* error = nullptr;
+        bool rejected = false;
+        bool open = true;
+        if (events & EPOLLIN) open = on_readable(*connection, error, rejected);
+        if (open && (events & EPOLLOUT)) open = flush(*connection);
+        if (open && (events & (EPOLLERR | EPOLLHUP))) open = false;
+        if (!open) {
+            if (error) {
+                std::fprintf(stderr, "cryptomon-collector: closing %s: %s\n",
+                             connection->peer.c_str(), error);
+            }
+            if (rejected) reject(*connection, error);
+            close_connection(connection);
+        }
+    }
+
+    // Best effort: tells the peer why its stream is being dropped
+    void reject(Connection& connection, const char* error) {
+        std::vector<uint8_t> frame;
+        collector::appendFrame(frame, FrameKind::ERROR, std::string(error));
+        if (connection.sent == connection.out.size()) {
+            ssize_t n = ::write(connection.fd, frame.data(), frame.size());
+            (void)n;
+        }
+    }
+
+    // Edge-triggered: read until EAGAIN, decoding after every chunk so the
+    // buffer only ever holds one partial frame.
+    bool on_readable(Connection& connection, const char*& error, bool& rejected) {
+        for (;;) {
+            size_t room;
+            uint8_t* dst;
+            try {
+                dst = connection.in.reserve(kReadChunk, room);
+            } catch (const std::bad_alloc&) {
+                error = "out of memory";
+                return false;
+            }
+            ssize_t n = ::read(connection.fd, dst, room);
+            if (n > 0) {
+                connection.in.commit(static_cast<size_t>(n));
+                bytes_ += static_cast<uint64_t>(n);
+                if (!decode(connection, error)) {
+                    rejected = true;
+                    return false;
+                }
+                continue;
+            }
+            if (n == 0) return false;
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            error = std::strerror(errno);
+            return false;
+        }
+    }
+
+    bool decode(Connection& connection, const char*& error) {
+        ReadBuffer& in = connection.in;
+        while (in.size() >= sizeof(FrameHeader)) {
+            FrameHeader header;
+            std::memcpy(&header, in.data(), sizeof(header));
+            if (header.length > collector::kMaxFrameLength) {
+                error = "frame too large";
+                return false;
+            }
+            size_t frame = sizeof(header) + header.length;
+            if (in.size() < frame) {
+                // Make sure the rest of a large frame fits without regrowing per read
+                size_t room;
+                try {
+                    in.reserve(frame - in.size(), room);
+                } catch (const std::bad_alloc&) {
+                    error = "out of memory";
+                    return false;
+                }
+                return true;
+            }
+            // Payloads come straight off the network; whatever decoding
+            // them throws is that peer's problem, not the daemon's
+            try {
+                error = handle_frame(connection, static_cast<FrameKind>(header.kind),
+                                     in.data() + sizeof(header), header.length);
+            } catch (const std::bad_alloc&) {
+                error = "out of memory";
+            } catch (...) {
+                error = "frame could not be applied";
+            }
+            if (error) return false;
+            in.consume(frame);
+            ++frames_;
+        }
+        return true;
+    }
+
+    // Returns an error message, or nullptr when the frame was applied
+    const char* handle_frame(Connection& connection, FrameKind kind,
+                             const uint8_t* payload, size_t length) {
+        if (kind == FrameKind::HELLO) {
+            if (connection.store) return "duplicate HELLO";
+            if (length == 0 || length > collector::kMaxHostName) return "bad host name";
+            connection.store = &hosts_[std::string(reinterpret_cast<const char*>(payload), length)];
+            return nullptr;
+        }
+        if (kind == FrameKind::QUERY) {
+            if (connection.out.size() > kMaxQueuedOutput) return "peer is not reading replies";
+            std::string host(reinterpret_cast<const char*>(payload), length);
+            std::vector<uint8_t> body;
+            if (host.empty()) {
+                body = global().serialize();
+            } else {
+                auto it = hosts_.find(host);
+                body = it != hosts_.end() ? it->second.serialize() : MonitorSummary().serialize();
+            }
+            collector::appendFrame(connection.out, FrameKind::SUMMARY, body);
+            return flush(connection) ? nullptr : "write failed";
+        }
+        if (!connection.store) return "data before HELLO";
+
+        switch (kind) {
+            case FrameKind::SUMMARY: {
+                MonitorSummary summary;
+                if (!summary.deserialize(payload, length)) return "malformed summary";
+                connection.store->merge(summary);
+                return nullptr;
+            }
+            case FrameKind::CAPTURE: {
+                EnhancedCryptoMonitor monitor;
+                if (!monitor.loadCapture(payload, length)) return "malformed capture";
+                connection.store->merge(monitor.summary());
+                return nullptr;
+            }
+            case FrameKind::EVENTS:
+                return fold_events(*connection.store, payload, length);
+            default:
+                return "unknown frame kind";
+        }
+    }
+
+    // Events carry no rounds, so only the execution-time accumulators
+    // move, under the record's label like any other record. The batch is
+    // checked whole first, so a rejected one leaves the store untouched.
+    const char* fold_events(MonitorSummary& store, const uint8_t* payload, size_t length) {
+        if (length % sizeof(CompletedOperation) != 0) return "truncated event batch";
+        static const std::vector<double> no_power;
+        static const std::vector<uint64_t> no_timings;
+        size_t count = length / sizeof(CompletedOperation);
+        for (size_t i = 0; i < count; ++i) {
+            CompletedOperation event;
+            std::memcpy(&event, payload + i * sizeof(event), sizeof(event));
+            if (event.op >= MonitorSummary::kOperations) return "bad operation in event";
+            if (event.end_cycle < event.start_cycle) return "event ends before it starts";
+        }
+        for (size_t i = 0; i < count; ++i) {
+            CompletedOperation event;
+            std::memcpy(&event, payload + i * sizeof(event), sizeof(event));
+            store.operations[event.op].add(
+                event.label, static_cast<double>(event.end_cycle - event.start_cycle),
+                no_power, no_timings);
+        }
+        events_ += count;
+        return nullptr;
+    }
+
+    bool flush(Connection& connection) {
+        while (connection.sent < connection.out.size()) {
+            ssize_t n = ::write(connection.fd, connection.out.data() + connection.sent,
+                                connection.out.size() - connection.sent);
+            if (n > 0) {
+                connection.sent += static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return set_want_write(connection, true);
+            }
+            return false;
+        }
+        connection.out.clear();
+        connection.sent = 0;
+        return set_want_write(connection, false);
+    }
+
+    bool set_want_write(Connection& connection, bool want) {
+        if (connection.want_write == want) return true;
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (want ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+        ev.data.ptr = &connection;
+        connection.want_write = want;
+        return ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &ev) == 0;
+    }
+
+    void close_connection(Connection* connection) {
+        int fd = connection->fd;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        connections_.erase(fd);
+    }
+
+    MonitorSummary global() const {
+        MonitorSummary merged;
+        for (const auto& entry : hosts_) merged.merge(entry.second);
+        return merged;
+    }
+
+    int epoll_fd_ = -1;
+    int signal_fd_ = -1;
+    std::vector<std::unique_ptr<Endpoint>> listeners_;
+    std::vector<std::string> unix_paths_;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+    std::map<std::string, MonitorSummary> hosts_;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t frames_ = 0;
+    uint64_t events_ = 0;
+    uint64_t bytes_ = 0;
+};
+
+int serve(int argc, char** argv) {
+    std::vector<Address> addresses;
+    std::string report_path = "-";
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--listen" && i + 1 < argc) {
+            Address address;
+            if (!parse_address(argv[++i], address)) return usage();
+            addresses.push_back(address);
+        } else if (arg == "--report" && i + 1 < argc) {
+            report_path = argv[++i];
+        } else {
+            return usage();
+        }
+    }
+    if (addresses.empty()) {
+        Address address;
+        parse_address("127.0.0.1:7878", address);
+        addresses.push_back(address);
+    }
+
+    Collector collector;
+    if (!collector.init()) {
+        log_error("init");
+        return 1;
+    }
+    for (const auto& address : addresses) {
+        if (!collector.listen(address)) {
+            log_error("listen");
+            return 1;
+        }
+    }
+    return collector.run(report_path);
+}
+
+// ---------------------------------------------------------------------------
+// Clients (blocking I/O)
+
+bool write_all(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool read_all(int fd, uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::read(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Reads the SUMMARY answering a QUERY. An ERROR frame instead means the
+// collector rejected an earlier frame and has closed the stream.
+bool read_reply(int fd, MonitorSummary& summary) {
+    FrameHeader header;
+    if (!read_all(fd, reinterpret_cast<uint8_t*>(&header), sizeof(header)) ||
+        header.length > collector::kMaxFrameLength) {
+        return false;
+    }
+    std::vector<uint8_t> body(header.length);
+    if (!read_all(fd, body.data(), body.size())) return false;
+    if (header.kind == static_cast<uint8_t>(FrameKind::ERROR)) {
+        std::fprintf(stderr, "cryptomon-collector: rejected: %.*s\n",
+                     static_cast<int>(body.size()), reinterpret_cast<const char*>(body.data()));
+        return false;
+    }
+    return header.kind == static_cast<uint8_t>(FrameKind::SUMMARY) &&
+           summary.deserialize(body.data(), body.size());
+}
+
+// Sends QUERY and waits for the reply. The collector handles a connection's
+// frames in order, so a reply also acknowledges everything sent before it.
+bool query(int fd, const std::string& host, MonitorSummary& summary) {
+    std::vector<uint8_t> frame;
+    collector::appendFrame(frame, FrameKind::QUERY, host);
+    if (!write_all(fd, frame.data(), frame.size())) {
+        // The collector may have closed after rejecting an earlier frame;
+        // its ERROR is still waiting to be read
+        read_reply(fd, summary);
+        return false;
+    }
+    return read_reply(fd, summary);
+}
+
+int connect_client(const std::string& text) {
+    Address address;
+    if (!parse_address(text, address)) return -1;
+    ::signal(SIGPIPE, SIG_IGN);
+    return open_socket(address, false);
+}
+
+bool hello(int fd, const std::string& host) {
+    std::vector<uint8_t> frame;
+    collector::appendFrame(frame, FrameKind::HELLO, host);
+    return write_all(fd, frame.data(), frame.size());
+}
+
+int send_files(int argc, char** argv) {
+    if (argc < 3) return usage();
+    std::string host;
+    bool as_summary = false;
+    std::vector<std::string> files;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--host" && i + 1 < argc) host = argv[++i];
+        else if (arg == "--summary") as_summary = true;
+        else files.push_back(arg);
+    }
+    if (host.empty() || files.empty()) return usage();
+
+    int fd = connect_client(argv[2]);
+    if (fd < 0) {
+        log_error(argv[2]);
+        return 1;
+    }
+    int status = hello(fd, host) ? 0 : 1;
+    for (const auto& path : files) {
+        if (status != 0) break;
+        std::vector<uint8_t> bytes;
+        if (!readCaptureFile(path, bytes)) {
+            std::fprintf(stderr, "cryptomon-collector: cannot read %s\n", path.c_str());
+            status = 1;
+            break;
+        }
+        std::vector<uint8_t> frame;
+        if (as_summary) {
+            // Summarize locally; only the fixed-size accumulators cross the wire
+            EnhancedCryptoMonitor monitor;
+            if (!monitor.loadCapture(bytes.data(), bytes.size())) {
+                std::fprintf(stderr, "cryptomon-collector: malformed capture %s\n", path.c_str());
+                status = 1;
+                break;
+            }
+            collector::appendFrame(frame, FrameKind::SUMMARY, monitor.serializeSummary());
+        } else {
+            collector::appendFrame(frame, FrameKind::CAPTURE, bytes);
+        }
+        if (!write_all(fd, frame.data(), frame.size())) {
+            // Possibly rejected; report the collector's reason if it sent one
+            MonitorSummary ignored;
+            read_reply(fd, ignored);
+            status = 1;
+        }
+    }
+
+    MonitorSummary acknowledged;
+    if (status == 0 && !query(fd, host, acknowledged)) status = 1;
+    if (status != 0) std::fprintf(stderr, "cryptomon-collector: send failed\n");
+    ::close(fd);
+    return status;
+}
+
+int query_collector(int argc, char** argv) {
+    if (argc < 3) return usage();
+    std::string host;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--host" && i + 1 < argc) host = argv[++i];
+        else return usage();
+    }
+    int fd = connect_client(argv[2]);
+    if (fd < 0) {
+        log_error(argv[2]);
+        return 1;
+    }
+    MonitorSummary summary;
+    bool ok = query(fd, host, summary);
+    ::close(fd);
+    if (!ok) {
+        std::fprintf(stderr, "cryptomon-collector: query failed\n");
+        return 1;
+    }
+    std::fputs(kReportHeader, stdout);
+    print_summary(stdout, host.empty() ? "*" : host, summary);
+    return 0;
+}
+
+// Load generator: streams synthetic EVENTS batches and reports the
+// end-to-end ingest rate once the collector acknowledges them.
+int flood(int argc, char** argv) {
+    if (argc < 3) return usage();
+    std::string host;
+    uint64_t total = 10000000;
+    size_t batch = 4096;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--host" && i + 1 < argc) host = argv[++i];
+        else if (arg == "--events" && i + 1 < argc) total = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--batch" && i + 1 < argc) batch = std::strtoul(argv[++i], nullptr, 10);
+        else return usage();
+    }
+    if (host.empty() || batch == 0) return usage();
+
+    std::vector<CompletedOperation> events(batch);
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < batch; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        uint64_t start = i * 1000;
+        events[i] = CompletedOperation{static_cast<uint32_t>(i % EnhancedCryptoMonitor::kOperationCount),
+                                       0, 128, start, start + 200 + state % 800};
+    }
+    std::vector<uint8_t> frame;
+    collector::appendFrame(frame, FrameKind::EVENTS, events.data(),
+                           events.size() * sizeof(CompletedOperation));
+
+    int fd = connect_client(argv[2]);
+    if (fd < 0) {
+        log_error(argv[2]);
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    bool ok = hello(fd, host);
+    uint64_t sent = 0;
+    while (ok && sent + batch <= total) {
+        ok = write_all(fd, frame.data(), frame.size());
+        sent += batch;
+    }
+    MonitorSummary acknowledged;
+    ok = ok && query(fd, host, acknowledged);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::close(fd);
+    if (!ok) {
+        std::fprintf(stderr, "cryptomon-collector: flood failed\n");
+        return 1;
+    }
+    std::printf("%llu events in %.3fs: %.0f events/s\n",
+                static_cast<unsigned long long>(sent), elapsed, sent / elapsed);
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) return usage();
+    std::string command = argv[1];
+    if (command == "serve") return serve(argc, argv);
+    if (command == "send") return send_files(argc, argv);
+    if (command == "query") return query_collector(argc, argv);
+    if (command == "flood") return flood(argc, argv);
+    return usage();
+}
@@ -0,0 +1,445 @@
+// libcrypto_interposer.cpp
+//
+// LD_PRELOAD shim that times common OpenSSL/BoringSSL entry points and
+// records them through EnhancedCryptoMonitor's lock-free per-thread path.
+//
+//   LD_PRELOAD=dist/native/libcrypto_interposer.so CRYPTO_MONITOR_REPORT=out.txt ./service
+//
+// CRYPTO_MONITOR_SPILL=/var/tmp/cm.seg keeps at most CRYPTO_MONITOR_BUDGET_MB
+// (default 256) of measurements in memory and spills older blocks there.
+//
+// No OpenSSL headers are needed: context objects are treated as opaque and
+// key sizes are read through accessors resolved with dlsym, so the same
+// library works against OpenSSL 1.1, 3.x and BoringSSL. A hooked function
+// the library does not provide fails the call the way that function
+// reports errors.
+//
+// Forked children keep recording and write their own report; spilling
+// stays with the parent.
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <dlfcn.h>
+#include <pthread.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "../wasm/crypto_monitor.h"
+
+using CryptoOperation = EnhancedCryptoMonitor::CryptoOperation;
+
+extern "C" {
+struct evp_cipher_ctx_st;
+struct evp_md_ctx_st;
+struct evp_md_st;
+struct rsa_st;
+struct ec_key_st;
+struct ec_group_st;
+struct ECDSA_SIG_st;
+}
+
+namespace {
+
+// Deliberately leaked so recording threads still running during exit
+// never see a destroyed monitor.
+EnhancedCryptoMonitor& monitor() {
+    static EnhancedCryptoMonitor* instance = [] {
+        auto* created = new EnhancedCryptoMonitor();
+        // Long-running services: cap resident measurements and spill the rest
+        if (const char* spill = std::getenv("CRYPTO_MONITOR_SPILL")) {
+            const char* budget = std::getenv("CRYPTO_MONITOR_BUDGET_MB");
+            size_t mb = budget ? std::strtoull(budget, nullptr, 10) : 256;
+            if (!created->enableSpill(spill, mb << 20)) {
+                std::fprintf(stderr, "crypto_monitor: cannot open spill file %s\n", spill);
+            }
+        }
+        return created;
+    }();
+    return *instance;
+}
+
+inline uint64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// The TSC is read directly and scaled to nanoseconds; a clock_gettime pair
+// alone would eat most of the per-call budget. Calibrated once at load.
+struct TscClock {
+    double ns_per_tick = 0.0;
+    uint64_t tsc_origin = 0;
+    uint64_t ns_origin = 0;
+
+    TscClock() {
+        uint64_t ns0 = monotonic_ns();
+        uint64_t tsc0 = __rdtsc();
+        timespec pause{0, 5000000};
+        nanosleep(&pause, nullptr);
+        uint64_t ns1 = monotonic_ns();
+        uint64_t tsc1 = __rdtsc();
+        if (tsc1 > tsc0) {
+            ns_per_tick = static_cast<double>(ns1 - ns0) / static_cast<double>(tsc1 - tsc0);
+        }
+        tsc_origin = tsc1;
+        ns_origin = ns1;
+    }
+};
+
+const TscClock& tsc_clock() {
+    static const TscClock clock;
+    return clock;
+}
+
+inline uint64_t now_ns() {
+    const TscClock& clock = tsc_clock();
+    if (clock.ns_per_tick <= 0.0) return monotonic_ns();
+    uint64_t ticks = __rdtsc() - clock.tsc_origin;
+    return clock.ns_origin + static_cast<uint64_t>(ticks * clock.ns_per_tick);
+}
+#else
+inline uint64_t now_ns() {
+    return monotonic_ns();
+}
+#endif
+
+// Only the outermost call is recorded; PBKDF2 and RSA padding call back
+// into the digest functions we also interpose.
+thread_local int hook_depth = 0;
+
+struct HookScope {
+    HookScope() { ++hook_depth; }
+    ~HookScope() { --hook_depth; }
+    bool outermost() const { return hook_depth == 1; }
+};
+
+template <typename Fn>
+Fn resolve_next(const char* name) {
+    return reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+}
+
+// First symbol found wins; lets us cover renamed accessors across versions.
+template <typename Fn>
+Fn resolve_any(const char* primary, const char* fallback) {
+    void* sym = dlsym(RTLD_DEFAULT, primary);
+    if (!sym && fallback) sym = dlsym(RTLD_DEFAULT, fallback);
+    return reinterpret_cast<Fn>(sym);
+}
+
+// Real entry points
+using EncryptUpdateFn = int (*)(evp_cipher_ctx_st*, unsigned char*, int*,
+                                const unsigned char*, int);
+using DigestUpdateFn = int (*)(evp_md_ctx_st*, const void*, size_t);
+using RsaCryptFn = int (*)(int, const unsigned char*, unsigned char*, rsa_st*, int);
+using EcdsaSignFn = ECDSA_SIG_st* (*)(const unsigned char*, int, ec_key_st*);
+using EcdsaVerifyFn = int (*)(const unsigned char*, int, const ECDSA_SIG_st*, ec_key_st*);
+using Pbkdf2Fn = int (*)(const char*, int, const unsigned char*, int, int,
+                         const evp_md_st*, int, unsigned char*);
+
+// Key size accessors
+using CipherKeyLengthFn = int (*)(const evp_cipher_ctx_st*);
+using CipherCtxCipherFn = const void* (*)(const evp_cipher_ctx_st*);
+using MdCtxMdFn = const evp_md_st* (*)(const evp_md_ctx_st*);
+using MdSizeFn = int (*)(const evp_md_st*);
+using RsaBitsFn = int (*)(const rsa_st*);
+using EcKeyGroupFn = const ec_group_st* (*)(const ec_key_st*);
+using EcGroupDegreeFn = int (*)(const ec_group_st*);
+
+struct Symbols {
+    EncryptUpdateFn encrypt_update;
+    EncryptUpdateFn decrypt_update;
+    DigestUpdateFn digest_update;
+    RsaCryptFn rsa_private_decrypt;
+    RsaCryptFn rsa_public_encrypt;
+    EcdsaSignFn ecdsa_do_sign;
+    EcdsaVerifyFn ecdsa_do_verify;
+    Pbkdf2Fn pbkdf2_hmac;
+
+    CipherKeyLengthFn cipher_key_length;
+    CipherCtxCipherFn cipher_ctx_cipher;
+    MdCtxMdFn md_ctx_md;
+    MdSizeFn md_size;
+    RsaBitsFn rsa_bits;
+    EcKeyGroupFn ec_key_group;
+    EcGroupDegreeFn ec_group_degree;
+
+    Symbols()
+        : encrypt_update(resolve_next<EncryptUpdateFn>("EVP_EncryptUpdate")),
+          decrypt_update(resolve_next<EncryptUpdateFn>("EVP_DecryptUpdate")),
+          digest_update(resolve_next<DigestUpdateFn>("EVP_DigestUpdate")),
+          rsa_private_decrypt(resolve_next<RsaCryptFn>("RSA_private_decrypt")),
+          rsa_public_encrypt(resolve_next<RsaCryptFn>("RSA_public_encrypt")),
+          ecdsa_do_sign(resolve_next<EcdsaSignFn>("ECDSA_do_sign")),
+          ecdsa_do_verify(resolve_next<EcdsaVerifyFn>("ECDSA_do_verify")),
+          pbkdf2_hmac(resolve_next<Pbkdf2Fn>("PKCS5_PBKDF2_HMAC")),
+          cipher_key_length(resolve_any<CipherKeyLengthFn>(
+              "EVP_CIPHER_CTX_get_key_length", "EVP_CIPHER_CTX_key_length")),
+          cipher_ctx_cipher(resolve_any<CipherCtxCipherFn>(
+              "EVP_CIPHER_CTX_get0_cipher", "EVP_CIPHER_CTX_cipher")),
+          md_ctx_md(resolve_any<MdCtxMdFn>("EVP_MD_CTX_get0_md", "EVP_MD_CTX_md")),
+          md_size(resolve_any<MdSizeFn>("EVP_MD_get_size", "EVP_MD_size")),
+          rsa_bits(resolve_any<RsaBitsFn>("RSA_bits", nullptr)),
+          ec_key_group(resolve_any<EcKeyGroupFn>("EC_KEY_get0_group", nullptr)),
+          ec_group_degree(resolve_any<EcGroupDegreeFn>("EC_GROUP_get_degree", nullptr)) {}
+};
+
+const Symbols& symbols() {
+    static const Symbols resolved;
+    return resolved;
+}
+
+inline void record(CryptoOperation op, uint64_t key_size, uint64_t start, uint64_t end) {
+    monitor().recordCompletedOperation(op, key_size, start, end);
+}
+
+// EVP_CIPHER_CTX_get_key_length goes through the provider parameter
+// machinery on OpenSSL 3 and costs more than the hook budget, so results
+// are cached per thread, keyed by context and the cipher bound to it.
+struct CipherKeyCacheEntry {
+    const evp_cipher_ctx_st* ctx;
+    const void* cipher;
+    uint64_t bits;
+};
+
+thread_local CipherKeyCacheEntry cipher_key_cache[64];
+
+uint64_t cipher_key_bits(const evp_cipher_ctx_st* ctx) {
+    const Symbols& sym = symbols();
+    if (!ctx || !sym.cipher_key_length) return 0;
+
+    const void* cipher = sym.cipher_ctx_cipher ? sym.cipher_ctx_cipher(ctx) : nullptr;
+    auto& entry = cipher_key_cache[(reinterpret_cast<uintptr_t>(ctx) >> 4) & 63];
+    if (entry.ctx == ctx && entry.cipher == cipher && cipher) return entry.bits;
+
+    int bytes = sym.cipher_key_length(ctx);
+    entry = {ctx, cipher, bytes > 0 ? static_cast<uint64_t>(bytes) * 8 : 0};
+    return entry.bits;
+}
+
+// Digests have no key; the digest width is the closest analogue.
+uint64_t digest_bits(const evp_md_ctx_st* ctx) {
+    const Symbols& sym = symbols();
+    if (!ctx || !sym.md_ctx_md || !sym.md_size) return 0;
+    const evp_md_st* md = sym.md_ctx_md(ctx);
+    int bytes = md ? sym.md_size(md) : 0;
+    return bytes > 0 ? static_cast<uint64_t>(bytes) * 8 : 0;
+}
+
+uint64_t rsa_key_bits(const rsa_st* rsa) {
+    auto fn = symbols().rsa_bits;
+    int bits = (fn && rsa) ? fn(rsa) : 0;
+    return bits > 0 ? static_cast<uint64_t>(bits) : 0;
+}
+
+uint64_t ec_key_bits(const ec_key_st* key) {
+    const Symbols& sym = symbols();
+    if (!key || !sym.ec_key_group || !sym.ec_group_degree) return 0;
+    const ec_group_st* group = sym.ec_key_group(key);
+    int bits = group ? sym.ec_group_degree(group) : 0;
+    return bits > 0 ? static_cast<uint64_t>(bits) : 0;
+}
+
+// Background consumer for the per-thread rings. Recording threads never
+// touch operation_measurements; only this thread and the exit report do.
+std::atomic<bool> drainer_running{false};
+std::thread* drainer = nullptr;
+
+void start_drainer() {
+    drainer_running.store(true);
+    drainer = new std::thread([] {
+        while (drainer_running.load(std::memory_order_relaxed)) {
+            monitor().drainThreadBuffers();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+}
+
+void stop_drainer() {
+    if (!drainer) return;
+    drainer_running.store(false);
+    drainer->join();
+    delete drainer;
+    drainer = nullptr;
+}
+
+// Only the forking thread survives fork(), so the child starts its own
+// drainer. The buffer registry is held across the fork itself.
+void fork_prepare() {
+    monitor().prepareFork();
+}
+
+void fork_parent() {
+    monitor().afterFork(false);
+}
+
+void fork_child() {
+    bool was_running = drainer != nullptr;
+    // The old std::thread names a thread this process does not have; it can
+    // be neither joined nor destroyed, so it is abandoned
+    drainer = nullptr;
+    monitor().afterFork(true);
+    if (was_running) start_drainer();
+}
+
+void write_report() {
+    stop_drainer();
+
+    const char* path = std::getenv("CRYPTO_MONITOR_REPORT");
+    if (!path) return;
+
+    FILE* out = (path[0] == '-' && path[1] == '\0') ? stderr : std::fopen(path, "w");
+    if (!out) return;
+
+    EnhancedCryptoMonitor& mon = monitor();
+    mon.drainThreadBuffers();
+    std::fprintf(out, "%-16s %10s %14s %14s %14s %14s\n",
+                 "operation", "count", "mean_ns", "stddev_ns", "min_ns", "max_ns");
+    for (size_t i = 0; i < EnhancedCryptoMonitor::kOperationCount; ++i) {
+        auto op = static_cast<CryptoOperation>(i);
+        auto stats = EnhancedCryptoMonitor::summarize(mon.collectExecutionTimes(op));
+        if (stats.count == 0) continue;
+        std::fprintf(out, "%-16s %10zu %14.1f %14.1f %14.1f %14.1f\n",
+                     EnhancedCryptoMonitor::operationName(op), stats.count,
+                     stats.mean, stats.stddev, stats.min, stats.max);
+    }
+    std::fprintf(out, "dropped %llu\n",
+                 static_cast<unsigned long long>(mon.droppedThreadRecords()));
+    if (out != stderr) std::fclose(out);
+}
+
+// Real symbols are resolved lazily on first use so a libcrypto that is
+// dlopen'ed after startup is still found.
+__attribute__((constructor)) void interposer_init() {
+    monitor();
+#if defined(__x86_64__) || defined(__i386__)
+    tsc_clock();
+#endif
+    start_drainer();
+    pthread_atfork(fork_prepare, fork_parent, fork_child);
+    std::atexit(write_report);
+}
+
+}  // namespace
+
+#define CM_EXPORT extern "C" __attribute__((visibility("default")))
+
+CM_EXPORT int EVP_EncryptUpdate(evp_cipher_ctx_st* ctx, unsigned char* out, int* outl,
+                                const unsigned char* in, int inl) {
+    auto real = symbols().encrypt_update;
+    if (!real) return 0;
+    HookScope scope;
+    uint64_t start = now_ns();
+    int ret = real(ctx, out, outl, in, inl);
+    uint64_t end = now_ns();
+    if (scope.outermost()) {
+        record(CryptoOperation::AES_ENCRYPT, cipher_key_bits(ctx), start, end);
+    }
+    return ret;
+}
+
+CM_EXPORT int EVP_DecryptUpdate(evp_cipher_ctx_st* ctx, unsigned char* out, int* outl,
+                                const unsigned char* in, int inl) {
+    auto real = symbols().decrypt_update;
+    if (!real) return 0;
+    HookScope scope;
+    uint64_t start = now_ns();
+    int ret = real(ctx, out, outl, in, inl);
+    uint64_t end = now_ns();
+    if (scope.outermost()) {
+        record(CryptoOperation::AES_DECRYPT, cipher_key_bits(ctx), start, end);
+    }
+    return ret;
+}
+
+CM_EXPORT int EVP_DigestUpdate(evp_md_ctx_st* ctx, const void* data, size_t count) {
+    auto real = symbols().digest_update;
+    if (!real) return 0;
+    HookScope scope;
+    uint64_t start = now_ns();
+    int ret = real(ctx, data, count);
+    uint64_t end = now_ns();
+    if (scope.outermost()) {
+        record(CryptoOperation::SHA256_HASH, digest_bits(ctx), start, end);
+    }
+    return ret;
+}
+
+CM_EXPORT int RSA_private_decrypt(int flen, const unsigned char* from, unsigned char* to,
+                                  rsa_st* rsa, int padding) {
+    auto real = symbols().rsa_private_decrypt;
+    if (!real) return -1;
+    HookScope scope;
+    uint64_t start = now_ns();
+    int ret = real(flen, from, to, rsa, padding);
+    uint64_t end = now_ns();
+    if (scope.outermost()) {
+        record(CryptoOperation::RSA_DECRYPT, rsa_key_bits(rsa), start, end);
+    }
+    return ret;
+}
+
+CM_EXPORT int RSA_public_encrypt(int flen, const unsigned char* from, unsigned char* to,
+                                 rsa_st* rsa, int padding) {
+    auto real = symbols().rsa_public_encrypt;
+    if (!real) return -1;
+    HookScope scope;
+    uint64_t start = now_ns();
+    int ret = real(flen, from, to, rsa, padding);
+    uint64_t end = now_ns();
+    if (scope.outermost()) {
+        record(CryptoOperation::RSA_ENCRYPT, rsa_key_bits(rsa), start, end);
+    }
+    return ret;
+}
+
+CM_EXPORT ECDSA_SIG_st* ECDSA_do_sign(const unsigned char* dgst, int dgst_len,
+                                      ec_key_st* eckey) {
+    auto real = symbols().ecdsa_do_sign;
+    if (!real) return nullptr;
+    HookScope scope;
+    uint64_t start = now_ns();
+    ECDSA_SIG_st* sig = real(dgst, dgst_len, eckey);
+    uint64_t end = now_ns();
+    if (scope.outermost()) {
+        record(CryptoOperation::ECDSA_SIGN, ec_key_bits(eckey), start, end);
+    }
+    return sig;
+}
+
+CM_EXPORT int ECDSA_do_verify(const unsigned char* dgst, int dgst_len,
+                              const ECDSA_SIG_st* sig, ec_key_st* eckey) {
+    auto real = symbols().ecdsa_do_verify;
+    if (!real) return -1;
+    HookScope scope;
+    uint64_t start = now_ns();
+    int ret = real(dgst, dgst_len, sig, eckey);
+    uint64_t end = now_ns();
+    if (scope.outermost()) {
+        record(CryptoOperation::ECDSA_VERIFY, ec_key_bits(eckey), start, end);
+    }
+    return ret;
+}
+
+CM_EXPORT int PKCS5_PBKDF2_HMAC(const char* pass, int passlen, const unsigned char* salt,
+                                int saltlen, int iter, const evp_md_st* digest,
+                                int keylen, unsigned char* out) {
+    auto real = symbols().pbkdf2_hmac;
+    if (!real) return 0;
+    HookScope scope;
+    uint64_t start = now_ns();
+    int ret = real(pass, passlen, salt, saltlen, iter, digest, keylen, out);
+    uint64_t end = now_ns();
+    if (scope.outermost()) {
+        record(CryptoOperation::KEY_DERIVATION,
+               keylen > 0 ? static_cast<uint64_t>(keylen) * 8 : 0, start, end);
+    }
+    return ret;
+}
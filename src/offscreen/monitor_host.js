@@ -0,0 +1,60 @@
+// monitor_host.js
+//
+// Offscreen document that owns the worker-hosted monitor. Service workers
+// cannot start dedicated workers, so the background creates this document
+// on demand and forwards event batches and queries to it, tagged with
+// target 'monitor-host'. Everything else on the runtime channel is left to
+// the other listeners. Content scripts share that channel, so messages
+// from anything but the extension's own pages are ignored.
+
+import WorkerMonitor from '../worker/monitor_client.js';
+import { fromBase64, toBase64 } from '../worker/event_batch.js';
+
+// Page batches cannot share the ring (pages are outside the extension's
+// agent cluster), so this document is its producer: each batch is copied
+// in and the worker drains it with everything else. Sized for two of the
+// largest batches webcrypto_relay.js passes on.
+const monitor = new WorkerMonitor({ capacity: 1 << 17 });
+const EXTENSION_ORIGIN = chrome.runtime.getURL('');
+
+chrome.runtime.onMessage.addListener((request, sender, sendResponse) => {
+  if (request.target !== 'monitor-host') return false;
+  if (sender.id !== chrome.runtime.id || sender.tab ||
+      !String(sender.url).startsWith(EXTENSION_ORIGIN)) {
+    return false;
+  }
+
+  const reply = (promise) => {
+    promise
+      .then(result => sendResponse({ result }))
+      .catch(error => sendResponse({ error: error.message }));
+  };
+
+  switch (request.action) {
+    case 'recordEvents':
+      reply(monitor.ready.then(() => monitor.recordBatch(fromBase64(request.events),
+                                                         request.count, request.timeOrigin)));
+      return true;
+
+    case 'liveDelta':
+      reply(monitor.call('liveDelta', request.subscriber)
+        .then(frame => (frame ? toBase64(frame.buffer) : null)));
+      return true;
+
+    case 'releaseLive':
+      reply(monitor.call('releaseLive', request.subscriber));
+      return true;
+
+    case 'researchMetrics':
+      reply(monitor.researchMetrics(request.operationType, { sliceMs: request.sliceMs }));
+      return true;
+
+    case 'query':
+      reply(monitor.call(request.method, ...(request.args || [])));
+      return true;
+
+    default:
+      sendResponse({ error: 'Unknown action' });
+      return false;
+  }
+});
@@ -0,0 +1,303 @@
+// cryptomon_module.cpp
+//
+// Python bindings over the native analysis engine, for offline work on
+// capture files:
+//
+//   import cryptomon
+//   cap = cryptomon.Capture.load("run.cmcp")
+//   cols = cap.columns("AES_ENCRYPT")    # one copy out of the record store
+//   cap.tvla("AES_ENCRYPT")["max_abs_t"]
+//
+// Analyses release the GIL while they run; each Capture serializes its
+// own calls, so one may be shared between Python threads.
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../native/capture_io.h"
+#include "../wasm/crypto_monitor.h"
+
+namespace py = pybind11;
+
+namespace {
+
+using CryptoOperation = EnhancedCryptoMonitor::CryptoOperation;
+using OperationColumns = EnhancedCryptoMonitor::OperationColumns;
+
+CryptoOperation parse_operation(const std::string& name) {
+    for (size_t i = 0; i < EnhancedCryptoMonitor::kOperationCount; ++i) {
+        auto op = static_cast<CryptoOperation>(i);
+        if (name == EnhancedCryptoMonitor::operationName(op)) return op;
+    }
+    throw py::value_error("unknown operation type: " + name);
+}
+
+std::vector<py::ssize_t> row_major_strides(const std::vector<py::ssize_t>& shape,
+                                           size_t item_size) {
+    std::vector<py::ssize_t> strides(shape.size());
+    py::ssize_t stride = static_cast<py::ssize_t>(item_size);
+    for (size_t i = shape.size(); i-- > 0;) {
+        strides[i] = stride;
+        stride *= shape[i];
+    }
+    return strides;
+}
+
+// Hands a vector's buffer to NumPy; the capsule frees it with the array.
+template <typename T>
+py::array_t<T> adopt(std::vector<T>&& values, std::vector<py::ssize_t> shape) {
+    auto* owned = new std::vector<T>(std::move(values));
+    py::capsule release(owned, [](void* p) { delete static_cast<std::vector<T>*>(p); });
+    auto strides = row_major_strides(shape, sizeof(T));
+    return py::array_t<T>(shape, strides, owned->data(), release);
+}
+
+template <typename T>
+py::array_t<T> adopt(std::vector<T>&& values) {
+    py::ssize_t n = static_cast<py::ssize_t>(values.size());
+    return adopt(std::move(values), {n});
+}
+
+// Read-only view into storage kept alive by `owner`.
+template <typename T>
+py::array view(const std::vector<T>& column, std::vector<py::ssize_t> shape,
+               py::handle owner) {
+    auto strides = row_major_strides(shape, sizeof(T));
+    py::array_t<T> array(shape, strides, column.data(), owner);
+    array.attr("flags").attr("writeable") = false;
+    return std::move(array);
+}
+
+template <typename T>
+py::array view(const std::vector<T>& column, py::handle owner) {
+    return view(column, {static_cast<py::ssize_t>(column.size())}, owner);
+}
+
+py::dict to_dict(const EnhancedCryptoMonitor::SummaryStatistics& stats) {
+    py::dict d;
+    d["count"] = stats.count;
+    d["mean"] = stats.mean;
+    d["stddev"] = stats.stddev;
+    d["min"] = stats.min;
+    d["max"] = stats.max;
+    return d;
+}
+
+// Column store for one operation, copied out of the record store once by
+// Capture::columns(); NumPy arrays returned from its properties alias
+// these vectors and keep this object alive.
+struct ColumnSet {
+    OperationColumns data;
+};
+
+class Capture {
+public:
+    Capture() : monitor_(std::make_unique<EnhancedCryptoMonitor>()) {}
+
+    static std::shared_ptr<Capture> load(const std::string& path) {
+        std::vector<uint8_t> bytes;
+        if (!readCaptureFile(path, bytes)) {
+            throw std::runtime_error("cannot read capture file: " + path);
+        }
+        auto capture = std::make_shared<Capture>();
+        capture->append(bytes.data(), bytes.size());
+        return capture;
+    }
+
+    static std::shared_ptr<Capture> fromBytes(const py::bytes& data) {
+        char* buffer = nullptr;
+        Py_ssize_t size = 0;
+        if (PyBytes_AsStringAndSize(data.ptr(), &buffer, &size) != 0) {
+            throw py::error_already_set();
+        }
+        auto capture = std::make_shared<Capture>();
+        capture->append(reinterpret_cast<const uint8_t*>(buffer), static_cast<size_t>(size));
+        return capture;
+    }
+
+    void append(const uint8_t* data, size_t size) {
+        bool ok = locked([&](EnhancedCryptoMonitor& monitor) {
+            return monitor.loadCapture(data, size);
+        });
+        if (!ok) throw std::runtime_error("malformed capture data");
+    }
+
+    void appendFile(const std::string& path) {
+        std::vector<uint8_t> bytes;
+        if (!readCaptureFile(path, bytes)) {
+            throw std::runtime_error("cannot read capture file: " + path);
+        }
+        append(bytes.data(), bytes.size());
+    }
+
+    void save(const std::string& path) {
+        std::vector<uint8_t> bytes = locked([](EnhancedCryptoMonitor& monitor) {
+            return monitor.serializeCapture();
+        });
+        if (!writeCaptureFile(path, bytes)) {
+            throw std::runtime_error("cannot write capture file: " + path);
+        }
+    }
+
+    py::dict operations() {
+        std::vector<size_t> sizes = locked([](EnhancedCryptoMonitor& monitor) {
+            std::vector<size_t> n(EnhancedCryptoMonitor::kOperationCount);
+            for (size_t i = 0; i < n.size(); ++i) {
+                n[i] = monitor.measurementCount(static_cast<CryptoOperation>(i));
+            }
+            return n;
+        });
+        py::dict counts;
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            auto op = static_cast<CryptoOperation>(i);
+            if (sizes[i] > 0) counts[EnhancedCryptoMonitor::operationName(op)] = sizes[i];
+        }
+        return counts;
+    }
+
+    std::shared_ptr<ColumnSet> columns(const std::string& operation) {
+        CryptoOperation op = parse_operation(operation);
+        auto set = std::make_shared<ColumnSet>();
+        set->data = locked([&](EnhancedCryptoMonitor& monitor) {
+            return monitor.extractColumns(op);
+        });
+        return set;
+    }
+
+    py::dict timing(const std::string& operation) {
+        CryptoOperation op = parse_operation(operation);
+        EnhancedCryptoMonitor::TimingAnalysis analysis;
+        EnhancedCryptoMonitor::SummaryStatistics rounds;
+        EnhancedCryptoMonitor::SummaryStatistics power;
+        locked([&](EnhancedCryptoMonitor& monitor) {
+            analysis = monitor.timingAnalysis(op);
+            rounds = EnhancedCryptoMonitor::summarize(analysis.round_variations);
+            power = EnhancedCryptoMonitor::summarize(analysis.power_variations);
+        });
+        py::dict d;
+        d["statistics"] = to_dict(analysis.statistics);
+        d["round_variation_statistics"] = to_dict(rounds);
+        d["power_variation_statistics"] = to_dict(power);
+        d["execution_times"] = adopt(std::move(analysis.execution_times));
+        d["round_variations"] = adopt(std::move(analysis.round_variations));
+        d["power_variations"] = adopt(std::move(analysis.power_variations));
+        return d;
+    }
+
+    py::dict tvla(const std::string& operation) {
+        CryptoOperation op = parse_operation(operation);
+        TvlaResult result = locked([&](EnhancedCryptoMonitor& monitor) {
+            return monitor.tvlaAnalysis(op);
+        });
+        py::dict d;
+        d["fixed_count"] = result.fixed_count;
+        d["random_count"] = result.random_count;
+        d["execution_time_t"] = result.execution_time_t;
+        d["round_power_t"] = adopt(std::move(result.round_power_t));
+        d["round_timing_t"] = adopt(std::move(result.round_timing_t));
+        d["max_abs_t"] = result.max_abs_t;
+        d["leakage_detected"] = result.leakage_detected;
+        return d;
+    }
+
+    py::dict cpa(const std::string& operation) {
+        CryptoOperation op = parse_operation(operation);
+        CpaResult result = locked([&](EnhancedCryptoMonitor& monitor) {
+            return monitor.cpaAnalysis(op);
+        });
+        py::dict d;
+        d["trace_count"] = result.trace_count;
+        d["points"] = result.points;
+        d["best_guess"] = result.best_guess;
+        d["best_correlation"] = result.best_correlation;
+        d["peak_correlation"] = adopt(std::vector<double>(result.peak_correlation.begin(),
+                                                          result.peak_correlation.end()));
+        py::ssize_t points = static_cast<py::ssize_t>(result.points);
+        d["correlations"] = result.points > 0
+            ? adopt(std::move(result.correlations), {256, points})
+            : adopt(std::vector<double>(), {0, 0});
+        return d;
+    }
+
+private:
+    // Runs fn(monitor) with the GIL released and this capture locked. The
+    // lock is taken after the GIL is dropped and freed before it is taken
+    // back, so a thread waiting for one never holds the other.
+    template <typename Fn>
+    auto locked(Fn&& fn) -> decltype(fn(std::declval<EnhancedCryptoMonitor&>())) {
+        py::gil_scoped_release release;
+        std::lock_guard<std::mutex> lock(mutex_);
+        return fn(*monitor_);
+    }
+
+    std::mutex mutex_;
+    std::unique_ptr<EnhancedCryptoMonitor> monitor_;
+};
+
+}  // namespace
+
+PYBIND11_MODULE(cryptomon, m) {
+    m.doc() = "Offline analysis of crypto monitor capture files";
+
+    py::class_<ColumnSet, std::shared_ptr<ColumnSet>>(m, "ColumnSet")
+        .def("__len__", [](const ColumnSet& c) { return c.data.count; })
+        .def_property_readonly("start_cycle", [](py::object self) {
+            return view(self.cast<ColumnSet&>().data.start_cycle, self);
+        })
+        .def_property_readonly("end_cycle", [](py::object self) {
+            return view(self.cast<ColumnSet&>().data.end_cycle, self);
+        })
+        .def_property_readonly("start_inst", [](py::object self) {
+            return view(self.cast<ColumnSet&>().data.start_inst, self);
+        })
+        .def_property_readonly("end_inst", [](py::object self) {
+            return view(self.cast<ColumnSet&>().data.end_inst, self);
+        })
+        .def_property_readonly("key_size", [](py::object self) {
+            return view(self.cast<ColumnSet&>().data.key_size, self);
+        })
+        .def_property_readonly("rounds", [](py::object self) {
+            return view(self.cast<ColumnSet&>().data.rounds, self);
+        })
+        .def_property_readonly("label", [](py::object self) {
+            return view(self.cast<ColumnSet&>().data.label, self);
+        })
+        .def_property_readonly("execution_time", [](py::object self) {
+            return view(self.cast<ColumnSet&>().data.execution_time, self);
+        })
+        .def_property_readonly("l1_miss_rate", [](py::object self) {
+            return view(self.cast<ColumnSet&>().data.l1_miss_rate, self);
+        })
+        .def_property_readonly("mispredict_rate", [](py::object self) {
+            return view(self.cast<ColumnSet&>().data.mispredict_rate, self);
+        })
+        .def_property_readonly("energy", [](py::object self) {
+            return view(self.cast<ColumnSet&>().data.energy, self);
+        })
+        .def_property_readonly("round_power", [](py::object self) {
+            const auto& data = self.cast<ColumnSet&>().data;
+            return view(data.round_power,
+                        {static_cast<py::ssize_t>(data.count),
+                         static_cast<py::ssize_t>(data.round_width)},
+                        self);
+        });
+
+    py::class_<Capture, std::shared_ptr<Capture>>(m, "Capture")
+        .def(py::init<>())
+        .def_static("load", &Capture::load, py::arg("path"))
+        .def_static("from_bytes", &Capture::fromBytes, py::arg("data"))
+        .def("append_file", &Capture::appendFile, py::arg("path"))
+        .def("save", &Capture::save, py::arg("path"))
+        .def("operations", &Capture::operations)
+        .def("columns", &Capture::columns, py::arg("operation"))
+        .def("timing", &Capture::timing, py::arg("operation"))
+        .def("tvla", &Capture::tvla, py::arg("operation"))
+        .def("cpa", &Capture::cpa, py::arg("operation"));
+}
@@ -0,0 +1,490 @@
+// alert_rules.h
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "event_ring.h"
+#include "side_channel_analysis.h"
+#include "sliding_window.h"
+#include "streaming_stats.h"
+
+enum class AlertMetric { COUNT, MEAN, STDDEV, MIN, MAX, QUANTILE, TVLA_MAX_T };
+enum class AlertComparison { GREATER, GREATER_EQUAL, LESS, LESS_EQUAL };
+
+// One parsed rule. Times are nanoseconds; key_size 0 matches any key and
+// window_ns 0 means everything since the rule was added.
+struct AlertRule {
+    AlertMetric metric = AlertMetric::MEAN;
+    double quantile = 0.0;
+    uint32_t op = 0;
+    uint64_t key_size = 0;
+    uint64_t window_ns = 0;
+    AlertComparison comparison = AlertComparison::GREATER;
+    double threshold = 0.0;
+};
+
+// Case-insensitive grammar:
+//   STAT of OP [KEY_SIZE] [over DURATION] CMP VALUE
+//   tvla [|t|] CMP VALUE for OP
+// STAT is count, mean, stddev, min, max or pNN[.N]; CMP is >, >=, < or
+// <=; DURATION takes ms, s, m or h; time VALUEs take ns (default), us, ms
+// or s. Example: "p99 of RSA_DECRYPT 2048 over 1m > 3ms".
+class AlertRuleParser {
+public:
+    explicit AlertRuleParser(std::vector<std::string> operation_names)
+        : operation_names_(std::move(operation_names)) {}
+
+    bool parse(const std::string& text, AlertRule& rule, std::string& error) const {
+        std::vector<std::string> tokens = tokenize(text);
+        size_t pos = 0;
+        auto next = [&]() -> std::string { return pos < tokens.size() ? tokens[pos++] : std::string(); };
+        auto peek = [&]() -> std::string { return pos < tokens.size() ? tokens[pos] : std::string(); };
+
+        AlertRule parsed;
+        std::string head = lower(next());
+        bool time_valued = true;
+        if (head == "tvla") {
+            parsed.metric = AlertMetric::TVLA_MAX_T;
+            time_valued = false;
+            if (peek() == "|t|") next();
+            if (!parse_comparison(next(), parsed.comparison)) return fail(error, "expected comparison");
+            if (!parse_value(next(), false, parsed.threshold)) return fail(error, "expected threshold");
+            if (lower(next()) != "for") return fail(error, "expected 'for'");
+            if (!parse_operation(next(), parsed.op)) return fail(error, "unknown operation");
+        } else {
+            if (!parse_metric(head, parsed)) return fail(error, "unknown statistic '" + head + "'");
+            time_valued = parsed.metric != AlertMetric::COUNT;
+            if (lower(next()) != "of") return fail(error, "expected 'of'");
+            if (!parse_operation(next(), parsed.op)) return fail(error, "unknown operation");
+            if (!peek().empty() && std::isdigit(static_cast<unsigned char>(peek()[0]))) {
+                char* end = nullptr;
+                std::string token = next();
+                parsed.key_size = std::strtoull(token.c_str(), &end, 10);
+                if (*end != '\0' || parsed.key_size == 0) return fail(error, "bad key size");
+            }
+            if (lower(peek()) == "over") {
+                next();
+                if (!parse_duration(next(), parsed.window_ns)) return fail(error, "bad duration");
+            }
+            if (!parse_comparison(next(), parsed.comparison)) return fail(error, "expected comparison");
+            if (!parse_value(next(), time_valued, parsed.threshold)) return fail(error, "expected threshold");
+        }
+        if (pos != tokens.size()) return fail(error, "unexpected '" + tokens[pos] + "'");
+        rule = parsed;
+        return true;
+    }
+
+private:
+    static bool fail(std::string& error, const std::string& message) {
+        error = message;
+        return false;
+    }
+
+    // Whitespace-separated, with runs of <, > and = split out on their own
+    static std::vector<std::string> tokenize(const std::string& text) {
+        std::vector<std::string> tokens;
+        std::string current;
+        auto flush = [&]() {
+            if (!current.empty()) tokens.push_back(current);
+            current.clear();
+        };
+        for (size_t i = 0; i < text.size(); ++i) {
+            char c = text[i];
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                flush();
+            } else if (c == '<' || c == '>' || c == '=') {
+                flush();
+                while (i < text.size() && (text[i] == '<' || text[i] == '>' || text[i] == '=')) {
+                    current += text[i++];
+                }
+                --i;
+                flush();
+            } else {
+                current += c;
+            }
+        }
+        flush();
+        return tokens;
+    }
+
+    static std::string lower(std::string s) {
+        for (char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return s;
+    }
+
+    static bool parse_metric(const std::string& name, AlertRule& rule) {
+        static const std::map<std::string, AlertMetric> metrics = {
+            {"count", AlertMetric::COUNT}, {"mean", AlertMetric::MEAN},
+            {"stddev", AlertMetric::STDDEV}, {"min", AlertMetric::MIN},
+            {"max", AlertMetric::MAX}
+        };
+        auto it = metrics.find(name);
+        if (it != metrics.end()) {
+            rule.metric = it->second;
+            return true;
+        }
+        if (name.size() < 2 || name[0] != 'p') return false;
+        char* end = nullptr;
+        double percentile = std::strtod(name.c_str() + 1, &end);
+        if (*end != '\0' || !(percentile >= 0.0 && percentile <= 100.0)) return false;
+        rule.metric = AlertMetric::QUANTILE;
+        rule.quantile = percentile / 100.0;
+        return true;
+    }
+
+    bool parse_operation(const std::string& name, uint32_t& op) const {
+        std::string upper = name;
+        for (char& c : upper) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        for (size_t i = 0; i < operation_names_.size(); ++i) {
+            if (operation_names_[i] == upper) {
+                op = static_cast<uint32_t>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool parse_comparison(const std::string& token, AlertComparison& comparison) {
+        if (token == ">") comparison = AlertComparison::GREATER;
+        else if (token == ">=") comparison = AlertComparison::GREATER_EQUAL;
+        else if (token == "<") comparison = AlertComparison::LESS;
+        else if (token == "<=") comparison = AlertComparison::LESS_EQUAL;
+        else return false;
+        return true;
+    }
+
+    static bool parse_value(const std::string& token, bool time_valued, double& value) {
+        if (token.empty()) return false;
+        char* end = nullptr;
+        value = std::strtod(token.c_str(), &end);
+        if (end == token.c_str() || !std::isfinite(value)) return false;
+        std::string unit = lower(end);
+        if (unit.empty()) return true;
+        if (!time_valued) return false;
+        if (unit == "ns") return true;
+        if (unit == "us") value *= 1e3;
+        else if (unit == "ms") value *= 1e6;
+        else if (unit == "s") value *= 1e9;
+        else return false;
+        return true;
+    }
+
+    static bool parse_duration(const std::string& token, uint64_t& ns) {
+        char* end = nullptr;
+        double amount = std::strtod(token.c_str(), &end);
+        if (end == token.c_str() || !(amount > 0.0)) return false;
+        std::string unit = lower(end);
+        double scale = 0.0;
+        if (unit == "ms") scale = 1e6;
+        else if (unit == "s") scale = 1e9;
+        else if (unit == "m") scale = 60e9;
+        else if (unit == "h") scale = 3600e9;
+        else return false;
+        ns = static_cast<uint64_t>(amount * scale);
+        return ns > 0;
+    }
+
+    std::vector<std::string> operation_names_;
+};
+
+// A rule crossing its threshold (firing) or dropping back (resolved)
+struct AlertEvent {
+    uint64_t timestamp;
+    uint32_t rule;
+    bool firing;
+    double value;
+};
+
+struct AlertState {
+    uint32_t rule;
+    std::string text;
+    bool firing;
+    double value;  // NaN until the source has data
+};
+
+// Rules compiled into shared sources: every distinct (op, key size,
+// window, kind) gets one accumulator, fed on ingest and marked dirty.
+// evaluate() only recomputes dirty sources (windows also turn dirty when
+// a bucket expires) and compares each dependent rule against the values
+// computed once per source; all quantiles of a source come from a single
+// sketch pass. Sources start empty when first referenced. Ingest-driven
+// checks go through maybeEvaluate(), which runs at most once per interval.
+class AlertEngine {
+public:
+    static constexpr size_t kRingCapacity = 1024;
+    static constexpr size_t kWindowBuckets = 60;
+    static constexpr uint64_t kDefaultIntervalNs = 1000000;  // 1 ms
+
+    using Callback = std::function<void(const AlertEvent&)>;
+
+    explicit AlertEngine(std::vector<std::string> operation_names)
+        : parser_(operation_names), by_op_(operation_names.size()) {}
+
+    // Returns the new rule id, or -1 with `error` set
+    int64_t addRule(const std::string& text, std::string& error) {
+        AlertRule parsed;
+        if (!parser_.parse(text, parsed, error)) return -1;
+
+        uint32_t id = next_id_++;
+        Rule& rule = rules_[id];
+        rule.id = id;
+        rule.text = text;
+        rule.rule = parsed;
+        rule.source = source_for(parsed);
+        rule.source->rules.push_back(&rule);
+        compile(*rule.source);
+        return id;
+    }
+
+    bool removeRule(uint32_t id) {
+        auto it = rules_.find(id);
+        if (it == rules_.end()) return false;
+        Source* source = it->second.source;
+        auto& dependents = source->rules;
+        dependents.erase(std::remove(dependents.begin(), dependents.end(), &it->second),
+                         dependents.end());
+        rules_.erase(it);
+        if (dependents.empty()) {
+            drop_source(source);
+        } else {
+            compile(*source);
+        }
+        return true;
+    }
+
+    bool empty() const { return rules_.empty(); }
+
+    void observe(uint32_t op, uint64_t key_size, uint64_t timestamp, double execution_time,
+                 uint32_t label, const std::vector<double>& round_power,
+                 const std::vector<uint64_t>& round_timings) {
+        for (Source* source : by_op_[op]) {
+            if (source->key_size != 0 && source->key_size != key_size) continue;
+            if (source->tvla) {
+                source->tvla_state.add(label, execution_time, round_power, round_timings);
+            } else if (source->window_ns) {
+                source->window.add(timestamp, execution_time);
+            } else {
+                source->moments.add(execution_time);
+                source->sketch.add(execution_time);
+            }
+            source->dirty = true;
+        }
+    }
+
+    void setInterval(uint64_t interval_ns) { interval_ns_ = interval_ns; }
+
+    void maybeEvaluate(uint64_t now) {
+        if (now >= last_evaluation_ && now - last_evaluation_ < interval_ns_) return;
+        evaluate(now);
+    }
+
+    void evaluate(uint64_t now) {
+        last_evaluation_ = now;
+        for (auto& owned : sources_) {
+            Source& source = *owned;
+            if (source.window_ns) {
+                uint64_t epoch = now / source.window.bucketNs();
+                if (epoch != source.epoch) {
+                    source.epoch = epoch;
+                    source.dirty = true;
+                }
+            }
+            if (!source.dirty) continue;
+            source.dirty = false;
+            Values values;
+            compute(source, now, values);
+            for (Rule* rule : source.rules) update(*rule, values, now);
+        }
+    }
+
+    void setCallback(Callback callback) { callback_ = std::move(callback); }
+
+    size_t poll(std::vector<AlertEvent>& out, size_t limit = SIZE_MAX) {
+        return ring_.poll(out, limit);
+    }
+
+    std::vector<AlertState> states() const {
+        std::vector<AlertState> result;
+        result.reserve(rules_.size());
+        for (const auto& entry : rules_) {
+            const Rule& rule = entry.second;
+            result.push_back(AlertState{rule.id, rule.text, rule.firing, rule.value});
+        }
+        return result;
+    }
+
+private:
+    struct Rule;
+
+    struct Source {
+        uint32_t op = 0;
+        uint64_t key_size = 0;
+        uint64_t window_ns = 0;
+        bool tvla = false;
+        bool extremes = false;
+        bool dirty = true;
+        uint64_t epoch = 0;
+        std::vector<double> quantiles;  // distinct, ascending
+        SlidingWindowStats window;
+        RunningMoments moments;
+        QuantileSketch sketch;
+        TvlaAccumulator tvla_state;
+        std::vector<Rule*> rules;
+    };
+
+    struct Rule {
+        uint32_t id = 0;
+        std::string text;
+        AlertRule rule;
+        Source* source = nullptr;
+        size_t quantile_slot = 0;
+        bool firing = false;
+        double value = std::numeric_limits<double>::quiet_NaN();
+    };
+
+    struct Values {
+        uint64_t count = 0;
+        double mean = 0.0;
+        double stddev = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+        std::vector<double> quantiles;
+        WindowExtremes folded;
+        double tvla_max_t = 0.0;
+    };
+
+    Source* source_for(const AlertRule& rule) {
+        bool tvla = rule.metric == AlertMetric::TVLA_MAX_T;
+        uint64_t window_ns = tvla ? 0 : rule.window_ns;
+        uint64_t key_size = tvla ? 0 : rule.key_size;
+        for (Source* source : by_op_[rule.op]) {
+            if (source->tvla == tvla && source->window_ns == window_ns &&
+                source->key_size == key_size) {
+                return source;
+            }
+        }
+        auto source = std::make_unique<Source>();
+        source->op = rule.op;
+        source->key_size = key_size;
+        source->window_ns = window_ns;
+        source->tvla = tvla;
+        if (window_ns) source->window.configure(window_ns, kWindowBuckets);
+        by_op_[rule.op].push_back(source.get());
+        sources_.push_back(std::move(source));
+        return sources_.back().get();
+    }
+
+    void drop_source(Source* source) {
+        auto& list = by_op_[source->op];
+        list.erase(std::remove(list.begin(), list.end(), source), list.end());
+        sources_.erase(std::remove_if(sources_.begin(), sources_.end(),
+                                      [source](const std::unique_ptr<Source>& owned) {
+                                          return owned.get() == source;
+                                      }),
+                       sources_.end());
+    }
+
+    // The evaluation plan of a source: whether it needs the extremes fold
+    // and which quantiles its rules read, each computed once
+    static void compile(Source& source) {
+        source.extremes = false;
+        source.quantiles.clear();
+        for (Rule* rule : source.rules) {
+            AlertMetric metric = rule->rule.metric;
+            if (metric == AlertMetric::MIN || metric == AlertMetric::MAX ||
+                metric == AlertMetric::QUANTILE) {
+                source.extremes = true;
+            }
+            if (metric == AlertMetric::QUANTILE) source.quantiles.push_back(rule->rule.quantile);
+        }
+        std::sort(source.quantiles.begin(), source.quantiles.end());
+        source.quantiles.erase(std::unique(source.quantiles.begin(), source.quantiles.end()),
+                               source.quantiles.end());
+        for (Rule* rule : source.rules) {
+            if (rule->rule.metric != AlertMetric::QUANTILE) continue;
+            rule->quantile_slot = static_cast<size_t>(
+                std::lower_bound(source.quantiles.begin(), source.quantiles.end(),
+                                 rule->rule.quantile) - source.quantiles.begin());
+        }
+        source.dirty = true;
+    }
+
+    static void compute(Source& source, uint64_t now, Values& values) {
+        if (source.tvla) {
+            values.tvla_max_t = source.tvla_state.result().max_abs_t;
+            values.count = source.tvla_state.executionMoments(0).count +
+                           source.tvla_state.executionMoments(1).count;
+        } else if (source.window_ns) {
+            WindowStatistics stats = source.window.query(now, false);
+            values.count = stats.count;
+            values.mean = stats.mean;
+            values.stddev = stats.stddev;
+            if (source.extremes && stats.count > 0) {
+                source.window.foldExtremes(values.folded);
+                values.min = values.folded.min;
+                values.max = values.folded.max;
+                values.folded.sketch.quantiles(source.quantiles, values.quantiles);
+            }
+        } else {
+            values.count = source.moments.count;
+            values.mean = source.moments.mean;
+            values.stddev = source.moments.stddev();
+            values.min = source.moments.min;
+            values.max = source.moments.max;
+            source.sketch.quantiles(source.quantiles, values.quantiles);
+        }
+    }
+
+    static double pick(const Rule& compiled, const Values& values) {
+        const AlertRule& rule = compiled.rule;
+        if (rule.metric == AlertMetric::COUNT) return static_cast<double>(values.count);
+        if (values.count == 0) return std::numeric_limits<double>::quiet_NaN();
+        switch (rule.metric) {
+            case AlertMetric::MEAN: return values.mean;
+            case AlertMetric::STDDEV: return values.stddev;
+            case AlertMetric::MIN: return values.min;
+            case AlertMetric::MAX: return values.max;
+            case AlertMetric::QUANTILE: return values.quantiles[compiled.quantile_slot];
+            case AlertMetric::TVLA_MAX_T: return values.tvla_max_t;
+            default: return std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+
+    void update(Rule& rule, const Values& values, uint64_t now) {
+        rule.value = pick(rule, values);
+        // NaN compares false, so a source without data never fires
+        bool firing = false;
+        switch (rule.rule.comparison) {
+            case AlertComparison::GREATER: firing = rule.value > rule.rule.threshold; break;
+            case AlertComparison::GREATER_EQUAL: firing = rule.value >= rule.rule.threshold; break;
+            case AlertComparison::LESS: firing = rule.value < rule.rule.threshold; break;
+            case AlertComparison::LESS_EQUAL: firing = rule.value <= rule.rule.threshold; break;
+        }
+        if (firing == rule.firing) return;
+        rule.firing = firing;
+        AlertEvent event{now, rule.id, firing, rule.value};
+        ring_.push(event);
+        if (callback_) callback_(event);
+    }
+
+    AlertRuleParser parser_;
+    std::map<uint32_t, Rule> rules_;
+    std::vector<std::unique_ptr<Source>> sources_;
+    std::vector<std::vector<Source*>> by_op_;
+    uint32_t next_id_ = 0;
+    uint64_t interval_ns_ = kDefaultIntervalNs;
+    uint64_t last_evaluation_ = 0;
+    EventRing<AlertEvent, kRingCapacity> ring_;
+    Callback callback_;
+};
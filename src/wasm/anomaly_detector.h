@@ -0,0 +1,109 @@
+// anomaly_detector.h
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "event_ring.h"
+
+// Exponentially weighted mean and variance. update() scores a sample
+// against the state before it and then folds it in, so a sustained shift
+// is flagged at first and absorbed once it becomes the new normal.
+struct EwmaTracker {
+    double mean = 0.0;
+    double variance = 0.0;
+    uint64_t count = 0;
+
+    double update(double x, double alpha) {
+        double z = 0.0;
+        if (count == 0) {
+            mean = x;
+        } else {
+            double diff = x - mean;
+            if (variance > 0.0) z = diff / std::sqrt(variance);
+            double increment = alpha * diff;
+            mean += increment;
+            variance = (1.0 - alpha) * (variance + diff * increment);
+        }
+        ++count;
+        return z;
+    }
+};
+
+// One flagged sample. `round` is -1 for a whole-operation execution time.
+struct AnomalyEvent {
+    uint64_t timestamp;
+    uint32_t op;
+    int32_t round;
+    double value;
+    double z_score;
+};
+
+struct AnomalyConfig {
+    double alpha = 0.05;      // weight of the newest sample
+    double threshold = 4.0;   // |z| at or above which an event is raised
+    uint64_t warmup = 30;     // samples per tracker before scoring starts
+};
+
+// EWMA z-score trackers per operation and per round index. Events go to
+// the optional callback and into a fixed ring that keeps the newest
+// kRingCapacity entries for polling consumers.
+class AnomalyDetector {
+public:
+    static constexpr size_t kRingCapacity = 1024;
+    static constexpr size_t kMaxTrackedRounds = 256;
+
+    using Callback = std::function<void(const AnomalyEvent&)>;
+
+    explicit AnomalyDetector(size_t operations) : operations_(operations), rounds_(operations) {}
+
+    // Changing the decay or warmup restarts every tracker
+    void configure(const AnomalyConfig& config) {
+        config_ = config;
+        for (auto& tracker : operations_) tracker = EwmaTracker();
+        for (auto& rounds : rounds_) rounds.clear();
+    }
+
+    const AnomalyConfig& config() const { return config_; }
+
+    void setCallback(Callback callback) { callback_ = std::move(callback); }
+
+    void observeOperation(uint32_t op, uint64_t timestamp, double value) {
+        score(operations_[op], op, -1, timestamp, value);
+    }
+
+    void observeRound(uint32_t op, size_t round, uint64_t timestamp, double value) {
+        if (round >= kMaxTrackedRounds) return;
+        auto& rounds = rounds_[op];
+        if (rounds.size() <= round) rounds.resize(round + 1);
+        score(rounds[round], op, static_cast<int32_t>(round), timestamp, value);
+    }
+
+    size_t poll(std::vector<AnomalyEvent>& out, size_t limit = SIZE_MAX) {
+        return ring_.poll(out, limit);
+    }
+
+    // Events overwritten before anyone polled them
+    uint64_t overwritten() const { return ring_.overwritten(); }
+
+private:
+    void score(EwmaTracker& tracker, uint32_t op, int32_t round, uint64_t timestamp,
+               double value) {
+        bool armed = tracker.count >= config_.warmup;
+        double z = tracker.update(value, config_.alpha);
+        if (!armed || std::fabs(z) < config_.threshold) return;
+
+        AnomalyEvent event{timestamp, op, round, value, z};
+        ring_.push(event);
+        if (callback_) callback_(event);
+    }
+
+    AnomalyConfig config_;
+    std::vector<EwmaTracker> operations_;
+    std::vector<std::vector<EwmaTracker>> rounds_;
+    EventRing<AnomalyEvent, kRingCapacity> ring_;
+    Callback callback_;
+};
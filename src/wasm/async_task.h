@@ -0,0 +1,334 @@
+// async_task.h
+#pragma once
+
+// Awaitable analysis tasks on C++20 coroutines. A Task<T> is lazy: its
+// body starts when it is first awaited (or handed to whenAll/syncWait) and
+// runs on the awaiting thread until it awaits something else, such as
+// ThreadPool::schedule(), which moves the rest of it onto a pool worker.
+// Exceptions thrown in a task are rethrown to whoever awaits it.
+//
+// Everything here needs coroutine support; the rest of the monitor is
+// C++17 and checks CRYPTO_MONITOR_HAS_COROUTINES before using it. The
+// pool and syncWait also need threads, so a single-threaded WASM build
+// gets Task and whenAll only.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define CRYPTO_MONITOR_HAS_COROUTINES 1
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#define CRYPTO_MONITOR_HAS_THREAD_POOL 1
+#include <condition_variable>
+#include <deque>
+#include <system_error>
+#include <thread>
+#endif
+
+template <typename T = void>
+class Task;
+
+namespace task_detail {
+
+// Hands control back to the awaiting coroutine, if any, without growing
+// the stack
+struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> self) noexcept {
+        std::coroutine_handle<> next = self.promise().continuation;
+        return next ? next : std::noop_coroutine();
+    }
+    void await_resume() const noexcept {}
+};
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+    template <typename U>
+    void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object() noexcept;
+    void return_void() const noexcept {}
+};
+
+// Result storage that also works for Task<void>
+struct Unit {};
+template <typename T>
+using Slot = std::optional<std::conditional_t<std::is_void_v<T>, Unit, T>>;
+
+// Fire-and-forget frame for the drivers below; it frees itself on exit
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+}  // namespace task_detail
+
+template <typename T>
+class Task {
+public:
+    using promise_type = task_detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(Handle handle) : handle_(handle) {}
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (handle_) handle_.destroy();
+    }
+
+    bool valid() const { return static_cast<bool>(handle_); }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+    T await_resume() {
+        promise_type& promise = handle_.promise();
+        if (promise.error) std::rethrow_exception(promise.error);
+        if constexpr (!std::is_void_v<T>) return std::move(*promise.value);
+    }
+
+private:
+    Handle handle_;
+};
+
+namespace task_detail {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+// Counts outstanding tasks plus one for the awaiter itself, so whichever
+// of them finishes last (possibly the awaiter, if everything completed
+// inline) resumes the awaiting coroutine
+struct WhenAllLatch {
+    std::atomic<size_t> remaining{1};
+    std::coroutine_handle<> continuation;
+    std::mutex mutex;
+    std::exception_ptr error;
+
+    void arrive() {
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) continuation.resume();
+    }
+};
+
+template <typename T>
+Detached whenAllMember(Task<T> task, Slot<T>* slot, WhenAllLatch* latch) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+        } else {
+            slot->emplace(co_await task);
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(latch->mutex);
+        if (!latch->error) latch->error = std::current_exception();
+    }
+    latch->arrive();
+}
+
+template <typename T>
+struct WhenAllAwaiter {
+    std::vector<Task<T>>& tasks;
+    std::vector<Slot<T>>* slots;
+    WhenAllLatch latch;
+
+    bool await_ready() const noexcept { return tasks.empty(); }
+    bool await_suspend(std::coroutine_handle<> awaiting) {
+        latch.continuation = awaiting;
+        latch.remaining.store(tasks.size() + 1, std::memory_order_relaxed);
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            whenAllMember<T>(std::move(tasks[i]), slots ? &(*slots)[i] : nullptr, &latch);
+        }
+        return latch.remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+    void await_resume() {
+        if (latch.error) std::rethrow_exception(latch.error);
+    }
+};
+
+}  // namespace task_detail
+
+// Starts every task, in order, on the awaiting thread and completes when
+// all have; the first exception is rethrown after the rest finish
+inline Task<void> whenAll(std::vector<Task<void>> tasks) {
+    co_await task_detail::WhenAllAwaiter<void>{tasks, nullptr, {}};
+}
+
+template <typename T>
+Task<std::vector<T>> whenAll(std::vector<Task<T>> tasks) {
+    std::vector<task_detail::Slot<T>> slots(tasks.size());
+    co_await task_detail::WhenAllAwaiter<T>{tasks, &slots, {}};
+    std::vector<T> results;
+    results.reserve(slots.size());
+    for (auto& slot : slots) results.push_back(std::move(*slot));
+    co_return results;
+}
+
+#ifdef CRYPTO_MONITOR_HAS_THREAD_POOL
+// Fixed set of workers resuming coroutines in FIFO order. If no worker
+// could be started, schedule() does not suspend and the work runs inline.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned t = 0; t < threads; ++t) {
+            try {
+                workers_.emplace_back([this] { run(); });
+            } catch (const std::system_error&) {
+                break;
+            }
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queued work still runs before the workers exit
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_) worker.join();
+    }
+
+    size_t size() const { return workers_.size(); }
+
+    struct ScheduleAwaiter {
+        ThreadPool& pool;
+
+        bool await_ready() const noexcept { return pool.workers_.empty(); }
+        void await_suspend(std::coroutine_handle<> awaiting) { pool.enqueue(awaiting); }
+        void await_resume() const noexcept {}
+    };
+
+    // co_await pool.schedule() continues the coroutine on a worker
+    ScheduleAwaiter schedule() { return ScheduleAwaiter{*this}; }
+
+private:
+    void enqueue(std::coroutine_handle<> handle) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(handle);
+        }
+        wake_.notify_one();
+    }
+
+    void run() {
+        for (;;) {
+            std::coroutine_handle<> handle;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                handle = queue_.front();
+                queue_.pop_front();
+            }
+            handle.resume();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::coroutine_handle<>> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+// Runs `work()` on a pool worker
+template <typename Fn>
+Task<void> runOn(ThreadPool& pool, Fn work) {
+    co_await pool.schedule();
+    work();
+}
+
+namespace task_detail {
+
+struct SyncState {
+    std::mutex mutex;
+    std::condition_variable done_signal;
+    bool done = false;
+    std::exception_ptr error;
+};
+
+template <typename T>
+Detached syncDrive(Task<T>& task, Slot<T>* result, SyncState* state) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+        } else {
+            result->emplace(co_await task);
+        }
+    } catch (...) {
+        state->error = std::current_exception();
+    }
+    // Signal under the lock: the waiter may destroy `state` as soon as
+    // it can see `done`
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->done = true;
+    state->done_signal.notify_all();
+}
+
+}  // namespace task_detail
+
+// Blocks the calling thread until `task` completes; for entry points such
+// as the CLI that are not coroutines themselves
+template <typename T>
+T syncWait(Task<T> task) {
+    task_detail::SyncState state;
+    task_detail::Slot<T> result;
+    task_detail::syncDrive<T>(task, &result, &state);
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.done_signal.wait(lock, [&] { return state.done; });
+    if (state.error) std::rethrow_exception(state.error);
+    if constexpr (!std::is_void_v<T>) return std::move(*result);
+}
+#endif  // CRYPTO_MONITOR_HAS_THREAD_POOL
+
+#endif  // __cpp_impl_coroutine
@@ -0,0 +1,96 @@
+// byte_buffer.h
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Little-endian encoding helpers for captures and summaries. Both targets
+// (wasm32 and x86-64/aarch64 native) are little-endian, so values are
+// copied as-is.
+class ByteWriter {
+public:
+    explicit ByteWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    template <typename T>
+    void put(T value) {
+        size_t offset = out_.size();
+        out_.resize(offset + sizeof(T));
+        std::memcpy(out_.data() + offset, &value, sizeof(T));
+    }
+
+    template <typename T>
+    void putVector(const std::vector<T>& values) {
+        put<uint64_t>(values.size());
+        putBytes(values.data(), values.size() * sizeof(T));
+    }
+
+    void putBytes(const void* data, size_t size) {
+        if (size == 0) return;
+        size_t offset = out_.size();
+        out_.resize(offset + size);
+        std::memcpy(out_.data() + offset, data, size);
+    }
+
+    size_t size() const { return out_.size(); }
+
+private:
+    std::vector<uint8_t>& out_;
+};
+
+// Bounds-checked reader. Any short read latches failed() and yields zeros,
+// so callers can decode a whole record and check once at the end.
+class ByteReader {
+public:
+    ByteReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (!require(sizeof(T))) return value;
+        std::memcpy(&value, data_ + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return value;
+    }
+
+    template <typename T>
+    void getVector(std::vector<T>& values) {
+        uint64_t count = get<uint64_t>();
+        if (failed_ || count > remaining() / sizeof(T)) {
+            failed_ = true;
+            values.clear();
+            return;
+        }
+        values.resize(static_cast<size_t>(count));
+        getBytes(values.data(), values.size() * sizeof(T));
+    }
+
+    void getBytes(void* out, size_t size) {
+        if (size == 0 || !require(size)) return;
+        std::memcpy(out, data_ + offset_, size);
+        offset_ += size;
+    }
+
+    const uint8_t* cursor() const { return data_ + offset_; }
+    void skip(size_t size) { if (require(size)) offset_ += size; }
+
+    void fail() { failed_ = true; }
+
+    size_t remaining() const { return size_ - offset_; }
+    size_t offset() const { return offset_; }
+    bool failed() const { return failed_; }
+
+private:
+    bool require(size_t size) {
+        if (failed_ || size > size_ - offset_) {
+            failed_ = true;
+            return false;
+        }
+        return true;
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t offset_ = 0;
+    bool failed_ = false;
+};
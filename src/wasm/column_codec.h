@@ -0,0 +1,475 @@
+// column_codec.h
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef CRYPTO_MONITOR_WITH_LZ4
+#include <lz4.h>
+#endif
+#ifdef CRYPTO_MONITOR_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include "byte_buffer.h"
+
+// Per-column encodings for capture and spill blocks. DELTA stores zigzag
+// varints of successive differences, which turns monotonic cycle counters
+// into one or two bytes per value; LZ4 and ZSTD compress the (optionally
+// delta-coded) column and are only available when the build defines
+// CRYPTO_MONITOR_WITH_LZ4 / CRYPTO_MONITOR_WITH_ZSTD. A reader built
+// without a codec rejects blocks that use it.
+enum class ColumnCodec : uint8_t {
+    RAW = 0,
+    DELTA = 1,
+    LZ4 = 2,
+    ZSTD = 3,
+    DELTA_LZ4 = 4,
+    DELTA_ZSTD = 5
+};
+
+inline bool codecAvailable(ColumnCodec codec) {
+    switch (codec) {
+        case ColumnCodec::RAW:
+        case ColumnCodec::DELTA:
+            return true;
+        case ColumnCodec::LZ4:
+        case ColumnCodec::DELTA_LZ4:
+#ifdef CRYPTO_MONITOR_WITH_LZ4
+            return true;
+#else
+            return false;
+#endif
+        case ColumnCodec::ZSTD:
+        case ColumnCodec::DELTA_ZSTD:
+#ifdef CRYPTO_MONITOR_WITH_ZSTD
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+inline const char* codecName(ColumnCodec codec) {
+    switch (codec) {
+        case ColumnCodec::RAW: return "raw";
+        case ColumnCodec::DELTA: return "delta";
+        case ColumnCodec::LZ4: return "lz4";
+        case ColumnCodec::ZSTD: return "zstd";
+        case ColumnCodec::DELTA_LZ4: return "delta+lz4";
+        case ColumnCodec::DELTA_ZSTD: return "delta+zstd";
+    }
+    return "?";
+}
+
+inline bool parseCodec(const std::string& name, ColumnCodec& codec) {
+    for (uint8_t i = 0; i <= static_cast<uint8_t>(ColumnCodec::DELTA_ZSTD); ++i) {
+        if (name == codecName(static_cast<ColumnCodec>(i))) {
+            codec = static_cast<ColumnCodec>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Which codec each column gets. Columns are named by the record field they
+// hold; vector fields produce a "<name>" values column and a length column
+// that always uses `lengths`. A codec this build lacks is not an error: its
+// columns are written DELTA (for DELTA_*) or RAW instead, and the block
+// records what was used. Callers that take a codec from the user should
+// check codecAvailable() first, as the CLI's --codec does.
+struct ColumnPolicy {
+    ColumnCodec integers = ColumnCodec::DELTA;
+    ColumnCodec floats = ColumnCodec::RAW;
+    ColumnCodec lengths = ColumnCodec::DELTA;
+    std::vector<std::pair<std::string, ColumnCodec>> overrides;
+
+    ColumnCodec codecFor(const char* name, bool floating) const {
+        for (const auto& entry : overrides) {
+            if (entry.first == name) return entry.second;
+        }
+        return floating ? floats : integers;
+    }
+
+    // Densest codecs this build supports
+    static ColumnPolicy dense() {
+        ColumnPolicy policy;
+#if defined(CRYPTO_MONITOR_WITH_ZSTD)
+        policy.integers = ColumnCodec::DELTA_ZSTD;
+        policy.floats = ColumnCodec::ZSTD;
+        policy.lengths = ColumnCodec::DELTA_ZSTD;
+#elif defined(CRYPTO_MONITOR_WITH_LZ4)
+        policy.integers = ColumnCodec::DELTA_LZ4;
+        policy.floats = ColumnCodec::LZ4;
+        policy.lengths = ColumnCodec::DELTA_LZ4;
+#endif
+        return policy;
+    }
+
+    // Cheapest to encode; used for spill blocks
+    static ColumnPolicy fast() {
+        ColumnPolicy policy;
+#if defined(CRYPTO_MONITOR_WITH_LZ4)
+        policy.integers = ColumnCodec::DELTA_LZ4;
+        policy.floats = ColumnCodec::LZ4;
+#endif
+        return policy;
+    }
+};
+
+namespace column_detail {
+
+constexpr uint64_t kMaxColumnBytes = uint64_t(1) << 31;
+constexpr int kZstdLevel = 6;
+
+inline bool uses_delta(ColumnCodec codec) {
+    return codec == ColumnCodec::DELTA || codec == ColumnCodec::DELTA_LZ4 ||
+           codec == ColumnCodec::DELTA_ZSTD;
+}
+
+inline uint64_t load_word(const uint8_t* p, size_t width) {
+    uint64_t value = 0;
+    std::memcpy(&value, p, width);
+    return value;
+}
+
+inline void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t byte = *p++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Differences are taken modulo the word width and sign-extended, so
+// wrapping counters and 32-bit columns round-trip exactly.
+inline void delta_encode(const std::vector<uint8_t>& raw, size_t width,
+                         std::vector<uint8_t>& out) {
+    const unsigned bits = static_cast<unsigned>(width * 8);
+    const uint64_t mask = bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+    out.clear();
+    out.reserve(raw.size() / 2 + 16);
+    uint64_t prev = 0;
+    for (size_t i = 0; i + width <= raw.size(); i += width) {
+        uint64_t x = load_word(raw.data() + i, width);
+        uint64_t diff = (x - prev) & mask;
+        int64_t signed_diff = static_cast<int64_t>(diff << (64 - bits)) >> (64 - bits);
+        put_varint(out, (static_cast<uint64_t>(signed_diff) << 1) ^
+                        static_cast<uint64_t>(signed_diff >> 63));
+        prev = x;
+    }
+}
+
+inline bool delta_decode(const uint8_t* p, size_t size, size_t width, uint64_t count,
+                         std::vector<uint8_t>& raw) {
+    const unsigned bits = static_cast<unsigned>(width * 8);
+    const uint64_t mask = bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+    const uint8_t* end = p + size;
+    // Every value takes at least one varint byte
+    if (count > size) return false;
+    raw.resize(static_cast<size_t>(count * width));
+    uint64_t prev = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t zigzag;
+        if (!get_varint(p, end, zigzag)) return false;
+        uint64_t diff = (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+        prev = (prev + diff) & mask;
+        std::memcpy(raw.data() + i * width, &prev, width);
+    }
+    return p == end;
+}
+
+inline bool compress(ColumnCodec codec, const std::vector<uint8_t>& in, std::vector<uint8_t>& out) {
+    switch (codec) {
+#ifdef CRYPTO_MONITOR_WITH_LZ4
+        case ColumnCodec::LZ4:
+        case ColumnCodec::DELTA_LZ4: {
+            out.resize(static_cast<size_t>(LZ4_compressBound(static_cast<int>(in.size()))));
+            int n = LZ4_compress_default(reinterpret_cast<const char*>(in.data()),
+                                         reinterpret_cast<char*>(out.data()),
+                                         static_cast<int>(in.size()),
+                                         static_cast<int>(out.size()));
+            if (n <= 0 && !in.empty()) return false;
+            out.resize(static_cast<size_t>(n));
+            return true;
+        }
+#endif
+#ifdef CRYPTO_MONITOR_WITH_ZSTD
+        case ColumnCodec::ZSTD:
+        case ColumnCodec::DELTA_ZSTD: {
+            out.resize(ZSTD_compressBound(in.size()));
+            size_t n = ZSTD_compress(out.data(), out.size(), in.data(), in.size(), kZstdLevel);
+            if (ZSTD_isError(n)) return false;
+            out.resize(n);
+            return true;
+        }
+#endif
+        default:
+            (void)in;
+            (void)out;
+            return false;
+    }
+}
+
+// Most output `size` compressed bytes can produce, so a forged stage size
+// is rejected before anything is allocated for it. An LZ4 sequence expands
+// at most 255:1; a zstd block holds at most 128 KiB behind a 3-byte header.
+inline uint64_t max_expansion(ColumnCodec codec, size_t size) {
+    switch (codec) {
+        case ColumnCodec::LZ4:
+        case ColumnCodec::DELTA_LZ4:
+            return uint64_t(size) * 255 + 16;
+        case ColumnCodec::ZSTD:
+        case ColumnCodec::DELTA_ZSTD:
+            return (uint64_t(size) / 3 + 1) * (uint64_t(1) << 17);
+        default:
+            return size;
+    }
+}
+
+inline bool decompress(ColumnCodec codec, const uint8_t* in, size_t size,
+                       size_t expected, std::vector<uint8_t>& out) {
+    if (expected > max_expansion(codec, size)) return false;
+#ifdef CRYPTO_MONITOR_WITH_ZSTD
+    if ((codec == ColumnCodec::ZSTD || codec == ColumnCodec::DELTA_ZSTD) &&
+        ZSTD_getFrameContentSize(in, size) != expected) {
+        return false;
+    }
+#endif
+    out.resize(expected);
+    switch (codec) {
+#ifdef CRYPTO_MONITOR_WITH_LZ4
+        case ColumnCodec::LZ4:
+        case ColumnCodec::DELTA_LZ4: {
+            int n = LZ4_decompress_safe(reinterpret_cast<const char*>(in),
+                                        reinterpret_cast<char*>(out.data()),
+                                        static_cast<int>(size), static_cast<int>(expected));
+            return n >= 0 && static_cast<size_t>(n) == expected;
+        }
+#endif
+#ifdef CRYPTO_MONITOR_WITH_ZSTD
+        case ColumnCodec::ZSTD:
+        case ColumnCodec::DELTA_ZSTD: {
+            size_t n = ZSTD_decompress(out.data(), expected, in, size);
+            return !ZSTD_isError(n) && n == expected;
+        }
+#endif
+        default:
+            (void)in;
+            (void)size;
+            return false;
+    }
+}
+
+}  // namespace column_detail
+
+// Visitor that splits records into columns. Records are fed by calling
+// field() for every member in a fixed order, then nextRecord(); the n-th
+// field() call of every record lands in column n.
+class ColumnBlockEncoder {
+public:
+    explicit ColumnBlockEncoder(const ColumnPolicy& policy) : policy_(policy) {}
+
+    template <typename T>
+    void field(const char* name, const T& value) {
+        static_assert(std::is_arithmetic<T>::value, "scalar columns only");
+        Column& c = column(name, sizeof(T), policy_.codecFor(name, std::is_floating_point<T>::value));
+        append(c, &value, sizeof(T));
+    }
+
+    template <typename T>
+    void field(const char* name, const std::vector<T>& values) {
+        uint64_t length = values.size();
+        append(column(name, sizeof(uint64_t), policy_.lengths), &length, sizeof(length));
+        Column& c = column(name, sizeof(T), policy_.codecFor(name, std::is_floating_point<T>::value));
+        append(c, values.data(), values.size() * sizeof(T));
+    }
+
+    void nextRecord() { next_ = 0; }
+
+    // Layout: u16 columns, then per column u8 codec | u8 width | u64 words |
+    // u64 stage size | u64 encoded size | bytes. The stage size is the
+    // delta-coded length when a compressor follows DELTA.
+    bool finish(ByteWriter& writer) {
+        writer.put<uint16_t>(static_cast<uint16_t>(columns_.size()));
+        std::vector<uint8_t> staged;
+        std::vector<uint8_t> packed;
+        for (Column& c : columns_) {
+            ColumnCodec codec = c.codec;
+            // Fall back to the uncompressed form; see ColumnPolicy
+            if (!codecAvailable(codec)) {
+                codec = column_detail::uses_delta(codec) ? ColumnCodec::DELTA : ColumnCodec::RAW;
+            }
+            const std::vector<uint8_t>* stage = &c.raw;
+            if (column_detail::uses_delta(codec)) {
+                column_detail::delta_encode(c.raw, c.width, staged);
+                stage = &staged;
+            }
+            const std::vector<uint8_t>* body = stage;
+            if (stage->empty()) {
+                // Nothing to compress; codecs would only add framing
+                codec = column_detail::uses_delta(codec) ? ColumnCodec::DELTA : ColumnCodec::RAW;
+            }
+            if (codec != ColumnCodec::RAW && codec != ColumnCodec::DELTA) {
+                if (!column_detail::compress(codec, *stage, packed)) return false;
+                body = &packed;
+            }
+            writer.put<uint8_t>(static_cast<uint8_t>(codec));
+            writer.put<uint8_t>(static_cast<uint8_t>(c.width));
+            writer.put<uint64_t>(c.raw.size() / c.width);
+            writer.put<uint64_t>(stage->size());
+            writer.put<uint64_t>(body->size());
+            writer.putBytes(body->data(), body->size());
+        }
+        return true;
+    }
+
+private:
+    struct Column {
+        ColumnCodec codec;
+        size_t width;
+        std::vector<uint8_t> raw;
+    };
+
+    Column& column(const char*, size_t width, ColumnCodec codec) {
+        if (next_ == columns_.size()) columns_.push_back(Column{codec, width, {}});
+        return columns_[next_++];
+    }
+
+    static void append(Column& c, const void* data, size_t size) {
+        if (size == 0) return;
+        size_t offset = c.raw.size();
+        c.raw.resize(offset + size);
+        std::memcpy(c.raw.data() + offset, data, size);
+    }
+
+    const ColumnPolicy& policy_;
+    std::vector<Column> columns_;
+    size_t next_ = 0;
+};
+
+// Inverse of ColumnBlockEncoder: load() decodes every column of a block,
+// then the same field() sequence reads records back out. Any mismatch
+// between the schema and the data latches failed().
+class ColumnBlockDecoder {
+public:
+    bool load(ByteReader& reader) {
+        uint16_t count = reader.get<uint16_t>();
+        columns_.assign(count, Column{});
+        std::vector<uint8_t> staged;
+        for (Column& c : columns_) {
+            auto codec = static_cast<ColumnCodec>(reader.get<uint8_t>());
+            c.width = reader.get<uint8_t>();
+            uint64_t words = reader.get<uint64_t>();
+            uint64_t stage_size = reader.get<uint64_t>();
+            uint64_t body_size = reader.get<uint64_t>();
+            if (reader.failed() || body_size > reader.remaining() ||
+                (c.width != 1 && c.width != 2 && c.width != 4 && c.width != 8) ||
+                words > column_detail::kMaxColumnBytes / c.width ||
+                stage_size > column_detail::kMaxColumnBytes || !codecAvailable(codec) ||
+                (column_detail::uses_delta(codec) ? words > stage_size
+                                                  : stage_size != words * c.width)) {
+                return fail();
+            }
+            const uint8_t* body = reader.cursor();
+            reader.skip(static_cast<size_t>(body_size));
+
+            const uint8_t* stage = body;
+            if (codec != ColumnCodec::RAW && codec != ColumnCodec::DELTA) {
+                if (!column_detail::decompress(codec, body, static_cast<size_t>(body_size),
+                                               static_cast<size_t>(stage_size), staged)) {
+                    return fail();
+                }
+                stage = staged.data();
+            } else if (stage_size != body_size) {
+                return fail();
+            }
+
+            if (column_detail::uses_delta(codec)) {
+                if (!column_detail::delta_decode(stage, static_cast<size_t>(stage_size),
+                                                 c.width, words, c.raw)) {
+                    return fail();
+                }
+            } else {
+                c.raw.assign(stage, stage + stage_size);
+            }
+        }
+        return !reader.failed() || fail();
+    }
+
+    template <typename T>
+    void field(const char*, T& value) {
+        take(sizeof(T), &value, sizeof(T));
+    }
+
+    template <typename T>
+    void field(const char*, std::vector<T>& values) {
+        uint64_t length = 0;
+        take(sizeof(uint64_t), &length, sizeof(length));
+        Column* c = next_column(sizeof(T));
+        if (!c || length > (c->raw.size() - c->cursor) / sizeof(T)) {
+            failed_ = true;
+            values.clear();
+            return;
+        }
+        values.resize(static_cast<size_t>(length));
+        if (length > 0) std::memcpy(values.data(), c->raw.data() + c->cursor, length * sizeof(T));
+        c->cursor += static_cast<size_t>(length * sizeof(T));
+    }
+
+    void nextRecord() { next_ = 0; }
+    bool failed() const { return failed_; }
+
+    // Values in the first column, which is the record count when the
+    // schema starts with a scalar field
+    size_t records() const {
+        return columns_.empty() ? 0 : columns_[0].raw.size() / columns_[0].width;
+    }
+
+private:
+    struct Column {
+        size_t width = 0;
+        std::vector<uint8_t> raw;
+        size_t cursor = 0;
+    };
+
+    bool fail() {
+        failed_ = true;
+        return false;
+    }
+
+    Column* next_column(size_t width) {
+        if (next_ >= columns_.size() || columns_[next_].width != width) return nullptr;
+        return &columns_[next_++];
+    }
+
+    void take(size_t width, void* out, size_t size) {
+        Column* c = next_column(width);
+        if (!c || c->raw.size() - c->cursor < size) {
+            failed_ = true;
+            std::memset(out, 0, size);
+            return;
+        }
+        std::memcpy(out, c->raw.data() + c->cursor, size);
+        c->cursor += size;
+    }
+
+    std::vector<Column> columns_;
+    size_t next_ = 0;
+    bool failed_ = false;
+};
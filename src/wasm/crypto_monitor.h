@@ -0,0 +1,2557 @@
+// crypto_monitor.h
+#pragma once
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/bind.h>
+#include <emscripten/emscripten.h>
+#endif
+#include <vector>
+#include <map>
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <numeric>  // for accumulate and inner_product
+#include <functional> // for arithmetic operations in algorithms
+#include <limits>
+// After the standard headers, which are what define __GLIBC__
+#if defined(__EMSCRIPTEN__) || defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "alert_rules.h"
+#include "anomaly_detector.h"
+#include "async_task.h"
+#include "byte_buffer.h"
+#include "column_codec.h"
+#include "distribution_shape.h"
+#include "kernel_density.h"
+#include "live_delta.h"
+#include "measurement_series.h"
+#include "metric_expression.h"
+#include "monitor_summary.h"
+#include "permutation_test.h"
+#include "side_channel_analysis.h"
+#include "sliding_window.h"
+#include "streaming_stats.h"
+#include "template_attack.h"
+#include "thread_event_buffer.h"
+#include "trace_pca.h"
+
+#if defined(__EMSCRIPTEN__) && defined(CRYPTO_MONITOR_HAS_COROUTINES)
+// A promise settling on the next macrotask, for coroutines that yield to
+// the event loop between slices of work
+EM_JS(emscripten::EM_VAL, crypto_monitor_next_macrotask, (), {
+    return Emval.toHandle(new Promise(resolve => setTimeout(resolve, 0)));
+});
+#endif
+
+class EnhancedCryptoMonitor {
+public:
+    enum class CryptoOperation {
+        AES_ENCRYPT,
+        AES_DECRYPT,
+        RSA_ENCRYPT,
+        RSA_DECRYPT,
+        ECDSA_SIGN,
+        ECDSA_VERIFY,
+        SHA256_HASH,
+        KEY_DERIVATION
+    };
+
+    static constexpr size_t kOperationCount = 8;
+
+    // Which per-sample vector the trace analyses read. ROUND_TIMING is
+    // the deltas between consecutive round timestamps.
+    enum class TraceSource : uint32_t {
+        ROUND_POWER = 0,
+        POWER_TRACE = 1,
+        ROUND_TIMING = 2,
+    };
+
+    // Plain summary of a sample series, usable without embind
+    struct SummaryStatistics {
+        size_t count = 0;
+        double mean = 0.0;
+        double stddev = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+    };
+
+private:
+    struct CryptoMetrics {
+        // Timing metrics
+        uint64_t start_cycle;
+        uint64_t end_cycle;
+        uint64_t start_inst;
+        uint64_t end_inst;
+
+        // Class label: TVLA group (0 fixed, 1 random) or known input byte for CPA
+        uint32_t label;
+        
+        // Cache metrics
+        struct CacheMetrics {
+            uint64_t l1_accesses;
+            uint64_t l1_misses;
+            uint64_t l2_misses;
+            uint64_t l3_misses;
+            double miss_rate;
+        } cache;
+        
+        // Branch prediction metrics
+        struct BranchMetrics {
+            uint64_t total_branches;
+            uint64_t mispredictions;
+            double mispredict_rate;
+        } branch;
+        
+        // Power analysis
+        struct PowerMetrics {
+            double start_energy;
+            double end_energy;
+            double voltage_fluctuation;
+            double current_draw;
+            std::vector<double> power_trace;
+        } power;
+        
+        // Memory metrics
+        struct MemoryMetrics {
+            uint64_t page_faults;
+            uint64_t tlb_misses;
+            uint64_t memory_bandwidth;
+            std::vector<uint64_t> access_patterns;
+        } memory;
+
+        // RSA-specific metrics
+        struct RSASpecificMetrics {
+            uint64_t modulus_size;
+            uint64_t modular_exponentiation_count;
+            uint64_t montgomery_multiplications;
+            
+            struct OperationMetrics {
+                uint64_t start_cycle;
+                uint64_t end_cycle;
+                std::vector<uint64_t> square_timings;
+                std::vector<uint64_t> multiply_timings;
+                std::vector<uint64_t> reduce_timings;
+            } operations;
+            
+            struct RSACacheMetrics {
+                uint64_t key_load_misses;
+                uint64_t modulus_load_misses;
+                uint64_t montgomery_cache_misses;
+            } cache_specific;
+            
+            struct RSAMemoryMetrics {
+                uint64_t key_memory_accesses;
+                uint64_t temp_buffer_accesses;
+                std::vector<uint64_t> memory_access_pattern;
+            } memory_specific;
+        } rsa_metrics;
+
+        // Crypto specific metrics
+        struct CryptoSpecific {
+            uint64_t key_size;
+            uint64_t block_size;
+            uint64_t rounds;
+            std::vector<uint64_t> round_timings;
+            std::vector<double> round_power;
+        } crypto_specific;
+    };
+
+    // Storage for measurements: one blocked series per operation. Sealed
+    // blocks may be spilled to disk in native builds (see enableSpill).
+    struct MetricsCodec;
+    using MeasurementStore = MeasurementSeries<CryptoMetrics, MetricsCodec>;
+    SpillContext spill_context;
+    std::array<MeasurementStore, kOperationCount> operation_measurements;
+
+    MeasurementStore& measurements(CryptoOperation op) {
+        return operation_measurements[static_cast<size_t>(op)];
+    }
+
+    const MeasurementStore& measurements(CryptoOperation op) const {
+        return operation_measurements[static_cast<size_t>(op)];
+    }
+
+    SlidingWindowStats& window(CryptoOperation op) {
+        return operation_windows[static_cast<size_t>(op)];
+    }
+
+    // Summaries merged in from other monitors without their raw samples.
+    // They contribute to summary() and tvlaAnalysis(), not to the
+    // sample-level analyses.
+    MonitorSummary merged_summary;
+
+    // Traces of an operation projected onto principal components as the
+    // operation ends; see setTraceProjection
+    struct TraceProjection {
+        TraceSource source = TraceSource::ROUND_POWER;
+        PrincipalComponents pca;
+        bool discard_raw = false;
+        std::vector<double> scores;
+    };
+    std::array<std::unique_ptr<TraceProjection>, kOperationCount> trace_projections;
+
+    // Round timings are kept either way; the timing analyses need them
+    void project_trace(TraceProjection& projection, CryptoMetrics& metrics) {
+        std::vector<double> scratch;
+        const auto& trace = traceOf(metrics, projection.source, scratch);
+        const PrincipalComponents& pca = projection.pca;
+        if (pca.count() == 0 || trace.size() < pca.points) return;
+        size_t offset = projection.scores.size();
+        projection.scores.resize(offset + pca.count());
+        pca.project(trace.data(), &projection.scores[offset]);
+        if (projection.discard_raw && projection.source != TraceSource::ROUND_TIMING) {
+            std::vector<double>().swap(projection.source == TraceSource::ROUND_POWER
+                                           ? metrics.crypto_specific.round_power
+                                           : metrics.power.power_trace);
+        }
+    }
+
+    // Gaussian templates profiled per operation; see buildTemplates
+    struct ProfiledTemplates {
+        TraceSource source = TraceSource::ROUND_POWER;
+        TemplateSet set;
+    };
+    std::array<std::unique_ptr<ProfiledTemplates>, kOperationCount> trace_templates;
+
+    // "Last N seconds" execution-time statistics, fed as operations end
+    std::array<SlidingWindowStats, kOperationCount> operation_windows;
+
+    // EWMA z-score trackers over execution and round times
+    AnomalyDetector anomalies{kOperationCount};
+
+    // Threshold rules over their own accumulators, checked as data arrives
+    AlertEngine alerts{operationNames()};
+
+    // Compiled derived-metric expressions, keyed by their text
+    static constexpr size_t kMaxCachedExpressions = 64;
+    std::map<std::string, std::unique_ptr<MetricExpression>> metric_expressions;
+
+    // Per-thread buffers filled by recordCompletedOperation. Registration
+    // takes the mutex once per thread; recording itself is lock-free. Each
+    // buffer is shared with its thread (see ThreadEventBuffer::release) and
+    // freed by the first drain after that thread exits.
+    std::mutex thread_buffers_mutex;
+    std::vector<ThreadEventBuffer*> thread_buffers;
+    uint64_t retired_dropped = 0;  // drops counted by buffers already freed
+    const uint64_t instance_id = next_instance_id();
+
+    static uint64_t next_instance_id() {
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
+    }
+
+    // The calling thread's buffers, one per monitor it records into. The
+    // thread lets go of them when it exits, or once their monitor is gone.
+    struct ThreadBufferCache {
+        std::vector<std::pair<uint64_t, ThreadEventBuffer*>> entries;
+
+        ~ThreadBufferCache() {
+            for (const auto& entry : entries) {
+                ThreadEventBuffer::release(entry.second, ThreadEventBuffer::PRODUCER);
+            }
+        }
+
+        ThreadEventBuffer* find(uint64_t id) const {
+            for (const auto& entry : entries) {
+                if (entry.first == id) return entry.second;
+            }
+            return nullptr;
+        }
+
+        void prune() {
+            auto orphaned = [](const std::pair<uint64_t, ThreadEventBuffer*>& entry) {
+                if (!entry.second->consumerGone()) return false;
+                ThreadEventBuffer::release(entry.second, ThreadEventBuffer::PRODUCER);
+                return true;
+            };
+            entries.erase(std::remove_if(entries.begin(), entries.end(), orphaned),
+                          entries.end());
+        }
+    };
+
+    static ThreadBufferCache& thread_buffer_cache() {
+        thread_local ThreadBufferCache cache;
+        return cache;
+    }
+
+    ThreadEventBuffer& local_event_buffer() {
+        ThreadBufferCache& cache = thread_buffer_cache();
+        if (ThreadEventBuffer* buffer = cache.find(instance_id)) return *buffer;
+        cache.prune();
+        cache.entries.reserve(cache.entries.size() + 1);
+        auto buffer = std::make_unique<ThreadEventBuffer>();
+        std::lock_guard<std::mutex> lock(thread_buffers_mutex);
+        thread_buffers.push_back(buffer.get());
+        cache.entries.emplace_back(instance_id, buffer.get());
+        return *buffer.release();
+    }
+
+public:
+    EnhancedCryptoMonitor() {
+        for (auto& series : operation_measurements) series.attach(&spill_context);
+    }
+
+    ~EnhancedCryptoMonitor() {
+        for (ThreadEventBuffer* buffer : thread_buffers) {
+            ThreadEventBuffer::release(buffer, ThreadEventBuffer::CONSUMER);
+        }
+    }
+
+    EnhancedCryptoMonitor(const EnhancedCryptoMonitor&) = delete;
+    EnhancedCryptoMonitor& operator=(const EnhancedCryptoMonitor&) = delete;
+
+    // Performance timing
+    static uint64_t get_timestamp() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now().time_since_epoch()
+        ).count();
+    }
+
+private:
+    // Simulated performance counter; IDs run up to 0x12 (RSA key loads)
+    static constexpr int kPmcCounters = 0x13;
+    uint64_t read_pmc(int counter) {
+        static uint64_t counters[kPmcCounters] = {0};
+        if (counter < 0 || counter >= kPmcCounters) return 0;
+        counters[counter]++;
+        return counters[counter];
+    }
+
+    // Simulated power monitoring
+    double measure_power_consumption() {
+        static double power = 0.1;
+        power += 0.01;
+        return power;
+    }
+
+    // Cache monitoring
+    void monitor_cache_behavior(CryptoMetrics& metrics) {
+        metrics.cache.l1_accesses = read_pmc(0x1);
+        metrics.cache.l1_misses = read_pmc(0x2);
+        metrics.cache.l2_misses = read_pmc(0x3);
+        metrics.cache.l3_misses = read_pmc(0x4);
+        
+        if (metrics.cache.l1_accesses > 0) {
+            metrics.cache.miss_rate = static_cast<double>(metrics.cache.l1_misses) / 
+                                    metrics.cache.l1_accesses;
+        }
+    }
+
+// Branch prediction monitoring
+    void monitor_branch_behavior(CryptoMetrics& metrics) {
+        metrics.branch.total_branches = read_pmc(0x5);
+        metrics.branch.mispredictions = read_pmc(0x6);
+        
+        if (metrics.branch.total_branches > 0) {
+            metrics.branch.mispredict_rate = static_cast<double>(metrics.branch.mispredictions) / 
+                                           metrics.branch.total_branches;
+        }
+    }
+
+    // Memory access pattern monitoring
+    void monitor_memory_behavior(CryptoMetrics& metrics) {
+        metrics.memory.tlb_misses = read_pmc(0x7);
+        metrics.memory.page_faults = read_pmc(0x8);
+        metrics.memory.memory_bandwidth = read_pmc(0x9);
+    }
+
+    // RSA-specific monitoring
+    void monitor_rsa_operation(CryptoMetrics& metrics) {
+        auto& rsa = metrics.rsa_metrics;
+        
+        // Monitor modular arithmetic operations
+        rsa.operations.square_timings.push_back(get_timestamp());
+        
+        // Monitor cache behavior specific to RSA
+        rsa.cache_specific.key_load_misses = read_pmc(0x10);
+        rsa.cache_specific.modulus_load_misses = read_pmc(0x11);
+        
+        // Monitor memory access patterns
+        uint64_t current_memory_access = read_pmc(0x12);
+        rsa.memory_specific.memory_access_pattern.push_back(current_memory_access);
+    }
+
+    // Folds one finished record, already checked by the caller, into the
+    // store and the streaming state
+    void ingest_completed(const CompletedOperation& event) {
+        CryptoMetrics metrics{};
+        metrics.start_cycle = event.start_cycle;
+        metrics.end_cycle = event.end_cycle;
+        metrics.crypto_specific.key_size = event.key_size;
+        metrics.label = event.label;
+        double execution_time = static_cast<double>(event.end_cycle - event.start_cycle);
+        operation_windows[event.op].add(event.end_cycle, execution_time);
+        anomalies.observeOperation(event.op, event.end_cycle, execution_time);
+        if (!alerts.empty()) {
+            alerts.observe(event.op, event.key_size, event.end_cycle, execution_time,
+                           event.label, {}, {});
+        }
+        measurements(static_cast<CryptoOperation>(event.op)).push_back(std::move(metrics));
+    }
+
+public:
+    // Lock-free recording of an already finished operation from any thread.
+    // Records land in the calling thread's buffer and are merged into the
+    // measurement store by drainThreadBuffers(). Returns false, recording
+    // nothing, for an unknown operation, an end before the start, or when
+    // the thread's buffer is full.
+    bool recordCompletedOperation(CryptoOperation op, uint64_t key_size,
+                                  uint64_t start_cycle, uint64_t end_cycle,
+                                  uint32_t label = 0) {
+        if (static_cast<size_t>(op) >= kOperationCount || end_cycle < start_cycle) return false;
+        CompletedOperation event{static_cast<uint32_t>(op), label, key_size,
+                                 start_cycle, end_cycle};
+        return local_event_buffer().push(event);
+    }
+
+    // Moves everything recorded through the per-thread path into
+    // operation_measurements. Returns the number of records drained.
+    size_t drainThreadBuffers() {
+        std::lock_guard<std::mutex> lock(thread_buffers_mutex);
+        size_t drained = 0;
+        for (size_t i = 0; i < thread_buffers.size();) {
+            ThreadEventBuffer* buffer = thread_buffers[i];
+            // Checked first, so this drain sees the thread's last records
+            bool finished = buffer->producerGone();
+            drained += buffer->drain([this](const CompletedOperation& event) {
+                ingest_completed(event);
+            });
+            if (finished) {
+                retired_dropped += buffer->dropped();
+                thread_buffers.erase(thread_buffers.begin() + static_cast<ptrdiff_t>(i));
+                ThreadEventBuffer::release(buffer, ThreadEventBuffer::CONSUMER);
+            } else {
+                ++i;
+            }
+        }
+        if (drained > 0 && !alerts.empty()) alerts.maybeEvaluate(get_timestamp());
+        return drained;
+    }
+
+    // Merges a batch of records produced outside this process's recording
+    // threads, such as a shared-memory ring drained by the worker hosting
+    // the monitor, with timestamps shifted by `clock_offset` into this
+    // monitor's clock. Must run on the thread that owns the monitor.
+    // Records naming an unknown operation, ending before they start or
+    // predating the monitor's clock once shifted are skipped; returns the
+    // number merged.
+    size_t recordCompletedBatch(const CompletedOperation* events, size_t count,
+                                int64_t clock_offset = 0) {
+        const uint64_t earliest = clock_offset < 0 ? static_cast<uint64_t>(-clock_offset) : 0;
+        size_t merged = 0;
+        for (size_t i = 0; i < count; ++i) {
+            CompletedOperation event = events[i];
+            if (event.op >= kOperationCount || event.end_cycle < event.start_cycle ||
+                event.start_cycle < earliest) {
+                continue;
+            }
+            event.start_cycle += static_cast<uint64_t>(clock_offset);
+            event.end_cycle += static_cast<uint64_t>(clock_offset);
+            ingest_completed(event);
+            ++merged;
+        }
+        if (merged > 0 && !alerts.empty()) alerts.maybeEvaluate(get_timestamp());
+        return merged;
+    }
+
+    uint64_t droppedThreadRecords() {
+        std::lock_guard<std::mutex> lock(thread_buffers_mutex);
+        uint64_t dropped = retired_dropped;
+        for (const ThreadEventBuffer* buffer : thread_buffers) {
+            dropped += buffer->dropped();
+        }
+        return dropped;
+    }
+
+    size_t measurementCount(CryptoOperation op) {
+        drainThreadBuffers();
+        return measurements(op).size();
+    }
+
+    std::vector<double> collectExecutionTimes(CryptoOperation op) {
+        drainThreadBuffers();
+        std::vector<double> execution_times;
+        execution_times.reserve(measurements(op).size());
+        measurements(op).forEach([&](const CryptoMetrics& metric) {
+            execution_times.push_back(
+                static_cast<double>(metric.end_cycle - metric.start_cycle)
+            );
+        });
+        return execution_times;
+    }
+
+    // Evaluates a derived metric such as
+    // "(end_inst - start_inst) / (end_cycle - start_cycle)" over every
+    // sample of `op`, in record order. The grammar is in
+    // metric_expression.h; field names are those of the capture columns.
+    bool deriveMetric(CryptoOperation op, const std::string& expression,
+                      std::vector<double>& values, std::string& error) {
+        const MetricExpression* compiled = compiledMetric(expression, error);
+        if (!compiled) return false;
+        drainThreadBuffers();
+        values.clear();
+        values.reserve(measurements(op).size());
+        compiled->evaluate(measurements(op), [&](const double* block, size_t count) {
+            values.insert(values.end(), block, block + count);
+        });
+        return true;
+    }
+
+    // Permutation test on a derived metric between the records labelled
+    // `label_a` and those labelled `label_b`; non-finite values are
+    // skipped. Fails, with `error` set, only if the expression does not parse.
+    bool permutationTest(CryptoOperation op, const std::string& expression, uint32_t label_a,
+                         uint32_t label_b, const PermutationTestOptions& options,
+                         PermutationTestResult& result, std::string& error) {
+        std::vector<double> values;
+        if (!deriveMetric(op, expression, values, error)) return false;
+        std::vector<double> a, b;
+        size_t index = 0;
+        measurements(op).forEach([&](const CryptoMetrics& metric) {
+            double v = values[index++];
+            if (!std::isfinite(v)) return;
+            if (metric.label == label_a) a.push_back(v);
+            else if (metric.label == label_b) b.push_back(v);
+        });
+        result = PermutationTest::run(a, b, options);
+        return true;
+    }
+
+    static SummaryStatistics summarize(const std::vector<double>& data) {
+        SummaryStatistics stats;
+        if (data.empty()) return stats;
+
+        double sum = std::accumulate(data.begin(), data.end(), 0.0);
+        double mean = sum / data.size();
+
+        double sq_sum = 0.0;
+        for (double x : data) sq_sum += (x - mean) * (x - mean);
+
+        stats.count = data.size();
+        stats.mean = mean;
+        stats.stddev = std::sqrt(sq_sum / data.size());
+        stats.min = *std::min_element(data.begin(), data.end());
+        stats.max = *std::max_element(data.begin(), data.end());
+        return stats;
+    }
+
+    static const char* operationName(CryptoOperation op) {
+        static const char* const names[kOperationCount] = {
+            "AES_ENCRYPT", "AES_DECRYPT", "RSA_ENCRYPT", "RSA_DECRYPT",
+            "ECDSA_SIGN", "ECDSA_VERIFY", "SHA256_HASH", "KEY_DERIVATION"
+        };
+        return names[static_cast<size_t>(op)];
+    }
+
+    static std::vector<std::string> operationNames() {
+        std::vector<std::string> names;
+        for (size_t i = 0; i < kOperationCount; ++i) {
+            names.push_back(operationName(static_cast<CryptoOperation>(i)));
+        }
+        return names;
+    }
+
+    void startCryptoOperation(const std::string& operation_type, uint64_t key_size) {
+        startOperation(parseCryptoOperation(operation_type), key_size);
+    }
+
+    void recordRoundMetrics(const std::string& operation_type, uint64_t round) {
+        recordRound(parseCryptoOperation(operation_type), round);
+    }
+
+    void endCryptoOperation(const std::string& operation_type) {
+        endOperation(parseCryptoOperation(operation_type));
+    }
+
+    // Enum-typed entry points used by the native C ABI; the string
+    // versions above are the embind surface.
+    void startOperation(CryptoOperation op, uint64_t key_size) {
+        CryptoMetrics metrics{};
+        
+        // Initialize timing
+        metrics.start_cycle = get_timestamp();
+        metrics.start_inst = read_pmc(0);
+        
+        // Initialize power monitoring
+        metrics.power.start_energy = measure_power_consumption();
+        
+        // Set crypto-specific parameters
+        metrics.crypto_specific.key_size = key_size;
+        
+        // Start standard monitoring
+        monitor_cache_behavior(metrics);
+        monitor_branch_behavior(metrics);
+        monitor_memory_behavior(metrics);
+        
+        // Add RSA-specific monitoring if applicable
+        if (op == CryptoOperation::RSA_ENCRYPT || op == CryptoOperation::RSA_DECRYPT) {
+            monitor_rsa_operation(metrics);
+        }
+        
+        measurements(op).push_back(std::move(metrics));
+    }
+
+    void recordRound(CryptoOperation op, uint64_t round) {
+        if (!measurements(op).empty()) {
+            auto& current_metrics = measurements(op).back();
+            
+            uint64_t round_cycles = get_timestamp();
+            auto& timings = current_metrics.crypto_specific.round_timings;
+            uint64_t previous = timings.empty() ? current_metrics.start_cycle : timings.back();
+            anomalies.observeRound(static_cast<uint32_t>(op), timings.size(), round_cycles,
+                                   static_cast<double>(round_cycles - previous));
+            timings.push_back(round_cycles);
+            
+            double round_power = measure_power_consumption();
+            current_metrics.crypto_specific.round_power.push_back(round_power);
+            
+            current_metrics.crypto_specific.rounds = round + 1;
+        }
+    }
+
+    void endOperation(CryptoOperation op) {
+        if (!measurements(op).empty()) {
+            auto& metrics = measurements(op).back();
+            
+            metrics.end_cycle = get_timestamp();
+            metrics.end_inst = read_pmc(0);
+            
+            metrics.power.end_energy = measure_power_consumption();
+            
+            monitor_cache_behavior(metrics);
+            monitor_branch_behavior(metrics);
+            monitor_memory_behavior(metrics);
+
+            double execution_time = static_cast<double>(metrics.end_cycle - metrics.start_cycle);
+            window(op).add(metrics.end_cycle, execution_time);
+            anomalies.observeOperation(static_cast<uint32_t>(op), metrics.end_cycle, execution_time);
+            if (!alerts.empty()) {
+                alerts.observe(static_cast<uint32_t>(op), metrics.crypto_specific.key_size,
+                               metrics.end_cycle, execution_time, metrics.label,
+                               metrics.crypto_specific.round_power,
+                               metrics.crypto_specific.round_timings);
+                alerts.maybeEvaluate(metrics.end_cycle);
+            }
+            // Last, so the alerts above still saw a trace discard_raw drops
+            if (auto& projection = trace_projections[static_cast<size_t>(op)]) {
+                project_trace(*projection, metrics);
+            }
+        }
+    }
+
+    void setOperationLabel(const std::string& operation_type, uint32_t label) {
+        labelOperation(parseCryptoOperation(operation_type), label);
+    }
+
+    // Tags the in-flight (most recent) operation with its class label
+    void labelOperation(CryptoOperation op, uint32_t label) {
+        if (!measurements(op).empty()) {
+            measurements(op).back().label = label;
+        }
+    }
+
+    struct TimingAnalysis {
+        std::vector<double> execution_times;
+        std::vector<double> round_variations;
+        std::vector<double> power_variations;
+        SummaryStatistics statistics;
+    };
+
+    struct CacheAnalysis {
+        std::vector<double> l1_miss_rates;
+        std::vector<double> l2_miss_rates;
+        std::vector<double> l3_miss_rates;
+    };
+
+    struct RSAAnalysis {
+        std::vector<double> modular_exponentiation_times;
+        std::vector<double> memory_access_patterns;
+        std::vector<double> cache_behavior;
+        SummaryStatistics statistics;
+    };
+
+    TimingAnalysis timingAnalysis(CryptoOperation op) {
+        drainThreadBuffers();
+        TimingAnalysis analysis;
+        analysis.execution_times.reserve(measurements(op).size());
+        measurements(op).forEach([&](const CryptoMetrics& metric) {
+            scanTiming(metric, analysis);
+        });
+        analysis.statistics = summarize(analysis.execution_times);
+        return analysis;
+    }
+
+    static void scanTiming(const CryptoMetrics& metric, TimingAnalysis& analysis) {
+        analysis.execution_times.push_back(
+            static_cast<double>(metric.end_cycle - metric.start_cycle));
+
+        for (size_t i = 1; i < metric.crypto_specific.round_timings.size(); ++i) {
+            analysis.round_variations.push_back(
+                static_cast<double>(
+                    metric.crypto_specific.round_timings[i] - 
+                    metric.crypto_specific.round_timings[i-1]
+                )
+            );
+        }
+        
+        for (size_t i = 1; i < metric.crypto_specific.round_power.size(); ++i) {
+            analysis.power_variations.push_back(
+                metric.crypto_specific.round_power[i] - 
+                metric.crypto_specific.round_power[i-1]
+            );
+        }
+    }
+
+    // Bimodality of execution times and of round-to-round deltas
+    struct DistributionAnalysis {
+        DistributionShape execution_time;
+        DistributionShape round_deltas;
+    };
+
+    DistributionAnalysis distributionAnalysis(CryptoOperation op) {
+        TimingAnalysis timing = timingAnalysis(op);
+        DistributionAnalysis analysis;
+        analysis.execution_time = analyzeDistributionShape(timing.execution_times);
+        analysis.round_deltas = analyzeDistributionShape(timing.round_variations);
+        return analysis;
+    }
+
+    // Smoothed execution-time density for plotting; see kernel_density.h
+    DensityEstimate executionTimeDensity(CryptoOperation op,
+                                         const DensityOptions& options = DensityOptions()) {
+        return KernelDensity::estimate(collectExecutionTimes(op), options);
+    }
+
+    CacheAnalysis cacheAnalysis(CryptoOperation op) {
+        drainThreadBuffers();
+        CacheAnalysis analysis;
+
+        measurements(op).forEach([&](const CryptoMetrics& metric) {
+            scanCache(metric, analysis);
+        });
+        return analysis;
+    }
+
+    static void scanCache(const CryptoMetrics& metric, CacheAnalysis& analysis) {
+        analysis.l1_miss_rates.push_back(metric.cache.miss_rate);
+    }
+
+    static bool isRsa(CryptoOperation op) {
+        return op == CryptoOperation::RSA_ENCRYPT || op == CryptoOperation::RSA_DECRYPT;
+    }
+
+    RSAAnalysis rsaAnalysis(CryptoOperation op) {
+        drainThreadBuffers();
+        RSAAnalysis analysis;
+        if (!isRsa(op)) return analysis;
+
+        measurements(op).forEach([&](const CryptoMetrics& metric) {
+            scanRsa(metric, analysis);
+        });
+
+        analysis.statistics = summarize(analysis.modular_exponentiation_times);
+        return analysis;
+    }
+
+    static void scanRsa(const CryptoMetrics& metric, RSAAnalysis& analysis) {
+        auto& ops = metric.rsa_metrics.operations;
+        for (size_t i = 1; i < ops.square_timings.size(); ++i) {
+            analysis.modular_exponentiation_times.push_back(
+                static_cast<double>(ops.square_timings[i] - ops.square_timings[i-1])
+            );
+        }
+        
+        auto& mem = metric.rsa_metrics.memory_specific;
+        for (size_t i = 1; i < mem.memory_access_pattern.size(); ++i) {
+            analysis.memory_access_patterns.push_back(
+                static_cast<double>(mem.memory_access_pattern[i] - 
+                                  mem.memory_access_pattern[i-1])
+            );
+        }
+        
+        auto& cache = metric.rsa_metrics.cache_specific;
+        analysis.cache_behavior.push_back(static_cast<double>(cache.key_load_misses));
+        analysis.cache_behavior.push_back(static_cast<double>(cache.modulus_load_misses));
+    }
+
+    // The research-metrics bundle computed in slices, so a caller on an
+    // event loop can yield between them. A job covers a snapshot of the
+    // records stored when it started: the scan walks it a block at a time, checking
+    // the clock after each, and the later phases (summaries, mixture fits)
+    // each run whole, so a slice overruns its budget by at most one phase.
+    enum class ResearchPhase { SCAN, STATISTICS, EXECUTION_SHAPE, ROUND_SHAPE, DONE };
+
+    struct ResearchJob {
+        CryptoOperation op = CryptoOperation::AES_ENCRYPT;
+        ResearchPhase phase = ResearchPhase::SCAN;
+        size_t cursor = 0;
+        size_t total = 0;
+        MeasurementStore records;  // snapshot being scanned; released after
+        RunningMoments scanned;  // execution times so far, for partial results
+        TimingAnalysis timing;
+        CacheAnalysis cache;
+        RSAAnalysis rsa;
+        DistributionAnalysis distribution;
+
+        bool done() const { return phase == ResearchPhase::DONE; }
+    };
+
+    uint32_t startResearch(CryptoOperation op) {
+        drainThreadBuffers();
+        uint32_t id = next_research_job++;
+        ResearchJob& job = research_jobs[id];
+        job.op = op;
+        job.records = measurements(op).snapshot();
+        job.total = job.records.size();
+        job.timing.execution_times.reserve(job.total);
+        return id;
+    }
+
+    // Runs job `id` until it is done or `budget_ns` has passed; nullptr
+    // for an unknown id
+    const ResearchJob* continueResearch(uint32_t id, uint64_t budget_ns) {
+        auto it = research_jobs.find(id);
+        if (it == research_jobs.end()) return nullptr;
+        ResearchJob& job = it->second;
+        const uint64_t deadline = get_timestamp() + budget_ns;
+
+        while (!job.done()) {
+            switch (job.phase) {
+                case ResearchPhase::SCAN: {
+                    if (job.cursor == job.total) {
+                        job.records = MeasurementStore();
+                        job.phase = ResearchPhase::STATISTICS;
+                        break;
+                    }
+                    size_t end = std::min(job.total, job.cursor + MeasurementStore::kBlockRecords);
+                    job.records.forEachRange(job.cursor, end, [&](const CryptoMetrics& metric) {
+                        scanResearch(metric, job);
+                    });
+                    job.cursor = end;
+                    break;
+                }
+                case ResearchPhase::STATISTICS:
+                    job.timing.statistics = summarize(job.timing.execution_times);
+                    if (isRsa(job.op)) job.rsa.statistics = summarize(job.rsa.modular_exponentiation_times);
+                    job.phase = ResearchPhase::EXECUTION_SHAPE;
+                    break;
+                case ResearchPhase::EXECUTION_SHAPE:
+                    job.distribution.execution_time = analyzeDistributionShape(job.timing.execution_times);
+                    job.phase = ResearchPhase::ROUND_SHAPE;
+                    break;
+                case ResearchPhase::ROUND_SHAPE:
+                    job.distribution.round_deltas = analyzeDistributionShape(job.timing.round_variations);
+                    job.phase = ResearchPhase::DONE;
+                    break;
+                case ResearchPhase::DONE:
+                    break;
+            }
+            if (get_timestamp() >= deadline) break;
+        }
+        return &job;
+    }
+
+    static void scanResearch(const CryptoMetrics& metric, ResearchJob& job) {
+        scanTiming(metric, job.timing);
+        job.scanned.add(job.timing.execution_times.back());
+        scanCache(metric, job.cache);
+        if (isRsa(job.op)) scanRsa(metric, job.rsa);
+    }
+
+#ifdef CRYPTO_MONITOR_HAS_THREAD_POOL
+    // Awaitable forms of the composite analyses. The thread that starts
+    // the task (the one recording) only takes a snapshot; the scan, the
+    // summaries and the mixture fits run on `pool`, the independent ones
+    // concurrently, and the task completes on whichever worker finishes
+    // last.
+    Task<DistributionAnalysis> distributionAnalysisAsync(CryptoOperation op, ThreadPool& pool) {
+        drainThreadBuffers();
+        MeasurementStore records = measurements(op).snapshot();
+        co_await pool.schedule();
+
+        TimingAnalysis timing;
+        timing.execution_times.reserve(records.size());
+        records.forEach([&](const CryptoMetrics& metric) {
+            scanTiming(metric, timing);
+        });
+        records = MeasurementStore();
+        DistributionAnalysis analysis;
+        std::vector<Task<void>> fits;
+        fits.push_back(runOn(pool, [&] {
+            analysis.execution_time = analyzeDistributionShape(timing.execution_times);
+        }));
+        fits.push_back(runOn(pool, [&] {
+            analysis.round_deltas = analyzeDistributionShape(timing.round_variations);
+        }));
+        co_await whenAll(std::move(fits));
+        co_return analysis;
+    }
+
+    // The whole research bundle in one go; the result is a finished job
+    Task<ResearchJob> researchAsync(CryptoOperation op, ThreadPool& pool) {
+        drainThreadBuffers();
+        ResearchJob job;
+        job.op = op;
+        job.records = measurements(op).snapshot();
+        job.total = job.records.size();
+        co_await pool.schedule();
+
+        job.timing.execution_times.reserve(job.total);
+        job.records.forEach([&](const CryptoMetrics& metric) {
+            scanResearch(metric, job);
+        });
+        job.records = MeasurementStore();
+        job.cursor = job.total;
+
+        std::vector<Task<void>> phases;
+        phases.push_back(runOn(pool, [&] {
+            job.timing.statistics = summarize(job.timing.execution_times);
+            if (isRsa(job.op)) job.rsa.statistics = summarize(job.rsa.modular_exponentiation_times);
+        }));
+        phases.push_back(runOn(pool, [&] {
+            job.distribution.execution_time = analyzeDistributionShape(job.timing.execution_times);
+        }));
+        phases.push_back(runOn(pool, [&] {
+            job.distribution.round_deltas = analyzeDistributionShape(job.timing.round_variations);
+        }));
+        co_await whenAll(std::move(phases));
+        job.phase = ResearchPhase::DONE;
+        co_return job;
+    }
+#endif
+
+    void cancelResearch(uint32_t id) {
+        research_jobs.erase(id);
+    }
+
+    static const char* researchPhaseName(ResearchPhase phase) {
+        switch (phase) {
+            case ResearchPhase::SCAN: return "scan";
+            case ResearchPhase::STATISTICS: return "statistics";
+            case ResearchPhase::EXECUTION_SHAPE: return "execution_shape";
+            case ResearchPhase::ROUND_SHAPE: return "round_shape";
+            case ResearchPhase::DONE: return "done";
+        }
+        return "done";
+    }
+
+private:
+    std::map<uint32_t, ResearchJob> research_jobs;
+    uint32_t next_research_job = 1;
+
+public:
+    TvlaResult tvlaAnalysis(CryptoOperation op) {
+        drainThreadBuffers();
+        TvlaAccumulator tvla;
+        measurements(op).forEach([&](const CryptoMetrics& metric) {
+            tvla.add(metric.label,
+                     static_cast<double>(metric.end_cycle - metric.start_cycle),
+                     metric.crypto_specific.round_power,
+                     metric.crypto_specific.round_timings);
+        });
+        tvla.merge(merged_summary.operations[static_cast<size_t>(op)].tvla);
+        return tvla.result();
+    }
+
+    // CPA trace layout: point 0 is the execution time, points 1.. are
+    // round_power; labels are the known input byte.
+    CpaResult cpaAnalysis(CryptoOperation op) {
+        drainThreadBuffers();
+        CpaAccumulator cpa;
+        std::vector<double> trace;
+        measurements(op).forEach([&](const CryptoMetrics& metric) {
+            const auto& power = metric.crypto_specific.round_power;
+            trace.assign(1, static_cast<double>(metric.end_cycle - metric.start_cycle));
+            trace.insert(trace.end(), power.begin(), power.end());
+            cpa.add(static_cast<uint8_t>(metric.label), trace);
+        });
+        return cpa.result();
+    }
+
+    // Per-point SNR with classes taken from the label's low byte, as in
+    // cpaAnalysis(). Pair with selectPointsOfInterest() to pick the few
+    // points worth a full CPA or template pass.
+    SnrResult snrAnalysis(CryptoOperation op, TraceSource source) {
+        drainThreadBuffers();
+        SnrAccumulator snr;
+        std::vector<double> scratch;
+        measurements(op).forEach([&](const CryptoMetrics& metric) {
+            const auto& trace = traceOf(metric, source, scratch);
+            snr.add(static_cast<uint8_t>(metric.label), trace.data(), trace.size());
+        });
+        return snr.result();
+    }
+
+    // Top principal components of the traces from `source`, from one
+    // streaming pass into a covariance accumulator (see trace_pca.h)
+    PrincipalComponents tracePca(CryptoOperation op, TraceSource source, size_t components) {
+        drainThreadBuffers();
+        CovarianceAccumulator covariance;
+        std::vector<double> scratch;
+        measurements(op).forEach([&](const CryptoMetrics& metric) {
+            const auto& trace = traceOf(metric, source, scratch);
+            covariance.add(trace.data(), trace.size());
+        });
+        std::vector<double> mean, matrix;
+        covariance.finish(mean, matrix);
+        return principalComponents(mean, matrix, covariance.count(), components);
+    }
+
+    // From now on each finished operation's trace is also projected onto
+    // `pca` and the scores kept (see projectedTraces). With `discard_raw`
+    // the raw trace is dropped once projected, which shrinks stored
+    // records to a few numbers per trace but leaves nothing for
+    // trace-level analyses of that source afterwards.
+    void setTraceProjection(CryptoOperation op, TraceSource source, PrincipalComponents pca,
+                            bool discard_raw) {
+        auto projection = std::make_unique<TraceProjection>();
+        projection->source = source;
+        projection->pca = std::move(pca);
+        projection->discard_raw = discard_raw;
+        trace_projections[static_cast<size_t>(op)] = std::move(projection);
+    }
+
+    void clearTraceProjection(CryptoOperation op) {
+        trace_projections[static_cast<size_t>(op)].reset();
+    }
+
+    // Scores of every trace projected so far, row-major [rows x width];
+    // returns the width (0 when no projection is set)
+    size_t projectedTraces(CryptoOperation op, std::vector<double>& out) const {
+        const auto& projection = trace_projections[static_cast<size_t>(op)];
+        if (!projection) {
+            out.clear();
+            return 0;
+        }
+        out = projection->scores;
+        return projection->pca.count();
+    }
+
+    // Profiling mode: Gaussian templates over `points` of `source` from
+    // the stored traces, one class per label low byte, kept for
+    // matchTemplates() and scoreTemplates(). Returns the class count, 0
+    // when there is too little data, a point lies beyond the longest
+    // trace, or the covariance cannot be factored.
+    size_t buildTemplates(CryptoOperation op, TraceSource source, std::vector<uint32_t> points) {
+        drainThreadBuffers();
+        size_t length = 0;
+        std::vector<double> scratch;
+        measurements(op).forEach([&](const CryptoMetrics& metric) {
+            length = std::max(length, traceOf(metric, source, scratch).size());
+        });
+        TemplateBuilder builder(std::move(points), length);
+        measurements(op).forEach([&](const CryptoMetrics& metric) {
+            const auto& trace = traceOf(metric, source, scratch);
+            builder.add(static_cast<uint8_t>(metric.label), trace.data(), trace.size());
+        });
+        auto profiled = std::make_unique<ProfiledTemplates>();
+        profiled->source = source;
+        profiled->set = builder.build();
+        size_t classes = profiled->set.classes();
+        if (classes == 0) profiled.reset();
+        trace_templates[static_cast<size_t>(op)] = std::move(profiled);
+        return classes;
+    }
+
+    const TemplateSet* templates(CryptoOperation op) const {
+        const auto& profiled = trace_templates[static_cast<size_t>(op)];
+        return profiled ? &profiled->set : nullptr;
+    }
+
+    // Matching mode: log-likelihoods of the stored traces from record
+    // `first` on, summed per template class, scored in batches
+    TemplateMatch matchTemplates(CryptoOperation op, size_t first = 0) {
+        drainThreadBuffers();
+        const auto& profiled = trace_templates[static_cast<size_t>(op)];
+        if (!profiled) return TemplateMatch();
+        const TemplateSet& set = profiled->set;
+        if (set.points.empty()) return TemplateMatch();
+        const size_t length = size_t(*std::max_element(set.points.begin(), set.points.end())) + 1;
+
+        std::vector<double> batch, scores(TemplateSet::kBatch * set.classes());
+        std::vector<double> totals(set.classes(), 0.0), scratch;
+        uint64_t scored = 0;
+        auto flush = [&]() {
+            size_t rows = batch.size() / length;
+            set.score(batch.data(), rows, length, scores.data());
+            TemplateMatch part = summarizeTemplateScores(set, scores.data(), rows);
+            for (size_t c = 0; c < totals.size(); ++c) totals[c] += part.log_likelihood[c];
+            scored += part.trace_count;
+            batch.clear();
+        };
+        size_t index = 0;
+        measurements(op).forEach([&](const CryptoMetrics& metric) {
+            if (index++ < first) return;
+            const auto& trace = traceOf(metric, profiled->source, scratch);
+            if (trace.size() < length) return;
+            batch.insert(batch.end(), trace.begin(), trace.begin() + length);
+            if (batch.size() == TemplateSet::kBatch * length) flush();
+        });
+        if (!batch.empty()) flush();
+
+        // Reuse the summary's best/margin logic on the totals as one row
+        TemplateMatch match = summarizeTemplateScores(set, totals.data(), 1);
+        match.trace_count = scored;
+        return match;
+    }
+
+    // Scores caller-supplied traces, row-major [count x length] in the
+    // source layout, into out[count x classes] ordered as templates()->labels
+    bool scoreTemplates(CryptoOperation op, const double* traces, size_t count, size_t length,
+                        std::vector<double>& out) const {
+        const TemplateSet* set = templates(op);
+        if (!set) return false;
+        out.resize(count * set->classes());
+        set->score(traces, count, length, out.data());
+        return true;
+    }
+
+    static const std::vector<double>& traceOf(const CryptoMetrics& metric, TraceSource source,
+                                              std::vector<double>& scratch) {
+        switch (source) {
+            case TraceSource::ROUND_POWER:
+                return metric.crypto_specific.round_power;
+            case TraceSource::POWER_TRACE:
+                return metric.power.power_trace;
+            case TraceSource::ROUND_TIMING:
+                break;
+        }
+        const auto& timings = metric.crypto_specific.round_timings;
+        scratch.clear();
+        for (size_t i = 1; i < timings.size(); ++i) {
+            scratch.push_back(static_cast<double>(timings[i] - timings[i - 1]));
+        }
+        return scratch;
+    }
+
+    // Column (structure-of-arrays) view of one operation's measurements for
+    // bulk consumers. round_power is row-major [count x round_width],
+    // NaN-padded for operations with fewer rounds.
+    struct OperationColumns {
+        size_t count = 0;
+        std::vector<uint64_t> start_cycle;
+        std::vector<uint64_t> end_cycle;
+        std::vector<uint64_t> start_inst;
+        std::vector<uint64_t> end_inst;
+        std::vector<uint64_t> key_size;
+        std::vector<uint64_t> rounds;
+        std::vector<uint32_t> label;
+        std::vector<double> execution_time;
+        std::vector<double> l1_miss_rate;
+        std::vector<double> mispredict_rate;
+        std::vector<double> energy;
+        size_t round_width = 0;
+        std::vector<double> round_power;
+    };
+
+    OperationColumns extractColumns(CryptoOperation op) {
+        drainThreadBuffers();
+        OperationColumns columns;
+        const MeasurementStore& series = measurements(op);
+        size_t n = series.size();
+        if (n == 0) return columns;
+        columns.count = n;
+        series.forEach([&](const CryptoMetrics& metric) {
+            columns.round_width = std::max(columns.round_width,
+                                           metric.crypto_specific.round_power.size());
+        });
+
+        columns.start_cycle.resize(n);
+        columns.end_cycle.resize(n);
+        columns.start_inst.resize(n);
+        columns.end_inst.resize(n);
+        columns.key_size.resize(n);
+        columns.rounds.resize(n);
+        columns.label.resize(n);
+        columns.execution_time.resize(n);
+        columns.l1_miss_rate.resize(n);
+        columns.mispredict_rate.resize(n);
+        columns.energy.resize(n);
+        columns.round_power.assign(n * columns.round_width,
+                                   std::numeric_limits<double>::quiet_NaN());
+
+        size_t i = 0;
+        series.forEach([&](const CryptoMetrics& metric) {
+            columns.start_cycle[i] = metric.start_cycle;
+            columns.end_cycle[i] = metric.end_cycle;
+            columns.start_inst[i] = metric.start_inst;
+            columns.end_inst[i] = metric.end_inst;
+            columns.key_size[i] = metric.crypto_specific.key_size;
+            columns.rounds[i] = metric.crypto_specific.rounds;
+            columns.label[i] = metric.label;
+            columns.execution_time[i] = static_cast<double>(metric.end_cycle - metric.start_cycle);
+            columns.l1_miss_rate[i] = metric.cache.miss_rate;
+            columns.mispredict_rate[i] = metric.branch.mispredict_rate;
+            columns.energy[i] = metric.power.end_energy - metric.power.start_energy;
+            const auto& power = metric.crypto_specific.round_power;
+            std::copy(power.begin(), power.end(),
+                      columns.round_power.begin() + i * columns.round_width);
+            ++i;
+        });
+        return columns;
+    }
+
+    // Binary capture: header followed by each operation's records in
+    // storage order. loadCapture appends to the current measurements.
+    static constexpr uint32_t kCaptureMagic = 0x50434D43;  // "CMCP"
+    // v2 added the per-record class label; v3 stores each operation as
+    // independently compressed column blocks behind a block index
+    static constexpr uint16_t kCaptureVersion = 3;
+    static constexpr size_t kCaptureBlockRecords = 4096;
+
+    // v3 operation section: u32 op | u64 records | u32 blocks |
+    // blocks x (u32 records, u64 bytes) | block payloads. The index gives
+    // every block's offset up front, so blocks decode independently.
+    std::vector<uint8_t> serializeCapture(const ColumnPolicy& policy = ColumnPolicy::dense()) {
+        drainThreadBuffers();
+        std::vector<uint8_t> out;
+        ByteWriter writer(out);
+        writer.put<uint32_t>(kCaptureMagic);
+        writer.put<uint16_t>(kCaptureVersion);
+        writer.put<uint16_t>(0);  // flags
+        uint32_t op_count = 0;
+        for (const auto& series : operation_measurements) op_count += series.empty() ? 0 : 1;
+        writer.put<uint32_t>(op_count);
+        for (size_t op = 0; op < kOperationCount; ++op) {
+            const MeasurementStore& series = operation_measurements[op];
+            if (series.empty()) continue;
+            size_t blocks = (series.size() + kCaptureBlockRecords - 1) / kCaptureBlockRecords;
+            writer.put<uint32_t>(static_cast<uint32_t>(op));
+            writer.put<uint64_t>(series.size());
+            writer.put<uint32_t>(static_cast<uint32_t>(blocks));
+
+            // Index entries are patched in once each block's size is known
+            size_t index_at = out.size();
+            out.resize(index_at + blocks * kIndexEntrySize);
+
+            size_t block = 0;
+            std::vector<CryptoMetrics> pending;
+            pending.reserve(std::min(series.size(), kCaptureBlockRecords));
+            auto flush = [&] {
+                size_t start = out.size();
+                encode_block(writer, pending, policy);
+                uint32_t records = static_cast<uint32_t>(pending.size());
+                uint64_t bytes = out.size() - start;
+                uint8_t* entry = out.data() + index_at + block * kIndexEntrySize;
+                std::memcpy(entry, &records, sizeof(records));
+                std::memcpy(entry + sizeof(records), &bytes, sizeof(bytes));
+                ++block;
+                pending.clear();
+            };
+            series.forEach([&](const CryptoMetrics& metric) {
+                pending.push_back(metric);
+                if (pending.size() == kCaptureBlockRecords) flush();
+            });
+            if (!pending.empty()) flush();
+        }
+        return out;
+    }
+
+    bool loadCapture(const uint8_t* data, size_t size) {
+        ByteReader reader(data, size);
+        if (reader.get<uint32_t>() != kCaptureMagic) return false;
+        uint16_t version = reader.get<uint16_t>();
+        if (version == 0 || version > kCaptureVersion) return false;
+        reader.get<uint16_t>();
+        uint32_t op_count = reader.get<uint32_t>();
+        if (version >= 3) return load_block_capture(reader, op_count);
+
+        // Decode everything first so a truncated capture leaves us untouched
+        std::map<CryptoOperation, std::vector<CryptoMetrics>> loaded;
+        for (uint32_t i = 0; i < op_count && !reader.failed(); ++i) {
+            uint32_t op = reader.get<uint32_t>();
+            uint64_t count = reader.get<uint64_t>();
+            if (op >= kOperationCount) return false;
+            auto& records = loaded[static_cast<CryptoOperation>(op)];
+            for (uint64_t r = 0; r < count && !reader.failed(); ++r) {
+                records.push_back(read_record(reader, version));
+            }
+        }
+        if (reader.failed()) return false;
+
+        for (auto& entry : loaded) {
+            auto& target = measurements(entry.first);
+            for (auto& metric : entry.second) target.push_back(std::move(metric));
+        }
+        return true;
+    }
+
+#ifndef __EMSCRIPTEN__
+    // Caps resident sealed measurements at `budget_bytes`; older blocks are
+    // written to an append-only segment file at `path` by a background
+    // thread and read back on demand by the analyses. The file is unlinked
+    // immediately and only the first call opens it. A forked child cannot
+    // spill into its parent's file (see afterFork), so this fails there.
+    bool enableSpill(const std::string& path, size_t budget_bytes) {
+        if (!spill_context.file) {
+            spill_context.file = SegmentFile::open(path);
+            if (!spill_context.file) return false;
+        }
+        if (spill_context.file->abandoned()) return false;
+        spill_context.budget = budget_bytes;
+        for (auto& series : operation_measurements) series.enforceBudget();
+        return true;
+    }
+
+    struct SpillStats {
+        size_t resident_bytes = 0;
+        uint64_t spilled_blocks = 0;
+        uint64_t spilled_bytes = 0;
+        uint64_t read_errors = 0;
+        bool write_failed = false;
+    };
+
+    SpillStats spillStats() const {
+        SpillStats stats;
+        stats.resident_bytes = spill_context.resident;
+        stats.spilled_blocks = spill_context.spilled_blocks;
+        stats.spilled_bytes = spill_context.spilled_bytes;
+        stats.read_errors = spill_context.read_errors;
+        stats.write_failed = spill_context.file && spill_context.file->failed();
+        return stats;
+    }
+
+    // fork() support for hosts that record from several threads, meant for
+    // pthread_atfork handlers: prepareFork() holds the buffer registry so
+    // neither process inherits it mid-update, and afterFork() lets it go.
+    // Only the forking thread exists in the child, so every other thread's
+    // buffer is freed after its next drain, and the child stops spilling:
+    // the segment file's writer thread is the parent's.
+    void prepareFork() { thread_buffers_mutex.lock(); }
+
+    void afterFork(bool child) {
+        if (child) {
+            ThreadEventBuffer* own = thread_buffer_cache().find(instance_id);
+            for (ThreadEventBuffer* buffer : thread_buffers) {
+                if (buffer != own) ThreadEventBuffer::release(buffer, ThreadEventBuffer::PRODUCER);
+            }
+            if (spill_context.file) {
+                // Blocks already on disk stay readable; the rest keep their
+                // in-memory copies, since nothing writes them any more
+                spill_context.file->abandonWriter();
+                spill_context.budget = std::numeric_limits<size_t>::max();
+            }
+        }
+        thread_buffers_mutex.unlock();
+    }
+#endif
+
+    // Drops an operation's measurements (and its projected trace scores)
+    // and frees their memory. Record numbering continues, so live-delta
+    // cursors stay valid; research jobs and snapshots keep the records
+    // they already hold until they finish. Windows, anomaly trackers and
+    // alert state are running aggregates and are not reset.
+    void clear(CryptoOperation op) {
+        drainThreadBuffers();
+        measurements(op).clear();
+        auto& projection = trace_projections[static_cast<size_t>(op)];
+        if (projection) std::vector<double>().swap(projection->scores);
+    }
+
+    // clear() for every operation, plus the merged summaries
+    void clearAll() {
+        for (size_t op = 0; op < kOperationCount; ++op) clear(static_cast<CryptoOperation>(op));
+        merged_summary = MonitorSummary();
+    }
+
+    // Rebuilds resident measurement blocks at their exact size (see
+    // MeasurementSeries::compact) and returns the bytes saved. Natively
+    // the allocator is then asked to hand free pages back to the system;
+    // a WASM heap cannot shrink, but the space is reused by later
+    // captures instead of growing it further.
+    size_t compact() {
+        drainThreadBuffers();
+        size_t saved = 0;
+        for (auto& series : operation_measurements) saved += series.compact();
+        for (auto& projection : trace_projections) {
+            if (projection) projection->scores.shrink_to_fit();
+        }
+#if defined(__GLIBC__) && !defined(__EMSCRIPTEN__)
+        malloc_trim(0);
+#endif
+        return saved;
+    }
+
+    // Per-record vectors, for memory accounting. RECORD is the fixed part.
+    static constexpr size_t kRecordSeriesCount = 9;
+
+    static const char* recordSeriesName(size_t series) {
+        static const char* const names[kRecordSeriesCount] = {
+            "record", "power_trace", "access_patterns", "square_timings",
+            "multiply_timings", "reduce_timings", "memory_access_pattern",
+            "round_timings", "round_power"};
+        return series < kRecordSeriesCount ? names[series] : "unknown";
+    }
+
+    struct SeriesMemory {
+        size_t used_bytes = 0;       // elements stored
+        size_t allocated_bytes = 0;  // capacity reserved
+    };
+
+    struct OperationMemory {
+        MeasurementStore::Usage store;
+        std::array<SeriesMemory, kRecordSeriesCount> series;  // resident records only
+        size_t projection_bytes = 0;
+    };
+
+    // What the allocator reports, where it can: mallinfo under emscripten
+    // and glibc
+    struct HeapMemory {
+        bool available = false;
+        size_t arena_bytes = 0;
+        size_t in_use_bytes = 0;
+        size_t free_bytes = 0;
+
+        double fragmentation() const {
+            return arena_bytes ? static_cast<double>(free_bytes) / arena_bytes : 0.0;
+        }
+    };
+
+    struct MemoryUsage {
+        std::array<OperationMemory, kOperationCount> operations;
+        size_t resident_bytes = 0;  // sealed + tail + index + projections
+        size_t slack_bytes = 0;     // allocated but unused record vector capacity
+        uint64_t dead_spill_bytes = 0;
+        HeapMemory heap;
+    };
+
+    MemoryUsage memoryUsage() {
+        drainThreadBuffers();
+        MemoryUsage usage;
+        for (size_t op = 0; op < kOperationCount; ++op) {
+            OperationMemory& memory = usage.operations[op];
+            memory.store = operation_measurements[op].usage();
+            operation_measurements[op].forEachResident([&](const CryptoMetrics& metric) {
+                accountRecord(metric, memory.series);
+            });
+            if (trace_projections[op]) {
+                memory.projection_bytes = trace_projections[op]->scores.capacity() * sizeof(double);
+            }
+            usage.resident_bytes += memory.store.sealed_bytes + memory.store.tail_bytes +
+                                    memory.store.index_bytes + memory.projection_bytes;
+            for (const SeriesMemory& series : memory.series) {
+                usage.slack_bytes += series.allocated_bytes - series.used_bytes;
+            }
+        }
+        usage.dead_spill_bytes = spill_context.dead_bytes;
+        usage.heap = heapMemory();
+        return usage;
+    }
+
+    static HeapMemory heapMemory() {
+        HeapMemory heap;
+#if defined(__EMSCRIPTEN__)
+        struct mallinfo info = mallinfo();
+        heap.available = true;
+        heap.arena_bytes = static_cast<size_t>(info.arena);
+        heap.in_use_bytes = static_cast<size_t>(info.uordblks);
+        heap.free_bytes = static_cast<size_t>(info.fordblks);
+#elif defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+        // Large blocks are mmapped outside the arenas; count them as in use
+        struct mallinfo2 info = mallinfo2();
+        heap.available = true;
+        heap.arena_bytes = info.arena + info.hblkhd;
+        heap.in_use_bytes = info.uordblks + info.hblkhd;
+        heap.free_bytes = info.fordblks;
+#endif
+        return heap;
+    }
+
+private:
+    static void accountRecord(const CryptoMetrics& m,
+                              std::array<SeriesMemory, kRecordSeriesCount>& series) {
+        auto add = [&](size_t index, const auto& values) {
+            using Value = typename std::decay_t<decltype(values)>::value_type;
+            series[index].used_bytes += values.size() * sizeof(Value);
+            series[index].allocated_bytes += values.capacity() * sizeof(Value);
+        };
+        series[0].used_bytes += sizeof(CryptoMetrics);
+        series[0].allocated_bytes += sizeof(CryptoMetrics);
+        add(1, m.power.power_trace);
+        add(2, m.memory.access_patterns);
+        add(3, m.rsa_metrics.operations.square_timings);
+        add(4, m.rsa_metrics.operations.multiply_timings);
+        add(5, m.rsa_metrics.operations.reduce_timings);
+        add(6, m.rsa_metrics.memory_specific.memory_access_pattern);
+        add(7, m.crypto_specific.round_timings);
+        add(8, m.crypto_specific.round_power);
+    }
+
+public:
+
+    // Appends other's measurements and merged summaries to ours. Records
+    // still sitting in other's per-thread buffers are left where they are.
+    void merge(const EnhancedCryptoMonitor& other) {
+        if (&other == this) return;
+        drainThreadBuffers();
+        for (size_t op = 0; op < kOperationCount; ++op) {
+            auto& target = operation_measurements[op];
+            other.operation_measurements[op].forEach([&](const CryptoMetrics& metric) {
+                target.push_back(metric);
+            });
+        }
+        merged_summary.merge(other.merged_summary);
+    }
+
+    // Replaces `target`'s measurements with a snapshot of ours: sealed
+    // blocks are shared and only each operation's open tail is copied, so
+    // the cost does not grow with the capture. `target` can then be
+    // analysed on another thread while this monitor keeps recording.
+    // Merged summaries come along; windows, alert and anomaly state and
+    // trace projections belong to ingest and do not.
+    void snapshotInto(EnhancedCryptoMonitor& target) {
+        if (&target == this) return;
+        drainThreadBuffers();
+#ifndef __EMSCRIPTEN__
+        if (spill_context.file) target.spill_context.file = spill_context.file;
+#endif
+        // Every sealed block comes along, and with it every charge
+        target.spill_context.resident = spill_context.resident;
+        for (size_t op = 0; op < kOperationCount; ++op) {
+            MeasurementStore& series = target.operation_measurements[op];
+            series = operation_measurements[op].snapshot();
+            series.attach(&target.spill_context);
+        }
+        target.merged_summary = merged_summary;
+    }
+
+    std::unique_ptr<EnhancedCryptoMonitor> snapshot() {
+        auto copy = std::make_unique<EnhancedCryptoMonitor>();
+        snapshotInto(*copy);
+        return copy;
+    }
+
+    // Resizes every operation's window and drops what it held. The window
+    // is split into `buckets` equal slices that expire as a whole.
+    void setWindow(uint64_t window_ns, size_t buckets) {
+        for (auto& window : operation_windows) window.configure(window_ns, buckets);
+    }
+
+    // Execution-time statistics over the operations that ended within the
+    // window before `now_ns` (a get_timestamp() value). Only live
+    // recordings count; merged monitors and loaded captures do not.
+    WindowStatistics windowStatistics(CryptoOperation op, uint64_t now_ns) {
+        drainThreadBuffers();
+        return window(op).query(now_ns);
+    }
+
+    WindowStatistics windowStatistics(CryptoOperation op) {
+        return windowStatistics(op, get_timestamp());
+    }
+
+    // Rollup of every record stored since `cursors` (one record number per
+    // operation, counting records dropped by clear()), which are advanced
+    // to the end. Records cleared before they were reported are skipped;
+    // a cursor past the end restarts from the first record.
+    LiveDelta liveDelta(std::array<uint64_t, kOperationCount>& cursors) {
+        drainThreadBuffers();
+        LiveDelta delta;
+        for (size_t i = 0; i < kOperationCount; ++i) {
+            const MeasurementStore& store = operation_measurements[i];
+            const uint64_t first = store.dropped();
+            const uint64_t end = first + store.size();
+            if (cursors[i] < first || cursors[i] > end) cursors[i] = first;
+            if (cursors[i] == end) continue;
+            LiveBucket bucket;
+            bucket.op = static_cast<uint32_t>(i);
+            store.forEachFrom(static_cast<size_t>(cursors[i] - first), [&](const CryptoMetrics& metric) {
+                bucket.add(static_cast<double>(metric.end_cycle - metric.start_cycle));
+            });
+            cursors[i] = end;
+            delta.buckets.push_back(std::move(bucket));
+        }
+        return delta;
+    }
+
+    // Anomalies are scored as operations end and rounds are recorded; the
+    // lock-free path is scored when drained. Reconfiguring resets the
+    // trackers but keeps undelivered events.
+    void configureAnomalyDetection(const AnomalyConfig& config) {
+        anomalies.configure(config);
+    }
+
+    // Called synchronously from endOperation/recordRound or from a drain,
+    // so it must not call back into this monitor
+    void setAnomalyCallback(AnomalyDetector::Callback callback) {
+        anomalies.setCallback(std::move(callback));
+    }
+
+    std::vector<AnomalyEvent> pollAnomalies(size_t limit = SIZE_MAX) {
+        drainThreadBuffers();
+        std::vector<AnomalyEvent> events;
+        anomalies.poll(events, limit);
+        return events;
+    }
+
+    uint64_t overwrittenAnomalies() const {
+        return anomalies.overwritten();
+    }
+
+    // Alert rules (grammar in alert_rules.h) are compiled once and checked
+    // on ingest, at most once per alert interval (1 ms by default), against
+    // only the accumulators that changed. They see live recordings from the
+    // moment they are added. Returns the rule id, or -1 with `error`
+    // describing the parse failure.
+    int64_t addAlertRule(const std::string& text, std::string& error) {
+        return alerts.addRule(text, error);
+    }
+
+    bool removeAlertRule(uint32_t id) {
+        return alerts.removeRule(id);
+    }
+
+    void setAlertInterval(uint64_t interval_ns) {
+        alerts.setInterval(interval_ns);
+    }
+
+    // Same re-entrancy rule as the anomaly callback
+    void setAlertCallback(AlertEngine::Callback callback) {
+        alerts.setCallback(std::move(callback));
+    }
+
+    // Also lets windowed rules resolve while no operations arrive
+    void evaluateAlerts(uint64_t now_ns) {
+        drainThreadBuffers();
+        alerts.evaluate(now_ns);
+    }
+
+    std::vector<AlertEvent> pollAlerts(size_t limit = SIZE_MAX) {
+        evaluateAlerts(get_timestamp());
+        std::vector<AlertEvent> events;
+        alerts.poll(events, limit);
+        return events;
+    }
+
+    std::vector<AlertState> alertStates() {
+        evaluateAlerts(get_timestamp());
+        return alerts.states();
+    }
+
+    // Mergeable summary of one operation: own samples plus merged summaries
+    OperationSummary operationSummary(CryptoOperation op) {
+        drainThreadBuffers();
+        OperationSummary summary;
+        measurements(op).forEach([&](const CryptoMetrics& metric) {
+            summary.add(metric.label,
+                        static_cast<double>(metric.end_cycle - metric.start_cycle),
+                        metric.crypto_specific.round_power,
+                        metric.crypto_specific.round_timings);
+        });
+        summary.merge(merged_summary.operations[static_cast<size_t>(op)]);
+        return summary;
+    }
+
+    MonitorSummary summary() {
+        MonitorSummary result;
+        for (size_t i = 0; i < kOperationCount; ++i) {
+            result.operations[i] = operationSummary(static_cast<CryptoOperation>(i));
+        }
+        return result;
+    }
+
+    std::vector<uint8_t> serializeSummary() {
+        return summary().serialize();
+    }
+
+    bool mergeSerializedSummary(const uint8_t* data, size_t size) {
+        MonitorSummary incoming;
+        if (!incoming.deserialize(data, size)) return false;
+        merged_summary.merge(incoming);
+        return true;
+    }
+
+#ifdef __EMSCRIPTEN__
+    emscripten::val analyzeRSAPerformance(const std::string& operation_type) {
+        CryptoOperation op = parseCryptoOperation(operation_type);
+        if (!isRsa(op)) return emscripten::val::object();
+        return rsaToVal(rsaAnalysis(op));
+    }
+
+    emscripten::val analyzeTimingSideChannels(const std::string& operation_type) {
+        CryptoOperation op = parseCryptoOperation(operation_type);
+        drainThreadBuffers();
+        if (measurements(op).empty()) return emscripten::val::object();
+        return timingToVal(timingAnalysis(op));
+    }
+
+    emscripten::val analyzeCacheBehavior(const std::string& operation_type) {
+        CryptoOperation op = parseCryptoOperation(operation_type);
+        drainThreadBuffers();
+        if (measurements(op).empty()) return emscripten::val::object();
+        return cacheToVal(cacheAnalysis(op));
+    }
+
+    emscripten::val getResearchMetrics(const std::string& operation_type) {
+        auto results = emscripten::val::object();
+        results.set("timing_analysis", analyzeTimingSideChannels(operation_type));
+        results.set("cache_analysis", analyzeCacheBehavior(operation_type));
+        results.set("distribution_analysis", analyzeDistribution(operation_type));
+        if (operation_type == "RSA_ENCRYPT" || operation_type == "RSA_DECRYPT") {
+            results.set("rsa_analysis", analyzeRSAPerformance(operation_type));
+        }
+        return results;
+    }
+
+    // Resumable getResearchMetrics: start a job, then call
+    // continueResearchMetrics(id, budget_ms) until it reports done,
+    // yielding to the event loop in between. Each step returns
+    // { done, phase, processed, total } with `partial` execution-time
+    // moments while scanning and `result` (getResearchMetrics' shape)
+    // once done, after which the job is released.
+    int startResearchMetrics(const std::string& operation_type) {
+        return static_cast<int>(startResearch(parseCryptoOperation(operation_type)));
+    }
+
+    emscripten::val continueResearchMetrics(int id, double budget_ms) {
+        uint64_t budget_ns = budget_ms > 0 ? static_cast<uint64_t>(budget_ms * 1e6) : 0;
+        const ResearchJob* job = continueResearch(static_cast<uint32_t>(id), budget_ns);
+        if (!job) return emscripten::val::null();
+
+        auto step = emscripten::val::object();
+        step.set("done", job->done());
+        step.set("phase", std::string(researchPhaseName(job->phase)));
+        step.set("processed", static_cast<double>(job->cursor));
+        step.set("total", static_cast<double>(job->total));
+        if (!job->done()) {
+            auto partial = emscripten::val::object();
+            partial.set("count", static_cast<double>(job->scanned.count));
+            partial.set("mean", job->scanned.mean);
+            partial.set("stddev", job->scanned.stddev());
+            partial.set("min", job->scanned.count ? job->scanned.min : 0.0);
+            partial.set("max", job->scanned.count ? job->scanned.max : 0.0);
+            step.set("partial", partial);
+            return step;
+        }
+
+        auto results = emscripten::val::object();
+        bool any = job->total > 0;
+        results.set("timing_analysis", any ? timingToVal(job->timing) : emscripten::val::object());
+        results.set("cache_analysis", any ? cacheToVal(job->cache) : emscripten::val::object());
+        results.set("distribution_analysis", distributionToVal(job->distribution));
+        if (isRsa(job->op)) results.set("rsa_analysis", rsaToVal(job->rsa));
+        step.set("result", results);
+        cancelResearch(static_cast<uint32_t>(id));
+        return step;
+    }
+
+    void cancelResearchMetrics(int id) {
+        cancelResearch(static_cast<uint32_t>(id));
+    }
+
+#ifdef CRYPTO_MONITOR_HAS_COROUTINES
+    // The same job as a Promise: resolves to getResearchMetrics' shape, or
+    // null if the job is cancelled meanwhile, after running slices of
+    // `slice_ms` with a macrotask between them. `on_progress`, unless
+    // null/undefined, is called with each unfinished step. The monitor
+    // must outlive the promise.
+    emscripten::val researchMetricsAsync(std::string operation_type, double slice_ms,
+                                         emscripten::val on_progress) {
+        int id = startResearchMetrics(operation_type);
+        for (;;) {
+            emscripten::val step = continueResearchMetrics(id, slice_ms);
+            if (step.isNull()) co_return emscripten::val::null();
+            if (step["done"].as<bool>()) co_return step["result"];
+            if (!on_progress.isNull() && !on_progress.isUndefined()) on_progress(step);
+            co_await emscripten::val::take_ownership(crypto_monitor_next_macrotask());
+        }
+    }
+#endif
+
+    emscripten::val timingToVal(const TimingAnalysis& analysis) {
+        auto results = emscripten::val::object();
+        results.set("execution_times", analysis.execution_times);
+        results.set("round_variations", analysis.round_variations);
+        results.set("power_variations", analysis.power_variations);
+        results.set("statistical_analysis", computeStatistics(analysis.statistics));
+        return results;
+    }
+
+    static emscripten::val cacheToVal(const CacheAnalysis& analysis) {
+        auto results = emscripten::val::object();
+        results.set("l1_miss_rates", analysis.l1_miss_rates);
+        results.set("l2_miss_rates", analysis.l2_miss_rates);
+        results.set("l3_miss_rates", analysis.l3_miss_rates);
+        return results;
+    }
+
+    emscripten::val rsaToVal(const RSAAnalysis& analysis) {
+        auto results = emscripten::val::object();
+        results.set("modular_exponentiation_times", analysis.modular_exponentiation_times);
+        results.set("memory_access_patterns", analysis.memory_access_patterns);
+        results.set("cache_behavior", analysis.cache_behavior);
+        results.set("statistical_analysis", computeStatistics(analysis.statistics));
+        return results;
+    }
+
+    static emscripten::val distributionToVal(const DistributionAnalysis& analysis) {
+        auto results = emscripten::val::object();
+        results.set("execution_time", shapeToVal(analysis.execution_time));
+        results.set("round_deltas", shapeToVal(analysis.round_deltas));
+        return results;
+    }
+
+    emscripten::val analyzeDistribution(const std::string& operation_type) {
+        return distributionToVal(distributionAnalysis(parseCryptoOperation(operation_type)));
+    }
+
+    // `method` is "isj" (default) or "silverman"; `density` is a
+    // Float64Array of `points` values evenly spaced over [low, high]
+    emscripten::val getDensity(const std::string& operation_type, int points,
+                               const std::string& method) {
+        DensityOptions options;
+        if (points > 1) options.points = static_cast<size_t>(points);
+        options.rule = method == "silverman" ? BandwidthRule::SILVERMAN : BandwidthRule::ISJ;
+        DensityEstimate estimate = executionTimeDensity(parseCryptoOperation(operation_type), options);
+
+        auto results = emscripten::val::object();
+        results.set("low", estimate.low);
+        results.set("high", estimate.high);
+        results.set("bandwidth", estimate.bandwidth);
+        results.set("method", std::string(estimate.rule == BandwidthRule::ISJ ? "isj" : "silverman"));
+        results.set("count", static_cast<double>(estimate.count));
+        results.set("outside", static_cast<double>(estimate.outside));
+        results.set("density", emscripten::val(emscripten::typed_memory_view(
+                                   estimate.density.size(), estimate.density.data()))
+                                   .call<emscripten::val>("slice"));
+        return results;
+    }
+
+    static emscripten::val shapeToVal(const DistributionShape& shape) {
+        auto result = emscripten::val::object();
+        result.set("count", static_cast<double>(shape.count));
+        result.set("outliers", static_cast<double>(shape.outliers));
+        auto components = emscripten::val::array();
+        for (const GaussianComponent& c : shape.mixture.components) {
+            auto component = emscripten::val::object();
+            component.set("weight", c.weight);
+            component.set("mean", c.mean);
+            component.set("stddev", c.stddev);
+            components.call<void>("push", component);
+        }
+        result.set("components", components);
+        result.set("separation", shape.separation);
+        result.set("bic_unimodal", shape.bic_unimodal);
+        result.set("bic_bimodal", shape.bic_bimodal);
+        result.set("dip", shape.dip);
+        result.set("dip_z", shape.dip_z);
+        result.set("bimodal", shape.bimodal);
+        return result;
+    }
+
+    emscripten::val analyzeTVLA(const std::string& operation_type) {
+        auto results = emscripten::val::object();
+        TvlaResult tvla = tvlaAnalysis(parseCryptoOperation(operation_type));
+        results.set("fixed_count", static_cast<double>(tvla.fixed_count));
+        results.set("random_count", static_cast<double>(tvla.random_count));
+        results.set("execution_time_t", tvla.execution_time_t);
+        results.set("round_power_t", tvla.round_power_t);
+        results.set("round_timing_t", tvla.round_timing_t);
+        results.set("max_abs_t", tvla.max_abs_t);
+        results.set("leakage_detected", tvla.leakage_detected);
+        return results;
+    }
+
+    emscripten::val analyzeCPA(const std::string& operation_type) {
+        auto results = emscripten::val::object();
+        CpaResult cpa = cpaAnalysis(parseCryptoOperation(operation_type));
+        results.set("trace_count", static_cast<double>(cpa.trace_count));
+        results.set("points", static_cast<double>(cpa.points));
+        results.set("peak_correlation", std::vector<double>(cpa.peak_correlation.begin(),
+                                                            cpa.peak_correlation.end()));
+        results.set("best_guess", cpa.best_guess);
+        results.set("best_correlation", cpa.best_correlation);
+        return results;
+    }
+
+    // `source` is "round_power" (default) or "power_trace"
+    emscripten::val analyzeSNR(const std::string& operation_type, const std::string& source,
+                               int top_k) {
+        auto results = emscripten::val::object();
+        SnrResult snr = snrAnalysis(parseCryptoOperation(operation_type),
+                                    parseTraceSource(source));
+        results.set("trace_count", static_cast<double>(snr.trace_count));
+        results.set("points", static_cast<double>(snr.points));
+        results.set("classes", snr.classes);
+        results.set("snr", snr.snr);
+        results.set("points_of_interest",
+                    selectPointsOfInterest(snr.snr, top_k > 0 ? static_cast<size_t>(top_k) : 10));
+        return results;
+    }
+
+    emscripten::val fitTracePCA(const std::string& operation_type, const std::string& source,
+                                int components) {
+        return pcaToVal(tracePca(parseCryptoOperation(operation_type), parseTraceSource(source),
+                                 components > 0 ? static_cast<size_t>(components) : 4));
+    }
+
+    // Fits on the traces so far and projects every later one; returns the fit
+    emscripten::val enableTraceProjection(const std::string& operation_type,
+                                          const std::string& source, int components,
+                                          bool discard_raw) {
+        CryptoOperation op = parseCryptoOperation(operation_type);
+        TraceSource trace_source = parseTraceSource(source);
+        PrincipalComponents pca = tracePca(op, trace_source,
+                                           components > 0 ? static_cast<size_t>(components) : 4);
+        emscripten::val result = pcaToVal(pca);
+        setTraceProjection(op, trace_source, std::move(pca), discard_raw);
+        return result;
+    }
+
+    void disableTraceProjection(const std::string& operation_type) {
+        clearTraceProjection(parseCryptoOperation(operation_type));
+    }
+
+    emscripten::val getProjectedTraces(const std::string& operation_type) {
+        auto results = emscripten::val::object();
+        std::vector<double> scores;
+        size_t width = projectedTraces(parseCryptoOperation(operation_type), scores);
+        results.set("components", static_cast<double>(width));
+        results.set("count", static_cast<double>(width ? scores.size() / width : 0));
+        results.set("scores", emscripten::val(emscripten::typed_memory_view(scores.size(),
+                                                                            scores.data()))
+                                  .call<emscripten::val>("slice"));
+        return results;
+    }
+
+    emscripten::val buildTemplateSet(const std::string& operation_type, const std::string& source,
+                                     const emscripten::val& points) {
+        CryptoOperation op = parseCryptoOperation(operation_type);
+        size_t classes = buildTemplates(op, parseTraceSource(source),
+                                        emscripten::convertJSArrayToNumberVector<uint32_t>(points));
+        auto results = emscripten::val::object();
+        results.set("classes", static_cast<double>(classes));
+        if (const TemplateSet* set = templates(op)) {
+            results.set("dims", static_cast<double>(set->dims()));
+            results.set("labels", set->labels);
+            results.set("ridge", set->ridge);
+        }
+        return results;
+    }
+
+    emscripten::val getTemplateMatch(const std::string& operation_type, double first) {
+        TemplateMatch match = matchTemplates(parseCryptoOperation(operation_type),
+                                             first > 0 ? static_cast<size_t>(first) : 0);
+        auto results = emscripten::val::object();
+        results.set("trace_count", static_cast<double>(match.trace_count));
+        results.set("labels", match.labels);
+        results.set("log_likelihood", match.log_likelihood);
+        results.set("best_label", match.best_label);
+        results.set("margin", match.margin);
+        return results;
+    }
+
+    // `traces` is a row-major Float64Array of traces `length` long; the
+    // result is [count x classes] log-likelihoods, or null without templates
+    emscripten::val scoreTemplateTraces(const std::string& operation_type,
+                                        const emscripten::val& traces, int length) {
+        std::vector<double> values = emscripten::convertJSArrayToNumberVector<double>(traces);
+        std::vector<double> scores;
+        if (length <= 0 ||
+            !scoreTemplates(parseCryptoOperation(operation_type), values.data(),
+                            values.size() / static_cast<size_t>(length),
+                            static_cast<size_t>(length), scores)) {
+            return emscripten::val::null();
+        }
+        return emscripten::val(emscripten::typed_memory_view(scores.size(), scores.data()))
+            .call<emscripten::val>("slice");
+    }
+
+    static TraceSource parseTraceSource(const std::string& source) {
+        if (source == "power_trace") return TraceSource::POWER_TRACE;
+        if (source == "round_timing") return TraceSource::ROUND_TIMING;
+        return TraceSource::ROUND_POWER;
+    }
+
+    static emscripten::val pcaToVal(const PrincipalComponents& pca) {
+        auto result = emscripten::val::object();
+        result.set("trace_count", static_cast<double>(pca.trace_count));
+        result.set("points", static_cast<double>(pca.points));
+        result.set("eigenvalues", pca.eigenvalues);
+        std::vector<double> explained;
+        for (double e : pca.eigenvalues) {
+            explained.push_back(pca.total_variance > 0 ? e / pca.total_variance : 0.0);
+        }
+        result.set("explained_variance_ratio", explained);
+        result.set("mean", pca.mean);
+        result.set("components", pca.components);
+        return result;
+    }
+
+    emscripten::val serialize() {
+        std::vector<uint8_t> bytes = serializeCapture();
+        // slice() copies out of the wasm heap before `bytes` is freed
+        return emscripten::val(emscripten::typed_memory_view(bytes.size(), bytes.data()))
+            .call<emscripten::val>("slice");
+    }
+
+    bool loadSerialized(const emscripten::val& data) {
+        std::vector<uint8_t> bytes = emscripten::convertJSArrayToNumberVector<uint8_t>(data);
+        return loadCapture(bytes.data(), bytes.size());
+    }
+
+    emscripten::val serializeSummaryBytes() {
+        std::vector<uint8_t> bytes = serializeSummary();
+        return emscripten::val(emscripten::typed_memory_view(bytes.size(), bytes.data()))
+            .call<emscripten::val>("slice");
+    }
+
+    bool mergeSummary(const emscripten::val& data) {
+        std::vector<uint8_t> bytes = emscripten::convertJSArrayToNumberVector<uint8_t>(data);
+        return mergeSerializedSummary(bytes.data(), bytes.size());
+    }
+
+    // `cursors` is the subscriber's array of per-operation record indices
+    // (empty to start from the beginning); returns
+    // { cursors, frame } with frame a Uint8Array, or null when nothing is new
+    emscripten::val getLiveDelta(const emscripten::val& cursors) {
+        std::vector<double> values = emscripten::convertJSArrayToNumberVector<double>(cursors);
+        std::array<uint64_t, kOperationCount> positions{};
+        for (size_t i = 0; i < kOperationCount && i < values.size(); ++i) {
+            positions[i] = values[i] > 0 ? static_cast<uint64_t>(values[i]) : 0;
+        }
+        LiveDelta delta = liveDelta(positions);
+        if (delta.empty()) return emscripten::val::null();
+        std::vector<uint8_t> bytes = delta.encode();
+        std::vector<double> advanced(positions.begin(), positions.end());
+        auto result = emscripten::val::object();
+        result.set("cursors", advanced);
+        result.set("frame", emscripten::val(emscripten::typed_memory_view(bytes.size(), bytes.data()))
+                                .call<emscripten::val>("slice"));
+        return result;
+    }
+
+    // Merges `count` packed CompletedOperation records the caller has
+    // already copied into the module heap at `address`, so a drained batch
+    // crosses into wasm as one copy and one call. `clock_offset_ns` is a
+    // BigInt mapping the producers' clock onto this monitor's.
+    int recordEventBatch(uintptr_t address, int count, int64_t clock_offset_ns) {
+        if (address == 0 || count <= 0) return 0;
+        return static_cast<int>(recordCompletedBatch(
+            reinterpret_cast<const CompletedOperation*>(address), static_cast<size_t>(count),
+            clock_offset_ns));
+    }
+
+    emscripten::val getSummary(const std::string& operation_type) {
+        auto results = emscripten::val::object();
+        OperationSummary summary = operationSummary(parseCryptoOperation(operation_type));
+        const RunningMoments& exec = summary.execution_time;
+        results.set("count", static_cast<double>(exec.count));
+        results.set("mean", exec.mean);
+        results.set("stddev", exec.stddev());
+        results.set("min", exec.count ? exec.min : 0.0);
+        results.set("max", exec.count ? exec.max : 0.0);
+        results.set("skewness", exec.skewness());
+        results.set("kurtosis", exec.kurtosis());
+        results.set("p50", summary.execution_sketch.quantile(0.50));
+        results.set("p90", summary.execution_sketch.quantile(0.90));
+        results.set("p99", summary.execution_sketch.quantile(0.99));
+
+        std::vector<double> timing_means, power_means;
+        for (const auto& m : summary.round_timing) timing_means.push_back(m.mean);
+        for (const auto& m : summary.round_power) power_means.push_back(m.mean);
+        results.set("round_timing_means", timing_means);
+        results.set("round_power_means", power_means);
+
+        TvlaResult tvla = summary.tvla.result();
+        results.set("tvla_max_abs_t", tvla.max_abs_t);
+        results.set("tvla_leakage_detected", tvla.leakage_detected);
+        return results;
+    }
+
+    void clearOperation(const std::string& operation_type) {
+        clear(parseCryptoOperation(operation_type));
+    }
+
+    double compactStorage() {
+        return static_cast<double>(compact());
+    }
+
+    // Bytes held per operation (with a per-series breakdown of the
+    // resident records) and what the heap allocator reports
+    emscripten::val getMemoryUsage() {
+        MemoryUsage usage = memoryUsage();
+        auto operations = emscripten::val::object();
+        for (size_t op = 0; op < kOperationCount; ++op) {
+            const OperationMemory& memory = usage.operations[op];
+            auto entry = emscripten::val::object();
+            entry.set("records", static_cast<double>(memory.store.records));
+            entry.set("sealed_bytes", static_cast<double>(memory.store.sealed_bytes));
+            entry.set("tail_bytes", static_cast<double>(memory.store.tail_bytes));
+            entry.set("shared_bytes", static_cast<double>(memory.store.shared_bytes));
+            entry.set("index_bytes", static_cast<double>(memory.store.index_bytes));
+            entry.set("projection_bytes", static_cast<double>(memory.projection_bytes));
+            auto series = emscripten::val::object();
+            for (size_t i = 0; i < kRecordSeriesCount; ++i) {
+                auto bytes = emscripten::val::object();
+                bytes.set("used", static_cast<double>(memory.series[i].used_bytes));
+                bytes.set("allocated", static_cast<double>(memory.series[i].allocated_bytes));
+                series.set(recordSeriesName(i), bytes);
+            }
+            entry.set("series", series);
+            operations.set(operationName(static_cast<CryptoOperation>(op)), entry);
+        }
+
+        auto heap = emscripten::val::object();
+        heap.set("arena_bytes", static_cast<double>(usage.heap.arena_bytes));
+        heap.set("in_use_bytes", static_cast<double>(usage.heap.in_use_bytes));
+        heap.set("free_bytes", static_cast<double>(usage.heap.free_bytes));
+        heap.set("fragmentation", usage.heap.fragmentation());
+        // The module's linear memory, which only ever grows
+        heap.set("memory_bytes", static_cast<double>(emscripten_get_heap_size()));
+
+        auto results = emscripten::val::object();
+        results.set("operations", operations);
+        results.set("resident_bytes", static_cast<double>(usage.resident_bytes));
+        results.set("slack_bytes", static_cast<double>(usage.slack_bytes));
+        results.set("heap", heap);
+        return results;
+    }
+
+    emscripten::val getWindowStatistics(const std::string& operation_type) {
+        auto results = emscripten::val::object();
+        WindowStatistics stats = windowStatistics(parseCryptoOperation(operation_type));
+        results.set("window_seconds", stats.window_ns / 1e9);
+        results.set("count", static_cast<double>(stats.count));
+        results.set("mean", stats.mean);
+        results.set("stddev", stats.stddev);
+        results.set("min", stats.min);
+        results.set("max", stats.max);
+        results.set("p50", stats.p50);
+        results.set("p90", stats.p90);
+        results.set("p99", stats.p99);
+        return results;
+    }
+
+    void setAnomalyDetection(double alpha, double threshold, uint32_t warmup) {
+        AnomalyConfig config;
+        config.alpha = alpha;
+        config.threshold = threshold;
+        config.warmup = warmup;
+        configureAnomalyDetection(config);
+    }
+
+    // `callback(event)` per anomaly; pass null or undefined to remove it
+    void onAnomaly(emscripten::val callback) {
+        if (callback.isNull() || callback.isUndefined()) {
+            setAnomalyCallback(nullptr);
+            return;
+        }
+        setAnomalyCallback([callback](const AnomalyEvent& event) {
+            callback(anomalyToVal(event));
+        });
+    }
+
+    emscripten::val getAnomalies() {
+        auto results = emscripten::val::array();
+        for (const AnomalyEvent& event : pollAnomalies()) {
+            results.call<void>("push", anomalyToVal(event));
+        }
+        return results;
+    }
+
+    static emscripten::val anomalyToVal(const AnomalyEvent& event) {
+        auto result = emscripten::val::object();
+        result.set("timestamp", static_cast<double>(event.timestamp));
+        result.set("operation", std::string(operationName(static_cast<CryptoOperation>(event.op))));
+        result.set("round", event.round);
+        result.set("value", event.value);
+        result.set("z_score", event.z_score);
+        return result;
+    }
+
+    // {values, statistical_analysis} or {error}; statistics skip the
+    // non-finite values a zero denominator produces
+    emscripten::val getDerivedMetric(const std::string& operation_type,
+                                     const std::string& expression) {
+        auto results = emscripten::val::object();
+        std::vector<double> values;
+        std::string error;
+        if (!deriveMetric(parseCryptoOperation(operation_type), expression, values, error)) {
+            results.set("error", error);
+            return results;
+        }
+        std::vector<double> finite;
+        finite.reserve(values.size());
+        for (double v : values) {
+            if (std::isfinite(v)) finite.push_back(v);
+        }
+        results.set("values", values);
+        results.set("statistical_analysis", computeStatistics(summarize(finite)));
+        return results;
+    }
+
+    // `statistic` is "mean" (default) or "median"
+    emscripten::val runPermutationTest(const std::string& operation_type,
+                                       const std::string& expression, uint32_t label_a,
+                                       uint32_t label_b, const std::string& statistic,
+                                       double max_permutations) {
+        auto results = emscripten::val::object();
+        PermutationTestOptions options;
+        if (statistic == "median") options.statistic = PermutationStatistic::MEDIAN_DIFFERENCE;
+        if (max_permutations >= 1) options.max_permutations = static_cast<uint64_t>(max_permutations);
+        PermutationTestResult test;
+        std::string error;
+        if (!permutationTest(parseCryptoOperation(operation_type), expression, label_a, label_b,
+                             options, test, error)) {
+            results.set("error", error);
+            return results;
+        }
+        results.set("count_a", static_cast<double>(test.count_a));
+        results.set("count_b", static_cast<double>(test.count_b));
+        results.set("observed", test.observed);
+        results.set("p_value", test.p_value);
+        results.set("permutations", static_cast<double>(test.permutations));
+        results.set("exceedances", static_cast<double>(test.exceedances));
+        results.set("stopped_early", test.stopped_early);
+        return results;
+    }
+
+    emscripten::val addAlert(const std::string& text) {
+        auto result = emscripten::val::object();
+        std::string error;
+        int64_t id = addAlertRule(text, error);
+        result.set("id", static_cast<double>(id));
+        if (id < 0) result.set("error", error);
+        return result;
+    }
+
+    bool removeAlert(uint32_t id) {
+        return removeAlertRule(id);
+    }
+
+    // `callback({rule, firing, value, timestamp})` on every transition
+    void onAlert(emscripten::val callback) {
+        if (callback.isNull() || callback.isUndefined()) {
+            setAlertCallback(nullptr);
+            return;
+        }
+        setAlertCallback([callback](const AlertEvent& event) {
+            callback(alertToVal(event));
+        });
+    }
+
+    emscripten::val getAlerts() {
+        auto results = emscripten::val::array();
+        for (const AlertEvent& event : pollAlerts()) {
+            results.call<void>("push", alertToVal(event));
+        }
+        return results;
+    }
+
+    emscripten::val getAlertStates() {
+        auto results = emscripten::val::array();
+        for (const AlertState& state : alertStates()) {
+            auto entry = emscripten::val::object();
+            entry.set("rule", state.rule);
+            entry.set("text", state.text);
+            entry.set("firing", state.firing);
+            entry.set("value", state.value);
+            results.call<void>("push", entry);
+        }
+        return results;
+    }
+
+    static emscripten::val alertToVal(const AlertEvent& event) {
+        auto result = emscripten::val::object();
+        result.set("timestamp", static_cast<double>(event.timestamp));
+        result.set("rule", event.rule);
+        result.set("firing", event.firing);
+        result.set("value", event.value);
+        return result;
+    }
+
+    void setWindowSeconds(double seconds, uint32_t buckets) {
+        setWindow(static_cast<uint64_t>(std::max(seconds, 0.0) * 1e9), buckets);
+    }
+#endif
+
+    CryptoOperation parseCryptoOperation(const std::string& operation_type) {
+        static const std::map<std::string, CryptoOperation> op_map = {
+            {"AES_ENCRYPT", CryptoOperation::AES_ENCRYPT},
+            {"AES_DECRYPT", CryptoOperation::AES_DECRYPT},
+            {"RSA_ENCRYPT", CryptoOperation::RSA_ENCRYPT},
+            {"RSA_DECRYPT", CryptoOperation::RSA_DECRYPT},
+            {"ECDSA_SIGN", CryptoOperation::ECDSA_SIGN},
+            {"ECDSA_VERIFY", CryptoOperation::ECDSA_VERIFY},
+            {"SHA256_HASH", CryptoOperation::SHA256_HASH},
+            {"KEY_DERIVATION", CryptoOperation::KEY_DERIVATION}
+        };
+        
+        auto it = op_map.find(operation_type);
+        return (it != op_map.end()) ? it->second : CryptoOperation::AES_ENCRYPT;
+    }
+
+private:
+    // Legacy (v1/v2) row-oriented record
+    static CryptoMetrics read_record(ByteReader& reader, uint16_t version) {
+        CryptoMetrics m{};
+        m.start_cycle = reader.get<uint64_t>();
+        m.end_cycle = reader.get<uint64_t>();
+        m.start_inst = reader.get<uint64_t>();
+        m.end_inst = reader.get<uint64_t>();
+        if (version >= 2) m.label = reader.get<uint32_t>();
+
+        m.cache.l1_accesses = reader.get<uint64_t>();
+        m.cache.l1_misses = reader.get<uint64_t>();
+        m.cache.l2_misses = reader.get<uint64_t>();
+        m.cache.l3_misses = reader.get<uint64_t>();
+        m.cache.miss_rate = reader.get<double>();
+
+        m.branch.total_branches = reader.get<uint64_t>();
+        m.branch.mispredictions = reader.get<uint64_t>();
+        m.branch.mispredict_rate = reader.get<double>();
+
+        m.power.start_energy = reader.get<double>();
+        m.power.end_energy = reader.get<double>();
+        m.power.voltage_fluctuation = reader.get<double>();
+        m.power.current_draw = reader.get<double>();
+        reader.getVector(m.power.power_trace);
+
+        m.memory.page_faults = reader.get<uint64_t>();
+        m.memory.tlb_misses = reader.get<uint64_t>();
+        m.memory.memory_bandwidth = reader.get<uint64_t>();
+        reader.getVector(m.memory.access_patterns);
+
+        auto& rsa = m.rsa_metrics;
+        rsa.modulus_size = reader.get<uint64_t>();
+        rsa.modular_exponentiation_count = reader.get<uint64_t>();
+        rsa.montgomery_multiplications = reader.get<uint64_t>();
+        rsa.operations.start_cycle = reader.get<uint64_t>();
+        rsa.operations.end_cycle = reader.get<uint64_t>();
+        reader.getVector(rsa.operations.square_timings);
+        reader.getVector(rsa.operations.multiply_timings);
+        reader.getVector(rsa.operations.reduce_timings);
+        rsa.cache_specific.key_load_misses = reader.get<uint64_t>();
+        rsa.cache_specific.modulus_load_misses = reader.get<uint64_t>();
+        rsa.cache_specific.montgomery_cache_misses = reader.get<uint64_t>();
+        rsa.memory_specific.key_memory_accesses = reader.get<uint64_t>();
+        rsa.memory_specific.temp_buffer_accesses = reader.get<uint64_t>();
+        reader.getVector(rsa.memory_specific.memory_access_pattern);
+
+        m.crypto_specific.key_size = reader.get<uint64_t>();
+        m.crypto_specific.block_size = reader.get<uint64_t>();
+        m.crypto_specific.rounds = reader.get<uint64_t>();
+        reader.getVector(m.crypto_specific.round_timings);
+        reader.getVector(m.crypto_specific.round_power);
+        return m;
+    }
+
+    static constexpr size_t kIndexEntrySize = sizeof(uint32_t) + sizeof(uint64_t);
+
+    // Every field in capture order, for the column block encoder/decoder.
+    // Metrics is CryptoMetrics or const CryptoMetrics.
+    template <typename Visitor, typename Metrics>
+    static void visit_fields(Visitor& v, Metrics& m) {
+        v.field("start_cycle", m.start_cycle);
+        v.field("end_cycle", m.end_cycle);
+        v.field("start_inst", m.start_inst);
+        v.field("end_inst", m.end_inst);
+        v.field("label", m.label);
+
+        v.field("l1_accesses", m.cache.l1_accesses);
+        v.field("l1_misses", m.cache.l1_misses);
+        v.field("l2_misses", m.cache.l2_misses);
+        v.field("l3_misses", m.cache.l3_misses);
+        v.field("miss_rate", m.cache.miss_rate);
+
+        v.field("total_branches", m.branch.total_branches);
+        v.field("mispredictions", m.branch.mispredictions);
+        v.field("mispredict_rate", m.branch.mispredict_rate);
+
+        v.field("start_energy", m.power.start_energy);
+        v.field("end_energy", m.power.end_energy);
+        v.field("voltage_fluctuation", m.power.voltage_fluctuation);
+        v.field("current_draw", m.power.current_draw);
+        v.field("power_trace", m.power.power_trace);
+
+        v.field("page_faults", m.memory.page_faults);
+        v.field("tlb_misses", m.memory.tlb_misses);
+        v.field("memory_bandwidth", m.memory.memory_bandwidth);
+        v.field("access_patterns", m.memory.access_patterns);
+
+        auto& rsa = m.rsa_metrics;
+        v.field("modulus_size", rsa.modulus_size);
+        v.field("modular_exponentiation_count", rsa.modular_exponentiation_count);
+        v.field("montgomery_multiplications", rsa.montgomery_multiplications);
+        v.field("rsa_start_cycle", rsa.operations.start_cycle);
+        v.field("rsa_end_cycle", rsa.operations.end_cycle);
+        v.field("square_timings", rsa.operations.square_timings);
+        v.field("multiply_timings", rsa.operations.multiply_timings);
+        v.field("reduce_timings", rsa.operations.reduce_timings);
+        v.field("key_load_misses", rsa.cache_specific.key_load_misses);
+        v.field("modulus_load_misses", rsa.cache_specific.modulus_load_misses);
+        v.field("montgomery_cache_misses", rsa.cache_specific.montgomery_cache_misses);
+        v.field("key_memory_accesses", rsa.memory_specific.key_memory_accesses);
+        v.field("temp_buffer_accesses", rsa.memory_specific.temp_buffer_accesses);
+        v.field("memory_access_pattern", rsa.memory_specific.memory_access_pattern);
+
+        v.field("key_size", m.crypto_specific.key_size);
+        v.field("block_size", m.crypto_specific.block_size);
+        v.field("rounds", m.crypto_specific.rounds);
+        v.field("round_timings", m.crypto_specific.round_timings);
+        v.field("round_power", m.crypto_specific.round_power);
+    }
+
+    static const RecordLayout& metrics_layout() {
+        static const RecordLayout layout = RecordLayout::of<CryptoMetrics>(
+            [](RecordLayout& fields, const CryptoMetrics& sample) { visit_fields(fields, sample); });
+        return layout;
+    }
+
+    const MetricExpression* compiledMetric(const std::string& expression, std::string& error) {
+        auto it = metric_expressions.find(expression);
+        if (it != metric_expressions.end()) return it->second.get();
+        std::unique_ptr<MetricExpression> compiled =
+            MetricExpression::compile(expression, metrics_layout(), error);
+        if (!compiled) return nullptr;
+        if (metric_expressions.size() >= kMaxCachedExpressions) metric_expressions.clear();
+        return (metric_expressions[expression] = std::move(compiled)).get();
+    }
+
+    static bool encode_block(ByteWriter& writer, const std::vector<CryptoMetrics>& records,
+                             const ColumnPolicy& policy) {
+        ColumnBlockEncoder encoder(policy);
+        for (const auto& metric : records) {
+            visit_fields(encoder, metric);
+            encoder.nextRecord();
+        }
+        return encoder.finish(writer);
+    }
+
+    static bool decode_block(ByteReader& reader, size_t count, std::vector<CryptoMetrics>& out) {
+        // The count comes from an index or spill header; only allocate for
+        // it once the decoded columns actually hold that many records
+        if (count > kCaptureBlockRecords) return false;
+        ColumnBlockDecoder decoder;
+        if (!decoder.load(reader) || decoder.records() != count) return false;
+        out.resize(count);
+        for (auto& metric : out) {
+            metric = CryptoMetrics{};
+            visit_fields(decoder, metric);
+            decoder.nextRecord();
+        }
+        return !decoder.failed();
+    }
+
+    // Runs fn(0..count-1) across hardware threads where the build has them
+    template <typename Fn>
+    static void parallel_for(size_t count, Fn&& fn) {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+        for (size_t i = 0; i < count; ++i) fn(i);
+#else
+        size_t workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), count);
+        if (workers <= 1) {
+            for (size_t i = 0; i < count; ++i) fn(i);
+            return;
+        }
+        std::atomic<size_t> next{0};
+        auto work = [&] {
+            for (size_t i = next++; i < count; i = next++) fn(i);
+        };
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < workers; ++t) threads.emplace_back(work);
+        work();
+        for (auto& thread : threads) thread.join();
+#endif
+    }
+
+    bool load_block_capture(ByteReader& reader, uint32_t op_count) {
+        struct BlockRef {
+            CryptoOperation op;
+            const uint8_t* data;
+            size_t size;
+            uint32_t records;
+        };
+        std::vector<BlockRef> blocks;
+        for (uint32_t i = 0; i < op_count && !reader.failed(); ++i) {
+            uint32_t op = reader.get<uint32_t>();
+            uint64_t count = reader.get<uint64_t>();
+            uint32_t block_count = reader.get<uint32_t>();
+            if (op >= kOperationCount || block_count > reader.remaining() / kIndexEntrySize) {
+                return false;
+            }
+            std::vector<std::pair<uint32_t, uint64_t>> index(block_count);
+            uint64_t total_records = 0;
+            for (auto& entry : index) {
+                entry.first = reader.get<uint32_t>();
+                entry.second = reader.get<uint64_t>();
+                if (entry.first == 0 || entry.first > kCaptureBlockRecords) return false;
+                total_records += entry.first;
+            }
+            if (total_records != count) return false;
+            for (const auto& entry : index) {
+                if (reader.failed() || entry.second > reader.remaining()) return false;
+                blocks.push_back(BlockRef{static_cast<CryptoOperation>(op), reader.cursor(),
+                                          static_cast<size_t>(entry.second), entry.first});
+                reader.skip(static_cast<size_t>(entry.second));
+            }
+        }
+        if (reader.failed()) return false;
+
+        // Decode everything first so a corrupt block leaves us untouched
+        std::vector<std::vector<CryptoMetrics>> decoded(blocks.size());
+        std::atomic<bool> ok{true};
+        parallel_for(blocks.size(), [&](size_t i) {
+            ByteReader block_reader(blocks[i].data, blocks[i].size);
+            if (!decode_block(block_reader, blocks[i].records, decoded[i])) ok = false;
+        });
+        if (!ok) return false;
+
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            auto& target = measurements(blocks[i].op);
+            for (auto& metric : decoded[i]) target.push_back(std::move(metric));
+            decoded[i] = std::vector<CryptoMetrics>();
+        }
+        return true;
+    }
+
+    // Spill encoding for MeasurementStore blocks: fast column codecs
+    struct MetricsCodec {
+        static bool encodeBlock(ByteWriter& writer, const std::vector<CryptoMetrics>& records) {
+            static const ColumnPolicy policy = ColumnPolicy::fast();
+            return encode_block(writer, records, policy);
+        }
+
+        static bool decodeBlock(ByteReader& reader, size_t count, std::vector<CryptoMetrics>& out) {
+            return decode_block(reader, count, out);
+        }
+
+        static size_t footprint(const CryptoMetrics& m) {
+            const auto& rsa = m.rsa_metrics;
+            return sizeof(CryptoMetrics) +
+                   m.power.power_trace.capacity() * sizeof(double) +
+                   m.memory.access_patterns.capacity() * sizeof(uint64_t) +
+                   (rsa.operations.square_timings.capacity() +
+                    rsa.operations.multiply_timings.capacity() +
+                    rsa.operations.reduce_timings.capacity() +
+                    rsa.memory_specific.memory_access_pattern.capacity() +
+                    m.crypto_specific.round_timings.capacity()) * sizeof(uint64_t) +
+                   m.crypto_specific.round_power.capacity() * sizeof(double);
+        }
+    };
+
+#ifdef __EMSCRIPTEN__
+    emscripten::val computeStatistics(const SummaryStatistics& summary) {
+        auto stats = emscripten::val::object();
+        
+        if (summary.count == 0) return stats;
+        
+        stats.set("mean", summary.mean);
+        stats.set("stddev", summary.stddev);
+        stats.set("min", summary.min);
+        stats.set("max", summary.max);
+        
+        return stats;
+    }
+#endif
+};
@@ -0,0 +1,353 @@
+// distribution_shape.h
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Equal-width histogram over the central mass of a sample. The 0.1% tails
+// on each side are left out (and counted) so one slow outlier cannot
+// squash the body into a few bins. Timers tick in fixed quanta; when the
+// quantum is coarser than a bin, bins are one quantum wide and centred on
+// the lattice, so quantization does not read as a comb of tiny modes.
+struct SampleHistogram {
+    static constexpr size_t kBins = 1024;
+    static constexpr double kTail = 0.001;
+
+    double low = 0.0;
+    double width = 0.0;
+    std::vector<double> counts;
+    uint64_t total = 0;
+    uint64_t outliers = 0;
+
+    static SampleHistogram build(const std::vector<double>& data) {
+        SampleHistogram h;
+        std::vector<double> scratch;
+        scratch.reserve(data.size());
+        for (double v : data) {
+            if (std::isfinite(v)) scratch.push_back(v);
+        }
+        if (scratch.empty()) return h;
+
+        size_t n = scratch.size();
+        size_t lo_rank = static_cast<size_t>(kTail * (n - 1));
+        size_t hi_rank = n - 1 - lo_rank;
+        std::nth_element(scratch.begin(), scratch.begin() + lo_rank, scratch.end());
+        double lo = scratch[lo_rank];
+        std::nth_element(scratch.begin() + lo_rank, scratch.begin() + hi_rank, scratch.end());
+        double hi = scratch[hi_rank];
+
+        h.low = lo;
+        h.width = hi > lo ? (hi - lo) / kBins : 1.0;
+        size_t bins = kBins;
+        double quantum = smallest_gap(scratch, lo, hi);
+        if (quantum > h.width) {
+            h.low = lo - quantum / 2;
+            h.width = quantum;
+            bins = static_cast<size_t>((hi - lo) / quantum + 0.5) + 1;
+        }
+        h.counts.assign(bins, 0.0);
+        for (double v : scratch) {
+            if (v < lo || v > hi) {
+                ++h.outliers;
+                continue;
+            }
+            size_t bin = std::min(bins - 1, static_cast<size_t>((v - h.low) / h.width));
+            h.counts[bin] += 1.0;
+            ++h.total;
+        }
+        return h;
+    }
+
+    double center(size_t bin) const { return low + (bin + 0.5) * width; }
+
+private:
+    // Smallest positive spacing among up to 4096 evenly strided samples
+    static double smallest_gap(const std::vector<double>& data, double lo, double hi) {
+        std::vector<double> probe;
+        size_t stride = std::max<size_t>(1, data.size() / 4096);
+        for (size_t i = 0; i < data.size(); i += stride) {
+            if (data[i] >= lo && data[i] <= hi) probe.push_back(data[i]);
+        }
+        std::sort(probe.begin(), probe.end());
+        double gap = 0.0;
+        for (size_t i = 1; i < probe.size(); ++i) {
+            double d = probe[i] - probe[i - 1];
+            if (d > 0 && (gap == 0.0 || d < gap)) gap = d;
+        }
+        return gap;
+    }
+};
+
+struct GaussianComponent {
+    double weight = 0.0;
+    double mean = 0.0;
+    double stddev = 0.0;
+};
+
+struct MixtureFit {
+    GaussianComponent components[2];
+    double log_likelihood = 0.0;
+    uint32_t iterations = 0;
+};
+
+// EM for a one- or two-component Gaussian mixture over histogram bins, so
+// each iteration costs O(bins) however many samples built the histogram.
+// Variances are floored at a bin width's quantization variance.
+inline MixtureFit fitGaussianMixture(const SampleHistogram& h, int k,
+                                     uint32_t max_iterations = 200, double tolerance = 1e-8) {
+    MixtureFit fit;
+    if (h.total == 0) return fit;
+    const size_t bins = h.counts.size();
+    const double total = static_cast<double>(h.total);
+    const double floor_var = h.width * h.width / 12.0;
+
+    auto moments = [&](size_t begin, size_t end, GaussianComponent& c) {
+        double w = 0.0, s = 0.0, ss = 0.0;
+        for (size_t b = begin; b < end; ++b) {
+            double x = h.center(b);
+            w += h.counts[b];
+            s += h.counts[b] * x;
+            ss += h.counts[b] * x * x;
+        }
+        c.weight = w / total;
+        c.mean = w > 0 ? s / w : h.center((begin + end) / 2);
+        c.stddev = std::sqrt(std::max(w > 0 ? ss / w - c.mean * c.mean : 0.0, floor_var));
+    };
+
+    if (k <= 1) {
+        moments(0, bins, fit.components[0]);
+        k = 1;
+    } else {
+        // Start from the two halves either side of the median bin
+        double half = total / 2, seen = 0.0;
+        size_t split = 1;
+        for (; split < bins; ++split) {
+            seen += h.counts[split - 1];
+            if (seen >= half) break;
+        }
+        moments(0, split, fit.components[0]);
+        moments(split, bins, fit.components[1]);
+    }
+
+    const double kLogSqrt2Pi = 0.5 * std::log(2.0 * M_PI);
+    double previous = -INFINITY;
+    for (fit.iterations = 0; fit.iterations < max_iterations; ++fit.iterations) {
+        double ll = 0.0;
+        double acc_w[2] = {0, 0}, acc_s[2] = {0, 0}, acc_ss[2] = {0, 0};
+        for (size_t b = 0; b < bins; ++b) {
+            if (h.counts[b] == 0) continue;
+            double x = h.center(b);
+            double logp[2];
+            for (int j = 0; j < k; ++j) {
+                const GaussianComponent& c = fit.components[j];
+                double z = (x - c.mean) / c.stddev;
+                logp[j] = std::log(std::max(c.weight, 1e-300)) - std::log(c.stddev) - kLogSqrt2Pi - 0.5 * z * z;
+            }
+            double top = k == 2 ? std::max(logp[0], logp[1]) : logp[0];
+            double norm = 0.0;
+            for (int j = 0; j < k; ++j) norm += std::exp(logp[j] - top);
+            ll += h.counts[b] * (top + std::log(norm));
+            for (int j = 0; j < k; ++j) {
+                double r = h.counts[b] * std::exp(logp[j] - top) / norm;
+                acc_w[j] += r;
+                acc_s[j] += r * x;
+                acc_ss[j] += r * x * x;
+            }
+        }
+        for (int j = 0; j < k; ++j) {
+            GaussianComponent& c = fit.components[j];
+            if (acc_w[j] <= 0) continue;
+            c.weight = acc_w[j] / total;
+            c.mean = acc_s[j] / acc_w[j];
+            c.stddev = std::sqrt(std::max(acc_ss[j] / acc_w[j] - c.mean * c.mean, floor_var));
+        }
+        fit.log_likelihood = ll;
+        if (std::fabs(ll - previous) <= tolerance * std::fabs(ll)) break;
+        previous = ll;
+    }
+    if (k == 2 && fit.components[0].mean > fit.components[1].mean) {
+        std::swap(fit.components[0], fit.components[1]);
+    }
+    return fit;
+}
+
+// Hartigan's dip statistic (Hartigan & Hartigan 1985, algorithm AS 217)
+// of an ascending sample: the sup distance between the empirical CDF and the
+// closest unimodal CDF. Ranges from 1/(2n) to 0.25.
+inline double dipStatistic(const std::vector<double>& sorted) {
+    const int n = static_cast<int>(sorted.size());
+    if (n < 2 || sorted.front() == sorted.back()) return n > 0 ? 0.5 / n : 0.0;
+
+    // 1-based views, as in the published algorithm
+    std::vector<double> x(n + 1);
+    std::copy(sorted.begin(), sorted.end(), x.begin() + 1);
+    std::vector<int> mn(n + 1), mj(n + 1), gcm(n + 1), lcm(n + 1);
+
+    // Combination indices for the greatest convex minorant ...
+    mn[1] = 1;
+    for (int j = 2; j <= n; ++j) {
+        mn[j] = j - 1;
+        for (;;) {
+            int mnj = mn[j], mnmnj = mn[mnj];
+            if (mnj == 1 || (x[j] - x[mnj]) * (mnj - mnmnj) < (x[mnj] - x[mnmnj]) * (j - mnj)) break;
+            mn[j] = mnmnj;
+        }
+    }
+    // ... and for the least concave majorant
+    mj[n] = n;
+    for (int k = n - 1; k >= 1; --k) {
+        mj[k] = k + 1;
+        for (;;) {
+            int mjk = mj[k], mjmjk = mj[mjk];
+            if (mjk == n || (x[k] - x[mjk]) * (mjk - mjmjk) < (x[mjk] - x[mjmjk]) * (k - mjk)) break;
+            mj[k] = mjmjk;
+        }
+    }
+
+    int low = 1, high = n;
+    double dip = 1.0;
+    for (;;) {
+        int l_gcm = 1;
+        gcm[1] = high;
+        while (gcm[l_gcm] > low) {
+            gcm[l_gcm + 1] = mn[gcm[l_gcm]];
+            ++l_gcm;
+        }
+        int l_lcm = 1;
+        lcm[1] = low;
+        while (lcm[l_lcm] < high) {
+            lcm[l_lcm + 1] = mj[lcm[l_lcm]];
+            ++l_lcm;
+        }
+
+        // Largest distance between the two hulls over [low, high]
+        int ig = l_gcm, ih = l_lcm;
+        int ix = l_gcm - 1, iv = 2;
+        double d = 0.0;
+        if (l_gcm != 2 || l_lcm != 2) {
+            do {
+                int gcmix = gcm[ix], lcmiv = lcm[iv];
+                double dx;
+                if (gcmix > lcmiv) {
+                    int gcmi1 = gcm[ix + 1];
+                    dx = (lcmiv - gcmi1 + 1) -
+                         (x[lcmiv] - x[gcmi1]) * (gcmix - gcmi1) / (x[gcmix] - x[gcmi1]);
+                    ++iv;
+                    if (dx >= d) {
+                        d = dx;
+                        ig = ix + 1;
+                        ih = iv - 1;
+                    }
+                } else {
+                    int lcmiv1 = lcm[iv - 1];
+                    dx = (x[gcmix] - x[lcmiv1]) * (lcmiv - lcmiv1) / (x[lcmiv] - x[lcmiv1]) -
+                         (gcmix - lcmiv1 - 1);
+                    --ix;
+                    if (dx >= d) {
+                        d = dx;
+                        ig = ix + 1;
+                        ih = iv;
+                    }
+                }
+                if (ix < 1) ix = 1;
+                if (iv > l_lcm) iv = l_lcm;
+            } while (gcm[ix] != lcm[iv]);
+        } else {
+            d = 1.0;
+        }
+        if (d < dip) break;
+
+        // Dips of the minorant and majorant outside the modal interval
+        double dip_l = 0.0, dip_u = 0.0;
+        for (int j = ig; j < l_gcm; ++j) {
+            double max_t = 1.0;
+            int jb = gcm[j + 1], je = gcm[j];
+            if (je - jb > 1 && x[je] != x[jb]) {
+                double c = (je - jb) / (x[je] - x[jb]);
+                for (int jj = jb; jj <= je; ++jj) {
+                    max_t = std::max(max_t, (jj - jb + 1) - (x[jj] - x[jb]) * c);
+                }
+            }
+            dip_l = std::max(dip_l, max_t);
+        }
+        for (int j = ih; j < l_lcm; ++j) {
+            double max_t = 1.0;
+            int jb = lcm[j], je = lcm[j + 1];
+            if (je - jb > 1 && x[je] != x[jb]) {
+                double c = (je - jb) / (x[je] - x[jb]);
+                for (int jj = jb; jj <= je; ++jj) {
+                    max_t = std::max(max_t, (x[jj] - x[jb]) * c - (jj - jb - 1));
+                }
+            }
+            dip_u = std::max(dip_u, max_t);
+        }
+        dip = std::max(dip, std::max(dip_l, dip_u));
+
+        if (low == gcm[ig] && high == lcm[ih]) break;
+        low = gcm[ig];
+        high = lcm[ih];
+    }
+    return dip / (2.0 * n);
+}
+
+struct DistributionShape {
+    uint64_t count = 0;
+    uint64_t outliers = 0;       // tails left out of the histogram
+    GaussianComponent unimodal;  // single Gaussian
+    MixtureFit mixture;          // two components, ascending means
+    double bic_unimodal = 0.0;
+    double bic_bimodal = 0.0;
+    double separation = 0.0;     // Ashman's D between the two components
+    double dip = 0.0;
+    double dip_z = 0.0;          // sqrt(n) * dip
+    bool bimodal = false;
+};
+
+// Two peaks are reported when BIC clearly prefers the mixture, the
+// components are well separated (Ashman's D > 2) and neither is a sliver,
+// or when the dip test rejects unimodality (sqrt(n) * dip above ~0.52,
+// its large-sample 5% critical value). The dip runs on kDipPoints order
+// statistics interpolated from the histogram rather than on the raw sort.
+inline DistributionShape analyzeDistributionShape(const std::vector<double>& data) {
+    static constexpr size_t kDipPoints = 4096;
+    static constexpr double kDipCritical = 0.52;
+
+    DistributionShape shape;
+    SampleHistogram h = SampleHistogram::build(data);
+    shape.count = h.total;
+    shape.outliers = h.outliers;
+    if (h.total < 2) return shape;
+
+    MixtureFit one = fitGaussianMixture(h, 1);
+    shape.unimodal = one.components[0];
+    shape.mixture = fitGaussianMixture(h, 2);
+    double log_n = std::log(static_cast<double>(h.total));
+    shape.bic_unimodal = -2.0 * one.log_likelihood + 2.0 * log_n;
+    shape.bic_bimodal = -2.0 * shape.mixture.log_likelihood + 5.0 * log_n;
+    const GaussianComponent& a = shape.mixture.components[0];
+    const GaussianComponent& b = shape.mixture.components[1];
+    shape.separation = std::sqrt(2.0) * std::fabs(a.mean - b.mean) /
+                       std::sqrt(a.stddev * a.stddev + b.stddev * b.stddev);
+
+    size_t points = std::min<size_t>(kDipPoints, h.total);
+    std::vector<double> quantiles;
+    quantiles.reserve(points);
+    double seen = 0.0;
+    size_t bin = 0;
+    for (size_t i = 0; i < points; ++i) {
+        double rank = (i + 0.5) * h.total / points;
+        while (bin + 1 < h.counts.size() && seen + h.counts[bin] < rank) seen += h.counts[bin++];
+        double within = h.counts[bin] > 0 ? (rank - seen) / h.counts[bin] : 0.5;
+        quantiles.push_back(h.low + (bin + std::min(1.0, std::max(0.0, within))) * h.width);
+    }
+    shape.dip = dipStatistic(quantiles);
+    shape.dip_z = std::sqrt(static_cast<double>(h.total)) * shape.dip;
+
+    bool mixture_wins = shape.bic_bimodal + 10.0 < shape.bic_unimodal && shape.separation > 2.0 &&
+                        std::min(a.weight, b.weight) > 0.05;
+    shape.bimodal = mixture_wins || shape.dip_z > kDipCritical;
+    return shape;
+}
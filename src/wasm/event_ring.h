@@ -0,0 +1,39 @@
+// event_ring.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bounded FIFO for events nobody may be polling: once full, each push
+// overwrites the oldest undelivered entry and counts it.
+template <typename Event, size_t Capacity>
+class EventRing {
+public:
+    EventRing() : slots_(Capacity) {}
+
+    void push(const Event& event) {
+        if (head_ - tail_ == Capacity) {
+            ++tail_;
+            ++overwritten_;
+        }
+        slots_[head_++ % Capacity] = event;
+    }
+
+    // Moves up to `limit` events, oldest first, into `out`
+    size_t poll(std::vector<Event>& out, size_t limit = SIZE_MAX) {
+        size_t moved = 0;
+        for (; tail_ < head_ && moved < limit; ++tail_, ++moved) {
+            out.push_back(slots_[tail_ % Capacity]);
+        }
+        return moved;
+    }
+
+    uint64_t overwritten() const { return overwritten_; }
+
+private:
+    std::vector<Event> slots_;
+    uint64_t head_ = 0;
+    uint64_t tail_ = 0;
+    uint64_t overwritten_ = 0;
+};
@@ -0,0 +1,321 @@
+// kernel_density.h
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// In-place iterative radix-2 FFT; the size must be a power of two
+inline void fftInPlace(std::vector<std::complex<double>>& a, bool inverse) {
+    const size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(a[i], a[j]);
+    }
+    const double pi = 3.14159265358979323846;
+    for (size_t len = 2; len <= n; len <<= 1) {
+        double angle = (inverse ? 2.0 : -2.0) * pi / static_cast<double>(len);
+        std::complex<double> step(std::cos(angle), std::sin(angle));
+        for (size_t i = 0; i < n; i += len) {
+            std::complex<double> w(1.0, 0.0);
+            for (size_t k = 0; k < len / 2; ++k) {
+                std::complex<double> u = a[i + k];
+                std::complex<double> v = a[i + k + len / 2] * w;
+                a[i + k] = u + v;
+                a[i + k + len / 2] = u - v;
+                w *= step;
+            }
+        }
+    }
+    if (inverse) {
+        for (auto& x : a) x /= static_cast<double>(n);
+    }
+}
+
+enum class BandwidthRule : uint32_t {
+    SILVERMAN = 0,
+    ISJ = 1,  // Botev's improved Sheather-Jones; falls back to Silverman
+};
+
+struct DensityOptions {
+    size_t points = 512;
+    BandwidthRule rule = BandwidthRule::ISJ;
+    double bandwidth = 0.0;  // > 0 overrides the rule
+    // Evaluation range; low >= high picks one from the data
+    double low = 0.0;
+    double high = 0.0;
+    // With an automatic range, the fraction left out on each side so a few
+    // stragglers do not flatten the body of the curve
+    double tail = 0.001;
+};
+
+// Density sampled at low + i * (high - low) / (points - 1). Samples
+// outside [low, high] are counted but not binned, so the curve integrates
+// to the fraction of samples inside the range.
+struct DensityEstimate {
+    double low = 0.0;
+    double high = 0.0;
+    double bandwidth = 0.0;
+    BandwidthRule rule = BandwidthRule::SILVERMAN;
+    uint64_t count = 0;
+    uint64_t outside = 0;
+    std::vector<double> density;
+};
+
+// Gaussian KDE by linear binning and FFT convolution (Wand 1994). One
+// O(N) pass for the range and moments, one O(N) pass to spread each sample
+// over its two neighbouring grid nodes (repeated only when trimming the
+// tails narrows the range a lot), then bandwidth selection and the
+// convolution run on the kGrid-node binned counts only, in O(G log G).
+class KernelDensity {
+public:
+    static constexpr size_t kGrid = 4096;
+    static constexpr int kMaxRebins = 4;
+
+    static DensityEstimate estimate(const std::vector<double>& data,
+                                    const DensityOptions& options = DensityOptions()) {
+        DensityEstimate result;
+        size_t points = std::max<size_t>(options.points, 2);
+
+        // Pass 1: finite count, range and moments (shifted for stability)
+        uint64_t n = 0;
+        double min = std::numeric_limits<double>::infinity();
+        double max = -min;
+        double shift = 0.0, sum = 0.0, sum_sq = 0.0;
+        for (double v : data) {
+            if (!std::isfinite(v)) continue;
+            if (n == 0) shift = v;
+            ++n;
+            min = std::min(min, v);
+            max = std::max(max, v);
+            double d = v - shift;
+            sum += d;
+            sum_sq += d * d;
+        }
+        result.count = n;
+        if (n == 0) return result;
+
+        double mean_d = sum / n;
+        double stddev = std::sqrt(std::max(0.0, sum_sq / n - mean_d * mean_d));
+        // Scott's rule bounds Silverman's from above; used only for padding
+        double pad_bandwidth = 1.06 * stddev * std::pow(static_cast<double>(n), -0.2);
+        if (options.bandwidth > 0) pad_bandwidth = std::max(pad_bandwidth, options.bandwidth);
+        if (pad_bandwidth <= 0) pad_bandwidth = std::max(1.0, std::fabs(min) * 1e-6);
+
+        std::vector<double> bins(kGrid, 0.0);
+        double low = options.low, high = options.high;
+        uint64_t inside = 0;
+        if (low < high) {
+            inside = bin(data, low, high, bins, result.outside);
+        } else {
+            low = min - 4 * pad_bandwidth;
+            high = max + 4 * pad_bandwidth;
+            inside = bin(data, low, high, bins, result.outside);
+            // Trimmed range padded by a robust bandwidth, read off the current
+            // binning; rebin while that halves the range. A far outlier
+            // can leave the body in a few coarse bins, hence the loop.
+            for (int pass = 0; pass < kMaxRebins && options.tail > 0 && inside > 0; ++pass) {
+                double delta = (high - low) / (kGrid - 1);
+                double body_low = binned_quantile(bins, delta, low, options.tail * inside);
+                double body_high = binned_quantile(bins, delta, low, (1 - options.tail) * inside);
+                double pad = 4 * std::max(silverman_bandwidth(bins, delta, low, stddev, inside),
+                                          std::max(options.bandwidth, delta));
+                double trimmed_low = std::max(low, body_low - pad);
+                double trimmed_high = std::min(high, body_high + pad);
+                if (!(trimmed_high - trimmed_low < 0.5 * (high - low))) break;
+                low = trimmed_low;
+                high = trimmed_high;
+                std::fill(bins.begin(), bins.end(), 0.0);
+                result.outside = 0;
+                inside = bin(data, low, high, bins, result.outside);
+            }
+        }
+        result.low = low;
+        result.high = high;
+        const double delta = (high - low) / (kGrid - 1);
+        if (inside == 0) {
+            result.density.assign(points, 0.0);
+            return result;
+        }
+
+        double silverman = silverman_bandwidth(bins, delta, low, stddev, inside);
+        double bandwidth = options.bandwidth;
+        result.rule = options.rule;
+        if (bandwidth <= 0 && options.rule == BandwidthRule::ISJ) {
+            bandwidth = isj_bandwidth(bins, inside, high - low);
+            if (!(bandwidth > 0)) result.rule = BandwidthRule::SILVERMAN;
+        }
+        if (!(bandwidth > 0)) bandwidth = silverman;
+        // Below a grid step the binning error dominates the estimate
+        bandwidth = std::max(bandwidth, delta);
+        result.bandwidth = bandwidth;
+
+        std::vector<double> grid = convolve(bins, delta, bandwidth, static_cast<double>(n));
+        result.density.resize(points);
+        double scale = static_cast<double>(kGrid - 1) / static_cast<double>(points - 1);
+        for (size_t i = 0; i < points; ++i) {
+            double position = i * scale;
+            size_t j = std::min(static_cast<size_t>(position), kGrid - 2);
+            double frac = position - static_cast<double>(j);
+            result.density[i] = grid[j] * (1.0 - frac) + grid[j + 1] * frac;
+        }
+        return result;
+    }
+
+private:
+    // Linear binning onto kGrid nodes spanning [low, high]
+    static uint64_t bin(const std::vector<double>& data, double low, double high,
+                        std::vector<double>& bins, uint64_t& outside) {
+        const double delta = (high - low) / (kGrid - 1);
+        uint64_t inside = 0;
+        for (double v : data) {
+            if (!std::isfinite(v)) continue;
+            if (v < low || v > high) {
+                ++outside;
+                continue;
+            }
+            double position = (v - low) / delta;
+            size_t i = std::min(static_cast<size_t>(position), kGrid - 2);
+            double frac = position - static_cast<double>(i);
+            bins[i] += 1.0 - frac;
+            bins[i + 1] += frac;
+            ++inside;
+        }
+        return inside;
+    }
+
+    // 0.9 * min(sd, IQR / 1.34) * n^(-1/5), with the IQR read off the
+    // binned cumulative counts
+    static double silverman_bandwidth(const std::vector<double>& bins, double delta,
+                                      double low, double stddev, uint64_t n) {
+        double q1 = binned_quantile(bins, delta, low, 0.25 * n);
+        double q3 = binned_quantile(bins, delta, low, 0.75 * n);
+        double spread = stddev;
+        double iqr = (q3 - q1) / 1.34;
+        if (iqr > 0 && iqr < spread) spread = iqr;
+        return 0.9 * spread * std::pow(static_cast<double>(n), -0.2);
+    }
+
+    static double binned_quantile(const std::vector<double>& bins, double delta, double low,
+                                  double target) {
+        double cumulative = 0.0;
+        for (size_t i = 0; i < bins.size(); ++i) {
+            if (cumulative + bins[i] >= target) {
+                double frac = bins[i] > 0 ? (target - cumulative) / bins[i] : 0.0;
+                return low + (i - 0.5 + frac) * delta;
+            }
+            cumulative += bins[i];
+        }
+        return low + (bins.size() - 1) * delta;
+    }
+
+    // Botev, Grotowski & Kroese (2010): solve t = xi * gamma^[l](t) over the
+    // squared DCT coefficients of the binned data rescaled to [0, 1].
+    // Returns 0 when the fixed point has no root in (0, 0.1].
+    static double isj_bandwidth(const std::vector<double>& bins, uint64_t n, double range) {
+        const size_t grid = bins.size();
+        std::vector<double> coefficients = dct2(bins);
+        const int l = 7;
+        // weighted[s][k] = (k+1)^(2s) * a_(k+1)^2, precomputed for s <= l
+        std::vector<double> index_sq(grid - 1);
+        std::vector<std::vector<double>> weighted(l + 1, std::vector<double>(grid - 1));
+        for (size_t k = 1; k < grid; ++k) {
+            index_sq[k - 1] = static_cast<double>(k) * static_cast<double>(k);
+            double a = coefficients[k] / static_cast<double>(n);
+            double term = a * a;
+            for (int s = 0; s <= l; ++s) {
+                weighted[s][k - 1] = term;
+                term *= index_sq[k - 1];
+            }
+        }
+
+        const double pi = 3.14159265358979323846;
+        const double N = static_cast<double>(n);
+        auto functional = [&](int s, double t) {
+            const std::vector<double>& w = weighted[s];
+            double f = 0.0;
+            for (size_t k = 0; k < index_sq.size(); ++k) {
+                double decay = std::exp(-index_sq[k] * pi * pi * t);
+                if (decay == 0.0) break;
+                f += w[k] * decay;
+            }
+            return 2.0 * std::pow(pi, 2 * s) * f;
+        };
+        auto fixed_point = [&](double t) {
+            double f = functional(l, t);
+            for (int s = l - 1; s >= 2; --s) {
+                double odd_product = 1.0;
+                for (int j = 1; j <= 2 * s - 1; j += 2) odd_product *= j;
+                double k0 = odd_product / std::sqrt(2.0 * pi);
+                double c = (1.0 + std::pow(0.5, s + 0.5)) / 3.0;
+                double time = std::pow(2.0 * c * k0 / (N * f), 2.0 / (3.0 + 2.0 * s));
+                f = functional(s, time);
+            }
+            return t - std::pow(2.0 * N * std::sqrt(pi) * f, -0.4);
+        };
+
+        double lo = 0.0, hi = 0.1;
+        double f_lo = fixed_point(1e-12), f_hi = fixed_point(hi);
+        if (!(f_lo < 0 && f_hi > 0)) return 0.0;
+        for (int iteration = 0; iteration < 60; ++iteration) {
+            double mid = 0.5 * (lo + hi);
+            double f_mid = fixed_point(mid);
+            if (!std::isfinite(f_mid)) return 0.0;
+            (f_mid < 0 ? lo : hi) = mid;
+        }
+        return std::sqrt(0.5 * (lo + hi)) * range;
+    }
+
+    // Unnormalized DCT-II, X_k = sum_j x_j cos(pi k (2j + 1) / 2n), through
+    // one complex FFT of the even/odd-reordered input (Makhoul 1980)
+    static std::vector<double> dct2(const std::vector<double>& x) {
+        const size_t n = x.size();
+        std::vector<std::complex<double>> v(n);
+        for (size_t j = 0; j < n / 2; ++j) {
+            v[j] = x[2 * j];
+            v[n - 1 - j] = x[2 * j + 1];
+        }
+        fftInPlace(v, false);
+        const double pi = 3.14159265358979323846;
+        std::vector<double> out(n);
+        for (size_t k = 0; k < n; ++k) {
+            double angle = -pi * static_cast<double>(k) / (2.0 * n);
+            out[k] = (v[k] * std::complex<double>(std::cos(angle), std::sin(angle))).real();
+        }
+        return out;
+    }
+
+    // Zero-padded linear convolution of the bin counts with a Gaussian
+    // sampled out to 5 bandwidths, divided by n to give a density
+    static std::vector<double> convolve(const std::vector<double>& bins, double delta,
+                                        double bandwidth, double n) {
+        const size_t grid = bins.size();
+        size_t reach = std::min(grid - 1, static_cast<size_t>(std::ceil(5.0 * bandwidth / delta)));
+        size_t size = 1;
+        while (size < grid + reach) size <<= 1;
+
+        std::vector<std::complex<double>> signal(size), kernel(size);
+        for (size_t i = 0; i < grid; ++i) signal[i] = bins[i];
+        const double norm = 1.0 / (bandwidth * std::sqrt(2.0 * 3.14159265358979323846) * n);
+        for (size_t k = 0; k <= reach; ++k) {
+            double u = k * delta / bandwidth;
+            double weight = norm * std::exp(-0.5 * u * u);
+            kernel[k] = weight;
+            if (k > 0) kernel[size - k] = weight;
+        }
+        fftInPlace(signal, false);
+        fftInPlace(kernel, false);
+        for (size_t i = 0; i < size; ++i) signal[i] *= kernel[i];
+        fftInPlace(signal, true);
+
+        std::vector<double> out(grid);
+        for (size_t i = 0; i < grid; ++i) out[i] = std::max(0.0, signal[i].real());
+        return out;
+    }
+};
@@ -0,0 +1,73 @@
+// live_delta.h
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "byte_buffer.h"
+#include "streaming_stats.h"
+
+// Incremental feed for live dashboards. A subscriber keeps one record
+// cursor per operation; each delta folds the records past its cursors into
+// one rollup bucket per operation, carrying the moments of the interval
+// and the sparse bins of its quantile sketch. The receiver merges buckets
+// into running totals (moments by the pairwise rule, bins by addition), so
+// a frame's size depends on how many sketch bins the interval touched and
+// never on how much has been captured.
+//
+// Frame, little-endian:
+//   u32 magic | u16 version | u16 bucket count | f64 sketch gamma
+//   per bucket: u32 op | u32 bin count | u64 count | f64 mean | f64 m2 |
+//               f64 min | f64 max | u64 zero count | bin count x (i32 index, u32 count)
+struct LiveBucket {
+    uint32_t op = 0;
+    RunningMoments moments;
+    QuantileSketch sketch;
+
+    void add(double value) {
+        moments.add(value);
+        sketch.add(value);
+    }
+};
+
+struct LiveDelta {
+    static constexpr uint32_t kMagic = 0x444c4d43;  // "CMLD"
+    static constexpr uint16_t kVersion = 1;
+
+    std::vector<LiveBucket> buckets;  // operations with new records only
+
+    bool empty() const { return buckets.empty(); }
+
+    std::vector<uint8_t> encode() const {
+        std::vector<uint8_t> out;
+        ByteWriter writer(out);
+        writer.put(kMagic);
+        writer.put(kVersion);
+        writer.put(static_cast<uint16_t>(buckets.size()));
+        writer.put(QuantileSketch::gamma());
+        for (const LiveBucket& bucket : buckets) {
+            std::vector<std::pair<int32_t, uint32_t>> bins;
+            bucket.sketch.forEachBin([&](int32_t index, uint64_t count) {
+                // An interval never holds 2^32 records in one bin; clamp anyway
+                bins.emplace_back(index, static_cast<uint32_t>(
+                                             std::min<uint64_t>(count, UINT32_MAX)));
+            });
+            writer.put(bucket.op);
+            writer.put(static_cast<uint32_t>(bins.size()));
+            writer.put(bucket.moments.count);
+            writer.put(bucket.moments.mean);
+            writer.put(bucket.moments.m2);
+            writer.put(bucket.moments.min);
+            writer.put(bucket.moments.max);
+            writer.put(bucket.sketch.zeroCount());
+            for (const auto& bin : bins) {
+                writer.put(bin.first);
+                writer.put(bin.second);
+            }
+        }
+        return out;
+    }
+};
@@ -0,0 +1,313 @@
+// measurement_series.h
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "byte_buffer.h"
+#include "segment_file.h"
+
+// Monitor-wide spill state shared by every series of one monitor. The
+// file is shared with snapshots, which read spilled blocks on their own
+// threads; read_errors is the only field they update.
+struct SpillContext {
+#ifndef __EMSCRIPTEN__
+    std::shared_ptr<SegmentFile> file;
+#endif
+    size_t budget = std::numeric_limits<size_t>::max();  // resident sealed bytes
+    size_t resident = 0;
+    uint64_t spilled_blocks = 0;
+    uint64_t spilled_bytes = 0;
+    uint64_t dead_bytes = 0;  // spilled bytes of cleared records; the file is append-only
+    std::atomic<uint64_t> read_errors{0};
+};
+
+// Append-only record series kept as sealed blocks plus an open tail. Only
+// the tail is mutable, so back() is always in memory. Once the owning
+// monitor's resident bytes exceed the budget, the oldest sealed blocks are
+// encoded with Codec and handed to the segment file; forEach() reads them
+// back transparently. Codec provides encodeBlock(ByteWriter&, records),
+// decodeBlock(ByteReader&, count, records) and footprint(const Record&).
+//
+// Sealed blocks are immutable and reference counted: spilling or releasing
+// one swaps in a new block rather than editing it, so copies of a series
+// share every sealed block and differ only in their tails (see snapshot).
+template <typename Record, typename Codec>
+class MeasurementSeries {
+public:
+    static constexpr size_t kBlockRecords = 1024;
+
+    void attach(SpillContext* context) { context_ = context; }
+
+    // Consistent view of the records so far that costs one tail copy. It
+    // can be read on another thread while this series keeps recording;
+    // blocks this series spills meanwhile stay in memory until the
+    // snapshot is gone. The copy reads spilled blocks through the same
+    // spill context, so attach() it elsewhere before recording into it.
+    MeasurementSeries snapshot() const { return *this; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    // Records removed by clear() so far; dropped() + i numbers record i
+    // the same way across clears
+    uint64_t dropped() const { return dropped_; }
+    Record& back() { return tail_.back(); }
+
+    void push_back(Record record) {
+        if (tail_.size() == kBlockRecords) seal();
+        tail_.push_back(std::move(record));
+        ++size_;
+    }
+
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        std::vector<Record> scratch;
+        for (const BlockPtr& ptr : sealed_) {
+            const Block& block = *ptr;
+            if (block.spilled) {
+                if (!load(block, scratch)) continue;
+                for (const Record& record : scratch) fn(record);
+            } else {
+                for (const Record& record : block.records) fn(record);
+            }
+        }
+        for (const Record& record : tail_) fn(record);
+    }
+
+    // forEach() over records [first, size()); whole blocks before `first`
+    // are skipped without being read back
+    template <typename Fn>
+    void forEachFrom(size_t first, Fn&& fn) const {
+        forEachRange(first, size_, std::forward<Fn>(fn));
+    }
+
+    // forEach() over records [first, last), reading back only the blocks
+    // that overlap it
+    template <typename Fn>
+    void forEachRange(size_t first, size_t last, Fn&& fn) const {
+        std::vector<Record> scratch;
+        size_t index = 0;
+        for (const BlockPtr& ptr : sealed_) {
+            const Block& block = *ptr;
+            size_t begin = index;
+            index += block.count;
+            if (index <= first) continue;
+            if (begin >= last) return;
+            const std::vector<Record>* records = &block.records;
+            if (block.spilled) {
+                if (!load(block, scratch)) continue;
+                records = &scratch;
+            }
+            size_t end = std::min(records->size(), last - begin);
+            for (size_t i = first > begin ? first - begin : 0; i < end; ++i) fn((*records)[i]);
+        }
+        size_t end = std::min(tail_.size(), last > index ? last - index : 0);
+        for (size_t i = first > index ? first - index : 0; i < end; ++i) fn(tail_[i]);
+    }
+
+    // Visits the records held in memory (resident sealed blocks and the
+    // tail) without reading spilled ones back
+    template <typename Fn>
+    void forEachResident(Fn&& fn) const {
+        for (size_t i = next_resident_; i < sealed_.size(); ++i) {
+            for (const Record& record : sealed_[i]->records) fn(record);
+        }
+        for (const Record& record : tail_) fn(record);
+    }
+
+    // Bytes held for this series. footprint counts Codec::footprint of
+    // resident records, so it includes vector capacity beyond their size.
+    struct Usage {
+        size_t records = 0;
+        size_t resident_blocks = 0;
+        size_t spilled_blocks = 0;
+        size_t sealed_bytes = 0;   // resident sealed blocks
+        size_t tail_bytes = 0;     // open tail
+        size_t shared_bytes = 0;   // sealed bytes a snapshot also holds
+        size_t pending_bytes = 0;  // encoded blocks awaiting the spill writer
+        size_t spilled_bytes = 0;  // on disk
+        size_t index_bytes = 0;    // block table and unused tail slots
+    };
+
+    Usage usage() const {
+        Usage usage;
+        usage.records = size_;
+        for (size_t i = 0; i < sealed_.size(); ++i) {
+            const Block& block = *sealed_[i];
+            if (block.spilled) {
+                ++usage.spilled_blocks;
+                usage.spilled_bytes += block.length;
+                if (i >= next_pending_) usage.pending_bytes += block.length;
+            } else {
+                ++usage.resident_blocks;
+                usage.sealed_bytes += block.footprint;
+                if (sealed_[i].use_count() > 1) usage.shared_bytes += block.footprint;
+            }
+        }
+        for (const Record& record : tail_) usage.tail_bytes += Codec::footprint(record);
+        usage.index_bytes = sealed_.capacity() * sizeof(BlockPtr) + sealed_.size() * sizeof(Block) +
+                            (tail_.capacity() - tail_.size()) * sizeof(Record);
+        return usage;
+    }
+
+    // Drops every record and the memory behind it. Blocks a snapshot
+    // still holds are freed when it lets go; spilled bytes stay in the
+    // append-only file and are counted as dead.
+    void clear() {
+        for (size_t i = 0; i < sealed_.size(); ++i) {
+            const Block& block = *sealed_[i];
+            if (!context_) break;
+            if (!block.spilled) {
+                context_->resident -= block.footprint;
+            } else {
+                if (i >= next_pending_) context_->resident -= block.length;
+                context_->dead_bytes += block.length;
+            }
+        }
+        dropped_ += size_;
+        std::vector<BlockPtr>().swap(sealed_);
+        std::vector<Record>().swap(tail_);
+        size_ = 0;
+        next_resident_ = 0;
+        next_pending_ = 0;
+    }
+
+    // Rebuilds every resident sealed block as a fresh copy, which sizes
+    // each record's vectors to their contents and lets the old, scattered
+    // allocations go back to the allocator together. The open tail is
+    // still being written and blocks a snapshot shares would only be
+    // duplicated, so both are left alone. Returns the bytes saved.
+    size_t compact() {
+        size_t saved = 0;
+        for (size_t i = next_resident_; i < sealed_.size(); ++i) {
+            if (sealed_[i].use_count() > 1) continue;
+            const Block& old = *sealed_[i];
+            auto block = std::make_shared<Block>();
+            block->count = old.count;
+            block->records.reserve(old.records.size());
+            for (const Record& record : old.records) {
+                block->records.push_back(record);
+                block->footprint += Codec::footprint(block->records.back());
+            }
+            if (block->footprint >= old.footprint) continue;
+            saved += old.footprint - block->footprint;
+            if (context_) context_->resident -= old.footprint - block->footprint;
+            sealed_[i] = std::move(block);
+        }
+        sealed_.shrink_to_fit();
+        return saved;
+    }
+
+    // Spills oldest resident blocks while the monitor is over budget
+    void enforceBudget() {
+#ifndef __EMSCRIPTEN__
+        release_durable();
+        if (!context_ || !context_->file) return;
+        while (context_->resident > context_->budget && next_resident_ < sealed_.size()) {
+            if (!spill(sealed_[next_resident_])) break;
+            ++next_resident_;
+        }
+#endif
+    }
+
+private:
+    struct Block {
+        std::vector<Record> records;  // empty once spilled
+        size_t count = 0;
+        size_t footprint = 0;
+        bool spilled = false;
+        uint64_t offset = 0;
+        uint64_t length = 0;
+#ifndef __EMSCRIPTEN__
+        SegmentFile::Bytes pending;  // encoded copy until the write is durable
+#endif
+    };
+    using BlockPtr = std::shared_ptr<const Block>;
+
+    void seal() {
+        auto block = std::make_shared<Block>();
+        block->count = tail_.size();
+        for (const Record& record : tail_) block->footprint += Codec::footprint(record);
+        block->records = std::move(tail_);
+        tail_ = std::vector<Record>();
+        if (context_) context_->resident += block->footprint;
+        sealed_.push_back(std::move(block));
+        enforceBudget();
+    }
+
+#ifndef __EMSCRIPTEN__
+    bool spill(BlockPtr& slot) {
+        auto bytes = std::make_shared<std::vector<uint8_t>>();
+        ByteWriter writer(*bytes);
+        if (!Codec::encodeBlock(writer, slot->records)) return false;
+
+        auto block = std::make_shared<Block>();
+        block->count = slot->count;
+        block->footprint = slot->footprint;
+        block->length = bytes->size();
+        block->offset = context_->file->append(bytes);
+        block->pending = std::move(bytes);
+        block->spilled = true;
+
+        // Pending bytes stay charged until the writer has them on disk
+        context_->resident = context_->resident - block->footprint + block->length;
+        ++context_->spilled_blocks;
+        context_->spilled_bytes += block->length;
+        slot = std::move(block);
+        return true;
+    }
+
+    // Spilled blocks form a prefix with increasing offsets, so the ones
+    // below the durable watermark are a prefix of that prefix.
+    void release_durable() {
+        if (!context_ || !context_->file) return;
+        uint64_t durable = context_->file->durable();
+        while (next_pending_ < next_resident_) {
+            BlockPtr& slot = sealed_[next_pending_];
+            if (slot->offset + slot->length > durable) break;
+            auto block = std::make_shared<Block>(*slot);
+            block->pending.reset();
+            context_->resident -= block->length;
+            slot = std::move(block);
+            ++next_pending_;
+        }
+    }
+#endif
+
+    bool load(const Block& block, std::vector<Record>& out) const {
+        out.clear();
+#ifndef __EMSCRIPTEN__
+        std::vector<uint8_t> buffer;
+        SegmentFile::Bytes pending = block.pending;
+        const uint8_t* data = nullptr;
+        if (pending) {
+            data = pending->data();
+        } else if (context_->file->read(block.offset, block.length, buffer)) {
+            data = buffer.data();
+        }
+        if (data) {
+            ByteReader reader(data, block.length);
+            if (Codec::decodeBlock(reader, block.count, out)) return true;
+        }
+        out.clear();
+        ++context_->read_errors;
+#else
+        (void)block;
+#endif
+        return false;
+    }
+
+    SpillContext* context_ = nullptr;
+    std::vector<BlockPtr> sealed_;
+    std::vector<Record> tail_;
+    size_t size_ = 0;
+    uint64_t dropped_ = 0;
+    size_t next_resident_ = 0;  // first sealed block still in memory
+    size_t next_pending_ = 0;   // first spilled block whose bytes are still held
+};
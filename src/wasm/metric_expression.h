@@ -0,0 +1,513 @@
+// metric_expression.h
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Byte offsets and readers for every named field of a record type, found
+// by walking a sample record with the same field visitor the column codec
+// uses. Scalars read as double; vectors offer their length and sum.
+class RecordLayout {
+public:
+    using Reader = double (*)(const char*);
+    using IntegerReader = uint64_t (*)(const char*);
+
+    struct Field {
+        std::string name;
+        size_t offset = 0;
+        Reader scalar = nullptr;  // null for vector fields
+        IntegerReader integer = nullptr;  // integral scalars only
+        Reader length = nullptr;
+        Reader sum = nullptr;
+    };
+
+    template <typename Record, typename Visit>
+    static RecordLayout of(Visit&& visit) {
+        static const Record sample{};
+        RecordLayout layout;
+        layout.base_ = reinterpret_cast<const char*>(&sample);
+        visit(layout, sample);
+        layout.base_ = nullptr;
+        return layout;
+    }
+
+    template <typename T>
+    void field(const char* name, const T& value) {
+        static_assert(std::is_arithmetic<T>::value, "scalar fields only");
+        Field f;
+        f.name = name;
+        f.offset = offset_of(&value);
+        f.scalar = &read_scalar<T>;
+        if (std::is_integral<T>::value) f.integer = &read_integer<T>;
+        fields_.push_back(f);
+    }
+
+    template <typename T>
+    void field(const char* name, const std::vector<T>& values) {
+        Field f;
+        f.name = name;
+        f.offset = offset_of(&values);
+        f.length = &read_length<T>;
+        f.sum = &read_sum<T>;
+        fields_.push_back(f);
+    }
+
+    const Field* find(const std::string& name) const {
+        for (const Field& f : fields_) {
+            if (f.name == name) return &f;
+        }
+        return nullptr;
+    }
+
+private:
+    size_t offset_of(const void* member) const {
+        return static_cast<size_t>(reinterpret_cast<const char*>(member) - base_);
+    }
+
+    template <typename T>
+    static double read_scalar(const char* p) {
+        return static_cast<double>(*reinterpret_cast<const T*>(p));
+    }
+
+    template <typename T>
+    static uint64_t read_integer(const char* p) {
+        return static_cast<uint64_t>(*reinterpret_cast<const T*>(p));
+    }
+
+    template <typename T>
+    static double read_length(const char* p) {
+        return static_cast<double>(reinterpret_cast<const std::vector<T>*>(p)->size());
+    }
+
+    template <typename T>
+    static double read_sum(const char* p) {
+        double total = 0.0;
+        for (const T& v : *reinterpret_cast<const std::vector<T>*>(p)) total += static_cast<double>(v);
+        return total;
+    }
+
+    const char* base_ = nullptr;
+    std::vector<Field> fields_;
+};
+
+// Derived metric over record fields, e.g.
+//   (end_inst - start_inst) / (end_cycle - start_cycle)
+//   (l1_misses + l2_misses) / max(rounds, 1)
+//   sum(round_power) / len(round_power)
+// Operators + - * / and unary minus; functions abs, sqrt, log, exp, min,
+// max, and len/sum over vector fields. Arithmetic is IEEE double, so a
+// zero denominator yields inf or NaN rather than an error. Nanosecond
+// timestamps exceed double precision, so the difference of two integer
+// fields is taken in 64-bit integers while gathering and stays exact.
+//
+// compile() parses once, folds constants and lowers the tree to register
+// instructions whose right operand may be a column or constant directly,
+// so leaves never get their own pass. evaluate() gathers the referenced
+// columns of kBlock records at a time and runs each instruction as one
+// tight loop over the block, which the compiler vectorizes; registers are
+// reused block to block, so nothing is allocated per record.
+//
+// Parentheses, calls and unary signs nest at most kMaxDepth deep and the
+// tree is at most kMaxHeight tall, checked while parsing, so hostile
+// input cannot exhaust the stack of the recursive parser, lowering or
+// destructor.
+class MetricExpression {
+public:
+    static constexpr size_t kBlock = 1024;
+    static constexpr size_t kMaxDepth = 32;
+    static constexpr size_t kMaxHeight = 256;
+
+    static std::unique_ptr<MetricExpression> compile(const std::string& text,
+                                                     const RecordLayout& layout,
+                                                     std::string& error) {
+        std::unique_ptr<MetricExpression> expression(new MetricExpression());
+        Parser parser(text, layout);
+        std::unique_ptr<Node> root = parser.parse(error);
+        if (!root) return nullptr;
+        size_t depth = 0;
+        expression->lower(*root, 0, depth);
+        if (depth > kMaxDepth) {
+            error = "expression too deeply nested";
+            return nullptr;
+        }
+        expression->registers_ = depth;
+        return expression;
+    }
+
+    // Calls out(values, count) once per block of results, in record order
+    template <typename Series, typename Out>
+    void evaluate(const Series& series, Out&& out) const {
+        std::vector<double> columns(columns_.size() * kBlock);
+        std::vector<double> registers(std::max<size_t>(registers_, 1) * kBlock);
+        size_t filled = 0;
+        series.forEach([&](const auto& record) {
+            const char* base = reinterpret_cast<const char*>(&record);
+            for (size_t c = 0; c < columns_.size(); ++c) {
+                const Column& column = columns_[c];
+                columns[c * kBlock + filled] =
+                    column.read ? column.read(base + column.offset)
+                                : static_cast<double>(static_cast<int64_t>(
+                                      column.minuend(base + column.offset) -
+                                      column.subtrahend(base + column.offset2)));
+            }
+            if (++filled == kBlock) {
+                run(columns.data(), registers.data(), filled);
+                out(static_cast<const double*>(registers.data()), filled);
+                filled = 0;
+            }
+        });
+        if (filled > 0) {
+            run(columns.data(), registers.data(), filled);
+            out(static_cast<const double*>(registers.data()), filled);
+        }
+    }
+
+private:
+    enum class Op : uint8_t { LOAD, NEG, ABS, SQRT, LOG, EXP, ADD, SUB, MUL, DIV, MIN, MAX };
+    enum class Operand : uint8_t { REGISTER, COLUMN, CONSTANT };
+
+    // Either read(offset), or minuend(offset) - subtrahend(offset2)
+    struct Column {
+        std::string key;
+        size_t offset;
+        RecordLayout::Reader read;
+        size_t offset2;
+        RecordLayout::IntegerReader minuend;
+        RecordLayout::IntegerReader subtrahend;
+    };
+
+    struct Node {
+        enum class Type { CONSTANT, COLUMN, UNARY, BINARY };
+
+        explicit Node(Type node_type) : type(node_type) {}
+
+        Type type;
+        size_t height = 1;
+        Op op = Op::LOAD;
+        double value = 0.0;
+        Column column{};
+        const RecordLayout::Field* field = nullptr;  // plain field columns
+        std::unique_ptr<Node> left, right;
+
+        bool leaf() const { return type == Type::CONSTANT || type == Type::COLUMN; }
+    };
+
+    struct Instruction {
+        Op op;
+        uint8_t target;
+        Operand kind;
+        size_t index;   // register or column
+        double value;   // constant
+    };
+
+    class Parser {
+    public:
+        Parser(const std::string& text, const RecordLayout& layout)
+            : text_(text), layout_(layout) {}
+
+        std::unique_ptr<Node> parse(std::string& error) {
+            std::unique_ptr<Node> root = sum();
+            skip_space();
+            if (!root && error_.empty()) error_ = "empty expression";
+            if (root && pos_ < text_.size()) {
+                error_ = "unexpected '" + text_.substr(pos_, 1) + "'";
+            }
+            if (!error_.empty()) {
+                error = error_ + " at offset " + std::to_string(pos_);
+                return nullptr;
+            }
+            return root;
+        }
+
+    private:
+        std::unique_ptr<Node> sum() {
+            std::unique_ptr<Node> node = product();
+            while (node) {
+                if (accept('+')) node = binary(Op::ADD, std::move(node), product());
+                else if (accept('-')) node = binary(Op::SUB, std::move(node), product());
+                else break;
+            }
+            return node;
+        }
+
+        std::unique_ptr<Node> product() {
+            std::unique_ptr<Node> node = unary();
+            while (node) {
+                if (accept('*')) node = binary(Op::MUL, std::move(node), unary());
+                else if (accept('/')) node = binary(Op::DIV, std::move(node), unary());
+                else break;
+            }
+            return node;
+        }
+
+        // Every nested '(', call or sign passes through here
+        std::unique_ptr<Node> unary() {
+            if (nesting_ == kMaxDepth) return fail("expression too deeply nested");
+            ++nesting_;
+            std::unique_ptr<Node> node;
+            if (accept('-')) node = apply(Op::NEG, unary());
+            else if (accept('+')) node = unary();
+            else node = primary();
+            --nesting_;
+            return node;
+        }
+
+        std::unique_ptr<Node> primary() {
+            skip_space();
+            if (pos_ >= text_.size()) return fail("unexpected end");
+            char c = text_[pos_];
+            if (accept('(')) {
+                std::unique_ptr<Node> inner = sum();
+                if (inner && !accept(')')) return fail("expected ')'");
+                return inner;
+            }
+            if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+                const char* start = text_.c_str() + pos_;
+                char* end = nullptr;
+                double value = std::strtod(start, &end);
+                if (end == start) return fail("bad number");
+                pos_ += static_cast<size_t>(end - start);
+                return constant(value);
+            }
+            if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+                std::string name = identifier();
+                if (accept('(')) return call(name);
+                const RecordLayout::Field* f = layout_.find(name);
+                if (!f) return fail("unknown field '" + name + "'");
+                if (!f->scalar) return fail("'" + name + "' is a vector; use len() or sum()");
+                auto node = column(Column{name, f->offset, f->scalar, 0, nullptr, nullptr});
+                node->field = f;
+                return node;
+            }
+            return fail("unexpected '" + std::string(1, c) + "'");
+        }
+
+        std::unique_ptr<Node> call(const std::string& name) {
+            if (name == "len" || name == "sum") {
+                skip_space();
+                std::string field = identifier();
+                const RecordLayout::Field* f = layout_.find(field);
+                if (!f || f->scalar) return fail(name + "() takes a vector field");
+                if (!accept(')')) return fail("expected ')'");
+                return column(Column{name + "(" + field + ")", f->offset,
+                                     name == "len" ? f->length : f->sum, 0, nullptr, nullptr});
+            }
+            std::unique_ptr<Node> first = sum();
+            if (!first) return nullptr;
+            if (name == "min" || name == "max") {
+                if (!accept(',')) return fail("expected ','");
+                std::unique_ptr<Node> second = sum();
+                if (!second || !accept(')')) return second ? fail("expected ')'") : nullptr;
+                return binary(name == "min" ? Op::MIN : Op::MAX, std::move(first), std::move(second));
+            }
+            if (!accept(')')) return fail("expected ')'");
+            if (name == "abs") return apply(Op::ABS, std::move(first));
+            if (name == "sqrt") return apply(Op::SQRT, std::move(first));
+            if (name == "log") return apply(Op::LOG, std::move(first));
+            if (name == "exp") return apply(Op::EXP, std::move(first));
+            return fail("unknown function '" + name + "'");
+        }
+
+        std::unique_ptr<Node> constant(double value) {
+            auto node = std::make_unique<Node>(Node::Type::CONSTANT);
+            node->value = value;
+            return node;
+        }
+
+        std::unique_ptr<Node> column(const Column& wanted) {
+            auto node = std::make_unique<Node>(Node::Type::COLUMN);
+            node->column = wanted;
+            return node;
+        }
+
+        // Folds constant operands so they cost nothing per record
+        std::unique_ptr<Node> apply(Op op, std::unique_ptr<Node> operand) {
+            if (!operand) return nullptr;
+            if (operand->type == Node::Type::CONSTANT) {
+                operand->value = scalar(op, operand->value, 0.0);
+                return operand;
+            }
+            if (operand->height == kMaxHeight) return fail("expression too deeply nested");
+            auto node = std::make_unique<Node>(Node::Type::UNARY);
+            node->op = op;
+            node->height = operand->height + 1;
+            node->left = std::move(operand);
+            return node;
+        }
+
+        std::unique_ptr<Node> binary(Op op, std::unique_ptr<Node> left, std::unique_ptr<Node> right) {
+            if (!left || !right) return nullptr;
+            if (left->type == Node::Type::CONSTANT && right->type == Node::Type::CONSTANT) {
+                left->value = scalar(op, left->value, right->value);
+                return left;
+            }
+            if (op == Op::SUB && left->field && left->field->integer &&
+                right->field && right->field->integer) {
+                const RecordLayout::Field& a = *left->field;
+                const RecordLayout::Field& b = *right->field;
+                return column(Column{a.name + "-" + b.name, a.offset, nullptr, b.offset,
+                                     a.integer, b.integer});
+            }
+            size_t height = std::max(left->height, right->height) + 1;
+            if (height > kMaxHeight) return fail("expression too deeply nested");
+            auto node = std::make_unique<Node>(Node::Type::BINARY);
+            node->op = op;
+            node->height = height;
+            node->left = std::move(left);
+            node->right = std::move(right);
+            return node;
+        }
+
+        std::string identifier() {
+            size_t start = pos_;
+            while (pos_ < text_.size() &&
+                   (std::isalnum(static_cast<unsigned char>(text_[pos_])) || text_[pos_] == '_')) {
+                ++pos_;
+            }
+            return text_.substr(start, pos_ - start);
+        }
+
+        bool accept(char c) {
+            skip_space();
+            if (pos_ < text_.size() && text_[pos_] == c) {
+                ++pos_;
+                return true;
+            }
+            return false;
+        }
+
+        void skip_space() {
+            while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) ++pos_;
+        }
+
+        std::unique_ptr<Node> fail(const std::string& message) {
+            if (error_.empty()) error_ = message;
+            return nullptr;
+        }
+
+        const std::string& text_;
+        const RecordLayout& layout_;
+        size_t pos_ = 0;
+        size_t nesting_ = 0;
+        std::string error_;
+    };
+
+    static double scalar(Op op, double a, double b) {
+        switch (op) {
+            case Op::NEG: return -a;
+            case Op::ABS: return std::fabs(a);
+            case Op::SQRT: return std::sqrt(a);
+            case Op::LOG: return std::log(a);
+            case Op::EXP: return std::exp(a);
+            case Op::ADD: return a + b;
+            case Op::SUB: return a - b;
+            case Op::MUL: return a * b;
+            case Op::DIV: return a / b;
+            case Op::MIN: return std::fmin(a, b);
+            case Op::MAX: return std::fmax(a, b);
+            default: return b;
+        }
+    }
+
+    static bool commutative(Op op) {
+        return op == Op::ADD || op == Op::MUL || op == Op::MIN || op == Op::MAX;
+    }
+
+    // Only columns that survive fusion are gathered, each once
+    size_t column_slot(const Column& wanted) {
+        auto it = std::find_if(columns_.begin(), columns_.end(),
+                               [&](const Column& c) { return c.key == wanted.key; });
+        if (it != columns_.end()) return static_cast<size_t>(it - columns_.begin());
+        columns_.push_back(wanted);
+        return columns_.size() - 1;
+    }
+
+    // Emits code leaving `node`'s value in register `target`
+    void lower(const Node& node, size_t target, size_t& depth) {
+        depth = std::max(depth, target + 1);
+        if (depth > kMaxDepth) return;
+        uint8_t reg = static_cast<uint8_t>(target);
+        switch (node.type) {
+            case Node::Type::CONSTANT:
+                code_.push_back(Instruction{Op::LOAD, reg, Operand::CONSTANT, 0, node.value});
+                return;
+            case Node::Type::COLUMN:
+                code_.push_back(Instruction{Op::LOAD, reg, Operand::COLUMN, column_slot(node.column), 0.0});
+                return;
+            case Node::Type::UNARY:
+                lower(*node.left, target, depth);
+                code_.push_back(Instruction{node.op, reg, Operand::REGISTER, target, 0.0});
+                return;
+            case Node::Type::BINARY: {
+                const Node* left = node.left.get();
+                const Node* right = node.right.get();
+                if (left->leaf() && !right->leaf() && commutative(node.op)) std::swap(left, right);
+                lower(*left, target, depth);
+                if (right->type == Node::Type::CONSTANT) {
+                    code_.push_back(Instruction{node.op, reg, Operand::CONSTANT, 0, right->value});
+                } else if (right->type == Node::Type::COLUMN) {
+                    code_.push_back(Instruction{node.op, reg, Operand::COLUMN, column_slot(right->column), 0.0});
+                } else {
+                    lower(*right, target + 1, depth);
+                    code_.push_back(Instruction{node.op, reg, Operand::REGISTER, target + 1, 0.0});
+                }
+                return;
+            }
+        }
+    }
+
+    template <typename F>
+    static void kernel(double* __restrict out, const double* __restrict in, size_t n, F f) {
+        for (size_t i = 0; i < n; ++i) out[i] = f(out[i], in[i]);
+    }
+
+    template <typename F>
+    static void kernel(double* __restrict out, double c, size_t n, F f) {
+        for (size_t i = 0; i < n; ++i) out[i] = f(out[i], c);
+    }
+
+    template <typename F>
+    static void dispatch(const Instruction& ins, double* out, const double* in, size_t n, F f) {
+        if (ins.kind == Operand::CONSTANT) kernel(out, ins.value, n, f);
+        else kernel(out, in, n, f);
+    }
+
+    void run(const double* columns, double* registers, size_t n) const {
+        for (const Instruction& ins : code_) {
+            double* out = registers + ins.target * kBlock;
+            const double* in = ins.kind == Operand::COLUMN ? columns + ins.index * kBlock
+                                                           : registers + ins.index * kBlock;
+            switch (ins.op) {
+                case Op::LOAD:
+                    if (ins.kind == Operand::CONSTANT) std::fill(out, out + n, ins.value);
+                    else std::copy(in, in + n, out);
+                    break;
+                case Op::NEG: for (size_t i = 0; i < n; ++i) out[i] = -out[i]; break;
+                case Op::ABS: for (size_t i = 0; i < n; ++i) out[i] = std::fabs(out[i]); break;
+                case Op::SQRT: for (size_t i = 0; i < n; ++i) out[i] = std::sqrt(out[i]); break;
+                case Op::LOG: for (size_t i = 0; i < n; ++i) out[i] = std::log(out[i]); break;
+                case Op::EXP: for (size_t i = 0; i < n; ++i) out[i] = std::exp(out[i]); break;
+                case Op::ADD: dispatch(ins, out, in, n, [](double a, double b) { return a + b; }); break;
+                case Op::SUB: dispatch(ins, out, in, n, [](double a, double b) { return a - b; }); break;
+                case Op::MUL: dispatch(ins, out, in, n, [](double a, double b) { return a * b; }); break;
+                case Op::DIV: dispatch(ins, out, in, n, [](double a, double b) { return a / b; }); break;
+                case Op::MIN: dispatch(ins, out, in, n, [](double a, double b) { return std::fmin(a, b); }); break;
+                case Op::MAX: dispatch(ins, out, in, n, [](double a, double b) { return std::fmax(a, b); }); break;
+            }
+        }
+    }
+
+    MetricExpression() = default;
+
+    std::vector<Column> columns_;
+    std::vector<Instruction> code_;
+    size_t registers_ = 0;
+};
@@ -0,0 +1,118 @@
+// monitor_summary.h
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "byte_buffer.h"
+#include "side_channel_analysis.h"
+#include "streaming_stats.h"
+
+// Mergeable per-operation state. Everything here combines exactly except
+// the sketch, whose quantiles stay within QuantileSketch::kRelativeAccuracy.
+struct OperationSummary {
+    RunningMoments execution_time;
+    QuantileSketch execution_sketch;
+    std::vector<RunningMoments> round_timing;  // delta between rounds i and i+1
+    std::vector<RunningMoments> round_power;   // power at round i
+    TvlaAccumulator tvla;
+
+    bool empty() const {
+        return execution_time.count == 0;
+    }
+
+    void add(uint32_t label, double exec_time,
+             const std::vector<double>& power,
+             const std::vector<uint64_t>& timings) {
+        execution_time.add(exec_time);
+        execution_sketch.add(exec_time);
+        if (round_power.size() < power.size()) round_power.resize(power.size());
+        for (size_t i = 0; i < power.size(); ++i) round_power[i].add(power[i]);
+        if (timings.size() > 1 && round_timing.size() < timings.size() - 1) {
+            round_timing.resize(timings.size() - 1);
+        }
+        for (size_t i = 1; i < timings.size(); ++i) {
+            round_timing[i - 1].add(static_cast<double>(timings[i] - timings[i - 1]));
+        }
+        tvla.add(label, exec_time, power, timings);
+    }
+
+    void merge(const OperationSummary& other) {
+        execution_time.merge(other.execution_time);
+        execution_sketch.merge(other.execution_sketch);
+        mergeMomentSeries(round_timing, other.round_timing);
+        mergeMomentSeries(round_power, other.round_power);
+        tvla.merge(other.tvla);
+    }
+
+    void write(ByteWriter& writer) const {
+        execution_time.write(writer);
+        execution_sketch.write(writer);
+        writeMomentSeries(writer, round_timing);
+        writeMomentSeries(writer, round_power);
+        tvla.write(writer);
+    }
+
+    void read(ByteReader& reader) {
+        execution_time.read(reader);
+        execution_sketch.read(reader);
+        readMomentSeries(reader, round_timing);
+        readMomentSeries(reader, round_power);
+        tvla.read(reader);
+    }
+};
+
+// Fixed-size summary of a whole monitor; what instances ship to a collector
+// instead of raw samples.
+struct MonitorSummary {
+    static constexpr uint32_t kMagic = 0x4D534D43;  // "CMSM"
+    static constexpr uint16_t kVersion = 1;
+    static constexpr size_t kOperations = 8;
+
+    std::array<OperationSummary, kOperations> operations;
+
+    void merge(const MonitorSummary& other) {
+        for (size_t i = 0; i < kOperations; ++i) {
+            operations[i].merge(other.operations[i]);
+        }
+    }
+
+    std::vector<uint8_t> serialize() const {
+        std::vector<uint8_t> out;
+        ByteWriter writer(out);
+        writer.put<uint32_t>(kMagic);
+        writer.put<uint16_t>(kVersion);
+        writer.put<uint16_t>(0);  // flags
+        uint32_t present = 0;
+        for (const auto& op : operations) present += op.empty() ? 0 : 1;
+        writer.put<uint32_t>(present);
+        for (size_t i = 0; i < kOperations; ++i) {
+            if (operations[i].empty()) continue;
+            writer.put<uint32_t>(static_cast<uint32_t>(i));
+            operations[i].write(writer);
+        }
+        return out;
+    }
+
+    // Replaces this summary with the decoded one; untouched on failure.
+    bool deserialize(const uint8_t* data, size_t size) {
+        ByteReader reader(data, size);
+        if (reader.get<uint32_t>() != kMagic) return false;
+        uint16_t version = reader.get<uint16_t>();
+        if (version == 0 || version > kVersion) return false;
+        reader.get<uint16_t>();
+        uint32_t present = reader.get<uint32_t>();
+        if (present > kOperations) return false;
+
+        MonitorSummary decoded;
+        for (uint32_t i = 0; i < present && !reader.failed(); ++i) {
+            uint32_t op = reader.get<uint32_t>();
+            if (op >= kOperations) return false;
+            decoded.operations[op].read(reader);
+        }
+        if (reader.failed()) return false;
+        *this = std::move(decoded);
+        return true;
+    }
+};
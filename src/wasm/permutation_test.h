@@ -0,0 +1,265 @@
+// permutation_test.h
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// xoshiro256++ (Blackman & Vigna). jump() advances by 2^128 draws, so
+// stream t of a seed is the seeded state jumped t times and streams never
+// overlap in practice.
+class Xoshiro256 {
+public:
+    explicit Xoshiro256(uint64_t seed) {
+        for (auto& word : state_) {
+            seed += 0x9e3779b97f4a7c15ull;  // splitmix64
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next() {
+        uint64_t result = rotl(state_[0] + state_[3], 23) + state_[0];
+        uint64_t t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = rotl(state_[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, bound) by Lemire's multiply-shift, rejecting the
+    // small biased slice
+    uint32_t below(uint32_t bound) {
+        uint64_t product = (next() >> 32) * bound;
+        uint32_t low = static_cast<uint32_t>(product);
+        if (low < bound) {
+            uint32_t threshold = static_cast<uint32_t>(-bound) % bound;
+            while (low < threshold) {
+                product = (next() >> 32) * bound;
+                low = static_cast<uint32_t>(product);
+            }
+        }
+        return static_cast<uint32_t>(product >> 32);
+    }
+
+    void jump() {
+        static const uint64_t kJump[] = {0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull,
+                                         0xa9582618e03fc9aaull, 0x39abdc4529b1661cull};
+        uint64_t s[4] = {0, 0, 0, 0};
+        for (uint64_t word : kJump) {
+            for (int bit = 0; bit < 64; ++bit) {
+                if (word & (1ull << bit)) {
+                    for (int i = 0; i < 4; ++i) s[i] ^= state_[i];
+                }
+                next();
+            }
+        }
+        for (int i = 0; i < 4; ++i) state_[i] = s[i];
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    uint64_t state_[4];
+};
+
+enum class PermutationStatistic : uint32_t {
+    MEAN_DIFFERENCE = 0,
+    MEDIAN_DIFFERENCE = 1,
+};
+
+struct PermutationTestOptions {
+    PermutationStatistic statistic = PermutationStatistic::MEAN_DIFFERENCE;
+    uint64_t max_permutations = 10000;
+    // Early stopping: once the p-value lies on one side of `alpha` with
+    // a z-score margin of `confidence_z`, further permutations cannot
+    // change the decision. alpha <= 0 always runs max_permutations.
+    double alpha = 0.05;
+    double confidence_z = 3.29;  // two-sided 99.9%
+    uint64_t seed = 0x5eed;
+    unsigned threads = 0;  // 0 = hardware concurrency
+};
+
+// Two-sided: p = (1 + #{|T*| >= |T|}) / (1 + permutations), which never
+// reports 0. `observed` is statistic(A) - statistic(B).
+struct PermutationTestResult {
+    uint64_t count_a = 0;
+    uint64_t count_b = 0;
+    double observed = 0.0;
+    double p_value = 1.0;
+    uint64_t permutations = 0;
+    uint64_t exceedances = 0;
+    bool stopped_early = false;
+};
+
+// Monte-Carlo permutation test between two samples. The pooled values
+// are sorted once and each worker shuffles its own array of uint32 ranks:
+// a partial Fisher-Yates over the smaller group's size draws a uniform
+// relabelling, after which the mean needs only that group's sum and the
+// median a selection over ranks. Workers run batches of kBatch
+// permutations on separate xoshiro streams and share atomic counters,
+// which the stopping rule reads between batches. With more than one
+// thread an early stop lands on a batch boundary reached by whichever
+// worker gets there first, so counts can vary slightly between runs.
+class PermutationTest {
+public:
+    static constexpr uint64_t kBatch = 64;
+    static constexpr uint64_t kMinPermutations = 256;
+
+    static PermutationTestResult run(const std::vector<double>& a, const std::vector<double>& b,
+                                     const PermutationTestOptions& options = PermutationTestOptions()) {
+        PermutationTestResult result;
+        result.count_a = a.size();
+        result.count_b = b.size();
+        if (a.empty() || b.empty() || a.size() + b.size() > UINT32_MAX) return result;
+
+        Pool pool(a, b, options.statistic);
+        result.observed = pool.observed();
+        const double threshold = std::fabs(result.observed) * (1.0 - 1e-12);
+
+        unsigned threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+        threads = 1;
+#endif
+        uint64_t batches = (options.max_permutations + kBatch - 1) / kBatch;
+        threads = static_cast<unsigned>(std::max<uint64_t>(1, std::min<uint64_t>(threads, batches)));
+
+        std::atomic<uint64_t> next_batch{0};
+        std::atomic<uint64_t> done{0};
+        std::atomic<uint64_t> exceeded{0};
+        std::atomic<bool> stop{false};
+
+        auto worker = [&](unsigned stream) {
+            Xoshiro256 rng(options.seed);
+            for (unsigned i = 0; i < stream; ++i) rng.jump();
+            std::vector<uint32_t> ranks = pool.initial_ranks();
+
+            while (!stop.load(std::memory_order_relaxed)) {
+                uint64_t batch = next_batch.fetch_add(1, std::memory_order_relaxed);
+                if (batch >= batches) break;
+                uint64_t size = std::min(kBatch, options.max_permutations - batch * kBatch);
+                uint64_t hits = 0;
+                for (uint64_t p = 0; p < size; ++p) {
+                    pool.shuffle(ranks, rng);
+                    if (std::fabs(pool.statistic(ranks)) >= threshold) ++hits;
+                }
+                uint64_t total_hits = exceeded.fetch_add(hits, std::memory_order_relaxed) + hits;
+                uint64_t total = done.fetch_add(size, std::memory_order_relaxed) + size;
+                if (decided(total, total_hits, options)) stop.store(true, std::memory_order_relaxed);
+            }
+        };
+
+        // The calling thread works stream 0; if spawning fails the test
+        // just runs on fewer threads
+        std::vector<std::thread> helpers;
+        try {
+            for (unsigned t = 1; t < threads; ++t) helpers.emplace_back(worker, t);
+        } catch (const std::system_error&) {
+        }
+        worker(0);
+        for (auto& helper : helpers) helper.join();
+
+        result.permutations = done.load();
+        result.exceedances = exceeded.load();
+        result.p_value = static_cast<double>(result.exceedances + 1) /
+                         static_cast<double>(result.permutations + 1);
+        result.stopped_early = result.permutations < options.max_permutations;
+        return result;
+    }
+
+private:
+    static bool decided(uint64_t total, uint64_t hits, const PermutationTestOptions& options) {
+        if (options.alpha <= 0 || total < kMinPermutations) return false;
+        double p = static_cast<double>(hits + 1) / static_cast<double>(total + 1);
+        double margin = options.confidence_z * std::sqrt(p * (1.0 - p) / static_cast<double>(total));
+        return std::fabs(p - options.alpha) > margin;
+    }
+
+    // Pooled sample in sorted order; permutations move ranks into it
+    class Pool {
+    public:
+        Pool(const std::vector<double>& a, const std::vector<double>& b,
+             PermutationStatistic statistic)
+            : statistic_(statistic) {
+            // The smaller group is the one drawn, so the shuffle is shorter
+            swapped_ = a.size() > b.size();
+            const std::vector<double>& drawn = swapped_ ? b : a;
+            const std::vector<double>& rest = swapped_ ? a : b;
+            drawn_ = drawn.size();
+
+            std::vector<std::pair<double, uint32_t>> order;
+            order.reserve(drawn.size() + rest.size());
+            for (double v : drawn) order.emplace_back(v, static_cast<uint32_t>(order.size()));
+            for (double v : rest) order.emplace_back(v, static_cast<uint32_t>(order.size()));
+            std::sort(order.begin(), order.end());
+            sorted_.resize(order.size());
+            initial_.resize(order.size());
+            for (uint32_t rank = 0; rank < order.size(); ++rank) {
+                sorted_[rank] = order[rank].first;
+                initial_[order[rank].second] = rank;
+            }
+            for (double v : sorted_) total_ += v;
+        }
+
+        std::vector<uint32_t> initial_ranks() const { return initial_; }
+
+        double observed() const {
+            std::vector<uint32_t> ranks = initial_;
+            return statistic(ranks);
+        }
+
+        // Leaves a uniformly random subset of ranks in [0, drawn_)
+        void shuffle(std::vector<uint32_t>& ranks, Xoshiro256& rng) const {
+            const uint32_t n = static_cast<uint32_t>(ranks.size());
+            for (uint32_t i = 0; i < drawn_; ++i) {
+                uint32_t j = i + rng.below(n - i);
+                std::swap(ranks[i], ranks[j]);
+            }
+        }
+
+        // statistic(A) - statistic(B) for the split [0, drawn_) | rest;
+        // the median path reorders within each part, which the next
+        // shuffle does not mind
+        double statistic(std::vector<uint32_t>& ranks) const {
+            const size_t rest = ranks.size() - drawn_;
+            double difference;
+            if (statistic_ == PermutationStatistic::MEAN_DIFFERENCE) {
+                double sum = 0.0;
+                for (uint32_t i = 0; i < drawn_; ++i) sum += sorted_[ranks[i]];
+                difference = sum / drawn_ - (total_ - sum) / rest;
+            } else {
+                difference = median(ranks.data(), drawn_) - median(ranks.data() + drawn_, rest);
+            }
+            return swapped_ ? -difference : difference;
+        }
+
+    private:
+        // Ranks order like values, so selection runs on the integers
+        double median(uint32_t* ranks, size_t count) const {
+            uint32_t* middle = ranks + count / 2;
+            std::nth_element(ranks, middle, ranks + count);
+            double upper = sorted_[*middle];
+            if (count % 2 == 1) return upper;
+            double lower = sorted_[*std::max_element(ranks, middle)];
+            return 0.5 * (lower + upper);
+        }
+
+        PermutationStatistic statistic_;
+        bool swapped_ = false;
+        uint32_t drawn_ = 0;
+        double total_ = 0.0;
+        std::vector<double> sorted_;
+        std::vector<uint32_t> initial_;
+    };
+};
@@ -0,0 +1,159 @@
+// segment_file.h
+#pragma once
+
+#ifndef __EMSCRIPTEN__
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Append-only spill file with a background writer. append() reserves the
+// next offset and returns immediately; the writer thread performs the
+// pwrite calls in order, so everything below durable() is readable from
+// disk. The file is unlinked as soon as it is opened and vanishes with the
+// descriptor, including on a crash.
+class SegmentFile {
+public:
+    using Bytes = std::shared_ptr<const std::vector<uint8_t>>;
+
+    static std::unique_ptr<SegmentFile> open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0) return nullptr;
+        ::unlink(path.c_str());
+        return std::unique_ptr<SegmentFile>(new SegmentFile(fd));
+    }
+
+    ~SegmentFile() {
+        if (abandoned_) {
+            writer_.detach();
+        } else {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            work_.notify_one();
+            writer_.join();
+        }
+        ::close(fd_);
+    }
+
+    SegmentFile(const SegmentFile&) = delete;
+    SegmentFile& operator=(const SegmentFile&) = delete;
+
+    // Queues `bytes` for writing and returns the offset it will occupy
+    uint64_t append(Bytes bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t offset = reserved_;
+        reserved_ += bytes->size();
+        queue_.push_back(Job{offset, std::move(bytes)});
+        work_.notify_one();
+        return offset;
+    }
+
+    bool read(uint64_t offset, size_t size, std::vector<uint8_t>& out) const {
+        out.resize(size);
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::pread(fd_, out.data() + done, size - done,
+                                static_cast<off_t>(offset + done));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    uint64_t durable() const { return durable_.load(std::memory_order_acquire); }
+    bool failed() const { return failed_.load(std::memory_order_relaxed); }
+
+    // Blocks until every queued write has completed
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this] { return queue_.empty() && !writing_; });
+    }
+
+    // For a forked child, which inherits the descriptor but not the writer
+    // thread. Only read() and durable() may be used afterwards: writes still
+    // queued never land, so durable() stays where the fork left it, and
+    // destruction closes the descriptor without joining. The lock and
+    // condition variables may be caught mid-use by the writer, and
+    // destroying them as they are would block, so they are recreated in
+    // place; nothing else runs in the child yet.
+    void abandonWriter() {
+        if (abandoned_) return;
+        new (&mutex_) std::mutex();
+        new (&work_) std::condition_variable();
+        new (&idle_) std::condition_variable();
+        queue_.clear();
+        writing_ = false;
+        abandoned_ = true;
+    }
+    bool abandoned() const { return abandoned_; }
+
+private:
+    struct Job {
+        uint64_t offset;
+        Bytes bytes;
+    };
+
+    explicit SegmentFile(int fd) : fd_(fd), writer_([this] { run(); }) {}
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            work_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return;
+            Job job = std::move(queue_.front());
+            queue_.pop_front();
+            writing_ = true;
+            lock.unlock();
+
+            // After a failed write the watermark stops moving, so callers keep
+            // their in-memory copies instead of reading back a hole
+            if (!write_all(job.offset, *job.bytes)) failed_.store(true, std::memory_order_relaxed);
+            if (!failed()) durable_.store(job.offset + job.bytes->size(), std::memory_order_release);
+
+            lock.lock();
+            writing_ = false;
+            if (queue_.empty()) idle_.notify_all();
+        }
+    }
+
+    bool write_all(uint64_t offset, const std::vector<uint8_t>& bytes) {
+        size_t done = 0;
+        while (done < bytes.size()) {
+            ssize_t n = ::pwrite(fd_, bytes.data() + done, bytes.size() - done,
+                                 static_cast<off_t>(offset + done));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    int fd_;
+    std::mutex mutex_;
+    std::condition_variable work_;
+    std::condition_variable idle_;
+    std::deque<Job> queue_;
+    uint64_t reserved_ = 0;
+    bool writing_ = false;
+    bool stopping_ = false;
+    bool abandoned_ = false;
+    std::atomic<uint64_t> durable_{0};
+    std::atomic<bool> failed_{false};
+    std::thread writer_;
+};
+
+#endif  // __EMSCRIPTEN__
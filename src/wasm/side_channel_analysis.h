@@ -0,0 +1,347 @@
+// side_channel_analysis.h
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "streaming_stats.h"
+
+// Conventional TVLA pass/fail bound on |t|
+constexpr double kTvlaThreshold = 4.5;
+
+struct TvlaResult {
+    uint64_t fixed_count = 0;
+    uint64_t random_count = 0;
+    double execution_time_t = 0.0;
+    std::vector<double> round_power_t;
+    std::vector<double> round_timing_t;
+    double max_abs_t = 0.0;
+    bool leakage_detected = false;
+};
+
+// Fixed-vs-random (non-specific) TVLA. Group 0 is the fixed-input class,
+// group 1 the random-input class; per-round statistics are indexed by round.
+class TvlaAccumulator {
+public:
+    void add(uint32_t group, double execution_time,
+             const std::vector<double>& round_power,
+             const std::vector<uint64_t>& round_timings) {
+        if (group > 1) return;
+        execution_[group].add(execution_time);
+
+        auto& power = round_power_[group];
+        if (power.size() < round_power.size()) power.resize(round_power.size());
+        for (size_t i = 0; i < round_power.size(); ++i) {
+            power[i].add(round_power[i]);
+        }
+
+        auto& timing = round_timing_[group];
+        if (round_timings.size() > 1 && timing.size() < round_timings.size() - 1) {
+            timing.resize(round_timings.size() - 1);
+        }
+        for (size_t i = 1; i < round_timings.size(); ++i) {
+            timing[i - 1].add(static_cast<double>(round_timings[i] - round_timings[i - 1]));
+        }
+    }
+
+    void merge(const TvlaAccumulator& other) {
+        for (int g = 0; g < 2; ++g) {
+            execution_[g].merge(other.execution_[g]);
+            mergeMomentSeries(round_power_[g], other.round_power_[g]);
+            mergeMomentSeries(round_timing_[g], other.round_timing_[g]);
+        }
+    }
+
+    void write(ByteWriter& writer) const {
+        for (int g = 0; g < 2; ++g) {
+            execution_[g].write(writer);
+            writeMomentSeries(writer, round_power_[g]);
+            writeMomentSeries(writer, round_timing_[g]);
+        }
+    }
+
+    void read(ByteReader& reader) {
+        for (int g = 0; g < 2; ++g) {
+            execution_[g].read(reader);
+            readMomentSeries(reader, round_power_[g]);
+            readMomentSeries(reader, round_timing_[g]);
+        }
+    }
+
+    TvlaResult result(double threshold = kTvlaThreshold) const {
+        TvlaResult r;
+        r.fixed_count = execution_[0].count;
+        r.random_count = execution_[1].count;
+        r.execution_time_t = welchT(execution_[0], execution_[1]);
+        r.round_power_t = series_t(round_power_[0], round_power_[1]);
+        r.round_timing_t = series_t(round_timing_[0], round_timing_[1]);
+
+        r.max_abs_t = std::fabs(r.execution_time_t);
+        for (double t : r.round_power_t) r.max_abs_t = std::fmax(r.max_abs_t, std::fabs(t));
+        for (double t : r.round_timing_t) r.max_abs_t = std::fmax(r.max_abs_t, std::fabs(t));
+        r.leakage_detected = r.max_abs_t > threshold;
+        return r;
+    }
+
+    const RunningMoments& executionMoments(int group) const { return execution_[group]; }
+    const std::vector<RunningMoments>& roundPowerMoments(int group) const { return round_power_[group]; }
+    const std::vector<RunningMoments>& roundTimingMoments(int group) const { return round_timing_[group]; }
+
+private:
+    static std::vector<double> series_t(const std::vector<RunningMoments>& a,
+                                        const std::vector<RunningMoments>& b) {
+        std::vector<double> t(std::min(a.size(), b.size()));
+        for (size_t i = 0; i < t.size(); ++i) t[i] = welchT(a[i], b[i]);
+        return t;
+    }
+
+    RunningMoments execution_[2];
+    std::vector<RunningMoments> round_power_[2];
+    std::vector<RunningMoments> round_timing_[2];
+};
+
+struct CpaResult {
+    uint64_t trace_count = 0;
+    size_t points = 0;
+    // correlations[guess * points + point]
+    std::vector<double> correlations;
+    std::array<double, 256> peak_correlation{};
+    uint32_t best_guess = 0;
+    double best_correlation = 0.0;
+};
+
+// First-order CPA against the AES first-round S-box output, using the
+// Hamming-weight model. Labels are the known plaintext byte. Traces are
+// reduced to per-label sums on ingest, so finishing costs
+// O(256 * 256 * points) regardless of trace count.
+class CpaAccumulator {
+public:
+    void add(uint8_t input_byte, const std::vector<double>& trace) {
+        if (points_ == 0) {
+            if (trace.empty()) return;
+            points_ = trace.size();
+            class_sums_.assign(256 * points_, 0.0);
+            sum_x_.assign(points_, 0.0);
+            sum_x2_.assign(points_, 0.0);
+        }
+        if (trace.size() < points_) return;
+
+        ++class_counts_[input_byte];
+        ++count_;
+        double* sums = &class_sums_[input_byte * points_];
+        for (size_t p = 0; p < points_; ++p) {
+            double x = trace[p];
+            sums[p] += x;
+            sum_x_[p] += x;
+            sum_x2_[p] += x * x;
+        }
+    }
+
+    CpaResult result() const {
+        CpaResult r;
+        r.trace_count = count_;
+        r.points = points_;
+        if (count_ < 2 || points_ == 0) return r;
+
+        const double n = static_cast<double>(count_);
+        r.correlations.assign(256 * points_, 0.0);
+        std::vector<double> sum_hx(points_);
+
+        for (uint32_t guess = 0; guess < 256; ++guess) {
+            double sum_h = 0.0;
+            double sum_h2 = 0.0;
+            std::fill(sum_hx.begin(), sum_hx.end(), 0.0);
+            for (uint32_t c = 0; c < 256; ++c) {
+                if (class_counts_[c] == 0) continue;
+                double h = hamming_weight(sbox()[c ^ guess]);
+                sum_h += class_counts_[c] * h;
+                sum_h2 += class_counts_[c] * h * h;
+                const double* sums = &class_sums_[c * points_];
+                for (size_t p = 0; p < points_; ++p) sum_hx[p] += h * sums[p];
+            }
+
+            double var_h = n * sum_h2 - sum_h * sum_h;
+            double* row = &r.correlations[guess * points_];
+            double peak = 0.0;
+            for (size_t p = 0; p < points_; ++p) {
+                double var_x = n * sum_x2_[p] - sum_x_[p] * sum_x_[p];
+                double denom = std::sqrt(var_h * var_x);
+                row[p] = denom > 0.0 ? (n * sum_hx[p] - sum_h * sum_x_[p]) / denom : 0.0;
+                if (std::fabs(row[p]) > std::fabs(peak)) peak = row[p];
+            }
+            r.peak_correlation[guess] = peak;
+            if (std::fabs(peak) > std::fabs(r.best_correlation)) {
+                r.best_correlation = peak;
+                r.best_guess = guess;
+            }
+        }
+        return r;
+    }
+
+    uint64_t count() const { return count_; }
+
+private:
+    static double hamming_weight(uint8_t v) {
+        return static_cast<double>(__builtin_popcount(v));
+    }
+
+    static const std::array<uint8_t, 256>& sbox() {
+        static const std::array<uint8_t, 256> table = {
+            0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+            0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+            0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+            0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+            0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+            0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+            0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+            0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+            0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+            0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+            0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+            0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+            0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+            0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+            0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+            0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+        };
+        return table;
+    }
+
+    size_t points_ = 0;
+    uint64_t count_ = 0;
+    std::array<uint64_t, 256> class_counts_{};
+    std::vector<double> class_sums_;
+    std::vector<double> sum_x_;
+    std::vector<double> sum_x2_;
+};
+
+struct SnrResult {
+    uint64_t trace_count = 0;
+    size_t points = 0;
+    uint32_t classes = 0;  // labels seen
+    // Per point: variance of the class means, mean within-class
+    // variance, and their ratio
+    std::vector<double> signal;
+    std::vector<double> noise;
+    std::vector<double> snr;
+};
+
+// Per-point signal-to-noise ratio across up to 256 label classes, for
+// finding leaking points before CPA or template analysis. Each class keeps
+// Welford means and M2 per point, allocated the first time it is seen, so
+// ingest is one pass over the trace in contiguous loops the compiler can
+// vectorize. Like CpaAccumulator, the first trace fixes the length;
+// shorter traces are skipped and longer ones truncated.
+class SnrAccumulator {
+public:
+    void add(uint8_t label, const double* trace, size_t length) {
+        if (points_ == 0) {
+            if (length == 0) return;
+            points_ = length;
+        }
+        if (length < points_) return;
+
+        ClassState& state = classes_[label];
+        if (state.mean.empty()) {
+            state.mean.assign(points_, 0.0);
+            state.m2.assign(points_, 0.0);
+        }
+        ++state.count;
+        ++count_;
+        const double inv_n = 1.0 / static_cast<double>(state.count);
+        double* mean = state.mean.data();
+        double* m2 = state.m2.data();
+        for (size_t p = 0; p < points_; ++p) {
+            double delta = trace[p] - mean[p];
+            mean[p] += delta * inv_n;
+            m2[p] += delta * (trace[p] - mean[p]);
+        }
+    }
+
+    SnrResult result() const {
+        SnrResult r;
+        r.trace_count = count_;
+        r.points = points_;
+        if (count_ == 0) return r;
+
+        const double n = static_cast<double>(count_);
+        std::vector<double> grand(points_, 0.0);
+        for (const ClassState& state : classes_) {
+            if (state.count == 0) continue;
+            ++r.classes;
+            const double w = state.count / n;
+            for (size_t p = 0; p < points_; ++p) grand[p] += w * state.mean[p];
+        }
+
+        r.signal.assign(points_, 0.0);
+        r.noise.assign(points_, 0.0);
+        for (const ClassState& state : classes_) {
+            if (state.count == 0) continue;
+            const double w = state.count / n;
+            for (size_t p = 0; p < points_; ++p) {
+                double d = state.mean[p] - grand[p];
+                r.signal[p] += w * d * d;
+                r.noise[p] += state.m2[p] / n;
+            }
+        }
+        r.snr.resize(points_);
+        for (size_t p = 0; p < points_; ++p) {
+            r.snr[p] = r.noise[p] > 0.0 ? r.signal[p] / r.noise[p] : 0.0;
+        }
+        return r;
+    }
+
+    uint64_t count() const { return count_; }
+
+private:
+    struct ClassState {
+        uint64_t count = 0;
+        std::vector<double> mean;
+        std::vector<double> m2;
+    };
+
+    size_t points_ = 0;
+    uint64_t count_ = 0;
+    std::array<ClassState, 256> classes_;
+};
+
+// Indices of the `k` highest scores, best first. With `min_spacing` > 0 a
+// point is passed over when a better one was already chosen fewer than
+// that many indices away, so one wide leak does not fill every slot.
+// NaN scores are never picked.
+inline std::vector<uint32_t> selectPointsOfInterest(const std::vector<double>& scores, size_t k,
+                                                    size_t min_spacing = 0) {
+    std::vector<uint32_t> order;
+    order.reserve(scores.size());
+    for (uint32_t i = 0; i < scores.size(); ++i) {
+        if (!std::isnan(scores[i])) order.push_back(i);
+    }
+    auto better = [&](uint32_t a, uint32_t b) {
+        return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+    };
+
+    std::vector<uint32_t> chosen;
+    if (min_spacing == 0) {
+        size_t take = std::min(k, order.size());
+        std::partial_sort(order.begin(), order.begin() + take, order.end(), better);
+        chosen.assign(order.begin(), order.begin() + take);
+        return chosen;
+    }
+    std::sort(order.begin(), order.end(), better);
+    for (uint32_t candidate : order) {
+        if (chosen.size() >= k) break;
+        bool clear = true;
+        for (uint32_t taken : chosen) {
+            uint32_t gap = candidate > taken ? candidate - taken : taken - candidate;
+            if (gap < min_spacing) {
+                clear = false;
+                break;
+            }
+        }
+        if (clear) chosen.push_back(candidate);
+    }
+    return chosen;
+}
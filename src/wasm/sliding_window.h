@@ -0,0 +1,261 @@
+// sliding_window.h
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "streaming_stats.h"
+
+// Count/mean/M2 that also supports removing a previously merged part, the
+// exact inverse of the pairwise merge.
+struct WindowedMoments {
+    uint64_t count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    void add(double x) {
+        ++count;
+        double delta = x - mean;
+        mean += delta / count;
+        m2 += delta * (x - mean);
+    }
+
+    void merge(const WindowedMoments& other) {
+        if (other.count == 0) return;
+        double n = static_cast<double>(count + other.count);
+        double delta = other.mean - mean;
+        m2 += other.m2 + delta * delta * count * other.count / n;
+        mean += delta * other.count / n;
+        count += other.count;
+    }
+
+    void subtract(const WindowedMoments& part) {
+        if (part.count >= count) {
+            *this = WindowedMoments();
+            return;
+        }
+        double n = static_cast<double>(count);
+        double remaining = static_cast<double>(count - part.count);
+        double rest_mean = (n * mean - part.count * part.mean) / remaining;
+        double delta = part.mean - rest_mean;
+        m2 = std::max(0.0, m2 - part.m2 - delta * delta * remaining * part.count / n);
+        mean = rest_mean;
+        count -= part.count;
+    }
+
+    double stddev() const {
+        return count > 0 ? std::sqrt(m2 / count) : 0.0;
+    }
+};
+
+// Aggregates without an inverse; kept in a two-stack queue instead.
+struct WindowExtremes {
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    QuantileSketch sketch;
+
+    void add(double x) {
+        if (x < min) min = x;
+        if (x > max) max = x;
+        sketch.add(x);
+    }
+
+    void merge(const WindowExtremes& other) {
+        if (other.min < min) min = other.min;
+        if (other.max > max) max = other.max;
+        sketch.merge(other.sketch);
+    }
+};
+
+// FIFO over a monoid with amortized O(1) push, pop and fold. The front
+// stack stores, per element, the fold of it and every newer element above
+// it; the back stack only needs its running fold.
+template <typename Agg>
+class TwoStackQueue {
+public:
+    void push(const Agg& value) {
+        back_.push_back(value);
+        back_fold_.merge(value);
+    }
+
+    void pop() {
+        if (front_.empty()) transfer();
+        if (!front_.empty()) front_.pop_back();
+    }
+
+    bool empty() const { return front_.empty() && back_.empty(); }
+    size_t size() const { return front_.size() + back_.size(); }
+
+    void foldInto(Agg& into) const {
+        if (!front_.empty()) into.merge(front_.back().fold);
+        into.merge(back_fold_);
+    }
+
+    void clear() {
+        front_.clear();
+        back_.clear();
+        back_fold_ = Agg();
+    }
+
+private:
+    struct Entry {
+        Agg fold;
+    };
+
+    void transfer() {
+        // Newest first, so each entry's fold covers itself and newer ones
+        while (!back_.empty()) {
+            Entry entry{std::move(back_.back())};
+            if (!front_.empty()) entry.fold.merge(front_.back().fold);
+            front_.push_back(std::move(entry));
+            back_.pop_back();
+        }
+        back_fold_ = Agg();
+    }
+
+    std::vector<Entry> front_;
+    std::vector<Agg> back_;
+    Agg back_fold_;
+};
+
+struct WindowStatistics {
+    uint64_t window_ns = 0;
+    uint64_t count = 0;
+    double mean = 0.0;
+    double stddev = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+};
+
+// Time-bucketed "last N seconds" statistics. Values land in the open
+// bucket; closed buckets are subtracted from the running moments and
+// popped from the extremes queue once they fall out of the window, so
+// both updates and queries are O(1) amortized in the number of samples.
+// Buckets expire whole, so the window edge has one bucket of granularity.
+class SlidingWindowStats {
+public:
+    explicit SlidingWindowStats(uint64_t window_ns = 60000000000ull, size_t buckets = 60) {
+        configure(window_ns, buckets);
+    }
+
+    void configure(uint64_t window_ns, size_t buckets) {
+        window_ns_ = std::max<uint64_t>(window_ns, 1);
+        width_ns_ = std::max<uint64_t>(window_ns_ / std::max<size_t>(buckets, 1), 1);
+        closed_.clear();
+        extremes_.clear();
+        total_ = WindowedMoments();
+        open_ = Bucket();
+        open_start_ = 0;
+        clock_ = 0;
+        has_open_ = false;
+        evictions_ = 0;
+    }
+
+    // `now_ns` must come from the clock used for queries. Late samples
+    // still inside the window are folded into the newest bucket.
+    void add(uint64_t now_ns, double value) {
+        if (now_ns + window_ns_ < clock_) return;
+        advance(now_ns);
+        if (!has_open_) {
+            open_start_ = clock_ - clock_ % width_ns_;
+            has_open_ = true;
+        }
+        open_.moments.add(value);
+        open_.extremes.add(value);
+        total_.add(value);
+    }
+
+    // Without `extremes` only count, mean and stddev are filled in, which
+    // skips folding the per-bucket sketches
+    WindowStatistics query(uint64_t now_ns, bool extremes = true) {
+        advance(now_ns);
+        WindowStatistics stats;
+        stats.window_ns = window_ns_;
+        stats.count = total_.count;
+        if (total_.count == 0) return stats;
+
+        stats.mean = total_.mean;
+        stats.stddev = total_.stddev();
+        if (!extremes) return stats;
+
+        WindowExtremes folded;
+        foldExtremes(folded);
+        stats.min = folded.min;
+        stats.max = folded.max;
+        stats.p50 = folded.sketch.quantile(0.50);
+        stats.p90 = folded.sketch.quantile(0.90);
+        stats.p99 = folded.sketch.quantile(0.99);
+        return stats;
+    }
+
+    // Min, max and sketch over the window as of the last add() or query()
+    void foldExtremes(WindowExtremes& into) const {
+        into.merge(open_.extremes);
+        extremes_.foldInto(into);
+    }
+
+    uint64_t windowNs() const { return window_ns_; }
+    uint64_t bucketNs() const { return width_ns_; }
+
+private:
+    struct Bucket {
+        WindowedMoments moments;
+        WindowExtremes extremes;
+    };
+
+    struct ClosedBucket {
+        uint64_t start;
+        WindowedMoments moments;
+    };
+
+    void advance(uint64_t now_ns) {
+        if (now_ns < clock_) return;
+        clock_ = now_ns;
+        if (has_open_ && now_ns >= open_start_ + width_ns_) {
+            if (open_.moments.count > 0) {
+                closed_.push_back(ClosedBucket{open_start_, open_.moments});
+                extremes_.push(open_.extremes);
+            }
+            open_ = Bucket();
+            has_open_ = false;
+        }
+        uint64_t horizon = now_ns > window_ns_ ? now_ns - window_ns_ : 0;
+        size_t expired = 0;
+        while (expired < closed_.size() && closed_[expired].start + width_ns_ <= horizon) {
+            total_.subtract(closed_[expired].moments);
+            extremes_.pop();
+            ++expired;
+        }
+        if (expired > 0) {
+            closed_.erase(closed_.begin(), closed_.begin() + static_cast<std::ptrdiff_t>(expired));
+            evictions_ += expired;
+            // Re-derive the running moments now and then so repeated
+            // subtraction cannot accumulate rounding error
+            if (evictions_ >= closed_.size() + 1) rebuild_total();
+        }
+    }
+
+    void rebuild_total() {
+        total_ = open_.moments;
+        for (const auto& bucket : closed_) total_.merge(bucket.moments);
+        evictions_ = 0;
+    }
+
+    uint64_t window_ns_ = 0;
+    uint64_t width_ns_ = 0;
+    std::vector<ClosedBucket> closed_;  // oldest first, at most ~buckets long
+    TwoStackQueue<WindowExtremes> extremes_;
+    WindowedMoments total_;
+    Bucket open_;
+    uint64_t open_start_ = 0;
+    uint64_t clock_ = 0;  // newest timestamp seen
+    bool has_open_ = false;
+    size_t evictions_ = 0;
+};
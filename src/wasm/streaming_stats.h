@@ -0,0 +1,284 @@
+// streaming_stats.h
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "byte_buffer.h"
+
+// Single-pass moments up to the fourth (Welford/Pebay) with exact
+// pairwise merge, so accumulators from different monitors combine
+// without revisiting samples.
+struct RunningMoments {
+    uint64_t count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+    double m3 = 0.0;
+    double m4 = 0.0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+
+    void add(double x) {
+        uint64_t n1 = count;
+        ++count;
+        double n = static_cast<double>(count);
+        double delta = x - mean;
+        double delta_n = delta / n;
+        double delta_n2 = delta_n * delta_n;
+        double term1 = delta * delta_n * n1;
+        mean += delta_n;
+        m4 += term1 * delta_n2 * (n * n - 3 * n + 3) + 6 * delta_n2 * m2 - 4 * delta_n * m3;
+        m3 += term1 * delta_n * (n - 2) - 3 * delta_n * m2;
+        m2 += term1;
+        if (x < min) min = x;
+        if (x > max) max = x;
+    }
+
+    void merge(const RunningMoments& other) {
+        if (other.count == 0) return;
+        if (count == 0) {
+            *this = other;
+            return;
+        }
+        double na = static_cast<double>(count);
+        double nb = static_cast<double>(other.count);
+        double n = na + nb;
+        double delta = other.mean - mean;
+        double delta2 = delta * delta;
+
+        double merged_m2 = m2 + other.m2 + delta2 * na * nb / n;
+        double merged_m3 = m3 + other.m3 + delta * delta2 * na * nb * (na - nb) / (n * n) +
+                           3.0 * delta * (na * other.m2 - nb * m2) / n;
+        double merged_m4 = m4 + other.m4 +
+                           delta2 * delta2 * na * nb * (na * na - na * nb + nb * nb) / (n * n * n) +
+                           6.0 * delta2 * (na * na * other.m2 + nb * nb * m2) / (n * n) +
+                           4.0 * delta * (na * other.m3 - nb * m3) / n;
+
+        mean += delta * nb / n;
+        m2 = merged_m2;
+        m3 = merged_m3;
+        m4 = merged_m4;
+        count += other.count;
+        if (other.min < min) min = other.min;
+        if (other.max > max) max = other.max;
+    }
+
+    // Population variance, matching computeStatistics
+    double variance() const {
+        return count > 0 ? m2 / count : 0.0;
+    }
+
+    double sampleVariance() const {
+        return count > 1 ? m2 / (count - 1) : 0.0;
+    }
+
+    double stddev() const {
+        return std::sqrt(variance());
+    }
+
+    double skewness() const {
+        if (count < 2 || m2 <= 0.0) return 0.0;
+        return std::sqrt(static_cast<double>(count)) * m3 / std::pow(m2, 1.5);
+    }
+
+    // Excess kurtosis
+    double kurtosis() const {
+        if (count < 2 || m2 <= 0.0) return 0.0;
+        return static_cast<double>(count) * m4 / (m2 * m2) - 3.0;
+    }
+
+    void write(ByteWriter& writer) const {
+        writer.put(count);
+        writer.put(mean);
+        writer.put(m2);
+        writer.put(m3);
+        writer.put(m4);
+        writer.put(min);
+        writer.put(max);
+    }
+
+    void read(ByteReader& reader) {
+        count = reader.get<uint64_t>();
+        mean = reader.get<double>();
+        m2 = reader.get<double>();
+        m3 = reader.get<double>();
+        m4 = reader.get<double>();
+        min = reader.get<double>();
+        max = reader.get<double>();
+    }
+};
+
+inline void writeMomentSeries(ByteWriter& writer, const std::vector<RunningMoments>& series) {
+    writer.put<uint64_t>(series.size());
+    for (const auto& moments : series) moments.write(writer);
+}
+
+inline void readMomentSeries(ByteReader& reader, std::vector<RunningMoments>& series) {
+    uint64_t size = reader.get<uint64_t>();
+    // Each encoded RunningMoments is 56 bytes; reject impossible sizes early
+    if (reader.failed() || size > reader.remaining() / 56) {
+        series.clear();
+        reader.fail();
+        return;
+    }
+    series.resize(static_cast<size_t>(size));
+    for (auto& moments : series) moments.read(reader);
+}
+
+inline void mergeMomentSeries(std::vector<RunningMoments>& into,
+                              const std::vector<RunningMoments>& from) {
+    if (into.size() < from.size()) into.resize(from.size());
+    for (size_t i = 0; i < from.size(); ++i) into[i].merge(from[i]);
+}
+
+// Welch's t statistic between two populations; 0 when undefined.
+inline double welchT(const RunningMoments& a, const RunningMoments& b) {
+    if (a.count < 2 || b.count < 2) return 0.0;
+    double se = a.sampleVariance() / a.count + b.sampleVariance() / b.count;
+    if (se <= 0.0) return 0.0;
+    return (a.mean - b.mean) / std::sqrt(se);
+}
+
+// Log-bucketed histogram with relative-error quantiles (DDSketch style).
+// Bucket i covers (gamma^(i-1), gamma^i]; non-positive values share a zero
+// bucket. Merging is exact bucket addition, so merged quantiles keep the
+// same relative accuracy as a single sketch.
+class QuantileSketch {
+public:
+    static constexpr double kRelativeAccuracy = 0.01;
+
+    void add(double x, uint64_t weight = 1) {
+        total_ += weight;
+        if (!(x > kMinValue)) {
+            zero_count_ += weight;
+            return;
+        }
+        int32_t index = bucket_index(std::min(x, kMaxValue));
+        ensure(index);
+        bins_[index - offset_] += weight;
+    }
+
+    void merge(const QuantileSketch& other) {
+        total_ += other.total_;
+        zero_count_ += other.zero_count_;
+        if (other.bins_.empty()) return;
+        ensure(other.offset_);
+        ensure(other.offset_ + static_cast<int32_t>(other.bins_.size()) - 1);
+        for (size_t i = 0; i < other.bins_.size(); ++i) {
+            bins_[other.offset_ + static_cast<int32_t>(i) - offset_] += other.bins_[i];
+        }
+    }
+
+    double quantile(double q) const {
+        if (total_ == 0) return 0.0;
+        q = std::min(1.0, std::max(0.0, q));
+        double rank = q * static_cast<double>(total_ - 1);
+        double seen = static_cast<double>(zero_count_);
+        if (rank < seen) return 0.0;
+        for (size_t i = 0; i < bins_.size(); ++i) {
+            seen += static_cast<double>(bins_[i]);
+            if (rank < seen) return bucket_value(offset_ + static_cast<int32_t>(i));
+        }
+        return bins_.empty() ? 0.0 : bucket_value(offset_ + static_cast<int32_t>(bins_.size()) - 1);
+    }
+
+    // quantile() for every entry of the ascending `qs`, in one pass
+    void quantiles(const std::vector<double>& qs, std::vector<double>& out) const {
+        out.assign(qs.size(), 0.0);
+        if (total_ == 0) return;
+        double seen = static_cast<double>(zero_count_);
+        size_t bin = 0;
+        for (size_t k = 0; k < qs.size(); ++k) {
+            double q = std::min(1.0, std::max(0.0, qs[k]));
+            double rank = q * static_cast<double>(total_ - 1);
+            if (rank < static_cast<double>(zero_count_)) continue;
+            while (bin < bins_.size() && !(rank < seen + static_cast<double>(bins_[bin]))) {
+                seen += static_cast<double>(bins_[bin]);
+                ++bin;
+            }
+            size_t index = bin < bins_.size() ? bin : bins_.size() - 1;
+            out[k] = bins_.empty() ? 0.0 : bucket_value(offset_ + static_cast<int32_t>(index));
+        }
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t zeroCount() const { return zero_count_; }
+
+    // Sparse view for incremental transfer: (index, count) of non-empty
+    // buckets, bucket i covering (gamma()^(i-1), gamma()^i]
+    template <typename Fn>
+    void forEachBin(Fn&& fn) const {
+        for (size_t i = 0; i < bins_.size(); ++i) {
+            if (bins_[i] != 0) fn(offset_ + static_cast<int32_t>(i), bins_[i]);
+        }
+    }
+
+    static double gamma() {
+        return (1.0 + kRelativeAccuracy) / (1.0 - kRelativeAccuracy);
+    }
+
+    // Histogram view: (bucket upper bound, count) for non-empty buckets
+    template <typename Fn>
+    void forEachBucket(Fn&& fn) const {
+        for (size_t i = 0; i < bins_.size(); ++i) {
+            if (bins_[i] == 0) continue;
+            fn(std::pow(gamma(), offset_ + static_cast<int32_t>(i)), bins_[i]);
+        }
+    }
+
+    void write(ByteWriter& writer) const {
+        writer.put(total_);
+        writer.put(zero_count_);
+        writer.put(offset_);
+        writer.putVector(bins_);
+    }
+
+    void read(ByteReader& reader) {
+        total_ = reader.get<uint64_t>();
+        zero_count_ = reader.get<uint64_t>();
+        offset_ = reader.get<int32_t>();
+        reader.getVector(bins_);
+        // Bound the index range so a corrupt summary cannot force a huge merge
+        int64_t last = static_cast<int64_t>(offset_) + static_cast<int64_t>(bins_.size());
+        if (offset_ < -kMaxIndex || last > kMaxIndex) {
+            bins_.clear();
+            reader.fail();
+        }
+    }
+
+private:
+    static constexpr double kMinValue = 1e-9;
+    static constexpr double kMaxValue = 1e300;
+    static constexpr int32_t kMaxIndex = 40000;  // > log_gamma(kMaxValue)
+
+    static int32_t bucket_index(double x) {
+        static const double inv_log_gamma = 1.0 / std::log(gamma());
+        return static_cast<int32_t>(std::ceil(std::log(x) * inv_log_gamma));
+    }
+
+    static double bucket_value(int32_t index) {
+        return 2.0 * std::pow(gamma(), index) / (gamma() + 1.0);
+    }
+
+    void ensure(int32_t index) {
+        if (bins_.empty()) {
+            offset_ = index;
+            bins_.assign(1, 0);
+            return;
+        }
+        if (index < offset_) {
+            bins_.insert(bins_.begin(), static_cast<size_t>(offset_ - index), 0);
+            offset_ = index;
+        } else if (index >= offset_ + static_cast<int32_t>(bins_.size())) {
+            bins_.resize(static_cast<size_t>(index - offset_ + 1), 0);
+        }
+    }
+
+    uint64_t total_ = 0;
+    uint64_t zero_count_ = 0;
+    int32_t offset_ = 0;
+    std::vector<uint64_t> bins_;
+};
@@ -0,0 +1,308 @@
+// template_attack.h
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// In-place Cholesky factorization A = L L^T of a symmetric positive
+// definite row-major matrix; the lower triangle of `a` becomes L and the
+// upper triangle is zeroed. Returns false when a pivot is not positive.
+inline bool choleskyFactor(std::vector<double>& a, size_t n) {
+    for (size_t j = 0; j < n; ++j) {
+        double diagonal = a[j * n + j];
+        for (size_t k = 0; k < j; ++k) diagonal -= a[j * n + k] * a[j * n + k];
+        if (!(diagonal > 0.0)) return false;
+        double pivot = std::sqrt(diagonal);
+        a[j * n + j] = pivot;
+        for (size_t i = j + 1; i < n; ++i) {
+            double value = a[i * n + j];
+            for (size_t k = 0; k < j; ++k) value -= a[i * n + k] * a[j * n + k];
+            a[i * n + j] = value / pivot;
+        }
+        for (size_t k = j + 1; k < n; ++k) a[j * n + k] = 0.0;
+    }
+    return true;
+}
+
+// Solves L y = x for lower-triangular row-major L
+inline void forwardSubstitute(const std::vector<double>& l, size_t n, const double* x, double* y) {
+    for (size_t i = 0; i < n; ++i) {
+        const double* row = &l[i * n];
+        double value = x[i];
+        for (size_t k = 0; k < i; ++k) value -= row[k] * y[k];
+        y[i] = value / row[i];
+    }
+}
+
+// Gaussian templates with a pooled covariance, ready for scoring. The
+// covariance is factored once as L L^T and every class mean whitened to
+// m_c = L^-1 mu_c, so a trace costs one triangular solve y = L^-1 x and
+// its log-likelihood under class c is
+//   constant - (|y|^2 - 2 y.m_c + |m_c|^2) / 2,
+// leaving the y.m_c products for all traces and classes as one matrix
+// product, done in batches.
+struct TemplateSet {
+    static constexpr size_t kBatch = 64;
+
+    std::vector<uint32_t> points;   // indices into the source trace
+    std::vector<uint32_t> labels;   // class of each template
+    std::vector<uint64_t> counts;   // profiling traces per class
+    std::vector<double> means;      // [classes x dims]
+    std::vector<double> covariance; // pooled, [dims x dims]
+    std::vector<double> cholesky;   // lower factor of covariance
+    std::vector<double> whitened;   // m_c transposed, [dims x classes]
+    std::vector<double> mean_norms; // |m_c|^2
+    double constant = 0.0;          // -(dims log 2pi + log det) / 2
+    double ridge = 0.0;             // added to the diagonal to factor
+
+    size_t dims() const { return points.size(); }
+    size_t classes() const { return labels.size(); }
+    bool empty() const { return labels.empty(); }
+
+    // out[t * classes() + c] = log N(trace t; mu_c, Sigma). Traces are
+    // row-major [count x length] in the source layout; POIs are gathered
+    // here, and traces shorter than the largest POI score -inf throughout.
+    void score(const double* traces, size_t count, size_t length, double* out) const {
+        const size_t d = dims(), c_count = classes();
+        if (empty()) return;
+        size_t needed = d ? size_t(*std::max_element(points.begin(), points.end())) + 1 : 0;
+        std::vector<double> gathered(d), y(kBatch * d), norms(kBatch);
+
+        for (size_t begin = 0; begin < count; begin += kBatch) {
+            const size_t batch = std::min(kBatch, count - begin);
+            for (size_t t = 0; t < batch; ++t) {
+                const double* trace = traces + (begin + t) * length;
+                double* yt = &y[t * d];
+                if (length < needed) {
+                    std::fill(yt, yt + d, 0.0);
+                    norms[t] = std::numeric_limits<double>::infinity();
+                    continue;
+                }
+                for (size_t k = 0; k < d; ++k) gathered[k] = trace[points[k]];
+                forwardSubstitute(cholesky, d, gathered.data(), yt);
+                double norm = 0.0;
+                for (size_t k = 0; k < d; ++k) norm += yt[k] * yt[k];
+                norms[t] = norm;
+            }
+            cross_products(y.data(), batch, out + begin * c_count);
+            for (size_t t = 0; t < batch; ++t) {
+                double* row = out + (begin + t) * c_count;
+                for (size_t c = 0; c < c_count; ++c) {
+                    row[c] = constant - 0.5 * (norms[t] - 2.0 * row[c] + mean_norms[c]);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr size_t kRows = 4;
+    static constexpr size_t kCols = 8;
+
+    // out[t][c] = y_t . m_c, in kRows x kCols register patches with the
+    // class index innermost over the transposed means
+    void cross_products(const double* y, size_t batch, double* out) const {
+        const size_t d = dims(), c_count = classes();
+        size_t t = 0;
+        for (; t + kRows <= batch; t += kRows) {
+            size_t c = 0;
+            for (; c + kCols <= c_count; c += kCols) {
+                double acc[kRows][kCols] = {};
+                for (size_t k = 0; k < d; ++k) {
+                    const double* m = &whitened[k * c_count + c];
+                    for (size_t r = 0; r < kRows; ++r) {
+                        const double v = y[(t + r) * d + k];
+                        for (size_t j = 0; j < kCols; ++j) acc[r][j] += v * m[j];
+                    }
+                }
+                for (size_t r = 0; r < kRows; ++r) {
+                    for (size_t j = 0; j < kCols; ++j) out[(t + r) * c_count + c + j] = acc[r][j];
+                }
+            }
+            cross_products_edge(y, t, t + kRows, c, c_count, out);
+        }
+        cross_products_edge(y, t, batch, 0, c_count, out);
+    }
+
+    void cross_products_edge(const double* y, size_t t_begin, size_t t_end, size_t c_begin,
+                             size_t c_end, double* out) const {
+        const size_t d = dims(), c_count = classes();
+        for (size_t t = t_begin; t < t_end; ++t) {
+            for (size_t c = c_begin; c < c_end; ++c) {
+                double dot = 0.0;
+                for (size_t k = 0; k < d; ++k) dot += y[t * d + k] * whitened[k * c_count + c];
+                out[t * c_count + c] = dot;
+            }
+        }
+    }
+};
+
+// Profiling side: per-class sums and one cross-product matrix over the
+// selected points, labels being the low byte of the record label. Values
+// are shifted by the first trace's so the pooled covariance,
+//   (sum x x^T - sum_c n_c mu_c mu_c^T) / (N - classes),
+// does not cancel catastrophically. Points must lie within `length`, the
+// longest trace profiled; otherwise the builder takes no points and
+// build() comes back empty.
+class TemplateBuilder {
+public:
+    TemplateBuilder(std::vector<uint32_t> points, size_t length) : points_(std::move(points)) {
+        if (!points_.empty()) {
+            needed_ = size_t(*std::max_element(points_.begin(), points_.end())) + 1;
+        }
+        if (needed_ > length) {
+            points_.clear();
+            needed_ = 0;
+        }
+        const size_t d = points_.size();
+        cross_.assign(d * d, 0.0);
+        x_.resize(d);
+    }
+
+    void add(uint8_t label, const double* trace, size_t length) {
+        const size_t d = points_.size();
+        if (d == 0 || length < needed_) return;
+        if (count_ == 0) {
+            shift_.resize(d);
+            for (size_t k = 0; k < d; ++k) shift_[k] = trace[points_[k]];
+        }
+        for (size_t k = 0; k < d; ++k) x_[k] = trace[points_[k]] - shift_[k];
+
+        ClassSums& state = classes_[label];
+        if (state.sum.empty()) state.sum.assign(d, 0.0);
+        ++state.count;
+        ++count_;
+        for (size_t k = 0; k < d; ++k) state.sum[k] += x_[k];
+        for (size_t i = 0; i < d; ++i) {
+            double* row = &cross_[i * d];
+            const double xi = x_[i];
+            for (size_t j = 0; j <= i; ++j) row[j] += xi * x_[j];
+        }
+    }
+
+    uint64_t count() const { return count_; }
+
+    // Empty when there are fewer traces than classes + 1 or the covariance
+    // cannot be factored even with a ridge
+    TemplateSet build() const {
+        TemplateSet set;
+        const size_t d = points_.size();
+        size_t class_count = 0;
+        for (const ClassSums& state : classes_) class_count += state.count > 0;
+        if (d == 0 || class_count == 0 || count_ <= class_count) return set;
+
+        set.points = points_;
+        std::vector<double> scatter(d * d);
+        for (size_t i = 0; i < d; ++i) {
+            for (size_t j = 0; j <= i; ++j) scatter[i * d + j] = cross_[i * d + j];
+        }
+        for (uint32_t label = 0; label < classes_.size(); ++label) {
+            const ClassSums& state = classes_[label];
+            if (state.count == 0) continue;
+            set.labels.push_back(label);
+            set.counts.push_back(state.count);
+            const double n = static_cast<double>(state.count);
+            for (size_t i = 0; i < d; ++i) {
+                for (size_t j = 0; j <= i; ++j) scatter[i * d + j] -= state.sum[i] * state.sum[j] / n;
+            }
+            for (size_t k = 0; k < d; ++k) set.means.push_back(shift_[k] + state.sum[k] / n);
+        }
+        const double dof = static_cast<double>(count_ - class_count);
+        set.covariance.assign(d * d, 0.0);
+        double trace = 0.0;
+        for (size_t i = 0; i < d; ++i) {
+            for (size_t j = 0; j <= i; ++j) {
+                double c = scatter[i * d + j] / dof;
+                set.covariance[i * d + j] = c;
+                set.covariance[j * d + i] = c;
+            }
+            trace += set.covariance[i * d + i];
+        }
+
+        // Constant or collinear points leave the covariance singular; a
+        // growing ridge keeps the rest usable
+        double ridge = 0.0;
+        double base = trace > 0 ? trace / d : 1.0;
+        for (int attempt = 0; attempt < 12; ++attempt) {
+            set.cholesky = set.covariance;
+            for (size_t i = 0; i < d; ++i) set.cholesky[i * d + i] += ridge;
+            if (choleskyFactor(set.cholesky, d)) break;
+            set.cholesky.clear();
+            ridge = ridge == 0.0 ? base * 1e-10 : ridge * 100.0;
+        }
+        if (set.cholesky.empty()) return TemplateSet();
+        set.ridge = ridge;
+
+        const double log_2pi = std::log(2.0 * 3.14159265358979323846);
+        double log_det = 0.0;
+        for (size_t i = 0; i < d; ++i) log_det += 2.0 * std::log(set.cholesky[i * d + i]);
+        set.constant = -0.5 * (d * log_2pi + log_det);
+
+        const size_t c_count = set.labels.size();
+        set.whitened.assign(d * c_count, 0.0);
+        set.mean_norms.assign(c_count, 0.0);
+        std::vector<double> m(d);
+        for (size_t c = 0; c < c_count; ++c) {
+            forwardSubstitute(set.cholesky, d, &set.means[c * d], m.data());
+            for (size_t k = 0; k < d; ++k) {
+                set.whitened[k * c_count + c] = m[k];
+                set.mean_norms[c] += m[k] * m[k];
+            }
+        }
+        return set;
+    }
+
+private:
+    struct ClassSums {
+        uint64_t count = 0;
+        std::vector<double> sum;
+    };
+
+    std::vector<uint32_t> points_;
+    size_t needed_ = 0;
+    uint64_t count_ = 0;
+    std::vector<double> shift_;
+    std::vector<double> x_;
+    std::vector<double> cross_;  // lower triangle
+    std::array<ClassSums, 256> classes_;
+};
+
+// Evidence from a set of attack traces: log-likelihoods summed per class
+struct TemplateMatch {
+    uint64_t trace_count = 0;
+    std::vector<uint32_t> labels;
+    std::vector<double> log_likelihood;
+    uint32_t best_label = 0;
+    double margin = 0.0;  // best minus runner-up
+};
+
+inline TemplateMatch summarizeTemplateScores(const TemplateSet& set, const double* scores,
+                                             size_t count) {
+    TemplateMatch match;
+    match.labels = set.labels;
+    match.log_likelihood.assign(set.classes(), 0.0);
+    for (size_t t = 0; t < count; ++t) {
+        const double* row = scores + t * set.classes();
+        if (!std::isfinite(row[0])) continue;
+        for (size_t c = 0; c < set.classes(); ++c) match.log_likelihood[c] += row[c];
+        ++match.trace_count;
+    }
+    if (set.empty()) return match;
+    size_t best = 0;
+    double runner_up = -std::numeric_limits<double>::infinity();
+    for (size_t c = 1; c < set.classes(); ++c) {
+        if (match.log_likelihood[c] > match.log_likelihood[best]) {
+            runner_up = match.log_likelihood[best];
+            best = c;
+        } else {
+            runner_up = std::max(runner_up, match.log_likelihood[c]);
+        }
+    }
+    match.best_label = set.labels[best];
+    match.margin = std::isfinite(runner_up) ? match.log_likelihood[best] - runner_up : 0.0;
+    return match;
+}
@@ -0,0 +1,84 @@
+// thread_event_buffer.h
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-size record of an operation that has already finished. This is what
+// the lock-free recording path stores; it carries timing, key size and the
+// class label. The layout is also the wire format of event batches, so it
+// must stay 32 packed bytes.
+struct CompletedOperation {
+    uint32_t op;
+    uint32_t label;
+    uint64_t key_size;
+    uint64_t start_cycle;
+    uint64_t end_cycle;
+};
+
+// Single-producer / single-consumer ring owned by one recording thread.
+// The producer never blocks or allocates: when the ring is full the record
+// is counted as dropped instead.
+//
+// The recording thread and the draining monitor own the buffer jointly:
+// each calls release() once when it lets go, and the second call frees it.
+// A consumer that sees producerGone() before a drain has everything the
+// thread will ever push and can release its side afterwards.
+class ThreadEventBuffer {
+public:
+    static constexpr size_t kCapacity = 1 << 15;  // power of two
+
+    enum Owner : uint8_t { PRODUCER = 1, CONSUMER = 2 };
+
+    static void release(ThreadEventBuffer* buffer, Owner owner) {
+        uint8_t previous = buffer->released_.fetch_or(owner, std::memory_order_acq_rel);
+        if (previous != 0 && (previous & owner) == 0) delete buffer;
+    }
+
+    bool producerGone() const {
+        return released_.load(std::memory_order_acquire) & PRODUCER;
+    }
+
+    bool consumerGone() const {
+        return released_.load(std::memory_order_acquire) & CONSUMER;
+    }
+
+    bool push(const CompletedOperation& event) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head - cached_tail_ >= kCapacity) {
+            // Only touch the consumer's cache line when we look full
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head - cached_tail_ >= kCapacity) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        ring_[head & (kCapacity - 1)] = event;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <typename Sink>
+    size_t drain(Sink&& sink) {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        uint64_t head = head_.load(std::memory_order_acquire);
+        for (uint64_t i = tail; i < head; ++i) {
+            sink(ring_[i & (kCapacity - 1)]);
+        }
+        tail_.store(head, std::memory_order_release);
+        return static_cast<size_t>(head - tail);
+    }
+
+    uint64_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+private:
+    alignas(64) std::atomic<uint64_t> head_{0};
+    uint64_t cached_tail_ = 0;  // producer-private
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint8_t> released_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    CompletedOperation ring_[kCapacity];
+};
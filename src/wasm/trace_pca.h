@@ -0,0 +1,321 @@
+// trace_pca.h
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Mean and covariance across trace points, accumulated as traces arrive.
+// Traces are shifted by the first one (so large offsets do not cancel
+// catastrophically), buffered kBlockRows at a time and folded into the
+// cross-product matrix as one rank-kBlockRows update. The update walks
+// kTile x kTile tiles so the block columns it touches stay in cache, and
+// within a tile sums kRows x kCols patches over all buffered rows in
+// registers before touching the matrix; the inner loops are contiguous
+// multiply-adds the compiler vectorizes. Only tiles on or above the
+// diagonal are updated. Memory is
+// points^2 doubles, so reduce very long traces (e.g. to points of
+// interest) first. The first trace fixes the length; shorter traces are
+// skipped and longer ones truncated.
+class CovarianceAccumulator {
+public:
+    static constexpr size_t kBlockRows = 32;
+    static constexpr size_t kTile = 64;
+    static constexpr size_t kRows = 4;  // register tile of the update
+    static constexpr size_t kCols = 8;
+
+    void add(const double* trace, size_t length) {
+        if (points_ == 0) {
+            if (length == 0) return;
+            points_ = length;
+            shift_.assign(trace, trace + points_);
+            sum_.assign(points_, 0.0);
+            cross_.assign(points_ * points_, 0.0);
+            block_.assign(kBlockRows * points_, 0.0);
+        }
+        if (length < points_) return;
+
+        double* row = &block_[pending_ * points_];
+        for (size_t p = 0; p < points_; ++p) {
+            row[p] = trace[p] - shift_[p];
+            sum_[p] += row[p];
+        }
+        ++count_;
+        if (++pending_ == kBlockRows) flush();
+    }
+
+    uint64_t count() const { return count_; }
+    size_t points() const { return points_; }
+
+    // Sample covariance, full symmetric points x points, row-major
+    void finish(std::vector<double>& mean, std::vector<double>& covariance) {
+        flush();
+        const size_t n = points_;
+        mean.assign(n, 0.0);
+        covariance.assign(n * n, 0.0);
+        if (count_ == 0) return;
+
+        const double count = static_cast<double>(count_);
+        const double denom = count_ > 1 ? count - 1.0 : 1.0;
+        for (size_t i = 0; i < n; ++i) mean[i] = shift_[i] + sum_[i] / count;
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = i; j < n; ++j) {
+                double c = (cross_[i * n + j] - sum_[i] * sum_[j] / count) / denom;
+                covariance[i * n + j] = c;
+                covariance[j * n + i] = c;
+            }
+        }
+    }
+
+private:
+    void flush() {
+        if (pending_ == 0) return;
+        const size_t n = points_;
+        for (size_t ti = 0; ti < n; ti += kTile) {
+            const size_t ti_end = std::min(ti + kTile, n);
+            for (size_t tj = ti; tj < n; tj += kTile) {
+                const size_t tj_end = std::min(tj + kTile, n);
+                size_t i = ti;
+                for (; i + kRows <= ti_end; i += kRows) {
+                    size_t j = tj;
+                    for (; j + kCols <= tj_end; j += kCols) update_block(i, j);
+                    update_edge(i, i + kRows, j, tj_end);
+                }
+                update_edge(i, ti_end, tj, tj_end);
+            }
+        }
+        pending_ = 0;
+    }
+
+    // kRows x kCols of the cross products summed over every pending row in
+    // registers, then added to the matrix once
+    void update_block(size_t i, size_t j) {
+        const size_t n = points_;
+        double acc[kRows][kCols] = {};
+        for (size_t r = 0; r < pending_; ++r) {
+            const double* row = &block_[r * n];
+            for (size_t a = 0; a < kRows; ++a) {
+                const double x = row[i + a];
+                for (size_t b = 0; b < kCols; ++b) acc[a][b] += x * row[j + b];
+            }
+        }
+        for (size_t a = 0; a < kRows; ++a) {
+            double* out = &cross_[(i + a) * n + j];
+            for (size_t b = 0; b < kCols; ++b) out[b] += acc[a][b];
+        }
+    }
+
+    void update_edge(size_t i_begin, size_t i_end, size_t j_begin, size_t j_end) {
+        const size_t n = points_;
+        for (size_t i = i_begin; i < i_end; ++i) {
+            double* out = &cross_[i * n];
+            for (size_t r = 0; r < pending_; ++r) {
+                const double* row = &block_[r * n];
+                const double a = row[i];
+                for (size_t j = j_begin; j < j_end; ++j) out[j] += a * row[j];
+            }
+        }
+    }
+
+    size_t points_ = 0;
+    uint64_t count_ = 0;
+    size_t pending_ = 0;
+    std::vector<double> shift_;
+    std::vector<double> sum_;
+    std::vector<double> cross_;  // upper triangle valid
+    std::vector<double> block_;  // kBlockRows x points, shifted
+};
+
+// Top principal components of a set of traces. components is row-major
+// [count x points], each row unit length, ordered by decreasing variance.
+struct PrincipalComponents {
+    size_t points = 0;
+    uint64_t trace_count = 0;
+    std::vector<double> mean;
+    std::vector<double> components;
+    std::vector<double> eigenvalues;
+    double total_variance = 0.0;  // trace of the covariance
+    uint32_t iterations = 0;
+
+    size_t count() const { return eigenvalues.size(); }
+
+    // out[c] = <trace - mean, component c>; `trace` has `points` values
+    void project(const double* trace, double* out) const {
+        for (size_t c = 0; c < count(); ++c) {
+            const double* component = &components[c * points];
+            double dot = 0.0;
+            for (size_t p = 0; p < points; ++p) dot += (trace[p] - mean[p]) * component[p];
+            out[c] = dot;
+        }
+    }
+};
+
+// Cyclic Jacobi on a small dense symmetric matrix. On return `a` holds the
+// eigenvalues on its diagonal and `v` (row-major) the eigenvectors as
+// columns.
+inline void jacobiEigen(std::vector<double>& a, std::vector<double>& v, size_t n) {
+    v.assign(n * n, 0.0);
+    for (size_t i = 0; i < n; ++i) v[i * n + i] = 1.0;
+    for (int sweep = 0; sweep < 100; ++sweep) {
+        double off = 0.0, scale = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            scale += a[i * n + i] * a[i * n + i];
+            for (size_t j = i + 1; j < n; ++j) off += a[i * n + j] * a[i * n + j];
+        }
+        if (off <= 1e-30 * scale || off == 0.0) return;
+        for (size_t p = 0; p < n; ++p) {
+            for (size_t q = p + 1; q < n; ++q) {
+                double apq = a[p * n + q];
+                if (apq == 0.0) continue;
+                double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+                double t = (theta >= 0 ? 1.0 : -1.0) /
+                           (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                double c = 1.0 / std::sqrt(t * t + 1.0), s = t * c;
+                for (size_t k = 0; k < n; ++k) {
+                    double akp = a[k * n + p], akq = a[k * n + q];
+                    a[k * n + p] = c * akp - s * akq;
+                    a[k * n + q] = s * akp + c * akq;
+                }
+                for (size_t k = 0; k < n; ++k) {
+                    double apk = a[p * n + k], aqk = a[q * n + k];
+                    a[p * n + k] = c * apk - s * aqk;
+                    a[q * n + k] = s * apk + c * aqk;
+                }
+                for (size_t k = 0; k < n; ++k) {
+                    double vkp = v[k * n + p], vkq = v[k * n + q];
+                    v[k * n + p] = c * vkp - s * vkq;
+                    v[k * n + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+}
+
+// Top `k` eigenpairs of a symmetric covariance by subspace iteration with
+// Rayleigh-Ritz: each step multiplies a block of k + 8 orthonormal vectors
+// by the matrix (O(points^2) per vector, rows streamed once) and solves
+// the small projected problem with Jacobi, stopping when the top k Ritz
+// values settle.
+inline PrincipalComponents principalComponents(const std::vector<double>& mean,
+                                               const std::vector<double>& covariance,
+                                               uint64_t trace_count, size_t k,
+                                               uint32_t max_iterations = 300,
+                                               double tolerance = 1e-10) {
+    PrincipalComponents pca;
+    const size_t n = mean.size();
+    pca.points = n;
+    pca.trace_count = trace_count;
+    pca.mean = mean;
+    for (size_t i = 0; i < n; ++i) pca.total_variance += covariance[i * n + i];
+    k = std::min(k, n);
+    if (k == 0 || trace_count < 2) return pca;
+
+    const size_t m = std::min(n, k + 8);
+    // basis[c * n + i], column-major so each vector is contiguous
+    std::vector<double> basis(m * n), product(m * n), ritz(m * n), next(m * n);
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    for (double& x : basis) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        x = static_cast<double>(state >> 11) * 0x1.0p-53 - 0.5;
+    }
+
+    auto orthonormalize = [&](std::vector<double>& vectors) {
+        for (size_t c = 0; c < m; ++c) {
+            double* vc = &vectors[c * n];
+            for (int pass = 0; pass < 2; ++pass) {
+                for (size_t d = 0; d < c; ++d) {
+                    const double* vd = &vectors[d * n];
+                    double dot = 0.0;
+                    for (size_t i = 0; i < n; ++i) dot += vc[i] * vd[i];
+                    for (size_t i = 0; i < n; ++i) vc[i] -= dot * vd[i];
+                }
+            }
+            double norm = 0.0;
+            for (size_t i = 0; i < n; ++i) norm += vc[i] * vc[i];
+            norm = std::sqrt(norm);
+            if (norm > 0) {
+                for (size_t i = 0; i < n; ++i) vc[i] /= norm;
+            } else {
+                vc[c % n] = 1.0;  // degenerate direction; any unit vector will do
+            }
+        }
+    };
+
+    orthonormalize(basis);
+    std::vector<double> h(m * m), v, previous(k, 0.0), values(m);
+    std::vector<size_t> order(m);
+    for (uint32_t iteration = 1; iteration <= max_iterations; ++iteration) {
+        // product = A * basis, one matrix row at a time against all vectors
+        for (size_t i = 0; i < n; ++i) {
+            const double* row = &covariance[i * n];
+            for (size_t c = 0; c < m; ++c) {
+                const double* vc = &basis[c * n];
+                double dot = 0.0;
+                for (size_t j = 0; j < n; ++j) dot += row[j] * vc[j];
+                product[c * n + i] = dot;
+            }
+        }
+        for (size_t a = 0; a < m; ++a) {
+            for (size_t b = a; b < m; ++b) {
+                double dot = 0.0;
+                for (size_t i = 0; i < n; ++i) dot += basis[a * n + i] * product[b * n + i];
+                h[a * m + b] = dot;
+                h[b * m + a] = dot;
+            }
+        }
+        jacobiEigen(h, v, m);
+        for (size_t c = 0; c < m; ++c) {
+            values[c] = h[c * m + c];
+            order[c] = c;
+        }
+        // Largest first, NaN (from NaN in the traces) last
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return values[a] > values[b] || (std::isnan(values[b]) && !std::isnan(values[a]));
+        });
+
+        // Ritz vectors basis * V, and the next basis A * basis * V
+        std::fill(ritz.begin(), ritz.end(), 0.0);
+        std::fill(next.begin(), next.end(), 0.0);
+        for (size_t c = 0; c < m; ++c) {
+            double* rc = &ritz[c * n];
+            double* nc = &next[c * n];
+            for (size_t d = 0; d < m; ++d) {
+                double w = v[d * m + order[c]];
+                const double* bd = &basis[d * n];
+                const double* pd = &product[d * n];
+                for (size_t i = 0; i < n; ++i) {
+                    rc[i] += w * bd[i];
+                    nc[i] += w * pd[i];
+                }
+            }
+        }
+
+        bool settled = true;
+        double scale = std::max(std::fabs(values[order[0]]), 1e-300);
+        for (size_t c = 0; c < k; ++c) {
+            if (std::fabs(values[order[c]] - previous[c]) > tolerance * scale) settled = false;
+            previous[c] = values[order[c]];
+        }
+        pca.iterations = iteration;
+        if (settled && iteration > 1) break;
+        basis.swap(next);
+        orthonormalize(basis);
+    }
+
+    pca.eigenvalues.assign(previous.begin(), previous.end());
+    pca.components.assign(ritz.begin(), ritz.begin() + k * n);
+    // Fix each sign so the largest-magnitude entry is positive
+    for (size_t c = 0; c < k; ++c) {
+        double* component = &pca.components[c * n];
+        size_t peak = 0;
+        for (size_t i = 1; i < n; ++i) {
+            if (std::fabs(component[i]) > std::fabs(component[peak])) peak = i;
+        }
+        if (component[peak] < 0) {
+            for (size_t i = 0; i < n; ++i) component[i] = -component[i];
+        }
+    }
+    return pca;
+}
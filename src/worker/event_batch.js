@@ -0,0 +1,97 @@
+// event_batch.js
+//
+// Batched event buffers for producers that cannot share the event ring,
+// such as page content scripts. Records have the ring's 32-byte
+// CompletedOperation layout, but timestamps are nanoseconds since the
+// producer's own performance.timeOrigin, which travels with the batch; the
+// ring's owner rebases them onto the epoch clock as it copies the batch in
+// (EventRingProducer.recordBatch). Keeping them relative lets the hot path
+// write two 32-bit halves instead of building BigInts.
+
+import { EVENT_RECORD_BYTES } from './event_ring.js';
+
+const WORDS = EVENT_RECORD_BYTES / 4;
+const TWO_32 = 4294967296;
+
+export class EventBatchWriter {
+  /**
+   * @param {number} capacity - Records per batch
+   */
+  constructor(capacity = 1024) {
+    this.capacity = capacity;
+    this.reset();
+  }
+
+  reset() {
+    this.buffer = new ArrayBuffer(this.capacity * EVENT_RECORD_BYTES);
+    this.words = new Uint32Array(this.buffer);
+    this.count = 0;
+  }
+
+  /**
+   * Append a record
+   * @param {number} op - Index from OPERATION_CODES
+   * @param {number} keySize - Key size in bits
+   * @param {number} startMs - performance.now() at the start
+   * @param {number} endMs - performance.now() at the end
+   * @param {number} label - Class label
+   * @returns {boolean} False when the batch is full
+   */
+  add(op, keySize, startMs, endMs, label = 0) {
+    if (this.count === this.capacity) return false;
+    const w = this.count * WORDS;
+    const start = Math.round(startMs * 1e6);
+    const end = Math.round(endMs * 1e6);
+    const words = this.words;
+    words[w] = op;
+    words[w + 1] = label;
+    words[w + 2] = keySize;
+    words[w + 4] = start >>> 0;
+    words[w + 5] = Math.floor(start / TWO_32);
+    words[w + 6] = end >>> 0;
+    words[w + 7] = Math.floor(end / TWO_32);
+    this.count++;
+    return true;
+  }
+
+  /**
+   * Hand over the filled records and start a new batch
+   * @returns {{buffer: ArrayBuffer, count: number, timeOrigin: number}|null}
+   */
+  take() {
+    if (this.count === 0) return null;
+    const batch = {
+      buffer: this.buffer.slice(0, this.count * EVENT_RECORD_BYTES),
+      count: this.count,
+      timeOrigin: performance.timeOrigin
+    };
+    this.count = 0;
+    return batch;
+  }
+}
+
+/**
+ * Extension messaging is JSON, so batches and other binary frames cross
+ * it as base64
+ * @param {ArrayBuffer} buffer - Packed records or frame
+ * @returns {string}
+ */
+export function toBase64(buffer) {
+  const bytes = new Uint8Array(buffer);
+  let binary = '';
+  for (let i = 0; i < bytes.length; i += 0x8000) {
+    binary += String.fromCharCode.apply(null, bytes.subarray(i, i + 0x8000));
+  }
+  return btoa(binary);
+}
+
+/**
+ * @param {string} text - From toBase64
+ * @returns {ArrayBuffer}
+ */
+export function fromBase64(text) {
+  const binary = atob(text);
+  const bytes = new Uint8Array(binary.length);
+  for (let i = 0; i < binary.length; i++) bytes[i] = binary.charCodeAt(i);
+  return bytes.buffer;
+}
@@ -0,0 +1,278 @@
+// event_ring.js
+//
+// Multi-producer / single-consumer ring of fixed-size event records in a
+// SharedArrayBuffer. Records use the layout of the monitor's
+// CompletedOperation (thread_event_buffer.h), so the consumer hands a
+// drained run to wasm with one copy:
+//
+//   u32 op | u32 label | u64 key_size | u64 start_ns | u64 end_ns
+//
+// Each slot carries a sequence number (Vyukov's bounded queue): a producer
+// claims a slot with one compare-exchange on the tail, writes the record
+// and publishes it by storing the sequence. A full ring counts the record
+// as dropped instead of blocking. The consumer releases slots by advancing
+// their sequence a lap ahead.
+//
+// A SharedArrayBuffer can only be shared within one agent cluster, which
+// for extension pages means they must be cross-origin isolated (see the
+// COOP/COEP keys in manifest.json).
+
+export const EVENT_RECORD_BYTES = 32;
+
+// Same order as EnhancedCryptoMonitor::CryptoOperation
+export const OPERATION_CODES = Object.freeze({
+  aes_encrypt: 0,
+  aes_decrypt: 1,
+  rsa_encrypt: 2,
+  rsa_decrypt: 3,
+  ecdsa_sign: 4,
+  ecdsa_verify: 5,
+  sha256_hash: 6,
+  key_derivation: 7
+});
+
+// Int32 indices into the header. Producer-written and consumer-written
+// fields sit on separate 64-byte lines.
+const TAIL = 0;
+const DROPPED = 1;
+const CAPACITY = 2;
+const HEAD = 16;
+const SLEEPING = 17;
+const DOORBELL = 18;
+const HEADER_BYTES = 128;
+const POLL_MS = 4;
+
+/**
+ * Allocate a ring
+ * @param {number} capacity - Record slots, rounded up to a power of two
+ * @returns {SharedArrayBuffer} Buffer to hand to producers and the consumer
+ */
+export function createEventRing(capacity = 1 << 14) {
+  let slots = 2;
+  while (slots < capacity) slots *= 2;
+  if (slots > 1 << 24) throw new RangeError('event ring capacity too large');
+  const buffer = new SharedArrayBuffer(HEADER_BYTES + slots * (4 + EVENT_RECORD_BYTES));
+  const header = new Int32Array(buffer, 0, HEADER_BYTES / 4);
+  header[CAPACITY] = slots;
+  const sequences = new Int32Array(buffer, HEADER_BYTES, slots);
+  for (let i = 0; i < slots; i++) sequences[i] = i;
+  return buffer;
+}
+
+function ringViews(buffer) {
+  const header = new Int32Array(buffer, 0, HEADER_BYTES / 4);
+  const capacity = Atomics.load(header, CAPACITY);
+  const recordOffset = HEADER_BYTES + capacity * 4;
+  return {
+    header,
+    capacity,
+    mask: capacity - 1,
+    sequences: new Int32Array(buffer, HEADER_BYTES, capacity),
+    recordOffset,
+    bytes: new Uint8Array(buffer, recordOffset, capacity * EVENT_RECORD_BYTES),
+    words: new Uint32Array(buffer, recordOffset, capacity * EVENT_RECORD_BYTES / 4),
+    longs: new BigUint64Array(buffer, recordOffset, capacity * EVENT_RECORD_BYTES / 8)
+  };
+}
+
+/**
+ * Nanoseconds since the Unix epoch on the shared wall clock, so records
+ * from different contexts (each with its own performance.timeOrigin) line
+ * up once the consumer maps them onto the monitor's clock
+ * @returns {bigint}
+ */
+export function epochNanoseconds() {
+  return millisecondsToNanoseconds(performance.timeOrigin + performance.now());
+}
+
+function millisecondsToNanoseconds(ms) {
+  const whole = Math.floor(ms);
+  return BigInt(whole) * 1000000n + BigInt(Math.round((ms - whole) * 1e6));
+}
+
+export class EventRingProducer {
+  /**
+   * @param {SharedArrayBuffer} buffer - Ring from createEventRing
+   */
+  constructor(buffer) {
+    Object.assign(this, ringViews(buffer));
+  }
+
+  /**
+   * Record a finished operation
+   * @param {number} op - Index from OPERATION_CODES
+   * @param {number} keySize - Key size in bits
+   * @param {bigint} startNs - From epochNanoseconds()
+   * @param {bigint} endNs - From epochNanoseconds()
+   * @param {number} label - Class label (TVLA group or known input byte)
+   * @returns {boolean} False when the ring was full and the record dropped
+   */
+  record(op, keySize, startNs, endNs, label = 0) {
+    const { header, sequences, mask } = this;
+    let position = Atomics.load(header, TAIL);
+    for (;;) {
+      const slot = position & mask;
+      const lag = (Atomics.load(sequences, slot) - position) | 0;
+      if (lag === 0) {
+        const seen = Atomics.compareExchange(header, TAIL, position, (position + 1) | 0);
+        if (seen === position) break;
+        position = seen;
+      } else if (lag < 0) {
+        // The consumer has not released this slot from the previous lap
+        Atomics.add(header, DROPPED, 1);
+        return false;
+      } else {
+        position = Atomics.load(header, TAIL);
+      }
+    }
+
+    const slot = position & mask;
+    const word = slot * (EVENT_RECORD_BYTES / 4);
+    const long = slot * (EVENT_RECORD_BYTES / 8);
+    this.words[word] = op;
+    this.words[word + 1] = label;
+    this.longs[long + 1] = BigInt(keySize);
+    this.longs[long + 2] = startNs;
+    this.longs[long + 3] = endNs;
+    // Seq-cst store: the plain writes above are visible to whoever reads it
+    Atomics.store(sequences, slot, (position + 1) | 0);
+
+    if (Atomics.load(header, SLEEPING) !== 0) {
+      Atomics.add(header, DOORBELL, 1);
+      Atomics.notify(header, DOORBELL, 1);
+    }
+    return true;
+  }
+
+  /**
+   * Copy a batch from a producer outside this agent cluster (see
+   * event_batch.js) into the ring, moving its timestamps from the
+   * producer's time origin onto the epoch clock
+   * @param {ArrayBuffer} buffer - Packed records
+   * @param {number} count - Records in the buffer
+   * @param {number} timeOrigin - The producer's performance.timeOrigin
+   * @returns {number} Records written; the rest were dropped
+   */
+  recordBatch(buffer, count, timeOrigin) {
+    const records = new BigUint64Array(buffer, 0, count * (EVENT_RECORD_BYTES / 8));
+    const words = new Uint32Array(buffer, 0, count * (EVENT_RECORD_BYTES / 4));
+    const origin = millisecondsToNanoseconds(timeOrigin);
+    let written = 0;
+    for (let i = 0; i < count; i++) {
+      const long = i * (EVENT_RECORD_BYTES / 8);
+      const word = i * (EVENT_RECORD_BYTES / 4);
+      if (this.record(words[word], Number(records[long + 1]), origin + records[long + 2],
+                      origin + records[long + 3], words[word + 1])) {
+        written++;
+      }
+    }
+    return written;
+  }
+
+  /**
+   * Time `fn` and record it; the result (or promise) is passed through
+   * @param {number} op - Index from OPERATION_CODES
+   * @param {number} keySize - Key size in bits
+   * @param {Function} fn - Operation to run
+   * @param {number} label - Class label
+   */
+  measure(op, keySize, fn, label = 0) {
+    const start = epochNanoseconds();
+    const result = fn();
+    if (result && typeof result.then === 'function') {
+      return result.then(value => {
+        this.record(op, keySize, start, epochNanoseconds(), label);
+        return value;
+      });
+    }
+    this.record(op, keySize, start, epochNanoseconds(), label);
+    return result;
+  }
+
+  get dropped() {
+    return Atomics.load(this.header, DROPPED);
+  }
+}
+
+export class EventRingConsumer {
+  /**
+   * @param {SharedArrayBuffer} buffer - Ring from createEventRing
+   */
+  constructor(buffer) {
+    Object.assign(this, ringViews(buffer));
+    this.head = Atomics.load(this.header, HEAD);
+  }
+
+  /**
+   * Copy up to `maxRecords` published records into `target` starting at
+   * byte `offset` and release their slots. Stops at the first slot that
+   * is claimed but not yet published, so records come out in claim order.
+   * @param {Uint8Array} target - e.g. the module's HEAPU8
+   * @param {number} offset - Byte offset of a staging area in `target`
+   * @param {number} maxRecords - Staging capacity in records
+   * @returns {number} Records copied
+   */
+  drainInto(target, offset, maxRecords) {
+    const { sequences, mask, capacity } = this;
+    let copied = 0;
+    while (copied < maxRecords) {
+      // Longest published run before the ring wraps or the staging fills
+      const first = this.head & mask;
+      const limit = Math.min(maxRecords - copied, capacity - first);
+      let run = 0;
+      while (run < limit &&
+             Atomics.load(sequences, first + run) === ((this.head + run + 1) | 0)) {
+        run++;
+      }
+      if (run === 0) break;
+
+      target.set(
+        this.bytes.subarray(first * EVENT_RECORD_BYTES, (first + run) * EVENT_RECORD_BYTES),
+        offset + copied * EVENT_RECORD_BYTES);
+      for (let i = 0; i < run; i++) {
+        Atomics.store(sequences, first + i, (this.head + i + capacity) | 0);
+      }
+      this.head = (this.head + run) | 0;
+      copied += run;
+    }
+    if (copied > 0) Atomics.store(this.header, HEAD, this.head);
+    return copied;
+  }
+
+  /**
+   * @returns {boolean} True when the next slot holds a published record
+   */
+  hasPending() {
+    return Atomics.load(this.sequences, this.head & this.mask) === ((this.head + 1) | 0);
+  }
+
+  /**
+   * Wait until a producer rings the doorbell or `timeoutMs` passes.
+   * Producers only notify while the consumer is flagged as sleeping, so
+   * a busy ring costs them no notify; the pending check after raising
+   * the flag closes the race with a record published just before it.
+   * Without Atomics.waitAsync this degrades to polling every few ms.
+   * @param {number} timeoutMs - Upper bound on the wait
+   * @returns {Promise<void>}
+   */
+  async wait(timeoutMs) {
+    const { header } = this;
+    const bell = Atomics.load(header, DOORBELL);
+    Atomics.store(header, SLEEPING, 1);
+    try {
+      if (this.hasPending()) return;
+      if (typeof Atomics.waitAsync !== 'function') {
+        await new Promise(resolve => setTimeout(resolve, Math.min(timeoutMs, POLL_MS)));
+        return;
+      }
+      const waiting = Atomics.waitAsync(header, DOORBELL, bell, timeoutMs);
+      if (waiting.async) await waiting.value;
+    } finally {
+      Atomics.store(header, SLEEPING, 0);
+    }
+  }
+
+  get dropped() {
+    return Atomics.load(this.header, DROPPED);
+  }
+}
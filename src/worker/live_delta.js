@@ -0,0 +1,155 @@
+// live_delta.js
+//
+// Decoder and running aggregate for the monitor's live delta frames
+// (live_delta.h). Each frame holds one rollup bucket per operation that
+// gained records; LiveAggregate merges them into running moments and a
+// sparse copy of the quantile sketch, and keeps the last few buckets as a
+// short history.
+
+const MAGIC = 0x444c4d43;
+const VERSION = 1;
+const BUCKET_BYTES = 56;
+
+// Index order of EnhancedCryptoMonitor::CryptoOperation
+export const OPERATION_NAMES = Object.freeze([
+  'AES_ENCRYPT', 'AES_DECRYPT', 'RSA_ENCRYPT', 'RSA_DECRYPT',
+  'ECDSA_SIGN', 'ECDSA_VERIFY', 'SHA256_HASH', 'KEY_DERIVATION'
+]);
+
+/**
+ * Decode one frame
+ * @param {ArrayBuffer} buffer - Frame bytes
+ * @returns {{gamma: number, buckets: Array<Object>}}
+ */
+export function decodeLiveDelta(buffer) {
+  const view = new DataView(buffer);
+  if (buffer.byteLength < 16 || view.getUint32(0, true) !== MAGIC ||
+      view.getUint16(4, true) !== VERSION) {
+    throw new Error('Not a live delta frame');
+  }
+  const bucketCount = view.getUint16(6, true);
+  const gamma = view.getFloat64(8, true);
+  const buckets = [];
+  let offset = 16;
+  for (let b = 0; b < bucketCount; b++) {
+    if (offset + BUCKET_BYTES > buffer.byteLength) throw new Error('Truncated live delta');
+    const binCount = view.getUint32(offset + 4, true);
+    const bucket = {
+      op: view.getUint32(offset, true),
+      count: Number(view.getBigUint64(offset + 8, true)),
+      mean: view.getFloat64(offset + 16, true),
+      m2: view.getFloat64(offset + 24, true),
+      min: view.getFloat64(offset + 32, true),
+      max: view.getFloat64(offset + 40, true),
+      zeroCount: Number(view.getBigUint64(offset + 48, true)),
+      bins: new Map()
+    };
+    offset += BUCKET_BYTES;
+    if (offset + binCount * 8 > buffer.byteLength) throw new Error('Truncated live delta');
+    for (let i = 0; i < binCount; i++, offset += 8) {
+      bucket.bins.set(view.getInt32(offset, true), view.getUint32(offset + 4, true));
+    }
+    buckets.push(bucket);
+  }
+  return { gamma, buckets };
+}
+
+class OperationTotals {
+  constructor() {
+    this.count = 0;
+    this.mean = 0;
+    this.m2 = 0;
+    this.min = Infinity;
+    this.max = -Infinity;
+    this.zeroCount = 0;
+    this.bins = new Map();
+    this.recent = [];
+  }
+
+  merge(bucket, historyLength) {
+    // Pairwise (Chan et al.) merge of count/mean/M2
+    const n = this.count + bucket.count;
+    const delta = bucket.mean - this.mean;
+    this.m2 += bucket.m2 + delta * delta * this.count * bucket.count / n;
+    this.mean += delta * bucket.count / n;
+    this.count = n;
+    this.min = Math.min(this.min, bucket.min);
+    this.max = Math.max(this.max, bucket.max);
+    this.zeroCount += bucket.zeroCount;
+    for (const [index, count] of bucket.bins) {
+      this.bins.set(index, (this.bins.get(index) || 0) + count);
+    }
+    this.recent.push({ count: bucket.count, mean: bucket.mean, min: bucket.min, max: bucket.max });
+    if (this.recent.length > historyLength) this.recent.shift();
+  }
+}
+
+export class LiveAggregate {
+  /**
+   * @param {number} historyLength - Buckets kept per operation
+   */
+  constructor(historyLength = 60) {
+    this.historyLength = historyLength;
+    this.gamma = 0;
+    this.operations = new Map();
+  }
+
+  /**
+   * Fold a frame into the totals
+   * @param {ArrayBuffer} buffer - Frame bytes
+   */
+  apply(buffer) {
+    const { gamma, buckets } = decodeLiveDelta(buffer);
+    this.gamma = gamma;
+    for (const bucket of buckets) {
+      const name = OPERATION_NAMES[bucket.op];
+      if (!name || bucket.count === 0) continue;
+      if (!this.operations.has(name)) this.operations.set(name, new OperationTotals());
+      this.operations.get(name).merge(bucket, this.historyLength);
+    }
+  }
+
+  /**
+   * Same relative-accuracy estimate the monitor's sketch gives
+   * @param {string} operation - e.g. 'AES_ENCRYPT'
+   * @param {number} q - Quantile in [0, 1]
+   * @returns {number}
+   */
+  quantile(operation, q) {
+    const totals = this.operations.get(operation);
+    if (!totals || totals.count === 0) return 0;
+    const rank = Math.min(1, Math.max(0, q)) * (totals.count - 1);
+    let seen = totals.zeroCount;
+    if (rank < seen) return 0;
+    const indices = [...totals.bins.keys()].sort((a, b) => a - b);
+    let index = indices[indices.length - 1];
+    for (const i of indices) {
+      seen += totals.bins.get(i);
+      if (rank < seen) {
+        index = i;
+        break;
+      }
+    }
+    return 2 * Math.pow(this.gamma, index) / (this.gamma + 1);
+  }
+
+  /**
+   * @param {string} operation - e.g. 'AES_ENCRYPT'
+   * @returns {Object|null} Totals, quantiles and recent buckets
+   */
+  summary(operation) {
+    const totals = this.operations.get(operation);
+    if (!totals) return null;
+    return {
+      count: totals.count,
+      mean: totals.mean,
+      stddev: totals.count > 0 ? Math.sqrt(totals.m2 / totals.count) : 0,
+      min: totals.min,
+      max: totals.max,
+      p50: this.quantile(operation, 0.5),
+      p90: this.quantile(operation, 0.9),
+      p99: this.quantile(operation, 0.99),
+      recent: totals.recent
+    };
+  }
+}
@@ -0,0 +1,127 @@
+// monitor_client.js
+import { createEventRing, EventRingProducer } from './event_ring.js';
+
+/**
+ * Handle on a worker-hosted monitor. Recording goes through the shared
+ * event ring (a few atomic operations, no message per event); queries are
+ * forwarded to the worker and resolve with the embind result.
+ *
+ * Requires a cross-origin isolated context for SharedArrayBuffer. The ring
+ * can be handed to other workers of this page with producerFor(); contexts
+ * outside this agent cluster cannot share it and must send batches.
+ */
+class WorkerMonitor {
+  /**
+   * @param {Object} options
+   * @param {number} options.capacity - Ring slots (power of two)
+   */
+  constructor(options = {}) {
+    if (typeof SharedArrayBuffer === 'undefined' || !globalThis.crossOriginIsolated) {
+      throw new Error('WorkerMonitor needs a cross-origin isolated context');
+    }
+    this.ring = createEventRing(options.capacity);
+    this.producer = new EventRingProducer(this.ring);
+    this.worker = new Worker(new URL('./monitor_worker.js', import.meta.url));
+    this.pending = new Map();
+    this.nextId = 1;
+    this.worker.onmessage = (event) => this.settle(event.data);
+    this.ready = this.call('init', this.ring);
+  }
+
+  settle({ id, result, error, progress }) {
+    const pending = this.pending.get(id);
+    if (!pending) return;
+    if (progress !== undefined) {
+      if (pending.onProgress) pending.onProgress(progress);
+      return;
+    }
+    this.pending.delete(id);
+    if (error !== undefined) pending.reject(new Error(error));
+    else pending.resolve(result);
+  }
+
+  /**
+   * Invoke a read-only EnhancedCryptoMonitor method in the worker (see
+   * QUERY_METHODS in monitor_worker.js); others are rejected
+   * @param {string} method - e.g. 'analyzeTimingSideChannels'
+   * @param {...*} args - Structured-cloneable arguments
+   * @returns {Promise<*>} Method result
+   */
+  call(method, ...args) {
+    return this.post(method, args, []);
+  }
+
+  post(method, args, transfer, onProgress = null) {
+    const id = this.nextId++;
+    return new Promise((resolve, reject) => {
+      this.pending.set(id, { resolve, reject, onProgress });
+      this.worker.postMessage({ id, method, args }, transfer);
+    });
+  }
+
+  /**
+   * Copy a batch from a producer that cannot share the ring (see
+   * event_batch.js) into the ring, so it reaches the worker like any
+   * other record, with no message of its own
+   * @param {ArrayBuffer} buffer - Packed records
+   * @param {number} count - Records in the buffer
+   * @param {number} timeOrigin - The producer's performance.timeOrigin
+   * @returns {number} Records written; the rest were dropped (ringStats)
+   */
+  recordBatch(buffer, count, timeOrigin) {
+    return this.producer.recordBatch(buffer, count, timeOrigin);
+  }
+
+  /**
+   * getResearchMetrics computed in time slices, so the worker keeps
+   * draining events and answering other calls while it runs
+   * @param {string} operation - e.g. 'RSA_ENCRYPT'
+   * @param {Object} options
+   * @param {number} options.sliceMs - Budget per slice (default 4)
+   * @param {Function} options.onProgress - Gets { phase, processed, total, partial }
+   * @returns {Promise<Object>} Same shape as getResearchMetrics
+   */
+  researchMetrics(operation, options = {}) {
+    return this.post('researchMetrics', [operation, options.sliceMs], [],
+                     options.onProgress || null);
+  }
+
+  /**
+   * Record a finished operation; see EventRingProducer.record
+   */
+  record(op, keySize, startNs, endNs, label = 0) {
+    return this.producer.record(op, keySize, startNs, endNs, label);
+  }
+
+  /**
+   * Time `fn` and record it; see EventRingProducer.measure
+   */
+  measure(op, keySize, fn, label = 0) {
+    return this.producer.measure(op, keySize, fn, label);
+  }
+
+  /**
+   * @returns {SharedArrayBuffer} Ring to post to another worker, which
+   * wraps it in its own EventRingProducer
+   */
+  producerFor() {
+    return this.ring;
+  }
+
+  /**
+   * @returns {Promise<{merged: number, dropped: number}>} Ring counters
+   */
+  ringStats() {
+    return this.call('ringStats');
+  }
+
+  terminate() {
+    this.worker.terminate();
+    for (const { reject } of this.pending.values()) {
+      reject(new Error('monitor worker terminated'));
+    }
+    this.pending.clear();
+  }
+}
+
+export default WorkerMonitor;
@@ -0,0 +1,140 @@
+// monitor_worker.js
+//
+// Dedicated worker hosting the WASM monitor. Producers append to the shared
+// event ring; this worker drains it in batches into a staging area on the
+// module heap and merges each batch with one recordEventBatch call, so
+// analysis never runs on a producer's thread. Queries arrive as
+//   { id, method, args }
+// naming one of the worker's own methods below or a read-only
+// EnhancedCryptoMonitor method in QUERY_METHODS, and are answered with
+//   { id, result } or { id, error }
+// preceded, for sliced analyses, by any number of { id, progress }.
+
+/* global importScripts, createModule */
+
+import { EVENT_RECORD_BYTES, EventRingConsumer } from './event_ring.js';
+
+const STAGING_RECORDS = 4096;
+const IDLE_WAIT_MS = 250;
+const RESEARCH_SLICE_MS = 4;
+
+// Monitor methods callable by name. Queries reach the worker from other
+// extension contexts, so anything that records, loads, clears or
+// reconfigures the monitor is left out.
+const QUERY_METHODS = new Set([
+  'analyzeTimingSideChannels', 'analyzeCacheBehavior', 'analyzeRSAPerformance',
+  'analyzeTVLA', 'analyzeCPA', 'analyzeSNR', 'fitTracePCA', 'getProjectedTraces',
+  'matchTemplates', 'scoreTemplates', 'analyzeDistribution', 'getDensity',
+  'getResearchMetrics', 'serialize', 'serializeSummary', 'getSummary',
+  'getWindowStatistics', 'getMemoryUsage', 'getAlertStates', 'deriveMetric',
+  'permutationTest'
+]);
+
+let module = null;
+let monitor = null;
+let consumer = null;
+let staging = 0;
+let clockOffsetNs = 0n;
+let merged = 0;
+
+// Records are stamped in epoch nanoseconds; the monitor's clock is this
+// worker's performance.now(), so the offset is minus our time origin
+function monitorClockOffset() {
+  const whole = Math.floor(performance.timeOrigin);
+  const fraction = Math.round((performance.timeOrigin - whole) * 1e6);
+  return -(BigInt(whole) * 1000000n + BigInt(fraction));
+}
+
+function drain() {
+  let total = 0;
+  for (;;) {
+    const count = consumer.drainInto(module.HEAPU8, staging, STAGING_RECORDS);
+    if (count === 0) break;
+    merged += monitor.recordEventBatch(staging, count, clockOffsetNs);
+    total += count;
+  }
+  return total;
+}
+
+async function drainLoop() {
+  for (;;) {
+    drain();
+    await consumer.wait(IDLE_WAIT_MS);
+  }
+}
+
+async function initialize(ring) {
+  // The emscripten build is a classic script next to this bundle; it
+  // resolves crypto_monitor.wasm relative to itself
+  importScripts('crypto_monitor.js');
+  module = await createModule();
+  monitor = new module.EnhancedCryptoMonitor();
+  staging = module._malloc(STAGING_RECORDS * EVENT_RECORD_BYTES);
+  consumer = new EventRingConsumer(ring);
+  clockOffsetNs = monitorClockOffset();
+  drainLoop();
+}
+
+// Per-subscriber record cursors for the live dashboard feed
+const liveCursors = new Map();
+
+function liveDelta(subscriber) {
+  const delta = monitor.liveDelta(liveCursors.get(subscriber) || []);
+  if (!delta) return null;
+  liveCursors.set(subscriber, delta.cursors);
+  return delta.frame;
+}
+
+// Runs getResearchMetrics through the monitor's promise-returning job,
+// which yields a macrotask between slices of `sliceMs` so queued messages
+// keep running; the ring is drained and `progress` gets each partial step
+// at every yield
+async function researchMetrics(operation, sliceMs, progress) {
+  const result = await monitor.researchMetricsAsync(operation, sliceMs || RESEARCH_SLICE_MS, (step) => {
+    drain();
+    progress(step);
+  });
+  if (result === null) throw new Error('research job was cancelled');
+  return result;
+}
+
+function stats() {
+  return { merged, dropped: consumer.dropped };
+}
+
+let ready = null;
+
+self.onmessage = async (event) => {
+  const { id, method, args = [] } = event.data;
+  try {
+    if (method === 'init') {
+      ready = ready || initialize(args[0]);
+      await ready;
+      self.postMessage({ id, result: true });
+      return;
+    }
+    if (!ready) throw new Error('monitor worker is not initialized');
+    await ready;
+
+    // Queries see everything published before they were sent
+    drain();
+    let result;
+    if (method === 'ringStats') {
+      result = stats();
+    } else if (method === 'researchMetrics') {
+      result = await researchMetrics(args[0], args[1],
+                                     progress => self.postMessage({ id, progress }));
+    } else if (method === 'liveDelta') {
+      result = liveDelta(args[0]);
+    } else if (method === 'releaseLive') {
+      result = liveCursors.delete(args[0]);
+    } else if (QUERY_METHODS.has(method)) {
+      result = monitor[method](...args);
+    } else {
+      throw new Error(`Unknown monitor method: ${method}`);
+    }
+    self.postMessage({ id, result });
+  } catch (error) {
+    self.postMessage({ id, error: error.message || String(error) });
+  }
+};
@@ -0,0 +1,633 @@
+// analysis_test.cpp
+//
+// Behaviour and edge-case checks for the analyses behind
+// EnhancedCryptoMonitor: bad caller input must be rejected, never read
+// out of bounds or trap. Built and run by run_tests.sh.
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/wasm/crypto_monitor.h"
+
+namespace {
+
+using CryptoOperation = EnhancedCryptoMonitor::CryptoOperation;
+using TraceSource = EnhancedCryptoMonitor::TraceSource;
+
+int failures = 0;
+
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition)) {                                                   \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__,       \
+                         __LINE__, #condition);                               \
+            ++failures;                                                       \
+        }                                                                     \
+    } while (0)
+
+// AES operations with ten round-power points each, labelled by parity
+void record_rounds(EnhancedCryptoMonitor& monitor, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        monitor.startOperation(CryptoOperation::AES_ENCRYPT, 128);
+        for (uint64_t round = 0; round < 10; ++round) {
+            monitor.recordRound(CryptoOperation::AES_ENCRYPT, round);
+        }
+        monitor.labelOperation(CryptoOperation::AES_ENCRYPT, i % 2);
+        monitor.endOperation(CryptoOperation::AES_ENCRYPT);
+    }
+}
+
+void test_templates() {
+    EnhancedCryptoMonitor monitor;
+    record_rounds(monitor, 200);
+    const auto op = CryptoOperation::AES_ENCRYPT;
+
+    CHECK(monitor.buildTemplates(op, TraceSource::ROUND_POWER, {1, 4, 7}) == 2);
+    TemplateMatch match = monitor.matchTemplates(op);
+    CHECK(match.trace_count == 200);
+
+    // Points at or past the trace length, including one whose + 1 wraps
+    // in 32 bits, are rejected rather than read
+    CHECK(monitor.buildTemplates(op, TraceSource::ROUND_POWER, {1, 0xFFFFFFFFu}) == 0);
+    CHECK(monitor.templates(op) == nullptr);
+    CHECK(monitor.matchTemplates(op).trace_count == 0);
+    CHECK(monitor.buildTemplates(op, TraceSource::ROUND_POWER, {10}) == 0);
+    CHECK(monitor.buildTemplates(op, TraceSource::ROUND_POWER, {9}) == 2);
+
+    // Caller traces too short for the points score -inf, including empty ones
+    std::vector<double> traces(3 * 10, 1.0), scores;
+    CHECK(monitor.scoreTemplates(op, traces.data(), 3, 10, scores));
+    CHECK(scores.size() == 3 * 2);
+    CHECK(monitor.scoreTemplates(op, traces.data(), 3, 5, scores));
+    CHECK(scores[0] == -std::numeric_limits<double>::infinity());
+    CHECK(monitor.scoreTemplates(op, traces.data(), 3, 0, scores));
+
+    EnhancedCryptoMonitor empty;
+    CHECK(empty.buildTemplates(op, TraceSource::ROUND_POWER, {0}) == 0);
+}
+
+void test_sliding_window() {
+    const uint64_t kSecond = 1000000000ull;
+    SlidingWindowStats window(10 * kSecond, 10);
+    for (uint64_t t = 0; t < 30; ++t) window.add(t * kSecond, static_cast<double>(t));
+
+    // Buckets expire whole: at 29.5 s the window still holds the bucket
+    // that started at 19 s
+    const uint64_t now = 29 * kSecond + kSecond / 2;
+    WindowStatistics stats = window.query(now);
+    CHECK(stats.count == 11);
+    CHECK(std::fabs(stats.mean - 24.0) < 1e-9);
+    CHECK(std::fabs(stats.stddev - std::sqrt(10.0)) < 1e-9);
+    CHECK(stats.min == 19.0 && stats.max == 29.0);
+    CHECK(stats.p50 >= 23.0 && stats.p50 <= 25.0);
+
+    // Too old for the window is dropped; late but inside lands in the
+    // newest bucket
+    window.add(5 * kSecond, 1000.0);
+    CHECK(window.query(now).count == 11);
+    window.add(25 * kSecond, 100.0);
+    stats = window.query(now);
+    CHECK(stats.count == 12 && stats.max == 100.0);
+    CHECK(window.query(100 * kSecond).count == 0);
+
+    // Large, nearly equal values over many windows: the moments kept by
+    // subtracting expired buckets match a direct pass over the same ones
+    SlidingWindowStats drift(kSecond, 20);
+    std::vector<double> values;
+    const uint64_t kStep = 1000000;
+    const size_t kSamples = 200000;
+    for (size_t i = 0; i < kSamples; ++i) {
+        values.push_back(1e9 + static_cast<double>(i % 17) + 0.25 * static_cast<double>(i % 3));
+        drift.add(i * kStep, values.back());
+    }
+    const uint64_t last = (kSamples - 1) * kStep, horizon = last - kSecond;
+    const uint64_t width = drift.bucketNs();
+    double sum = 0.0, sum_sq = 0.0;
+    uint64_t count = 0;
+    for (size_t i = 0; i < kSamples; ++i) {
+        uint64_t t = i * kStep;
+        if (t - t % width + width <= horizon) continue;
+        ++count;
+        sum += values[i] - 1e9;
+    }
+    const double mean = sum / static_cast<double>(count);
+    for (size_t i = 0; i < kSamples; ++i) {
+        uint64_t t = i * kStep;
+        if (t - t % width + width <= horizon) continue;
+        sum_sq += (values[i] - 1e9 - mean) * (values[i] - 1e9 - mean);
+    }
+    stats = drift.query(last);
+    CHECK(stats.count == count);
+    CHECK(std::fabs(stats.mean - (1e9 + mean)) < 1e-6);
+    CHECK(std::fabs(stats.stddev - std::sqrt(sum_sq / static_cast<double>(count))) < 1e-6);
+
+    // Through the monitor, resizing drops what the windows held
+    EnhancedCryptoMonitor monitor;
+    const auto op = CryptoOperation::SHA256_HASH;
+    const uint64_t start = EnhancedCryptoMonitor::get_timestamp();
+    for (uint64_t i = 0; i < 100; ++i) {
+        monitor.recordCompletedOperation(op, 256, start + i * 1000, start + i * 1000 + 10 + i % 3);
+    }
+    stats = monitor.windowStatistics(op, start + 100 * 1000);
+    CHECK(stats.count == 100);
+    CHECK(stats.min == 10.0 && stats.max == 12.0);
+    monitor.setWindow(kSecond, 10);
+    CHECK(monitor.windowStatistics(op, start + 100 * 1000).count == 0);
+}
+
+// Alternates around `center`, so the EWMA variance settles near 1
+double steady(double center, uint64_t i) {
+    return center + (i % 2 ? 1.0 : -1.0);
+}
+
+void test_anomaly_detection() {
+    AnomalyDetector detector(2);
+    AnomalyConfig config;
+    config.alpha = 0.05;
+    config.threshold = 4.0;
+    config.warmup = 30;
+    detector.configure(config);
+    std::vector<AnomalyEvent> events;
+    size_t called = 0;
+    detector.setCallback([&called](const AnomalyEvent&) { ++called; });
+
+    uint64_t t = 0;
+    for (; t < 500; ++t) detector.observeOperation(1, t, steady(100.0, t));
+    CHECK(detector.poll(events) == 0);
+    detector.observeOperation(1, t++, 150.0);
+    CHECK(detector.poll(events) == 1);
+    CHECK(events[0].op == 1 && events[0].round == -1 && events[0].value == 150.0);
+    CHECK(events[0].timestamp == 500 && events[0].z_score > 20.0);
+    CHECK(called == 1);
+
+    // A sustained shift is flagged at first and then becomes the baseline
+    detector.configure(config);
+    for (uint64_t i = 0; i < 500; ++i) detector.observeOperation(1, t++, steady(100.0, i));
+    const uint64_t shift = t;
+    for (uint64_t i = 0; i < 500; ++i) detector.observeOperation(1, t++, steady(110.0, i));
+    events.clear();
+    CHECK(detector.poll(events) > 0);
+    CHECK(!events.empty() && events.front().timestamp == shift);
+    CHECK(!events.empty() && events.back().timestamp < t - 200);
+    // The other operation's tracker never saw any of it
+    detector.observeOperation(0, t++, 110.0);
+    CHECK(detector.poll(events) == 0);
+
+    // No scoring before the warmup, and reconfiguring starts it again
+    detector.configure(config);
+    for (uint64_t i = 0; i < 10; ++i) detector.observeOperation(1, t++, steady(100.0, i));
+    detector.observeOperation(1, t++, 1000.0);
+    CHECK(detector.poll(events) == 0);
+
+    // Rounds have their own trackers, up to kMaxTrackedRounds
+    for (uint64_t i = 0; i < 100; ++i) {
+        detector.observeRound(1, 3, t, steady(5.0, i));
+        detector.observeRound(1, AnomalyDetector::kMaxTrackedRounds, t++, steady(5.0, i));
+    }
+    detector.observeRound(1, 3, t, 50.0);
+    detector.observeRound(1, AnomalyDetector::kMaxTrackedRounds, t, 50.0);
+    events.clear();
+    CHECK(detector.poll(events) == 1);
+    CHECK(events[0].round == 3);
+
+    // The ring keeps the newest events and counts what it overwrote
+    config.threshold = 0.5;
+    detector.configure(config);
+    for (uint64_t i = 0; i < 3000; ++i) detector.observeOperation(0, t++, steady(1.0, i));
+    events.clear();
+    CHECK(detector.poll(events) == AnomalyDetector::kRingCapacity);
+    CHECK(detector.overwritten() > 0);
+    CHECK(events.back().timestamp == t - 1);
+
+    // Through the monitor, the lock-free path is scored when drained
+    EnhancedCryptoMonitor monitor;
+    monitor.configureAnomalyDetection(AnomalyConfig());
+    const auto op = CryptoOperation::SHA256_HASH;
+    for (uint64_t i = 0; i < 200; ++i) {
+        uint64_t duration = static_cast<uint64_t>(steady(100.0, i));
+        monitor.recordCompletedOperation(op, 256, i * 1000, i * 1000 + duration);
+    }
+    monitor.recordCompletedOperation(op, 256, 200000, 200000 + 400);
+    std::vector<AnomalyEvent> found = monitor.pollAnomalies();
+    CHECK(found.size() == 1);
+    CHECK(!found.empty() && found[0].op == static_cast<uint32_t>(op) && found[0].value == 400.0);
+}
+
+void test_alert_rules() {
+    AlertEngine engine(EnhancedCryptoMonitor::operationNames());
+    std::string error;
+    CHECK(engine.addRule("mean of NO_SUCH_OP > 1", error) == -1);
+    CHECK(error == "unknown operation");
+    CHECK(engine.addRule("median of SHA256_HASH > 1", error) == -1);
+    CHECK(engine.addRule("mean of SHA256_HASH", error) == -1);
+    CHECK(engine.addRule("count of SHA256_HASH over 0s > 1", error) == -1);
+    CHECK(engine.addRule("count of SHA256_HASH > 3ms", error) == -1);
+    CHECK(engine.addRule("mean of SHA256_HASH > 1 extra", error) == -1);
+    CHECK(engine.empty());
+
+    const int64_t mean = engine.addRule("MEAN of sha256_hash > 1us", error);
+    const int64_t p90 = engine.addRule("p90 of SHA256_HASH>80", error);
+    const int64_t big_keys = engine.addRule("max of SHA256_HASH 512 > 0", error);
+    const int64_t recent = engine.addRule("count of SHA256_HASH over 1s >= 5", error);
+    CHECK(mean >= 0 && p90 >= 0 && big_keys >= 0 && recent >= 0);
+    CHECK(engine.addRule("tvla |t| > 4.5 for AES_ENCRYPT", error) >= 0);
+
+    // Rules sharing a source see the same samples; a key size filters them
+    const uint32_t sha = static_cast<uint32_t>(CryptoOperation::SHA256_HASH);
+    for (uint64_t i = 1; i <= 100; ++i) {
+        engine.observe(sha, 256, i, static_cast<double>(i), 0, {}, {});
+    }
+    engine.evaluate(100);
+    std::vector<AlertEvent> events;
+    CHECK(engine.poll(events) == 2);
+    CHECK(events.size() == 2 && events[0].firing && events[1].firing);
+    CHECK(events.size() == 2 && events[0].rule == p90 && events[1].rule == recent);
+    CHECK(events.size() == 2 && events[0].value >= 85.0 && events[0].value <= 95.0);
+    CHECK(events.size() == 2 && events[1].value == 100.0);
+
+    // Thresholds take time units
+    for (uint64_t i = 0; i < 100; ++i) engine.observe(sha, 256, 200, 5000.0, 0, {}, {});
+    engine.evaluate(200);
+    events.clear();
+    CHECK(engine.poll(events) == 1);
+    CHECK(events.size() == 1 && events[0].rule == mean && events[0].value == 2525.25);
+
+    // A windowed rule resolves once its samples age out, without new data
+    engine.evaluate(3000000000ull);
+    events.clear();
+    CHECK(engine.poll(events) == 1);
+    CHECK(events.size() == 1 && events[0].rule == recent && !events[0].firing);
+
+    for (const AlertState& state : engine.states()) {
+        if (state.rule == big_keys) CHECK(!state.firing && std::isnan(state.value));
+        if (state.rule == mean) CHECK(state.firing && state.text == "MEAN of sha256_hash > 1us");
+    }
+    CHECK(engine.removeRule(static_cast<uint32_t>(p90)));
+    CHECK(!engine.removeRule(static_cast<uint32_t>(p90)));
+    CHECK(engine.states().size() == 4);
+
+    // Through the monitor, rules are checked as drained records arrive
+    EnhancedCryptoMonitor monitor;
+    monitor.setAlertInterval(0);
+    const int64_t slow = monitor.addAlertRule("max of SHA256_HASH > 100", error);
+    CHECK(slow >= 0);
+    monitor.recordCompletedOperation(CryptoOperation::SHA256_HASH, 256, 1000, 1050);
+    CHECK(monitor.pollAlerts().empty());
+    monitor.recordCompletedOperation(CryptoOperation::SHA256_HASH, 256, 2000, 2500);
+    std::vector<AlertEvent> fired = monitor.pollAlerts();
+    CHECK(fired.size() == 1);
+    CHECK(fired.size() == 1 && fired[0].rule == slow && fired[0].firing && fired[0].value == 500.0);
+}
+
+std::vector<double> gaussian(size_t count, double mean, double stddev, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double> normal(mean, stddev);
+    std::vector<double> values(count);
+    for (double& v : values) v = normal(rng);
+    return values;
+}
+
+std::vector<double> joined(std::vector<double> a, const std::vector<double>& b) {
+    a.insert(a.end(), b.begin(), b.end());
+    return a;
+}
+
+void test_distribution_shape() {
+    DistributionShape one = analyzeDistributionShape(gaussian(20000, 1000.0, 50.0, 1));
+    CHECK(one.count + one.outliers == 20000 && one.outliers <= 40);
+    CHECK(!one.bimodal);
+    CHECK(std::fabs(one.unimodal.mean - 1000.0) < 5.0);
+    CHECK(std::fabs(one.unimodal.stddev - 50.0) < 5.0);
+    CHECK(one.dip_z < 0.52);
+
+    // Two equal peaks ten standard deviations apart; means come back ascending
+    DistributionShape two = analyzeDistributionShape(
+        joined(gaussian(10000, 1300.0, 30.0, 2), gaussian(10000, 1000.0, 30.0, 3)));
+    CHECK(two.bimodal);
+    CHECK(std::fabs(two.mixture.components[0].mean - 1000.0) < 10.0);
+    CHECK(std::fabs(two.mixture.components[1].mean - 1300.0) < 10.0);
+    CHECK(std::fabs(two.mixture.components[0].weight - 0.5) < 0.05);
+    CHECK(std::fabs(two.mixture.components[0].stddev - 30.0) < 6.0);
+    CHECK(two.separation > 2.0);
+    CHECK(two.bic_bimodal < two.bic_unimodal);
+    CHECK(two.dip_z > 0.52);
+
+    // A minor mode holding a tenth of the samples still counts
+    DistributionShape skewed = analyzeDistributionShape(
+        joined(gaussian(18000, 1000.0, 30.0, 4), gaussian(2000, 1400.0, 30.0, 5)));
+    CHECK(skewed.bimodal);
+    CHECK(std::fabs(skewed.mixture.components[1].weight - 0.1) < 0.03);
+
+    // The dip statistic itself, on sorted samples
+    std::vector<double> uniform, clusters;
+    for (int i = 0; i < 1000; ++i) {
+        uniform.push_back(i / 999.0);
+        clusters.push_back(i < 500 ? i * 1e-6 : 1.0 + i * 1e-6);
+    }
+    CHECK(dipStatistic(uniform) < 0.01);
+    CHECK(dipStatistic(clusters) > 0.2);
+
+    // Degenerate inputs report nothing rather than NaN
+    CHECK(analyzeDistributionShape({}).count == 0);
+    CHECK(!analyzeDistributionShape({5.0}).bimodal);
+    DistributionShape flat = analyzeDistributionShape(std::vector<double>(1000, 42.0));
+    CHECK(!flat.bimodal);
+    CHECK(!std::isnan(flat.dip) && !std::isnan(flat.unimodal.mean));
+
+    // Through the monitor, on execution times
+    EnhancedCryptoMonitor monitor;
+    std::vector<double> times =
+        joined(gaussian(3000, 400.0, 10.0, 6), gaussian(3000, 700.0, 10.0, 7));
+    for (size_t i = 0; i < times.size(); ++i) {
+        uint64_t start = i * 1000;
+        monitor.recordCompletedOperation(CryptoOperation::RSA_DECRYPT, 2048, start,
+                                         start + static_cast<uint64_t>(times[i]));
+    }
+    CHECK(monitor.distributionAnalysis(CryptoOperation::RSA_DECRYPT).execution_time.bimodal);
+}
+
+// Density at x, read off the estimate's grid
+double density_at(const DensityEstimate& estimate, double x) {
+    double step = (estimate.high - estimate.low) / static_cast<double>(estimate.density.size() - 1);
+    size_t i = static_cast<size_t>(std::lround((x - estimate.low) / step));
+    return estimate.density[std::min(i, estimate.density.size() - 1)];
+}
+
+double integral(const DensityEstimate& estimate) {
+    double step = (estimate.high - estimate.low) / static_cast<double>(estimate.density.size() - 1);
+    double area = 0.0;
+    for (size_t i = 1; i < estimate.density.size(); ++i) {
+        area += 0.5 * (estimate.density[i - 1] + estimate.density[i]) * step;
+    }
+    return area;
+}
+
+void test_kernel_density() {
+    const double kPeak = 1.0 / std::sqrt(2.0 * std::acos(-1.0));
+    DensityOptions silverman;
+    silverman.rule = BandwidthRule::SILVERMAN;
+
+    std::vector<double> normal = gaussian(100000, 0.0, 1.0, 11);
+    DensityEstimate isj = KernelDensity::estimate(normal);
+    DensityEstimate rule = KernelDensity::estimate(normal, silverman);
+    CHECK(isj.rule == BandwidthRule::ISJ && isj.count == 100000);
+    CHECK(isj.density.size() == DensityOptions().points);
+    // On a single Gaussian both selectors land near 0.9 * n^(-1/5)
+    CHECK(rule.bandwidth > 0.08 && rule.bandwidth < 0.1);
+    CHECK(isj.bandwidth > 0.5 * rule.bandwidth && isj.bandwidth < 2.0 * rule.bandwidth);
+    CHECK(std::fabs(density_at(isj, 0.0) - kPeak) < 0.02);
+    CHECK(std::fabs(density_at(isj, 1.0) - kPeak * std::exp(-0.5)) < 0.02);
+    CHECK(std::fabs(integral(isj) - (1.0 - static_cast<double>(isj.outside) / isj.count)) < 0.01);
+
+    // Two narrow peaks: Silverman's rule oversmooths, ISJ keeps the valley
+    std::vector<double> peaks =
+        joined(gaussian(50000, -3.0, 0.5, 12), gaussian(50000, 3.0, 0.5, 13));
+    isj = KernelDensity::estimate(peaks);
+    rule = KernelDensity::estimate(peaks, silverman);
+    CHECK(isj.rule == BandwidthRule::ISJ);
+    CHECK(isj.bandwidth < 0.5 * rule.bandwidth);
+    CHECK(density_at(isj, 0.0) < 0.01 * density_at(isj, 3.0));
+    CHECK(std::fabs(density_at(isj, 3.0) - 0.5 * kPeak / 0.5) < 0.03);
+
+    // A fixed range counts what falls outside; a fixed bandwidth is kept
+    DensityOptions fixed;
+    fixed.low = -1.0;
+    fixed.high = 1.0;
+    fixed.bandwidth = 0.25;
+    fixed.points = 101;
+    DensityEstimate window = KernelDensity::estimate(normal, fixed);
+    CHECK(window.low == -1.0 && window.high == 1.0 && window.density.size() == 101);
+    CHECK(window.bandwidth == 0.25);
+    CHECK(std::fabs(static_cast<double>(window.outside) / window.count - 0.3173) < 0.01);
+
+    // Non-finite samples are skipped; degenerate input gives no NaN
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<double> dirty = {1.0, std::nan(""), 2.0, inf, -inf, 3.0};
+    CHECK(KernelDensity::estimate(dirty).count == 3);
+    DensityEstimate empty = KernelDensity::estimate({});
+    CHECK(empty.count == 0 && empty.density.empty());
+    DensityOptions two;
+    two.points = 0;
+    DensityEstimate flat = KernelDensity::estimate(std::vector<double>(1000, 7.0), two);
+    CHECK(flat.density.size() == 2);
+    for (double d : KernelDensity::estimate(std::vector<double>(1000, 7.0)).density) {
+        CHECK(std::isfinite(d));
+    }
+
+    // Through the monitor, on execution times
+    EnhancedCryptoMonitor monitor;
+    for (uint64_t i = 0; i < 5000; ++i) {
+        monitor.recordCompletedOperation(CryptoOperation::AES_ENCRYPT, 128, i * 1000,
+                                         i * 1000 + 200 + i % 50);
+    }
+    DensityEstimate times = monitor.executionTimeDensity(CryptoOperation::AES_ENCRYPT);
+    CHECK(times.count == 5000);
+    CHECK(times.low <= 200.0 && times.high >= 249.0);
+}
+
+double mean_of(const std::vector<double>& values) {
+    double sum = 0.0;
+    for (double v : values) sum += v;
+    return sum / static_cast<double>(values.size());
+}
+
+void test_permutation_test() {
+    PermutationTestOptions exhaustive;
+    exhaustive.alpha = 0.0;
+    exhaustive.max_permutations = 2000;
+    exhaustive.threads = 1;
+
+    // Same distribution: no evidence, and the p-value is never 0
+    std::vector<double> a = gaussian(400, 100.0, 10.0, 21);
+    std::vector<double> b = gaussian(600, 100.0, 10.0, 22);
+    PermutationTestResult same = PermutationTest::run(a, b, exhaustive);
+    CHECK(same.count_a == 400 && same.count_b == 600);
+    CHECK(same.permutations == 2000 && !same.stopped_early);
+    CHECK(same.p_value > 0.05);
+    CHECK(same.p_value == (same.exceedances + 1.0) / (same.permutations + 1.0));
+    CHECK(std::fabs(same.observed - (mean_of(a) - mean_of(b))) < 1e-9);
+
+    // One seed and one thread reproduce the run exactly
+    PermutationTestResult again = PermutationTest::run(a, b, exhaustive);
+    CHECK(again.exceedances == same.exceedances && again.p_value == same.p_value);
+    // More threads still run exactly max_permutations when nothing stops them
+    exhaustive.threads = 4;
+    CHECK(PermutationTest::run(a, b, exhaustive).permutations == 2000);
+
+    // A shift of half a standard deviation, stopped as soon as it is clear
+    std::vector<double> shifted = gaussian(600, 105.0, 10.0, 23);
+    PermutationTestOptions options;
+    options.threads = 1;
+    PermutationTestResult different = PermutationTest::run(a, shifted, options);
+    CHECK(different.observed < -3.0);
+    CHECK(different.p_value < 0.01 && different.p_value > 0.0);
+    CHECK(different.stopped_early && different.permutations >= PermutationTest::kMinPermutations);
+    CHECK(different.permutations < options.max_permutations);
+
+    // Medians, with B's order irrelevant
+    options.statistic = PermutationStatistic::MEDIAN_DIFFERENCE;
+    PermutationTestResult medians = PermutationTest::run({1, 2, 3, 4, 100}, {5, 6, 7}, options);
+    CHECK(medians.observed == 3.0 - 6.0);
+    CHECK(PermutationTest::run({1, 2, 3, 4, 100}, {7, 5, 6}, options).observed == -3.0);
+
+    // An empty group has nothing to test
+    PermutationTestResult empty = PermutationTest::run({}, b, options);
+    CHECK(empty.permutations == 0 && empty.p_value == 1.0);
+
+    // Through the monitor, on a derived metric split by label
+    EnhancedCryptoMonitor monitor;
+    std::vector<double> fast = gaussian(300, 500.0, 20.0, 24);
+    std::vector<double> slow = gaussian(300, 520.0, 20.0, 25);
+    for (uint64_t i = 0; i < 300; ++i) {
+        uint64_t start = i * 10000;
+        monitor.recordCompletedOperation(CryptoOperation::RSA_DECRYPT, 2048, start,
+                                         start + static_cast<uint64_t>(fast[i]), 0);
+        monitor.recordCompletedOperation(CryptoOperation::RSA_DECRYPT, 2048, start + 5000,
+                                         start + 5000 + static_cast<uint64_t>(slow[i]), 1);
+    }
+    PermutationTestResult result;
+    std::string error;
+    CHECK(monitor.permutationTest(CryptoOperation::RSA_DECRYPT, "end_cycle - start_cycle", 0, 1,
+                                  PermutationTestOptions(), result, error));
+    CHECK(result.count_a == 300 && result.count_b == 300);
+    CHECK(result.observed < 0.0 && result.p_value < 0.01);
+    CHECK(!monitor.permutationTest(CryptoOperation::RSA_DECRYPT, "end_cycle -", 0, 1,
+                                   PermutationTestOptions(), result, error));
+    CHECK(!error.empty());
+}
+
+bool derives(EnhancedCryptoMonitor& monitor, const std::string& expression,
+             std::vector<double>& values, std::string& error) {
+    error.clear();
+    return monitor.deriveMetric(CryptoOperation::SHA256_HASH, expression, values, error);
+}
+
+void test_metric_expressions() {
+    EnhancedCryptoMonitor monitor;
+    for (uint64_t i = 0; i < 3000; ++i) {
+        monitor.recordCompletedOperation(CryptoOperation::SHA256_HASH, 256, i * 100,
+                                         i * 100 + 10 + i % 5);
+    }
+    std::vector<double> values;
+    std::string error;
+
+    CHECK(derives(monitor, "(end_cycle - start_cycle) * 2 + -(1)", values, error));
+    CHECK(values.size() == 3000);
+    CHECK(values[3] == (10 + 3) * 2 - 1);
+    CHECK(derives(monitor, "max(abs(-(end_cycle - start_cycle)), 1) / len(round_power)",
+                  values, error));
+
+    CHECK(!derives(monitor, "", values, error) && !error.empty());
+    CHECK(!derives(monitor, "(1", values, error));
+    CHECK(!derives(monitor, "no_such_field", values, error));
+    CHECK(!derives(monitor, "1 +", values, error));
+
+    // Nesting within the limit parses; hostile nesting is an error, not a
+    // stack overflow
+    const size_t limit = MetricExpression::kMaxDepth;
+    CHECK(derives(monitor, std::string(limit - 1, '(') + "key_size" + std::string(limit - 1, ')'),
+                  values, error));
+    CHECK(!derives(monitor, std::string(200000, '(') + "1" + std::string(200000, ')'), values,
+                   error));
+    CHECK(error.find("too deeply nested") != std::string::npos);
+    CHECK(!derives(monitor, std::string(200000, '-') + "key_size", values, error));
+    CHECK(!derives(monitor, std::string(200000, '+') + "key_size", values, error));
+    CHECK(!derives(monitor, "max(" + std::string(100000, '(') + "1", values, error));
+
+    // So are long operator chains, which nest through the left operand
+    std::string chain = "key_size";
+    for (int i = 0; i < 100000; ++i) chain += " + key_size";
+    CHECK(!derives(monitor, chain, values, error));
+    chain = "key_size";
+    for (int i = 0; i < 100; ++i) chain += " * key_size";
+    CHECK(derives(monitor, chain, values, error));
+    // Constants fold, whatever their count
+    chain = "1";
+    for (int i = 0; i < 100000; ++i) chain += " + 1";
+    CHECK(derives(monitor, chain, values, error));
+    CHECK(values[0] == 100001.0);
+}
+
+void test_points_of_interest() {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    std::vector<double> scores = {0.5, nan, 3.0, nan, 2.0, 3.0, nan, 0.1, 9.0, nan};
+    CHECK(selectPointsOfInterest(scores, 3) == (std::vector<uint32_t>{8, 2, 5}));
+    CHECK(selectPointsOfInterest(scores, 3, 2) == (std::vector<uint32_t>{8, 2, 5}));
+    CHECK(selectPointsOfInterest(scores, 3, 3) == (std::vector<uint32_t>{8, 2, 5}));
+    CHECK(selectPointsOfInterest(scores, 3, 4) == (std::vector<uint32_t>{8, 2}));
+    // NaN points are never picked, even with slots to spare
+    CHECK(selectPointsOfInterest(scores, 20).size() == 6);
+    CHECK(selectPointsOfInterest(scores, 20, 1).size() == 6);
+    CHECK(selectPointsOfInterest(std::vector<double>(1000, nan), 5).empty());
+
+    // Mostly NaN with a few finite scores, large enough for introsort
+    std::vector<double> mixed(5000, nan);
+    for (size_t i = 0; i < mixed.size(); i += 97) mixed[i] = static_cast<double>(i % 13);
+    std::vector<uint32_t> chosen = selectPointsOfInterest(mixed, 10, 1);
+    CHECK(chosen.size() == 10);
+    for (size_t i = 1; i < chosen.size(); ++i) CHECK(mixed[chosen[i - 1]] >= mixed[chosen[i]]);
+}
+
+void test_principal_components() {
+    // Points 0..11 with variances 12, 11, ..., 1 and no correlation
+    const size_t n = 12;
+    std::vector<double> mean(n, 0.0), covariance(n * n, 0.0);
+    for (size_t i = 0; i < n; ++i) covariance[i * n + i] = static_cast<double>(n - i);
+    PrincipalComponents pca = principalComponents(mean, covariance, 100, 3);
+    CHECK(pca.count() == 3);
+    for (size_t c = 0; c < pca.count(); ++c) {
+        CHECK(std::fabs(pca.eigenvalues[c] - static_cast<double>(n - c)) < 1e-6);
+    }
+
+    // A NaN in the traces reaches the covariance and the Ritz values; the
+    // solver must still return rather than sort with a broken comparator
+    covariance[5 * n + 7] = covariance[7 * n + 5] = std::numeric_limits<double>::quiet_NaN();
+    pca = principalComponents(mean, covariance, 100, 3, 20);
+    CHECK(pca.iterations <= 20);
+}
+
+void test_completed_records() {
+    EnhancedCryptoMonitor monitor;
+    const auto op = CryptoOperation::SHA256_HASH;
+    const uint64_t now = EnhancedCryptoMonitor::get_timestamp();
+    CHECK(monitor.recordCompletedOperation(op, 256, now - 100, now - 60));
+    CHECK(monitor.recordCompletedOperation(op, 256, now - 50, now - 50));
+
+    // Rejected outright rather than wrapping to a ~1.8e19 execution time
+    // or indexing past the per-operation state
+    CHECK(!monitor.recordCompletedOperation(op, 256, now - 10, now - 20));
+    CHECK(!monitor.recordCompletedOperation(
+        static_cast<CryptoOperation>(EnhancedCryptoMonitor::kOperationCount), 256, 0, 1));
+    CHECK(monitor.measurementCount(op) == 2);
+    CHECK(monitor.droppedThreadRecords() == 0);
+
+    WindowStatistics window = monitor.windowStatistics(op, now);
+    CHECK(window.count == 2);
+    CHECK(window.max == 40.0);
+}
+
+}  // namespace
+
+int main() {
+    test_templates();
+    test_sliding_window();
+    test_anomaly_detection();
+    test_alert_rules();
+    test_distribution_shape();
+    test_kernel_density();
+    test_permutation_test();
+    test_metric_expressions();
+    test_points_of_interest();
+    test_principal_components();
+    test_completed_records();
+
+    if (failures) {
+        std::fprintf(stderr, "analysis_test: %d failure(s)\n", failures);
+        return 1;
+    }
+    std::printf("analysis_test: ok\n");
+    return 0;
+}
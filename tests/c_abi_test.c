@@ -0,0 +1,167 @@
+/* c_abi_test.c
+ *
+ * Round trips and argument checking through the C ABI only, linked against
+ * the shared library from build_native.sh. Built and run by run_tests.sh. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "crypto_monitor_c.h"
+
+static int failures = 0;
+
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition)) {                                                   \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,  \
+                    #condition);                                              \
+            ++failures;                                                       \
+        }                                                                     \
+    } while (0)
+
+/* Same execution times, in the same order */
+static int same_times(cm_monitor* a, cm_monitor* b, cm_operation op) {
+    size_t count = cm_copy_execution_times(a, op, NULL, 0);
+    if (cm_copy_execution_times(b, op, NULL, 0) != count) return 0;
+    if (count == 0) return 1;
+    double* left = malloc(count * sizeof(double));
+    double* right = malloc(count * sizeof(double));
+    int same = left && right &&
+               cm_copy_execution_times(a, op, left, count) == count &&
+               cm_copy_execution_times(b, op, right, count) == count &&
+               memcmp(left, right, count * sizeof(double)) == 0;
+    free(left);
+    free(right);
+    return same;
+}
+
+static void populate(cm_monitor* monitor) {
+    for (uint64_t i = 0; i < 5000; ++i) {
+        CHECK(cm_record_completed(monitor, CM_SHA256_HASH, 256, 1000 + i * 50,
+                                  1000 + i * 50 + 20 + i % 9) == CM_OK);
+    }
+    for (uint32_t i = 0; i < 200; ++i) {
+        CHECK(cm_start(monitor, CM_AES_ENCRYPT, 128) == CM_OK);
+        for (uint64_t round = 0; round < 10; ++round) {
+            CHECK(cm_record_round(monitor, CM_AES_ENCRYPT, round) == CM_OK);
+        }
+        CHECK(cm_set_label(monitor, CM_AES_ENCRYPT, i % 2) == CM_OK);
+        CHECK(cm_end(monitor, CM_AES_ENCRYPT) == CM_OK);
+    }
+}
+
+static void test_round_trip(cm_monitor* monitor) {
+    uint8_t* capture = NULL;
+    size_t size = 0;
+    CHECK(cm_serialize(monitor, &capture, &size) == CM_OK);
+    CHECK(capture != NULL && size > 0);
+
+    cm_monitor* loaded = cm_monitor_create();
+    CHECK(loaded != NULL);
+    CHECK(cm_load(loaded, capture, size) == CM_OK);
+    CHECK(cm_copy_execution_times(loaded, CM_SHA256_HASH, NULL, 0) == 5000);
+    CHECK(cm_copy_execution_times(loaded, CM_AES_ENCRYPT, NULL, 0) == 200);
+    CHECK(same_times(monitor, loaded, CM_SHA256_HASH));
+    CHECK(same_times(monitor, loaded, CM_AES_ENCRYPT));
+
+    uint8_t* again = NULL;
+    size_t again_size = 0;
+    CHECK(cm_serialize(loaded, &again, &again_size) == CM_OK);
+    CHECK(again_size == size && memcmp(again, capture, size) == 0);
+    cm_free(again);
+
+    /* Every proper prefix is rejected and leaves the monitor empty */
+    cm_monitor* partial = cm_monitor_create();
+    size_t accepted = 0;
+    for (size_t n = 0; n < size; n += 1 + n / 64) {
+        if (cm_load(partial, capture, n) != CM_ERR_BAD_FORMAT) ++accepted;
+    }
+    CHECK(accepted == 0);
+    CHECK(cm_copy_execution_times(partial, CM_SHA256_HASH, NULL, 0) == 0);
+    cm_monitor_destroy(partial);
+
+    cm_monitor_destroy(loaded);
+    cm_free(capture);
+}
+
+static void test_garbage(void) {
+    cm_monitor* monitor = cm_monitor_create();
+    uint8_t garbage[256];
+    for (size_t i = 0; i < sizeof(garbage); ++i) garbage[i] = (uint8_t)(i * 131 + 7);
+    CHECK(cm_load(monitor, garbage, sizeof(garbage)) == CM_ERR_BAD_FORMAT);
+    CHECK(cm_load(monitor, garbage, 3) == CM_ERR_BAD_FORMAT);
+    CHECK(cm_load(monitor, NULL, 0) == CM_ERR_BAD_FORMAT);
+    cm_monitor_destroy(monitor);
+}
+
+static void test_snapshot(cm_monitor* monitor) {
+    cm_monitor* snapshot = cm_snapshot(monitor);
+    CHECK(snapshot != NULL);
+    CHECK(same_times(monitor, snapshot, CM_SHA256_HASH));
+
+    /* Recording into the source does not show up in the snapshot */
+    CHECK(cm_record_completed(monitor, CM_SHA256_HASH, 256, 10, 30) == CM_OK);
+    CHECK(cm_copy_execution_times(monitor, CM_SHA256_HASH, NULL, 0) == 5001);
+    CHECK(cm_copy_execution_times(snapshot, CM_SHA256_HASH, NULL, 0) == 5000);
+    cm_monitor_destroy(snapshot);
+}
+
+static void test_clear(cm_monitor* monitor) {
+    cm_memory_usage usage;
+    CHECK(cm_memory_stats(monitor, &usage) == CM_OK);
+    CHECK(usage.operations[CM_SHA256_HASH].records == 5001);
+    CHECK(usage.operations[CM_AES_ENCRYPT].records == 200);
+    CHECK(usage.resident_bytes > 0);
+
+    CHECK(cm_clear_all(monitor) == CM_OK);
+    CHECK(cm_memory_stats(monitor, &usage) == CM_OK);
+    for (int op = CM_AES_ENCRYPT; op <= CM_KEY_DERIVATION; ++op) {
+        CHECK(usage.operations[op].records == 0);
+    }
+    CHECK(cm_copy_execution_times(monitor, CM_SHA256_HASH, NULL, 0) == 0);
+}
+
+static void test_invalid_arguments(cm_monitor* monitor) {
+    uint8_t* data = NULL;
+    size_t size = 0;
+    cm_memory_usage usage;
+    CHECK(cm_serialize(NULL, &data, &size) == CM_ERR_INVALID_ARGUMENT);
+    CHECK(cm_serialize(monitor, NULL, &size) == CM_ERR_INVALID_ARGUMENT);
+    CHECK(cm_serialize(monitor, &data, NULL) == CM_ERR_INVALID_ARGUMENT);
+    CHECK(cm_load(NULL, (const uint8_t*)"x", 1) == CM_ERR_INVALID_ARGUMENT);
+    CHECK(cm_load(monitor, NULL, 1) == CM_ERR_INVALID_ARGUMENT);
+    CHECK(cm_start(NULL, CM_AES_ENCRYPT, 128) == CM_ERR_INVALID_ARGUMENT);
+    CHECK(cm_start(monitor, (cm_operation)8, 128) == CM_ERR_INVALID_ARGUMENT);
+    CHECK(cm_record_completed(NULL, CM_AES_ENCRYPT, 128, 0, 1) == CM_ERR_INVALID_ARGUMENT);
+    CHECK(cm_record_completed(monitor, (cm_operation)8, 128, 0, 1) == CM_ERR_INVALID_ARGUMENT);
+    CHECK(cm_record_completed(monitor, CM_AES_ENCRYPT, 128, 20, 10) == CM_ERR_INVALID_ARGUMENT);
+    CHECK(cm_copy_execution_times(monitor, CM_AES_ENCRYPT, NULL, 0) == 0);
+    CHECK(cm_memory_stats(monitor, NULL) == CM_ERR_INVALID_ARGUMENT);
+    CHECK(cm_memory_stats(NULL, &usage) == CM_ERR_INVALID_ARGUMENT);
+    CHECK(cm_clear_all(NULL) == CM_ERR_INVALID_ARGUMENT);
+    CHECK(cm_snapshot(NULL) == NULL);
+    CHECK(cm_copy_execution_times(NULL, CM_AES_ENCRYPT, NULL, 0) == 0);
+    cm_monitor_destroy(NULL);
+    cm_free(NULL);
+}
+
+int main(void) {
+    CHECK(cm_abi_version() == CM_ABI_VERSION);
+
+    cm_monitor* monitor = cm_monitor_create();
+    CHECK(monitor != NULL);
+    populate(monitor);
+    test_round_trip(monitor);
+    test_garbage();
+    test_snapshot(monitor);
+    test_clear(monitor);
+    test_invalid_arguments(monitor);
+    cm_monitor_destroy(monitor);
+
+    if (failures) {
+        fprintf(stderr, "c_abi_test: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("c_abi_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,248 @@
+// capture_test.cpp
+//
+// Capture format round trips and malformed-input handling for
+// EnhancedCryptoMonitor::serializeCapture / loadCapture. Built and run by
+// run_tests.sh.
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../src/wasm/crypto_monitor.h"
+
+namespace {
+
+using CryptoOperation = EnhancedCryptoMonitor::CryptoOperation;
+
+int failures = 0;
+
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition)) {                                                   \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__,       \
+                         __LINE__, #condition);                               \
+            ++failures;                                                       \
+        }                                                                     \
+    } while (0)
+
+size_t total_records(EnhancedCryptoMonitor& monitor) {
+    size_t total = 0;
+    for (size_t i = 0; i < EnhancedCryptoMonitor::kOperationCount; ++i) {
+        total += monitor.measurementCount(static_cast<CryptoOperation>(i));
+    }
+    return total;
+}
+
+// Records with rounds, power samples, labels and RSA vectors, spanning
+// several capture blocks for AES
+void populate(EnhancedCryptoMonitor& monitor) {
+    for (uint32_t i = 0; i < 9000; ++i) {
+        monitor.startOperation(CryptoOperation::AES_ENCRYPT, 128);
+        for (uint64_t round = 0; round < 10; ++round) {
+            monitor.recordRound(CryptoOperation::AES_ENCRYPT, round);
+        }
+        monitor.labelOperation(CryptoOperation::AES_ENCRYPT, i % 2);
+        monitor.endOperation(CryptoOperation::AES_ENCRYPT);
+    }
+    for (uint32_t i = 0; i < 50; ++i) {
+        monitor.startOperation(CryptoOperation::RSA_DECRYPT, 2048);
+        monitor.recordRound(CryptoOperation::RSA_DECRYPT, 0);
+        monitor.endOperation(CryptoOperation::RSA_DECRYPT);
+    }
+    for (uint64_t i = 0; i < 3000; ++i) {
+        monitor.recordCompletedOperation(CryptoOperation::SHA256_HASH, 256,
+                                         1000 + i * 40, 1000 + i * 40 + 25 + i % 7, i % 3);
+    }
+}
+
+void test_round_trip(const std::vector<uint8_t>& capture, const ColumnPolicy& policy) {
+    EnhancedCryptoMonitor loaded;
+    CHECK(loaded.loadCapture(capture.data(), capture.size()));
+    CHECK(loaded.measurementCount(CryptoOperation::AES_ENCRYPT) == 9000);
+    CHECK(loaded.measurementCount(CryptoOperation::RSA_DECRYPT) == 50);
+    CHECK(loaded.measurementCount(CryptoOperation::SHA256_HASH) == 3000);
+    CHECK(loaded.serializeCapture(policy) == capture);
+
+    // Appends rather than replaces
+    CHECK(loaded.loadCapture(capture.data(), capture.size()));
+    CHECK(loaded.measurementCount(CryptoOperation::AES_ENCRYPT) == 18000);
+}
+
+void test_header(const std::vector<uint8_t>& capture) {
+    uint32_t magic;
+    uint16_t version;
+    std::memcpy(&magic, capture.data(), sizeof(magic));
+    std::memcpy(&version, capture.data() + 4, sizeof(version));
+    CHECK(magic == EnhancedCryptoMonitor::kCaptureMagic);
+    CHECK(version == EnhancedCryptoMonitor::kCaptureVersion);
+
+    std::vector<uint8_t> future = capture;
+    uint16_t next = EnhancedCryptoMonitor::kCaptureVersion + 1;
+    std::memcpy(future.data() + 4, &next, sizeof(next));
+    EnhancedCryptoMonitor monitor;
+    CHECK(!monitor.loadCapture(future.data(), future.size()));
+
+    CHECK(monitor.loadCapture(capture.data(), 0) == false);
+}
+
+// A failed load must leave the monitor as it was and never throw
+bool rejected(const std::vector<uint8_t>& bytes) {
+    EnhancedCryptoMonitor monitor;
+    try {
+        if (monitor.loadCapture(bytes.data(), bytes.size())) return false;
+    } catch (...) {
+        return false;
+    }
+    return total_records(monitor) == 0;
+}
+
+void test_truncated(const std::vector<uint8_t>& capture) {
+    size_t bad = 0;
+    for (size_t size = 0; size < capture.size(); ++size) {
+        std::vector<uint8_t> prefix(capture.begin(), capture.begin() + size);
+        if (!rejected(prefix)) ++bad;
+    }
+    CHECK(bad == 0);
+}
+
+struct CaptureBuilder {
+    std::vector<uint8_t> bytes;
+    ByteWriter writer{bytes};
+
+    CaptureBuilder(uint16_t version, uint32_t op_count) {
+        writer.put<uint32_t>(EnhancedCryptoMonitor::kCaptureMagic);
+        writer.put<uint16_t>(version);
+        writer.put<uint16_t>(0);
+        writer.put<uint32_t>(op_count);
+    }
+};
+
+void test_oversized() {
+    // Index claims 2^32-1 records for a 2-byte block
+    {
+        CaptureBuilder b(3, 1);
+        b.writer.put<uint32_t>(0);
+        b.writer.put<uint64_t>(0xFFFFFFFFull);
+        b.writer.put<uint32_t>(1);
+        b.writer.put<uint32_t>(0xFFFFFFFFu);
+        b.writer.put<uint64_t>(2);
+        b.writer.put<uint16_t>(0);
+        CHECK(rejected(b.bytes));
+    }
+    // One more record per block than the format allows
+    {
+        CaptureBuilder b(3, 1);
+        b.writer.put<uint32_t>(0);
+        b.writer.put<uint64_t>(EnhancedCryptoMonitor::kCaptureBlockRecords + 1);
+        b.writer.put<uint32_t>(1);
+        b.writer.put<uint32_t>(EnhancedCryptoMonitor::kCaptureBlockRecords + 1);
+        b.writer.put<uint64_t>(2);
+        b.writer.put<uint16_t>(0);
+        CHECK(rejected(b.bytes));
+    }
+    // Record count that the block's columns do not hold
+    {
+        CaptureBuilder b(3, 1);
+        b.writer.put<uint32_t>(0);
+        b.writer.put<uint64_t>(4096);
+        b.writer.put<uint32_t>(1);
+        b.writer.put<uint32_t>(4096);
+        b.writer.put<uint64_t>(2);
+        b.writer.put<uint16_t>(0);
+        CHECK(rejected(b.bytes));
+    }
+    // More blocks than the index could hold
+    {
+        CaptureBuilder b(3, 1);
+        b.writer.put<uint32_t>(0);
+        b.writer.put<uint64_t>(1);
+        b.writer.put<uint32_t>(0xFFFFFFFFu);
+        CHECK(rejected(b.bytes));
+    }
+    // Column headers with forged sizes: a delta column claiming more words
+    // than it has bytes, and a raw column far larger than its body
+    for (uint8_t codec : {uint8_t(ColumnCodec::DELTA), uint8_t(ColumnCodec::RAW)}) {
+        CaptureBuilder b(3, 1);
+        b.writer.put<uint32_t>(0);
+        b.writer.put<uint64_t>(1);
+        b.writer.put<uint32_t>(1);
+        b.writer.put<uint32_t>(1);
+        b.writer.put<uint64_t>(2 + 1 + 1 + 3 * 8 + 1);
+        b.writer.put<uint16_t>(1);
+        b.writer.put<uint8_t>(codec);
+        b.writer.put<uint8_t>(8);
+        b.writer.put<uint64_t>(uint64_t(1) << 27);
+        b.writer.put<uint64_t>(codec == uint8_t(ColumnCodec::RAW) ? uint64_t(1) << 30 : 1);
+        b.writer.put<uint64_t>(1);
+        b.writer.put<uint8_t>(0);
+        CHECK(rejected(b.bytes));
+    }
+    // Legacy capture claiming far more records than it contains
+    {
+        CaptureBuilder b(2, 1);
+        b.writer.put<uint32_t>(0);
+        b.writer.put<uint64_t>(~uint64_t(0));
+        CHECK(rejected(b.bytes));
+    }
+    // Unknown operation
+    {
+        CaptureBuilder b(3, 1);
+        b.writer.put<uint32_t>(EnhancedCryptoMonitor::kOperationCount);
+        b.writer.put<uint64_t>(0);
+        b.writer.put<uint32_t>(0);
+        CHECK(rejected(b.bytes));
+    }
+}
+
+// Corrupted bytes either decode to something or are rejected; neither may
+// throw or crash
+void test_corrupted(const std::vector<uint8_t>& capture) {
+    std::mt19937 rng(7);
+    size_t threw = 0;
+    for (int iteration = 0; iteration < 300; ++iteration) {
+        std::vector<uint8_t> bytes = capture;
+        // Half the runs hit the header and index, where sizes live
+        size_t span = iteration % 2 ? std::min<size_t>(bytes.size(), 256) : bytes.size();
+        for (int flip = 0; flip < 4; ++flip) bytes[rng() % span] = static_cast<uint8_t>(rng());
+        EnhancedCryptoMonitor monitor;
+        try {
+            monitor.loadCapture(bytes.data(), bytes.size());
+        } catch (...) {
+            ++threw;
+        }
+    }
+    CHECK(threw == 0);
+}
+
+}  // namespace
+
+int main() {
+    EnhancedCryptoMonitor monitor;
+    populate(monitor);
+
+    for (const ColumnPolicy& policy : {ColumnPolicy::dense(), ColumnPolicy::fast(), ColumnPolicy()}) {
+        std::vector<uint8_t> capture = monitor.serializeCapture(policy);
+        test_round_trip(capture, policy);
+        test_corrupted(capture);
+    }
+
+    std::vector<uint8_t> capture = monitor.serializeCapture();
+    test_header(capture);
+    test_oversized();
+
+    EnhancedCryptoMonitor small;
+    for (uint64_t i = 0; i < 40; ++i) {
+        small.recordCompletedOperation(CryptoOperation::AES_DECRYPT, 128, i * 10, i * 10 + 7);
+    }
+    small.startOperation(CryptoOperation::RSA_ENCRYPT, 2048);
+    small.recordRound(CryptoOperation::RSA_ENCRYPT, 0);
+    small.endOperation(CryptoOperation::RSA_ENCRYPT);
+    test_truncated(small.serializeCapture());
+
+    if (failures) {
+        std::fprintf(stderr, "capture_test: %d failure(s)\n", failures);
+        return 1;
+    }
+    std::printf("capture_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,153 @@
+// fork_test.cpp
+//
+// The per-thread recording path across thread exit, monitor teardown and
+// fork(): every record is drained exactly once, the buffers of exited
+// threads are freed, and a forked child keeps recording and reading its
+// spilled blocks without the parent's writer thread. Built and run by
+// run_tests.sh, plain and under the sanitizers; leaks show up there.
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/wasm/crypto_monitor.h"
+
+namespace {
+
+using CryptoOperation = EnhancedCryptoMonitor::CryptoOperation;
+
+int failures = 0;
+
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition)) {                                                   \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__,       \
+                         __LINE__, #condition);                               \
+            ++failures;                                                       \
+        }                                                                     \
+    } while (0)
+
+void record(EnhancedCryptoMonitor& monitor, uint64_t count) {
+    for (uint64_t i = 0; i < count; ++i) {
+        monitor.recordCompletedOperation(CryptoOperation::SHA256_HASH, 256, i * 100,
+                                         i * 100 + 20 + i % 7);
+    }
+}
+
+// Short-lived threads, drained while others are still starting and exiting
+void test_thread_churn() {
+    EnhancedCryptoMonitor monitor;
+    const int kRounds = 20, kThreads = 16, kRecords = 500;
+    for (int round = 0; round < kRounds; ++round) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&monitor] { record(monitor, kRecords); });
+        }
+        monitor.drainThreadBuffers();
+        for (auto& thread : threads) thread.join();
+    }
+    CHECK(monitor.measurementCount(CryptoOperation::SHA256_HASH) ==
+          static_cast<size_t>(kRounds) * kThreads * kRecords);
+    CHECK(monitor.droppedThreadRecords() == 0);
+}
+
+// Monitors destroyed while threads that recorded into them are still
+// alive; those threads free their side on exit, or when they next record
+// into another monitor
+void test_monitor_teardown() {
+    const int kThreads = 8;
+    for (int generation = 0; generation < 10; ++generation) {
+        auto* monitor = new EnhancedCryptoMonitor();
+        std::atomic<int> recorded{0};
+        std::atomic<bool> destroyed{false};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&, monitor] {
+                record(*monitor, 100);
+                ++recorded;
+                while (!destroyed) std::this_thread::yield();
+                if (generation % 2) {
+                    EnhancedCryptoMonitor next;
+                    record(next, 10);
+                }
+            });
+        }
+        while (recorded < kThreads) std::this_thread::yield();
+        CHECK(monitor->measurementCount(CryptoOperation::SHA256_HASH) ==
+              static_cast<size_t>(kThreads) * 100);
+        delete monitor;
+        destroyed = true;
+        for (auto& thread : threads) thread.join();
+    }
+}
+
+// What libcrypto_interposer's pthread_atfork handlers do, with a recording
+// thread running and blocks spilled to disk when the fork happens
+int run_child(EnhancedCryptoMonitor& monitor, size_t before) {
+    monitor.afterFork(true);
+    record(monitor, 1000);
+    // Plus whatever the recording thread had buffered when the fork came
+    size_t count = monitor.measurementCount(CryptoOperation::SHA256_HASH);
+    CHECK(count >= before + 1000);
+    CHECK(monitor.collectExecutionTimes(CryptoOperation::SHA256_HASH).size() == count);
+    CHECK(!monitor.enableSpill("/tmp/fork_test_child_spill", 1));
+    CHECK(monitor.spillStats().read_errors == 0);
+    return failures ? 1 : 0;
+}
+
+void test_fork() {
+    auto* monitor = new EnhancedCryptoMonitor();
+    std::string path = "/tmp/fork_test_spill_" + std::to_string(getpid());
+    CHECK(monitor->enableSpill(path, 64 * 1024));
+    for (int chunk = 0; chunk < 5; ++chunk) {
+        record(*monitor, 10000);  // well inside one thread buffer
+        monitor->drainThreadBuffers();
+    }
+    CHECK(monitor->measurementCount(CryptoOperation::SHA256_HASH) == 50000);
+    CHECK(monitor->spillStats().spilled_blocks > 0);
+
+    std::thread recorder([monitor] { record(*monitor, 20000); });
+    for (int i = 0; i < 3; ++i) {
+        size_t before = monitor->measurementCount(CryptoOperation::SHA256_HASH);
+        monitor->prepareFork();
+        pid_t pid = fork();
+        if (pid == 0) {
+            int status = run_child(*monitor, before);
+            // Destroying the monitor must not wait on the parent's writer
+            delete monitor;
+            std::exit(status);
+        }
+        monitor->afterFork(false);
+        CHECK(pid > 0);
+        int status = 0;
+        CHECK(waitpid(pid, &status, 0) == pid);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    recorder.join();
+
+    CHECK(monitor->measurementCount(CryptoOperation::SHA256_HASH) == 70000);
+    CHECK(monitor->collectExecutionTimes(CryptoOperation::SHA256_HASH).size() == 70000);
+    CHECK(monitor->droppedThreadRecords() == 0);
+    CHECK(monitor->spillStats().read_errors == 0);
+    delete monitor;
+}
+
+}  // namespace
+
+int main() {
+    test_thread_churn();
+    test_monitor_teardown();
+    test_fork();
+
+    if (failures) {
+        std::fprintf(stderr, "fork_test: %d failure(s)\n", failures);
+        return 1;
+    }
+    std::printf("fork_test: ok\n");
+    return 0;
+}
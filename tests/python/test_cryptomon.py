@@ -0,0 +1,119 @@
+"""Capture round-trip, error and threading tests for the cryptomon module.
+
+Captures are recorded through the C ABI (libcryptomonitor via ctypes), so
+build_native.sh and build_python.sh must both have run. Run by
+run_tests.sh when the module has been built.
+"""
+import ctypes
+import os
+import sys
+import tempfile
+import threading
+import unittest
+
+NATIVE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "dist", "native")
+sys.path.insert(0, NATIVE)
+
+import cryptomon  # noqa: E402
+
+CM_AES_ENCRYPT = 0
+CM_SHA256_HASH = 6
+
+
+def record_capture():
+    lib = ctypes.CDLL(os.path.join(NATIVE, "libcryptomonitor.so"))
+    lib.cm_monitor_create.restype = ctypes.c_void_p
+    lib.cm_monitor_destroy.argtypes = [ctypes.c_void_p]
+    lib.cm_record_completed.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_uint64,
+                                        ctypes.c_uint64, ctypes.c_uint64]
+    lib.cm_start.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_uint64]
+    lib.cm_set_label.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_uint32]
+    lib.cm_end.argtypes = [ctypes.c_void_p, ctypes.c_int]
+    lib.cm_serialize.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_void_p),
+                                 ctypes.POINTER(ctypes.c_size_t)]
+    lib.cm_free.argtypes = [ctypes.c_void_p]
+
+    monitor = lib.cm_monitor_create()
+    try:
+        for i in range(3000):
+            start = 1000 + i * 50
+            assert lib.cm_record_completed(monitor, CM_SHA256_HASH, 256, start, start + 20 + i % 9) == 0
+        for i in range(100):
+            assert lib.cm_start(monitor, CM_AES_ENCRYPT, 128) == 0
+            assert lib.cm_set_label(monitor, CM_AES_ENCRYPT, i % 2) == 0
+            assert lib.cm_end(monitor, CM_AES_ENCRYPT) == 0
+        data = ctypes.c_void_p()
+        size = ctypes.c_size_t()
+        assert lib.cm_serialize(monitor, ctypes.byref(data), ctypes.byref(size)) == 0
+        try:
+            return ctypes.string_at(data, size.value)
+        finally:
+            lib.cm_free(data)
+    finally:
+        lib.cm_monitor_destroy(monitor)
+
+
+class CaptureTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        cls.capture = record_capture()
+
+    def test_from_bytes(self):
+        capture = cryptomon.Capture.from_bytes(self.capture)
+        self.assertEqual(capture.operations(), {"SHA256_HASH": 3000, "AES_ENCRYPT": 100})
+        columns = capture.columns("SHA256_HASH")
+        self.assertEqual(len(columns), 3000)
+        self.assertEqual(list(columns.execution_time[:3]), [20.0, 21.0, 22.0])
+        self.assertEqual(capture.timing("SHA256_HASH")["statistics"]["count"], 3000)
+
+    def test_save_and_load(self):
+        capture = cryptomon.Capture.from_bytes(self.capture)
+        with tempfile.TemporaryDirectory() as directory:
+            path = os.path.join(directory, "capture.bin")
+            capture.save(path)
+            with open(path, "rb") as f:
+                self.assertEqual(f.read(), self.capture)
+            loaded = cryptomon.Capture.load(path)
+            loaded.append_file(path)
+        self.assertEqual(loaded.operations()["SHA256_HASH"], 6000)
+
+    def test_shared_between_threads(self):
+        # Calls release the GIL, so the capture must serialize them itself:
+        # readers only ever see whole appended captures
+        capture = cryptomon.Capture.from_bytes(self.capture)
+        errors = []
+
+        def read():
+            try:
+                for _ in range(20):
+                    self.assertEqual(len(capture.columns("AES_ENCRYPT")) % 100, 0)
+                    capture.timing("SHA256_HASH")
+                    capture.tvla("AES_ENCRYPT")
+            except Exception as e:  # noqa: BLE001
+                errors.append(e)
+
+        with tempfile.TemporaryDirectory() as directory:
+            path = os.path.join(directory, "capture.bin")
+            with open(path, "wb") as f:
+                f.write(self.capture)
+            readers = [threading.Thread(target=read) for _ in range(3)]
+            for reader in readers:
+                reader.start()
+            for _ in range(10):
+                capture.append_file(path)
+            for reader in readers:
+                reader.join()
+        self.assertEqual(errors, [])
+        self.assertEqual(capture.operations()["AES_ENCRYPT"], 1100)
+
+    def test_malformed(self):
+        for data in (b"", b"\x00" * 3, bytes(range(256)), self.capture[: len(self.capture) // 2]):
+            with self.assertRaises(RuntimeError):
+                cryptomon.Capture.from_bytes(data)
+        capture = cryptomon.Capture.from_bytes(self.capture)
+        with self.assertRaises(ValueError):
+            capture.columns("NOT_AN_OPERATION")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -6,7 +6,10 @@ module.exports = {
   devtool: false,  
   entry: {
     popup: './popup.js',
-    background: './background.js'
+    background: './background.js',
+    monitor_host: './src/offscreen/monitor_host.js',
+    webcrypto_hook: './src/content/webcrypto_hook.js',
+    webcrypto_relay: './src/content/webcrypto_relay.js'
   },
   output: {
     path: path.resolve(__dirname, 'dist'),
@@ -50,6 +53,12 @@ module.exports = {
         { 
           from: "dist/crypto_monitor.wasm",
           to: "crypto_monitor.wasm"
+        },
+        {
+          // Loaded with importScripts by the monitor worker
+          from: "dist/crypto_monitor.js",
+          to: "crypto_monitor.js",
+          noErrorOnMissing: true
         }
       ],
     }),